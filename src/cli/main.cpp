@@ -25,7 +25,8 @@ void PrintUsage(const char* prog) {
         << "  " << prog << " vm shutdown <id>\n"
         << "  " << prog << " vm rm <id>\n"
         << "  " << prog << " vm console <id>\n"
-        << "  " << prog << " vm logs <id> [--lines N]\n";
+        << "  " << prog << " vm logs <id> [--lines N]\n"
+        << "  " << prog << " vm stats <id>\n";
 }
 
 int PrintResponse(const tenbox::client::Response& response) {
@@ -160,6 +161,9 @@ int main(int argc, char** argv) {
         if (!follow || rc != 0) return rc;
         return client.FollowLogs(argv[3]);
     }
+    if (cmd == "stats" && argc >= 4) {
+        return PrintResponse(client.Request({{"type", "vm.stats"}, {"vm_id", argv[3]}}));
+    }
 
     PrintUsage(argv[0]);
     return 2;
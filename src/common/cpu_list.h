@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linux-style CPU list ("0-3,8,10-11"), as used by cpuset.cpus and
+// taskset -c. Shared by tenboxd (placement policy) and the runtime
+// (thread affinity) so both sides agree on the syntax.
+
+// Parse |text| into a sorted, de-duplicated CPU index list. Returns false on
+// malformed input. An empty string parses to an empty list.
+inline bool ParseCpuList(const std::string& text, std::vector<uint32_t>* out) {
+    std::vector<uint32_t> cpus;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t comma = text.find(',', pos);
+        if (comma == std::string::npos) comma = text.size();
+        const std::string item = text.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (item.empty()) return false;
+
+        auto parse_num = [](const std::string& s, uint32_t* v) {
+            if (s.empty() || s.size() > 5) return false;
+            uint32_t n = 0;
+            for (char c : s) {
+                if (c < '0' || c > '9') return false;
+                n = n * 10 + static_cast<uint32_t>(c - '0');
+            }
+            *v = n;
+            return true;
+        };
+
+        const size_t dash = item.find('-');
+        uint32_t lo = 0, hi = 0;
+        if (dash == std::string::npos) {
+            if (!parse_num(item, &lo)) return false;
+            hi = lo;
+        } else {
+            if (!parse_num(item.substr(0, dash), &lo) ||
+                !parse_num(item.substr(dash + 1), &hi) || hi < lo) {
+                return false;
+            }
+        }
+        for (uint32_t c = lo; c <= hi; ++c) cpus.push_back(c);
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    *out = std::move(cpus);
+    return true;
+}
+
+// Inverse of ParseCpuList; collapses consecutive runs into ranges.
+inline std::string FormatCpuList(std::vector<uint32_t> cpus) {
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    std::string out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!out.empty()) out.push_back(',');
+        out += std::to_string(cpus[i]);
+        if (j > i) out += "-" + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return out;
+}
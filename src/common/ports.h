@@ -53,6 +53,18 @@ struct DisplayFrame {
     const uint8_t* pixel_ref = nullptr;
     size_t pixel_ref_size = 0;
     std::vector<uint8_t> pixels;
+
+    // The device already rendered this rect into the surface handed out by
+    // DisplayPort::AcquireScanoutSurface(); only the metadata is new.
+    bool in_surface = false;
+};
+
+// Host memory the display side lets the device render the scanout into
+// directly, laid out as resource_height rows of `stride` bytes.
+struct DisplaySurface {
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    uint32_t stride = 0;
 };
 
 struct CursorInfo {
@@ -73,6 +85,12 @@ public:
     virtual void SubmitFrame(DisplayFrame frame) = 0;
     virtual void SubmitCursor(const CursorInfo& cursor) = 0;
     virtual void SubmitScanoutState(bool active, uint32_t width, uint32_t height) = 0;
+    // Optional: a surface of |width| x |height| BGRA pixels that stays valid
+    // until a frame of a different size is submitted. Empty when the port
+    // has none, in which case every frame is copied out of the device.
+    virtual DisplaySurface AcquireScanoutSurface(uint32_t /*width*/, uint32_t /*height*/) {
+        return {};
+    }
 };
 
 struct AudioChunk {
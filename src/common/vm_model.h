@@ -228,6 +228,10 @@ struct SharedFolder {
     std::string tag;        // virtiofs mount tag (e.g., "share")
     std::string host_path;  // host directory path
     bool readonly = false;
+    std::string cache = "auto";  // guest cache policy: "none", "auto" or "always"
+    bool writeback = false;      // guest buffers writes (host must not write the tree)
+    uint64_t iops_limit = 0;     // requests per second, 0 = unlimited
+    uint64_t bps_limit = 0;      // READ + WRITE bytes per second, 0 = unlimited
 };
 
 enum class VmPowerState : uint8_t {
@@ -238,6 +242,21 @@ enum class VmPowerState : uint8_t {
     kCrashed = 4,
 };
 
+// Host CPU placement for a VM's runtime threads. Resolved by tenboxd at start
+// time into --vcpu-cpus / --io-cpus / --vcpu-fifo runtime flags plus an
+// optional cgroup v2 cpu.max limit on the whole runtime process.
+struct CpuPlacement {
+    std::string vcpu_cpus;        // CPU list ("4-7"), "auto" (tenboxd picks free cores), or empty
+    std::string io_cpus;          // CPU list for device threads; empty = tenboxd housekeeping set
+    int vcpu_fifo_priority = 0;   // SCHED_FIFO priority for vCPU threads; 0 = normal scheduling
+    uint32_t cpu_quota_pct = 0;   // cgroup v2 cpu.max in percent of one CPU; 0 = unlimited
+
+    bool IsDefault() const {
+        return vcpu_cpus.empty() && io_cpus.empty() &&
+               vcpu_fifo_priority == 0 && cpu_quota_pct == 0;
+    }
+};
+
 struct VmSpec {
     std::string name;
     std::string vm_id;       // UUID derived from directory name
@@ -254,6 +273,10 @@ struct VmSpec {
     std::vector<HostForward> host_forwards;
     std::vector<GuestForward> guest_forwards;
     std::vector<SharedFolder> shared_folders;
+    // Upper bound of the adaptive halt-poll window in ns (0 disables).
+    // Unset = runtime default.
+    std::optional<uint32_t> halt_poll_max_ns;
+    CpuPlacement placement;
     int64_t creation_time = 0;   // Unix timestamp (seconds since epoch), 0 = not set
     int64_t last_boot_time = 0;  // Unix timestamp when VM was last started
 };
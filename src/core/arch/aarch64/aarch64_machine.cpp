@@ -1,6 +1,7 @@
 #include "core/arch/aarch64/aarch64_machine.h"
 #include "core/arch/aarch64/fdt_builder.h"
 #include "core/device/irq/gicv3.h"
+#include "core/util/mapped_file.h"
 #include "core/vmm/vm.h"
 #include <cinttypes>
 #include <cstring>
@@ -44,13 +45,13 @@ bool Aarch64Machine::SetupPlatformDevices(
     uart_.SetTxCallback([this](uint8_t byte) {
         tx_batcher_->Append(&byte, 1);
     });
-    addr_space.AddMmioDevice(kUartBase, Pl011::kMmioSize, &uart_);
+    addr_space.AddMmioDevice(kUartBase, Pl011::kMmioSize, &uart_, "pl011");
 
     // PL031 RTC
     rtc_.SetIrqLevelCallback([this](bool asserted) {
         SetIrqLevel(hv_vm_, kRtcIrq, asserted);
     });
-    addr_space.AddMmioDevice(kRtcBase, Pl031Rtc::kMmioSize, &rtc_);
+    addr_space.AddMmioDevice(kRtcBase, Pl031Rtc::kMmioSize, &rtc_, "pl031");
 
     // Register software GICv3 MMIO if HVF GIC is not available
 #ifdef __APPLE__
@@ -92,56 +93,39 @@ bool Aarch64Machine::LoadKernel(
     uint64_t initrd_size = 0;
 
     if (!config.initrd_path.empty()) {
-        FILE* fp = fopen(config.initrd_path.c_str(), "rb");
-        if (!fp) {
+        MappedFile initrd;
+        if (!initrd.Open(config.initrd_path)) {
             LOG_ERROR("aarch64: cannot open initrd: %s", config.initrd_path.c_str());
             return false;
         }
-        fseek(fp, 0, SEEK_END);
-        long sz = ftell(fp);
-        fseek(fp, 0, SEEK_SET);
-
-        if (sz <= 0) {
+        if (initrd.size() == 0) {
             LOG_ERROR("aarch64: initrd is empty");
-            fclose(fp);
             return false;
         }
-        initrd_size = static_cast<uint64_t>(sz);
+        initrd_size = initrd.size();
 
         // Place initrd after kernel's reserved region, aligned to page boundary.
         // Must use image_size (not file size) — the kernel expands BSS/init in-place.
+        // The Image header is read back from guest RAM, where LoadLinuxImage
+        // just put it, rather than reopening the kernel file.
         uint64_t text_offset = kernel_entry_ - Layout::kRamBase;
-        uint64_t kernel_reserved_end = text_offset;
-        {
-            FILE* kfp = fopen(config.kernel_path.c_str(), "rb");
-            if (kfp) {
-                LinuxImageHeader hdr{};
-                if (fread(&hdr, sizeof(hdr), 1, kfp) == 1 && hdr.image_size > 0) {
-                    kernel_reserved_end = text_offset + hdr.image_size;
-                } else {
-                    fseek(kfp, 0, SEEK_END);
-                    kernel_reserved_end = text_offset + static_cast<uint64_t>(ftell(kfp));
-                }
-                fclose(kfp);
+        LinuxImageHeader hdr{};
+        memcpy(&hdr, mem.base + text_offset, sizeof(hdr));
+        uint64_t kernel_reserved_end = text_offset + hdr.image_size;
+        if (hdr.image_size == 0) {
+            MappedFile kernel;
+            if (kernel.Open(config.kernel_path)) {
+                kernel_reserved_end = text_offset + kernel.size();
             }
         }
 
         uint64_t initrd_offset = AlignUp(kernel_reserved_end, kPageSize);
         if (initrd_offset + initrd_size > mem.alloc_size) {
             LOG_ERROR("aarch64: initrd doesn't fit in guest RAM");
-            fclose(fp);
             return false;
         }
 
-        uint8_t* dest = mem.base + initrd_offset;
-        size_t read = fread(dest, 1, static_cast<size_t>(initrd_size), fp);
-        fclose(fp);
-
-        if (read != static_cast<size_t>(initrd_size)) {
-            LOG_ERROR("aarch64: short initrd read (%zu / %" PRIu64 ")", read,
-                      initrd_size);
-            return false;
-        }
+        initrd.CopyTo(mem.base + initrd_offset, 0, initrd_size);
 
         initrd_start = Layout::kRamBase + initrd_offset;
         initrd_end = initrd_start + initrd_size;
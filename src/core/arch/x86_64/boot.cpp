@@ -1,27 +1,19 @@
 #include "core/arch/x86_64/boot.h"
 #include "core/arch/x86_64/acpi.h"
-#include <fstream>
+#include "core/util/mapped_file.h"
 #include <cstring>
 #include <algorithm>
 
 namespace x86 {
 
-static std::vector<uint8_t> ReadFile(const std::string& path) {
-    std::ifstream f(path, std::ios::binary | std::ios::ate);
-    if (!f) return {};
-    auto size = f.tellg();
-    f.seekg(0);
-    std::vector<uint8_t> buf(static_cast<size_t>(size));
-    f.read(reinterpret_cast<char*>(buf.data()), size);
-    return buf;
-}
-
 uint64_t LoadLinuxKernel(const BootConfig& config) {
     const auto& mem = config.mem;
     uint8_t* ram = mem.base;
 
-    auto kernel = ReadFile(config.kernel_path);
-    if (kernel.size() < 1024) {
+    // Images are mapped rather than read so each byte is copied exactly
+    // once, from the page cache straight into guest RAM.
+    MappedFile kernel;
+    if (!kernel.Open(config.kernel_path) || kernel.size() < 1024) {
         LOG_ERROR("Kernel file too small or not found: %s",
                   config.kernel_path.c_str());
         return 0;
@@ -33,8 +25,8 @@ uint64_t LoadLinuxKernel(const BootConfig& config) {
         return 0;
     }
 
-    uint16_t version = *reinterpret_cast<uint16_t*>(
-        kernel.data() + BootOffset::kVersion);
+    uint16_t version = 0;
+    memcpy(&version, kernel.data() + BootOffset::kVersion, sizeof(version));
     LOG_INFO("Linux boot protocol version: %d.%d",
              version >> 8, version & 0xFF);
 
@@ -43,10 +35,14 @@ uint64_t LoadLinuxKernel(const BootConfig& config) {
         return 0;
     }
 
-    uint8_t setup_sects = kernel[BootOffset::kSetupSects];
+    uint8_t setup_sects = kernel.data()[BootOffset::kSetupSects];
     if (setup_sects == 0) setup_sects = 4;
 
     uint32_t setup_size = (1 + setup_sects) * 512;
+    if (setup_size >= kernel.size()) {
+        LOG_ERROR("Invalid bzImage: setup (%u bytes) exceeds file size", setup_size);
+        return 0;
+    }
     uint32_t kernel_size = static_cast<uint32_t>(kernel.size()) - setup_size;
 
     if (Layout::kKernelBase + kernel_size > mem.low_size) {
@@ -55,7 +51,7 @@ uint64_t LoadLinuxKernel(const BootConfig& config) {
     }
 
     // Copy protected-mode kernel to 1MB
-    memcpy(ram + Layout::kKernelBase, kernel.data() + setup_size, kernel_size);
+    kernel.CopyTo(ram + Layout::kKernelBase, setup_size, kernel_size);
     LOG_INFO("Kernel loaded at GPA 0x%" PRIX64 " (%u bytes)",
              (uint64_t)Layout::kKernelBase, kernel_size);
 
@@ -89,12 +85,16 @@ uint64_t LoadLinuxKernel(const BootConfig& config) {
     // Load initrd — always place in low RAM so the 32-bit ramdisk_image
     // field in boot_params can represent the address.
     if (!config.initrd_path.empty()) {
-        auto initrd = ReadFile(config.initrd_path);
-        if (initrd.empty()) {
+        MappedFile initrd;
+        if (!initrd.Open(config.initrd_path) || initrd.size() == 0) {
             LOG_ERROR("Failed to read initrd: %s", config.initrd_path.c_str());
             return 0;
         }
 
+        if (initrd.size() >= mem.low_size) {
+            LOG_ERROR("Not enough RAM for initrd (%zu bytes)", initrd.size());
+            return 0;
+        }
         uint64_t initrd_addr = AlignDown(
             mem.low_size - initrd.size(), kPageSize);
 
@@ -103,7 +103,7 @@ uint64_t LoadLinuxKernel(const BootConfig& config) {
             return 0;
         }
 
-        memcpy(ram + initrd_addr, initrd.data(), initrd.size());
+        initrd.CopyTo(ram + initrd_addr, 0, initrd.size());
 
         *reinterpret_cast<uint32_t*>(bp + BootOffset::kRamdiskImage) =
             static_cast<uint32_t>(initrd_addr);
@@ -41,49 +41,50 @@ bool X86Machine::SetupPlatformDevices(
         tx_batcher_->Append(&byte, 1);
     });
     addr_space.AddPioDevice(
-        Uart16550::kCom1Base, Uart16550::kRegCount, &uart_);
+        Uart16550::kCom1Base, Uart16550::kRegCount, &uart_, "uart");
 
     pit_.SetIrqCallback([this]() { irq_injector_(0); });
     pit_.SetIoLoop(io_loop);
     addr_space.AddPioDevice(
-        I8254Pit::kBasePort, I8254Pit::kRegCount, &pit_);
+        I8254Pit::kBasePort, I8254Pit::kRegCount, &pit_, "pit");
     sys_ctrl_b_.SetPit(&pit_);
     addr_space.AddPioDevice(
-        SystemControlB::kPort, SystemControlB::kRegCount, &sys_ctrl_b_);
+        SystemControlB::kPort, SystemControlB::kRegCount, &sys_ctrl_b_,
+        "sysctrl-b");
 
     addr_space.AddPioDevice(
-        CmosRtc::kBasePort, CmosRtc::kRegCount, &rtc_);
+        CmosRtc::kBasePort, CmosRtc::kRegCount, &rtc_, "cmos");
 
     addr_space.AddMmioDevice(
-        IoApic::kBaseAddress, IoApic::kSize, &ioapic_);
+        IoApic::kBaseAddress, IoApic::kSize, &ioapic_, "ioapic");
 
     lapic_.SetIrqInjectCallback([hv_vm](uint32_t vector, uint32_t cpu) {
         hv_vm->QueueInterrupt(vector, cpu);
     });
     lapic_.SetIoLoop(io_loop);
     addr_space.AddMmioDevice(
-        LocalApic::kBaseAddress, LocalApic::kSize, &lapic_);
+        LocalApic::kBaseAddress, LocalApic::kSize, &lapic_, "lapic");
     lapic_.Start();
 
     acpi_pm_.SetShutdownCallback(std::move(shutdown_cb));
     acpi_pm_.SetResetCallback(std::move(reboot_cb));
     acpi_pm_.SetSciCallback([this]() { irq_injector_(9); });
     addr_space.AddPioDevice(
-        AcpiPm::kBasePort, AcpiPm::kRegCount, &acpi_pm_);
+        AcpiPm::kBasePort, AcpiPm::kRegCount, &acpi_pm_, "acpi-pm");
 
     addr_space.AddPioDevice(
-        I8259Pic::kMasterBase, I8259Pic::kRegCount, &pic_master_);
+        I8259Pic::kMasterBase, I8259Pic::kRegCount, &pic_master_, "pic");
     addr_space.AddPioDevice(
-        I8259Pic::kSlaveBase, I8259Pic::kRegCount, &pic_slave_);
+        I8259Pic::kSlaveBase, I8259Pic::kRegCount, &pic_slave_, "pic");
     addr_space.AddPioDevice(
-        PciHostBridge::kBasePort, PciHostBridge::kRegCount, &pci_host_);
-
-    addr_space.AddPioDevice(0x80,  1, &port_sink_);
-    addr_space.AddPioDevice(0x87,  1, &port_sink_);
-    addr_space.AddPioDevice(0x2E8, 8, &port_sink_);
-    addr_space.AddPioDevice(0x2F8, 8, &port_sink_);
-    addr_space.AddPioDevice(0x3E8, 8, &port_sink_);
-    addr_space.AddPioDevice(0xC000, 0x1000, &port_sink_);
+        PciHostBridge::kBasePort, PciHostBridge::kRegCount, &pci_host_, "pci");
+
+    addr_space.AddPioDevice(0x80,  1, &port_sink_, "sink");
+    addr_space.AddPioDevice(0x87,  1, &port_sink_, "sink");
+    addr_space.AddPioDevice(0x2E8, 8, &port_sink_, "sink");
+    addr_space.AddPioDevice(0x2F8, 8, &port_sink_, "sink");
+    addr_space.AddPioDevice(0x3E8, 8, &port_sink_, "sink");
+    addr_space.AddPioDevice(0xC000, 0x1000, &port_sink_, "sink");
 
     return true;
 }
@@ -49,10 +49,10 @@ void SoftGic::RegisterVCpuKick(uint32_t cpu, VCpuKickFn fn) {
 void SoftGic::RegisterDevices(AddressSpace& addr_space,
                               uint64_t dist_base, uint64_t redist_base) {
     redist_base_ = redist_base;
-    addr_space.AddMmioDevice(dist_base, kGicdSize, &dist_dev_);
+    addr_space.AddMmioDevice(dist_base, kGicdSize, &dist_dev_, "gicd");
     for (uint32_t i = 0; i < cpu_count_; i++) {
         uint64_t base = redist_base + static_cast<uint64_t>(i) * kGicrSizePerCpu;
-        addr_space.AddMmioDevice(base, kGicrSizePerCpu, &redist_devs_[i]);
+        addr_space.AddMmioDevice(base, kGicrSizePerCpu, &redist_devs_[i], "gicr");
     }
 }
 
@@ -1,6 +1,10 @@
 #include "core/device/virtio/virtio_fs.h"
+#include "core/util/thread_policy.h"
 #include "core/vmm/types.h"
 #include <algorithm>
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
 
 #ifdef _WIN32
@@ -38,6 +42,9 @@ static std::string WideToUtf8(const std::wstring& wide) {
 #endif
 #include <sys/statvfs.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
 #endif
 
 // Platform path separator
@@ -50,12 +57,271 @@ static constexpr char kPathSep = '/';
 // Virtual root inode number
 constexpr uint64_t VIRTUAL_ROOT_INODE = 1;
 
-VirtioFsDevice::VirtioFsDevice(const std::string& mount_tag)
-    : mount_tag_(mount_tag) {
+bool ParseFsCachePolicy(const std::string& name, FsCachePolicy* out) {
+    if (name == "none") {
+        *out = FsCachePolicy::kNone;
+    } else if (name == "auto") {
+        *out = FsCachePolicy::kAuto;
+    } else if (name == "always") {
+        *out = FsCachePolicy::kAlways;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* FsCachePolicyName(FsCachePolicy policy) {
+    switch (policy) {
+    case FsCachePolicy::kNone: return "none";
+    case FsCachePolicy::kAlways: return "always";
+    default: return "auto";
+    }
+}
+
+bool ParseFsRate(const std::string& text, uint64_t* out) {
+    if (text.empty() || text[0] < '0' || text[0] > '9') return false;
+    char* end = nullptr;
+    errno = 0;
+    uint64_t value = std::strtoull(text.c_str(), &end, 10);
+    if (errno != 0) return false;
+    uint64_t scale = 1;
+    switch (*end) {
+    case '\0': break;
+    case 'k': case 'K': scale = 1ull << 10; ++end; break;
+    case 'm': case 'M': scale = 1ull << 20; ++end; break;
+    case 'g': case 'G': scale = 1ull << 30; ++end; break;
+    default: return false;
+    }
+    if (*end != '\0' || value > UINT64_MAX / scale) return false;
+    *out = value * scale;
+    return true;
+}
+
+static uint64_t SteadyNowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+FsShareIo::FsShareIo(const FsShareLimits& limits)
+    : limits_(limits),
+      op_tokens_(static_cast<double>(limits.iops)),
+      byte_tokens_(static_cast<double>(limits.bytes_per_sec)),
+      refill_ns_(SteadyNowNs()) {
+}
+
+uint64_t FsShareIo::Admit(uint32_t opcode, uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.ops++;
+    if (opcode == FUSE_READ) {
+        stats_.read_ops++;
+        stats_.read_bytes += bytes;
+    } else if (opcode == FUSE_WRITE) {
+        stats_.write_ops++;
+        stats_.write_bytes += bytes;
+    }
+    if (!limits_.iops && !limits_.bytes_per_sec) return 0;
+
+    // Refill both buckets up to one second of budget, then charge the
+    // request. A negative balance is the time it has to wait.
+    uint64_t now = SteadyNowNs();
+    double elapsed = (now - refill_ns_) / 1e9;
+    refill_ns_ = now;
+    double delay = 0;
+    if (limits_.iops) {
+        double rate = static_cast<double>(limits_.iops);
+        op_tokens_ = std::min(rate, op_tokens_ + elapsed * rate) - 1;
+        if (op_tokens_ < 0) delay = std::max(delay, -op_tokens_ / rate);
+    }
+    if (limits_.bytes_per_sec) {
+        double rate = static_cast<double>(limits_.bytes_per_sec);
+        byte_tokens_ = std::min(rate, byte_tokens_ + elapsed * rate) - static_cast<double>(bytes);
+        if (byte_tokens_ < 0) delay = std::max(delay, -byte_tokens_ / rate);
+    }
+    uint64_t delay_ns = static_cast<uint64_t>(delay * 1e9);
+    if (delay_ns) {
+        stats_.throttled++;
+        stats_.throttled_ns += delay_ns;
+    }
+    return delay_ns;
+}
+
+void FsShareIo::SetLimits(const FsShareLimits& limits) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    limits_ = limits;
+    // Start the new limits with a full bucket and no carried-over debt.
+    op_tokens_ = static_cast<double>(limits.iops);
+    byte_tokens_ = static_cast<double>(limits.bytes_per_sec);
+    refill_ns_ = SteadyNowNs();
+}
+
+FsShareStats FsShareIo::Read() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FsShareStats stats = stats_;
+    stats.limits = limits_;
+    return stats;
+}
+
+// Entry and attribute timeout, in seconds, handed to the guest for inodes
+// of a share with |policy|.
+static uint64_t CacheTimeout(FsCachePolicy policy) {
+    switch (policy) {
+    case FsCachePolicy::kNone: return 0;
+    case FsCachePolicy::kAlways: return 24 * 60 * 60;
+    default: return 1;
+    }
+}
+
+// FuseOpenOut::open_flags for a regular file opened on |share|. On a
+// writeback mount, shares that did not opt in bypass the guest page cache
+// so their writes still reach the host as they happen.
+static uint32_t OpenFlags(const ShareInfo& share, bool writeback_mount) {
+    if (writeback_mount && !share.writeback && !share.readonly) return FOPEN_DIRECT_IO;
+    switch (share.cache) {
+    case FsCachePolicy::kNone: return FOPEN_DIRECT_IO;
+    case FsCachePolicy::kAlways: return FOPEN_KEEP_CACHE;
+    default: return 0;
+    }
+}
+
+InodeAnchor::~InodeAnchor() {
+#ifndef _WIN32
+    if (fd >= 0) ::close(fd);
+#endif
+}
+
+// Slice of guest memory taken from a descriptor chain.
+struct FsIoSeg {
+    uint8_t* addr;
+    uint32_t len;
+};
+
+// Segments covering [offset, offset + max_len) of the readable (or writable)
+// part of |chain|, in chain order.
+static std::vector<FsIoSeg> SliceChain(const std::vector<VirtqChainElem>& chain, bool writable,
+                                       size_t offset, size_t max_len) {
+    std::vector<FsIoSeg> segs;
+    for (const auto& elem : chain) {
+        if (elem.writable != writable) continue;
+        if (max_len == 0) break;
+        if (offset >= elem.len) {
+            offset -= elem.len;
+            continue;
+        }
+        size_t len = std::min(static_cast<size_t>(elem.len) - offset, max_len);
+        segs.push_back({elem.addr + offset, static_cast<uint32_t>(len)});
+        max_len -= len;
+        offset = 0;
+    }
+    return segs;
+}
+
+static size_t CopyFromChain(const std::vector<VirtqChainElem>& chain, size_t offset,
+                            void* dst, size_t len) {
+    size_t copied = 0;
+    for (const auto& seg : SliceChain(chain, false, offset, len)) {
+        memcpy(static_cast<uint8_t*>(dst) + copied, seg.addr, seg.len);
+        copied += seg.len;
+    }
+    return copied;
+}
+
+static size_t CopyToChain(const std::vector<VirtqChainElem>& chain, size_t offset,
+                          const void* src, size_t len) {
+    size_t copied = 0;
+    for (const auto& seg : SliceChain(chain, true, offset, len)) {
+        memcpy(seg.addr, static_cast<const uint8_t*>(src) + copied, seg.len);
+        copied += seg.len;
+    }
+    return copied;
+}
+
+// Positional read/write on a host file. Both leave the platform error
+// (errno / GetLastError) set for PlatformErrorToFuse() on failure.
+static bool PreadHost(FsHandle h, void* buf, size_t len, uint64_t offset, size_t* done) {
+#ifdef _WIN32
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD got = 0;
+    if (!ReadFile(h, buf, static_cast<DWORD>(len), &got, &ov) && GetLastError() != ERROR_HANDLE_EOF) {
+        return false;
+    }
+    *done = got;
+#else
+    ssize_t got = ::pread(h, buf, len, static_cast<off_t>(offset));
+    if (got < 0) return false;
+    *done = static_cast<size_t>(got);
+#endif
+    return true;
+}
+
+static bool PwriteHost(FsHandle h, const void* buf, size_t len, uint64_t offset, size_t* done) {
+#ifdef _WIN32
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD put = 0;
+    if (!WriteFile(h, buf, static_cast<DWORD>(len), &put, &ov)) return false;
+    *done = put;
+#else
+    ssize_t put = ::pwrite(h, buf, len, static_cast<off_t>(offset));
+    if (put < 0) return false;
+    *done = static_cast<size_t>(put);
+#endif
+    return true;
+}
+
+// Copy up to |len| bytes from |in| at |off_in| to |out| at |off_out|,
+// adding the amount copied to |*copied|. On Linux the host kernel does the
+// copy (a reflink where the filesystem supports it); elsewhere, and when
+// the two files sit on different filesystems, it bounces through a host
+// buffer. Either way the data never crosses the virtqueue. Returns false
+// with the platform error set only if nothing could be copied.
+static bool CopyRangeHost(FsHandle in, uint64_t off_in, FsHandle out, uint64_t off_out,
+                          uint64_t len, uint64_t* copied) {
+#if defined(__linux__)
+    while (*copied < len) {
+        loff_t in_pos = static_cast<loff_t>(off_in + *copied);
+        loff_t out_pos = static_cast<loff_t>(off_out + *copied);
+        ssize_t n = ::copy_file_range(in, &in_pos, out, &out_pos, len - *copied, 0);
+        if (n < 0) {
+            if (*copied == 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP)) break;
+            return *copied > 0;
+        }
+        if (n == 0) return true;
+        *copied += static_cast<uint64_t>(n);
+    }
+    if (*copied == len) return true;
+#endif
+    std::vector<uint8_t> buf(static_cast<size_t>(std::min<uint64_t>(len, 1u << 20)));
+    while (*copied < len) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(buf.size(), len - *copied));
+        size_t got = 0;
+        if (!PreadHost(in, buf.data(), chunk, off_in + *copied, &got)) return *copied > 0;
+        if (got == 0) break;
+        size_t written = 0;
+        while (written < got) {
+            size_t put = 0;
+            if (!PwriteHost(out, buf.data() + written, got - written,
+                            off_out + *copied + written, &put) || put == 0) {
+                *copied += written;
+                return *copied > 0;
+            }
+            written += put;
+        }
+        *copied += got;
+    }
+    return true;
+}
+
+VirtioFsDevice::VirtioFsDevice(const std::string& mount_tag, uint32_t num_request_queues,
+                               uint32_t num_workers)
+    : mount_tag_(mount_tag),
+      queue_mutexes_(1 + std::max<uint32_t>(num_request_queues, 1)) {
     memset(&config_, 0, sizeof(config_));
     size_t tag_len = std::min(mount_tag_.size(), sizeof(config_.tag) - 1);
     memcpy(config_.tag, mount_tag_.c_str(), tag_len);
-    config_.num_request_queues = 1;
+    config_.num_request_queues = std::max<uint32_t>(num_request_queues, 1);
     virtual_root_mtime_ = static_cast<uint64_t>(time(nullptr));
 
     InodeInfo root;
@@ -66,31 +332,49 @@ VirtioFsDevice::VirtioFsDevice(const std::string& mount_tag)
     root.share_tag = "";
     inodes_[VIRTUAL_ROOT_INODE] = root;
 
-    LOG_INFO("VirtIO FS: mount_tag=%s (virtual root with dynamic shares)", mount_tag_.c_str());
+#if defined(__linux__)
+    // Every inode the guest holds pins an O_PATH descriptor, so lift the
+    // soft descriptor limit to the hard one up front.
+    struct rlimit rl;
+    if (::getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &rl);
+    }
+#endif
+
+    num_workers = std::max<uint32_t>(num_workers, 1);
+    workers_.reserve(num_workers);
+    for (uint32_t i = 0; i < num_workers; i++) {
+        workers_.emplace_back(&VirtioFsDevice::WorkerLoop, this, i);
+    }
+
+    LOG_INFO("VirtIO FS: mount_tag=%s (virtual root with dynamic shares, "
+             "%u request queues, %u workers)",
+             mount_tag_.c_str(), config_.num_request_queues, num_workers);
 }
 
 VirtioFsDevice::~VirtioFsDevice() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& [fh, handle] : file_handles_) {
-        if (handle.handle != FS_INVALID_HANDLE) {
-#ifdef _WIN32
-            CloseHandle(handle.handle);
-#else
-            ::close(handle.handle);
-#endif
-        }
-    }
+    Stop();
+    std::lock_guard<std::mutex> lock(handle_mutex_);
     file_handles_.clear();
 }
 
-bool VirtioFsDevice::AddShare(const std::string& tag, const std::string& host_path, bool readonly) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (shares_.find(tag) != shares_.end()) {
-        LOG_ERROR("VirtIO FS: share tag '%s' already exists", tag.c_str());
-        return false;
+void VirtioFsDevice::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(work_mutex_);
+        if (stop_workers_) return;
+        stop_workers_ = true;
+    }
+    work_cv_.notify_all();
+    idle_cv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
     }
+}
 
+bool VirtioFsDevice::AddShare(const std::string& tag, const std::string& host_path, bool readonly,
+                              FsCachePolicy cache, bool writeback,
+                              const FsShareLimits& limits) {
     std::string path = host_path;
 #ifdef _WIN32
     DWORD attrs = GetFileAttributesW(Utf8ToWide(path).c_str());
@@ -114,33 +398,63 @@ bool VirtioFsDevice::AddShare(const std::string& tag, const std::string& host_pa
     }
 #endif
 
-    uint64_t share_root_inode = next_inode_++;
-    
+    std::shared_ptr<InodeAnchor> anchor;
+#if defined(__linux__)
+    int root_fd = ::open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        LOG_ERROR("VirtIO FS: cannot open share root '%s': %s", host_path.c_str(), strerror(errno));
+        return false;
+    }
+    anchor = std::make_shared<InodeAnchor>(root_fd);
+#endif
+
+    std::unique_lock<std::shared_mutex> shares_lock(shares_mutex_);
+    if (shares_.find(tag) != shares_.end()) {
+        LOG_ERROR("VirtIO FS: share tag '%s' already exists", tag.c_str());
+        return false;
+    }
+
+    uint64_t share_root_inode;
+    {
+        std::lock_guard<std::mutex> lock(inode_mutex_);
+        share_root_inode = next_inode_++;
+
+        InodeInfo share_root;
+        share_root.inode = share_root_inode;
+        share_root.host_path = path;
+        share_root.nlookup = 1;
+        share_root.is_dir = true;
+        share_root.share_tag = tag;
+        share_root.anchor = std::move(anchor);
+        inodes_[share_root_inode] = share_root;
+        path_to_inode_[path] = share_root_inode;
+    }
+
     ShareInfo share;
     share.tag = tag;
     share.host_path = path;
     share.readonly = readonly;
+    share.cache = cache;
+    share.writeback = writeback;
+    share.limits = limits;
+    share.io = std::make_shared<FsShareIo>(limits);
     share.root_inode = share_root_inode;
     shares_[tag] = share;
 
-    InodeInfo share_root;
-    share_root.inode = share_root_inode;
-    share_root.host_path = path;
-    share_root.nlookup = 1;
-    share_root.is_dir = true;
-    share_root.share_tag = tag;
-    inodes_[share_root_inode] = share_root;
-    path_to_inode_[path] = share_root_inode;
-
     shares_version_++;
     virtual_root_mtime_ = static_cast<uint64_t>(time(nullptr));
-    LOG_INFO("VirtIO FS: added share '%s' -> '%s' (readonly=%s, inode=%" PRIu64 ")",
-             tag.c_str(), host_path.c_str(), readonly ? "true" : "false", share_root_inode);
+    LOG_INFO("VirtIO FS: added share '%s' -> '%s' (readonly=%s, cache=%s, writeback=%s, inode=%" PRIu64 ")",
+             tag.c_str(), host_path.c_str(), readonly ? "true" : "false",
+             FsCachePolicyName(cache), writeback ? "true" : "false", share_root_inode);
+    if (writeback && initialized_ && !writeback_) {
+        LOG_WARN("VirtIO FS: share '%s' asked for writeback, but the guest mount is write-through",
+                 tag.c_str());
+    }
     return true;
 }
 
 bool VirtioFsDevice::RemoveShare(const std::string& tag) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_lock<std::shared_mutex> shares_lock(shares_mutex_);
     
     auto it = shares_.find(tag);
     if (it == shares_.end()) {
@@ -148,27 +462,27 @@ bool VirtioFsDevice::RemoveShare(const std::string& tag) {
         return false;
     }
 
-    for (auto fh_it = file_handles_.begin(); fh_it != file_handles_.end(); ) {
-        if (fh_it->second.share_tag == tag) {
-            if (fh_it->second.handle != FS_INVALID_HANDLE) {
-#ifdef _WIN32
-                CloseHandle(fh_it->second.handle);
-#else
-                ::close(fh_it->second.handle);
-#endif
+    {
+        std::lock_guard<std::mutex> lock(inode_mutex_);
+        for (auto inode_it = inodes_.begin(); inode_it != inodes_.end(); ) {
+            if (inode_it->second.share_tag == tag) {
+                inode_it = EraseInodeLocked(inode_it);
+            } else {
+                ++inode_it;
             }
-            fh_it = file_handles_.erase(fh_it);
-        } else {
-            ++fh_it;
         }
     }
 
-    for (auto inode_it = inodes_.begin(); inode_it != inodes_.end(); ) {
-        if (inode_it->second.share_tag == tag) {
-            path_to_inode_.erase(inode_it->second.host_path);
-            inode_it = inodes_.erase(inode_it);
-        } else {
-            ++inode_it;
+    // Handles still in use by a worker are closed when that request drops
+    // its reference.
+    {
+        std::lock_guard<std::mutex> lock(handle_mutex_);
+        for (auto fh_it = file_handles_.begin(); fh_it != file_handles_.end(); ) {
+            if (fh_it->second->share_tag == tag) {
+                fh_it = file_handles_.erase(fh_it);
+            } else {
+                ++fh_it;
+            }
         }
     }
 
@@ -180,7 +494,7 @@ bool VirtioFsDevice::RemoveShare(const std::string& tag) {
 }
 
 std::vector<std::string> VirtioFsDevice::GetShareTags() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(shares_mutex_);
     std::vector<std::string> tags;
     for (const auto& [tag, _] : shares_) {
         tags.push_back(tag);
@@ -189,7 +503,7 @@ std::vector<std::string> VirtioFsDevice::GetShareTags() const {
 }
 
 std::vector<ShareInfo> VirtioFsDevice::GetShares() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(shares_mutex_);
     std::vector<ShareInfo> result;
     result.reserve(shares_.size());
     for (const auto& [_, info] : shares_) {
@@ -199,7 +513,7 @@ std::vector<ShareInfo> VirtioFsDevice::GetShares() const {
 }
 
 bool VirtioFsDevice::HasShare(const std::string& tag) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(shares_mutex_);
     return shares_.find(tag) != shares_.end();
 }
 
@@ -225,45 +539,185 @@ void VirtioFsDevice::ReadConfig(uint32_t offset, uint8_t size, uint32_t* value)
 void VirtioFsDevice::WriteConfig(uint32_t, uint8_t, uint32_t) {
 }
 
+void VirtioFsDevice::OnBeforeReset() {
+    // Requests popped before the reset must complete while their rings are
+    // still mapped, or not at all.
+    DrainWorkers();
+}
+
 void VirtioFsDevice::OnStatusChange(uint32_t new_status) {
     if (new_status == 0) {
         LOG_INFO("VirtIO FS: device reset");
-        std::lock_guard<std::mutex> lock(mutex_);
-        for (auto& [fh, handle] : file_handles_) {
-            if (handle.handle != FS_INVALID_HANDLE) {
-#ifdef _WIN32
-                CloseHandle(handle.handle);
-#else
-                ::close(handle.handle);
-#endif
-            }
-        }
+        std::lock_guard<std::mutex> lock(handle_mutex_);
         file_handles_.clear();
         initialized_ = false;
     }
 }
 
 void VirtioFsDevice::OnQueueNotify(uint32_t queue_idx, VirtQueue& vq) {
-    if (queue_idx > 1) return;
+    if (queue_idx >= queue_mutexes_.size()) return;
+
+    std::vector<PendingRequest> popped;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutexes_[queue_idx]);
+        uint16_t head;
+        while (vq.PopAvail(&head)) {
+            PendingRequest req{&vq, queue_idx, head, {}};
+            if (!vq.WalkChain(head, &req.chain) || req.chain.empty()) {
+                LOG_ERROR("VirtIO FS: failed to walk descriptor chain");
+                continue;
+            }
+            popped.push_back(std::move(req));
+        }
+    }
+    if (popped.empty()) return;
 
-    uint16_t head;
-    while (vq.PopAvail(&head)) {
-        ProcessRequest(vq, head);
+    // The hiprio queue only carries FORGET / INTERRUPT: cheap table updates
+    // that must not wait behind slow host I/O, so run them right here.
+    if (queue_idx == 0) {
+        for (auto& req : popped) CompleteRequest(req);
+        return;
     }
 
-    if (mmio_) mmio_->NotifyUsedBuffer(queue_idx);
+    {
+        std::lock_guard<std::mutex> lock(work_mutex_);
+        if (stop_workers_) return;
+        for (auto& req : popped) work_queue_.push_back(std::move(req));
+    }
+    if (popped.size() == 1) {
+        work_cv_.notify_one();
+    } else {
+        work_cv_.notify_all();
+    }
 }
 
-void VirtioFsDevice::ProcessRequest(VirtQueue& vq, uint16_t head_idx) {
-    std::vector<VirtqChainElem> chain;
-    if (!vq.WalkChain(head_idx, &chain)) {
-        LOG_ERROR("VirtIO FS: failed to walk descriptor chain");
-        return;
+void VirtioFsDevice::WorkerLoop(uint32_t index) {
+    char name[16];
+    snprintf(name, sizeof(name), "vm-fs-%u", index);
+    InitVmThread(name, VmThreadRole::kIo);
+
+    for (;;) {
+        PendingRequest req;
+        {
+            // Deferred requests that are due go first, so fresh work from
+            // other shares cannot starve them past their release time.
+            std::unique_lock<std::mutex> lock(work_mutex_);
+            for (;;) {
+                if (stop_workers_) return;
+                auto now = std::chrono::steady_clock::now();
+                if (!deferred_.empty() && deferred_.begin()->first <= now) {
+                    req = std::move(deferred_.begin()->second);
+                    deferred_.erase(deferred_.begin());
+                    break;
+                }
+                if (!work_queue_.empty()) {
+                    req = std::move(work_queue_.front());
+                    work_queue_.pop_front();
+                    break;
+                }
+                if (deferred_.empty()) {
+                    work_cv_.wait(lock);
+                } else {
+                    // By value: a reset may clear deferred_ while we sleep.
+                    const auto deadline = deferred_.begin()->first;
+                    work_cv_.wait_until(lock, deadline);
+                }
+            }
+            busy_workers_++;
+        }
+
+        uint64_t delay_ns = req.admitted ? 0 : AdmitRequest(req);
+        req.admitted = true;
+        if (delay_ns) {
+            std::lock_guard<std::mutex> lock(work_mutex_);
+            busy_workers_--;
+            deferred_.emplace(std::chrono::steady_clock::now() + std::chrono::nanoseconds(delay_ns),
+                              std::move(req));
+            // Idle workers may be sleeping towards a later deadline.
+            work_cv_.notify_all();
+            if (busy_workers_ == 0) idle_cv_.notify_all();
+            continue;
+        }
+
+        CompleteRequest(req);
+
+        {
+            std::lock_guard<std::mutex> lock(work_mutex_);
+            busy_workers_--;
+            if (busy_workers_ == 0) idle_cv_.notify_all();
+        }
     }
+}
 
-    if (chain.empty()) {
-        LOG_ERROR("VirtIO FS: empty descriptor chain");
-        return;
+uint64_t VirtioFsDevice::AdmitRequest(const PendingRequest& req) {
+    FuseInHeader hdr;
+    if (CopyFromChain(req.chain, 0, &hdr, sizeof(hdr)) < sizeof(hdr)) return 0;
+
+    uint64_t bytes = 0;
+    if (hdr.opcode == FUSE_READ) {
+        FuseReadIn read_in;
+        if (CopyFromChain(req.chain, sizeof(hdr), &read_in, sizeof(read_in)) == sizeof(read_in)) {
+            bytes = read_in.size;
+        }
+    } else if (hdr.opcode == FUSE_WRITE) {
+        FuseWriteIn write_in;
+        if (CopyFromChain(req.chain, sizeof(hdr), &write_in, sizeof(write_in)) == sizeof(write_in)) {
+            bytes = write_in.size;
+        }
+    }
+
+    std::string tag;
+    {
+        std::lock_guard<std::mutex> lock(inode_mutex_);
+        auto it = inodes_.find(hdr.nodeid);
+        if (it == inodes_.end()) return 0;
+        tag = it->second.share_tag;
+    }
+    std::shared_ptr<FsShareIo> io;
+    {
+        std::shared_lock<std::shared_mutex> lock(shares_mutex_);
+        auto it = shares_.find(tag);
+        if (it == shares_.end()) return 0;
+        io = it->second.io;
+    }
+    return io ? io->Admit(hdr.opcode, bytes) : 0;
+}
+
+void VirtioFsDevice::DrainWorkers() {
+    std::unique_lock<std::mutex> lock(work_mutex_);
+    work_queue_.clear();
+    deferred_.clear();
+    idle_cv_.wait(lock, [this] { return stop_workers_ || busy_workers_ == 0; });
+    // A worker admitting a request as the queues were cleared may have
+    // deferred it since.
+    deferred_.clear();
+}
+
+void VirtioFsDevice::CompleteRequest(PendingRequest& req) {
+    uint32_t used_len = ProcessRequest(req.chain);
+
+    std::lock_guard<std::mutex> lock(queue_mutexes_[req.queue_idx]);
+    req.vq->PushUsed(req.head_idx, used_len);
+    if (mmio_) mmio_->NotifyUsedBuffer(req.queue_idx);
+}
+
+uint32_t VirtioFsDevice::ProcessRequest(const std::vector<VirtqChainElem>& chain) {
+    FuseInHeader hdr;
+    if (CopyFromChain(chain, 0, &hdr, sizeof(hdr)) < sizeof(hdr)) {
+        LOG_ERROR("VirtIO FS: request too small for FUSE header");
+        return 0;
+    }
+
+    if (hdr.opcode == FUSE_READ || hdr.opcode == FUSE_WRITE) {
+        std::vector<uint8_t> out_buf;
+        if (hdr.opcode == FUSE_READ) {
+            uint32_t used = HandleRead(&hdr, chain, out_buf);
+            if (used) return used;
+        } else {
+            HandleWrite(&hdr, chain, out_buf);
+        }
+        CopyToChain(chain, 0, out_buf.data(), out_buf.size());
+        return static_cast<uint32_t>(out_buf.size());
     }
 
     std::vector<uint8_t> in_buf;
@@ -275,7 +729,7 @@ void VirtioFsDevice::ProcessRequest(VirtQueue& vq, uint16_t head_idx) {
 
     if (in_buf.size() < sizeof(FuseInHeader)) {
         LOG_ERROR("VirtIO FS: request too small (%zu bytes)", in_buf.size());
-        return;
+        return 0;
     }
 
     auto* in_hdr = reinterpret_cast<const FuseInHeader*>(in_buf.data());
@@ -294,6 +748,9 @@ void VirtioFsDevice::ProcessRequest(VirtQueue& vq, uint16_t head_idx) {
     case FUSE_FORGET:
         HandleForget(in_hdr, in_data);
         break;
+    case FUSE_BATCH_FORGET:
+        HandleBatchForget(in_data, in_len);
+        break;
     case FUSE_GETATTR:
         HandleGetAttr(in_hdr, in_data, out_buf);
         break;
@@ -303,12 +760,6 @@ void VirtioFsDevice::ProcessRequest(VirtQueue& vq, uint16_t head_idx) {
     case FUSE_OPEN:
         HandleOpen(in_hdr, in_data, out_buf);
         break;
-    case FUSE_READ:
-        HandleRead(in_hdr, in_data, out_buf);
-        break;
-    case FUSE_WRITE:
-        HandleWrite(in_hdr, in_data, in_len, out_buf);
-        break;
     case FUSE_RELEASE:
         HandleRelease(in_hdr, in_data);
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_OK);
@@ -354,29 +805,35 @@ void VirtioFsDevice::ProcessRequest(VirtQueue& vq, uint16_t head_idx) {
         HandleFsync(in_hdr, in_data);
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_OK);
         break;
+    case FUSE_FALLOCATE:
+        HandleFallocate(in_hdr, in_data, in_len, out_buf);
+        break;
+    case FUSE_LSEEK:
+        HandleLseek(in_hdr, in_data, in_len, out_buf);
+        break;
+    case FUSE_COPY_FILE_RANGE:
+        HandleCopyFileRange(in_hdr, in_data, in_len, out_buf);
+        break;
     case FUSE_ACCESS:
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_OK);
         break;
     case FUSE_DESTROY:
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_OK);
         break;
+    case FUSE_SETUPMAPPING:
+        HandleSetupMapping(in_hdr, in_data, in_len, out_buf);
+        break;
+    case FUSE_REMOVEMAPPING:
+        HandleRemoveMapping(in_hdr, in_data, in_len, out_buf);
+        break;
     default:
         LOG_WARN("VirtIO FS: unsupported opcode %u", in_hdr->opcode);
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOSYS);
         break;
     }
 
-    size_t out_offset = 0;
-    for (const auto& elem : chain) {
-        if (elem.writable && out_offset < out_buf.size()) {
-            size_t copy_len = std::min(static_cast<size_t>(elem.len), 
-                                       out_buf.size() - out_offset);
-            memcpy(elem.addr, out_buf.data() + out_offset, copy_len);
-            out_offset += copy_len;
-        }
-    }
-
-    vq.PushUsed(head_idx, static_cast<uint32_t>(out_buf.size()));
+    CopyToChain(chain, 0, out_buf.data(), out_buf.size());
+    return static_cast<uint32_t>(out_buf.size());
 }
 
 void VirtioFsDevice::WriteErrorResponse(std::vector<uint8_t>& out_buf, 
@@ -394,7 +851,8 @@ void VirtioFsDevice::HandleInit(const FuseInHeader* in_hdr, const uint8_t* in_da
                                  std::vector<uint8_t>& out_buf) {
     auto* init_in = reinterpret_cast<const FuseInitIn*>(in_data);
     
-    LOG_INFO("VirtIO FS: INIT major=%u minor=%u", init_in->major, init_in->minor);
+    LOG_INFO("VirtIO FS: INIT major=%u minor=%u flags=0x%x", init_in->major, init_in->minor,
+             init_in->flags);
 
     FuseOutHeader out_hdr;
     FuseInitOut init_out;
@@ -404,11 +862,46 @@ void VirtioFsDevice::HandleInit(const FuseInHeader* in_hdr, const uint8_t* in_da
     init_out.minor = FUSE_KERNEL_MINOR_VERSION;
     init_out.max_readahead = init_in->max_readahead;
     init_out.flags = FUSE_BIG_WRITES | FUSE_PARALLEL_DIROPS;
+    // AUTO_INVAL_DATA lets the guest drop cached pages when it sees a
+    // file's size or mtime change, which is what keeps the "auto" cache
+    // policy coherent. READDIRPLUS folds the per-entry LOOKUPs of a
+    // directory walk into the listing itself. ASYNC_READ / ASYNC_DIO let
+    // readahead and O_DIRECT I/O keep several requests in flight per file;
+    // reads and writes use positional host I/O on reference-counted
+    // handles, so the worker pool runs them in any order.
+    init_out.flags |= init_in->flags &
+                      (FUSE_AUTO_INVAL_DATA | FUSE_DO_READDIRPLUS | FUSE_READDIRPLUS_AUTO |
+                       FUSE_ASYNC_READ | FUSE_ASYNC_DIO);
+
+    // Writeback caching applies to the whole mount, so it is only turned on
+    // when every writable share asked for it.
+    bool writeback = false;
+    if (init_in->flags & FUSE_WRITEBACK_CACHE) {
+        std::shared_lock<std::shared_mutex> lock(shares_mutex_);
+        for (const auto& [tag, share] : shares_) {
+            if (share.readonly) continue;
+            if (!share.writeback) {
+                writeback = false;
+                break;
+            }
+            writeback = true;
+        }
+    }
+    if (writeback) init_out.flags |= FUSE_WRITEBACK_CACHE;
+    writeback_ = writeback;
+
     init_out.max_write = 1024 * 1024;
-    init_out.max_background = 16;
-    init_out.congestion_threshold = 12;
+    // Background requests (readahead, async direct I/O, writeback flushes)
+    // the guest keeps queued before it starts throttling writers.
+    init_out.max_background = 64;
+    init_out.congestion_threshold = 48;
     init_out.time_gran = 1;
     init_out.max_pages = 256;
+    if (dax_window_ && (init_in->flags & FUSE_MAP_ALIGNMENT)) {
+        // Mappings only need to be host-page aligned (log2 of the size).
+        init_out.flags |= FUSE_MAP_ALIGNMENT;
+        init_out.map_alignment = 12;
+    }
 
     out_hdr.len = sizeof(FuseOutHeader) + sizeof(FuseInitOut);
     out_hdr.error = 0;
@@ -418,6 +911,7 @@ void VirtioFsDevice::HandleInit(const FuseInHeader* in_hdr, const uint8_t* in_da
     memcpy(out_buf.data(), &out_hdr, sizeof(out_hdr));
     memcpy(out_buf.data() + sizeof(out_hdr), &init_out, sizeof(init_out));
 
+    if (writeback) LOG_INFO("VirtIO FS: writeback cache enabled");
     initialized_ = true;
 }
 
@@ -426,16 +920,12 @@ void VirtioFsDevice::HandleLookup(const FuseInHeader* in_hdr, const uint8_t* in_
     std::string name(reinterpret_cast<const char*>(in_data), 
                      strnlen(reinterpret_cast<const char*>(in_data), in_len));
     
-    std::lock_guard<std::mutex> lock(mutex_);
-
     if (in_hdr->nodeid == VIRTUAL_ROOT_INODE) {
-        auto it = shares_.find(name);
-        if (it == shares_.end()) {
+        ShareInfo share;
+        if (!FindShare(name, &share)) {
             WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
             return;
         }
-
-        const ShareInfo& share = it->second;
         
         FuseOutHeader out_hdr;
         FuseEntryOut entry_out;
@@ -462,69 +952,28 @@ void VirtioFsDevice::HandleLookup(const FuseInHeader* in_hdr, const uint8_t* in_
         return;
     }
 
-    auto inode_it = inodes_.find(in_hdr->nodeid);
-    if (inode_it == inodes_.end()) {
+    InodeInfo parent;
+    if (!LookupInode(in_hdr->nodeid, &parent)) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
         return;
     }
 
-    const InodeInfo& parent = inode_it->second;
-    std::string child_path = parent.host_path + kPathSep + name;
-    
-    bool is_dir;
-#ifdef _WIN32
-    DWORD attrs = GetFileAttributesW(Utf8ToWide(child_path).c_str());
-    if (attrs == INVALID_FILE_ATTRIBUTES) {
-        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
-        return;
-    }
-    is_dir = (attrs & FILE_ATTRIBUTE_DIRECTORY) != 0;
-#else
-    struct stat st;
-    if (::stat(child_path.c_str(), &st) != 0) {
-        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
-        return;
-    }
-    is_dir = S_ISDIR(st.st_mode);
-#endif
-    
-    auto path_it = path_to_inode_.find(child_path);
-    uint64_t inode;
-    if (path_it != path_to_inode_.end()) {
-        inode = path_it->second;
-        inodes_[inode].nlookup++;
-    } else {
-        inode = next_inode_++;
-        InodeInfo info;
-        info.inode = inode;
-        info.host_path = child_path;
-        info.nlookup = 1;
-        info.is_dir = is_dir;
-        info.share_tag = parent.share_tag;
-        inodes_[inode] = info;
-        path_to_inode_[child_path] = inode;
-    }
-
     FuseOutHeader out_hdr;
     FuseEntryOut entry_out;
     memset(&entry_out, 0, sizeof(entry_out));
 
-    entry_out.nodeid = inode;
-    entry_out.generation = 1;
-    entry_out.entry_valid = 1;
-    entry_out.attr_valid = 1;
-
-    bool readonly = false;
-    {
-        auto sit = shares_.find(parent.share_tag);
-        if (sit != shares_.end()) readonly = sit->second.readonly;
-    }
-    int32_t err = FillAttr(child_path, &entry_out.attr, inode, readonly);
+    ShareInfo share;
+    FindShare(parent.share_tag, &share);
+    int32_t err = LookupChild(parent, name, share.readonly, &entry_out.nodeid, &entry_out.attr);
     if (err != FUSE_OK) {
         WriteErrorResponse(out_buf, in_hdr->unique, err);
         return;
     }
 
+    entry_out.generation = 1;
+    entry_out.entry_valid = CacheTimeout(share.cache);
+    entry_out.attr_valid = CacheTimeout(share.cache);
+
     out_hdr.len = sizeof(FuseOutHeader) + sizeof(FuseEntryOut);
     out_hdr.error = 0;
     out_hdr.unique = in_hdr->unique;
@@ -536,34 +985,32 @@ void VirtioFsDevice::HandleLookup(const FuseInHeader* in_hdr, const uint8_t* in_
 
 void VirtioFsDevice::HandleForget(const FuseInHeader* in_hdr, const uint8_t* in_data) {
     auto* forget_in = reinterpret_cast<const FuseForgetIn*>(in_data);
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (in_hdr->nodeid == VIRTUAL_ROOT_INODE) return;
-    for (const auto& [tag, share] : shares_) {
-        if (share.root_inode == in_hdr->nodeid) return;
-    }
+    ForgetInode(in_hdr->nodeid, forget_in->nlookup);
+}
 
-    auto it = inodes_.find(in_hdr->nodeid);
-    if (it != inodes_.end()) {
-        if (it->second.nlookup > forget_in->nlookup) {
-            it->second.nlookup -= forget_in->nlookup;
-        } else {
-            path_to_inode_.erase(it->second.host_path);
-            inodes_.erase(it);
-        }
+void VirtioFsDevice::HandleBatchForget(const uint8_t* in_data, uint32_t in_len) {
+    // Like FORGET, BATCH_FORGET has no reply.
+    if (in_len < sizeof(FuseBatchForgetIn)) return;
+    FuseBatchForgetIn batch;
+    memcpy(&batch, in_data, sizeof(batch));
+
+    size_t available = (in_len - sizeof(batch)) / sizeof(FuseForgetOne);
+    size_t count = std::min<size_t>(batch.count, available);
+    const uint8_t* entries = in_data + sizeof(batch);
+    for (size_t i = 0; i < count; i++) {
+        FuseForgetOne one;
+        memcpy(&one, entries + i * sizeof(one), sizeof(one));
+        ForgetInode(one.nodeid, one.nlookup);
     }
 }
 
 void VirtioFsDevice::HandleGetAttr(const FuseInHeader* in_hdr, const uint8_t*,
                                     std::vector<uint8_t>& out_buf) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     FuseOutHeader out_hdr;
     FuseAttrOut attr_out;
     memset(&attr_out, 0, sizeof(attr_out));
-    attr_out.attr_valid = 1;
 
+    ShareInfo share;
     if (in_hdr->nodeid == VIRTUAL_ROOT_INODE) {
         attr_out.attr_valid = 0;
         int32_t err = FillVirtualRootAttr(&attr_out.attr);
@@ -571,40 +1018,29 @@ void VirtioFsDevice::HandleGetAttr(const FuseInHeader* in_hdr, const uint8_t*,
             WriteErrorResponse(out_buf, in_hdr->unique, err);
             return;
         }
+    } else if (FindShareByRoot(in_hdr->nodeid, &share)) {
+        attr_out.attr_valid = 0;
+        int32_t err = FillShareRootAttr(share, &attr_out.attr);
+        if (err != FUSE_OK) {
+            WriteErrorResponse(out_buf, in_hdr->unique, err);
+            return;
+        }
     } else {
-        for (const auto& [tag, share] : shares_) {
-            if (share.root_inode == in_hdr->nodeid) {
-                attr_out.attr_valid = 0;
-                int32_t err = FillShareRootAttr(share, &attr_out.attr);
-                if (err != FUSE_OK) {
-                    WriteErrorResponse(out_buf, in_hdr->unique, err);
-                    return;
-                }
-                goto send_response;
-            }
+        InodeInfo info;
+        if (!LookupInode(in_hdr->nodeid, &info)) {
+            WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+            return;
         }
 
-        {
-            auto it = inodes_.find(in_hdr->nodeid);
-            if (it == inodes_.end()) {
-                WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
-                return;
-            }
+        FindShare(info.share_tag, &share);
+        attr_out.attr_valid = CacheTimeout(share.cache);
+        int32_t err = GetNodeAttr(info, share.readonly, &attr_out.attr);
+        if (err != FUSE_OK) {
+            WriteErrorResponse(out_buf, in_hdr->unique, err);
+            return;
+        }
+    }
 
-            bool readonly = false;
-            {
-                auto sit = shares_.find(it->second.share_tag);
-                if (sit != shares_.end()) readonly = sit->second.readonly;
-            }
-            int32_t err = FillAttr(it->second.host_path, &attr_out.attr, in_hdr->nodeid, readonly);
-            if (err != FUSE_OK) {
-                WriteErrorResponse(out_buf, in_hdr->unique, err);
-                return;
-            }
-        }
-    }
-
-send_response:
     out_hdr.len = sizeof(FuseOutHeader) + sizeof(FuseAttrOut);
     out_hdr.error = 0;
     out_hdr.unique = in_hdr->unique;
@@ -621,19 +1057,18 @@ void VirtioFsDevice::HandleSetAttr(const FuseInHeader* in_hdr, const uint8_t* in
         return;
     }
 
-    std::string share_tag = NodeIdToShareTag(in_hdr->nodeid);
-    if (IsShareReadonly(share_tag)) {
+    InodeInfo info;
+    if (!LookupInode(in_hdr->nodeid, &info)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+        return;
+    }
+    if (IsShareReadonly(info.share_tag)) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
         return;
     }
 
     auto* setattr_in = reinterpret_cast<const FuseSetAttrIn*>(in_data);
-    
-    std::string path = NodeIdToPath(in_hdr->nodeid);
-    if (path.empty()) {
-        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
-        return;
-    }
+    std::string path = NodePath(info);
 
     if (setattr_in->valid & FATTR_SIZE) {
 #ifdef _WIN32
@@ -647,12 +1082,20 @@ void VirtioFsDevice::HandleSetAttr(const FuseInHeader* in_hdr, const uint8_t* in
             CloseHandle(h);
         }
 #else
-        // GCC's warn_unused_result on truncate() survives a plain (void)
-        // cast, so stash the result in a discarded local.  A short-write
-        // failure here is reported to the guest implicitly via the next
-        // getattr; nothing actionable to do at this point.
-        int truncate_rc = ::truncate(path.c_str(),
-                                     static_cast<off_t>(setattr_in->size));
+        // Truncate through the guest's open handle when it names one: a
+        // writeback flush can shrink a file the guest opened writable but
+        // whose mode no longer allows opening it by path. GCC's
+        // warn_unused_result on truncate() survives a plain (void) cast, so
+        // stash the result in a discarded local. A failure here is reported
+        // to the guest implicitly via the next getattr.
+        std::shared_ptr<FileHandle> fh;
+        if (setattr_in->valid & FATTR_FH) fh = GetFileHandle(setattr_in->fh);
+        int truncate_rc;
+        if (fh && !fh->is_dir && fh->handle != FS_INVALID_HANDLE) {
+            truncate_rc = ::ftruncate(fh->handle, static_cast<off_t>(setattr_in->size));
+        } else {
+            truncate_rc = ::truncate(path.c_str(), static_cast<off_t>(setattr_in->size));
+        }
         (void)truncate_rc;
 #endif
     }
@@ -719,18 +1162,21 @@ void VirtioFsDevice::HandleOpen(const FuseInHeader* in_hdr, const uint8_t* in_da
                                  std::vector<uint8_t>& out_buf) {
     auto* open_in = reinterpret_cast<const FuseOpenIn*>(in_data);
     
-    std::string path = NodeIdToPath(in_hdr->nodeid);
-    if (path.empty()) {
+    InodeInfo info;
+    if (in_hdr->nodeid == VIRTUAL_ROOT_INODE || !LookupInode(in_hdr->nodeid, &info)) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
         return;
     }
 
-    std::string share_tag = NodeIdToShareTag(in_hdr->nodeid);
+    std::string path = NodePath(info);
+    const std::string& share_tag = info.share_tag;
+    ShareInfo share_info;
+    FindShare(share_tag, &share_info);
     
     uint32_t flags = open_in->flags;
     bool write_access = (flags & 0x3) != 0;
     
-    if (IsShareReadonly(share_tag) && write_access) {
+    if (share_info.readonly && write_access) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
         return;
     }
@@ -748,8 +1194,18 @@ void VirtioFsDevice::HandleOpen(const FuseInHeader* in_hdr, const uint8_t* in_da
         access = GENERIC_READ | GENERIC_WRITE;
     }
 
-    HANDLE h = CreateFileW(Utf8ToWide(path).c_str(), access, share, nullptr, disposition,
-                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    HANDLE h = INVALID_HANDLE_VALUE;
+    if (writeback_ && access == GENERIC_WRITE) {
+        // The guest page cache fills partial pages by reading through
+        // whatever handle it writes with, so a write-only open must also be
+        // readable. Fall back to write-only if the host refuses.
+        h = CreateFileW(Utf8ToWide(path).c_str(), GENERIC_READ | GENERIC_WRITE, share, nullptr,
+                        disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+    if (h == INVALID_HANDLE_VALUE) {
+        h = CreateFileW(Utf8ToWide(path).c_str(), access, share, nullptr, disposition,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
     if (h == INVALID_HANDLE_VALUE) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
@@ -764,19 +1220,27 @@ void VirtioFsDevice::HandleOpen(const FuseInHeader* in_hdr, const uint8_t* in_da
         oflags = O_RDWR;
     }
 
-    int h = ::open(path.c_str(), oflags);
+    int h = -1;
+    if (writeback_ && oflags == O_WRONLY) {
+        // The guest page cache fills partial pages by reading through
+        // whatever handle it writes with, so a write-only open must also be
+        // readable. Fall back to write-only if the host refuses.
+        h = ::open(path.c_str(), O_RDWR);
+    }
+    if (h < 0) h = ::open(path.c_str(), oflags);
     if (h < 0) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
 #endif
 
-    uint64_t fh = AllocFileHandle(h, false, path, share_tag);
+    uint64_t fh = AllocFileHandle(h, false, path, share_tag, info.anchor);
 
     FuseOutHeader out_hdr;
     FuseOpenOut open_out;
     memset(&open_out, 0, sizeof(open_out));
     open_out.fh = fh;
+    open_out.open_flags = OpenFlags(share_info, writeback_);
 
     out_hdr.len = sizeof(FuseOutHeader) + sizeof(FuseOpenOut);
     out_hdr.error = 0;
@@ -787,40 +1251,57 @@ void VirtioFsDevice::HandleOpen(const FuseInHeader* in_hdr, const uint8_t* in_da
     memcpy(out_buf.data() + sizeof(out_hdr), &open_out, sizeof(open_out));
 }
 
-void VirtioFsDevice::HandleRead(const FuseInHeader* in_hdr, const uint8_t* in_data,
-                                 std::vector<uint8_t>& out_buf) {
-    auto* read_in = reinterpret_cast<const FuseReadIn*>(in_data);
-    
-    FileHandle* fh = GetFileHandle(read_in->fh);
+uint32_t VirtioFsDevice::HandleRead(const FuseInHeader* in_hdr,
+                                    const std::vector<VirtqChainElem>& chain,
+                                    std::vector<uint8_t>& out_buf) {
+    FuseReadIn read_in;
+    if (CopyFromChain(chain, sizeof(FuseInHeader), &read_in, sizeof(read_in)) < sizeof(read_in)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return 0;
+    }
+
+    auto fh = GetFileHandle(read_in.fh);
     if (!fh || fh->handle == FS_INVALID_HANDLE) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
-        return;
+        return 0;
     }
 
-    std::vector<uint8_t> data(read_in->size);
+    // File data lands right after the reply header in the guest's buffers.
+    std::vector<FsIoSeg> segs = SliceChain(chain, true, sizeof(FuseOutHeader), read_in.size);
     
 #ifdef _WIN32
-    LARGE_INTEGER offset;
-    offset.QuadPart = static_cast<LONGLONG>(read_in->offset);
-    
-    OVERLAPPED ov = {};
-    ov.Offset = offset.LowPart;
-    ov.OffsetHigh = offset.HighPart;
-    
-    DWORD bytes_read = 0;
-    if (!ReadFile(fh->handle, data.data(), read_in->size, &bytes_read, &ov)) {
-        DWORD err = GetLastError();
-        if (err != ERROR_HANDLE_EOF) {
-            WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
-            return;
+    uint64_t bytes_read = 0;
+    for (const auto& seg : segs) {
+        LARGE_INTEGER offset;
+        offset.QuadPart = static_cast<LONGLONG>(read_in.offset + bytes_read);
+
+        OVERLAPPED ov = {};
+        ov.Offset = offset.LowPart;
+        ov.OffsetHigh = offset.HighPart;
+
+        DWORD got = 0;
+        if (!ReadFile(fh->handle, seg.addr, seg.len, &got, &ov)) {
+            DWORD err = GetLastError();
+            if (err != ERROR_HANDLE_EOF) {
+                if (bytes_read > 0) break;
+                WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
+                return 0;
+            }
         }
+        bytes_read += got;
+        if (got < seg.len) break;
     }
 #else
-    ssize_t bytes_read = ::pread(fh->handle, data.data(), read_in->size,
-                                 static_cast<off_t>(read_in->offset));
+    std::vector<struct iovec> iov(segs.size());
+    for (size_t i = 0; i < segs.size(); i++) {
+        iov[i].iov_base = segs[i].addr;
+        iov[i].iov_len = segs[i].len;
+    }
+    ssize_t bytes_read = ::preadv(fh->handle, iov.data(), static_cast<int>(iov.size()),
+                                  static_cast<off_t>(read_in.offset));
     if (bytes_read < 0) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
-        return;
+        return 0;
     }
 #endif
 
@@ -828,19 +1309,23 @@ void VirtioFsDevice::HandleRead(const FuseInHeader* in_hdr, const uint8_t* in_da
     out_hdr.len = sizeof(FuseOutHeader) + static_cast<uint32_t>(bytes_read);
     out_hdr.error = 0;
     out_hdr.unique = in_hdr->unique;
-
-    out_buf.resize(out_hdr.len);
-    memcpy(out_buf.data(), &out_hdr, sizeof(out_hdr));
-    if (bytes_read > 0) {
-        memcpy(out_buf.data() + sizeof(out_hdr), data.data(), bytes_read);
+    if (CopyToChain(chain, 0, &out_hdr, sizeof(out_hdr)) < sizeof(out_hdr)) {
+        LOG_ERROR("VirtIO FS: READ reply buffer too small");
+        return 0;
     }
+    return out_hdr.len;
 }
 
-void VirtioFsDevice::HandleWrite(const FuseInHeader* in_hdr, const uint8_t* in_data,
-                                  uint32_t in_len, std::vector<uint8_t>& out_buf) {
-    auto* write_in = reinterpret_cast<const FuseWriteIn*>(in_data);
-    
-    FileHandle* fh = GetFileHandle(write_in->fh);
+void VirtioFsDevice::HandleWrite(const FuseInHeader* in_hdr,
+                                  const std::vector<VirtqChainElem>& chain,
+                                  std::vector<uint8_t>& out_buf) {
+    FuseWriteIn write_in;
+    if (CopyFromChain(chain, sizeof(FuseInHeader), &write_in, sizeof(write_in)) < sizeof(write_in)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+
+    auto fh = GetFileHandle(write_in.fh);
     if (!fh || fh->handle == FS_INVALID_HANDLE) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
         return;
@@ -851,29 +1336,39 @@ void VirtioFsDevice::HandleWrite(const FuseInHeader* in_hdr, const uint8_t* in_d
         return;
     }
 
-    const uint8_t* write_data = in_data + sizeof(FuseWriteIn);
-    uint32_t data_len = in_len - sizeof(FuseWriteIn);
-    
-    if (data_len < write_in->size) {
-        data_len = write_in->size;
-    }
+    // The payload follows FuseWriteIn in the readable descriptors; a chain
+    // shorter than write_in.size is written as far as it goes.
+    std::vector<FsIoSeg> segs = SliceChain(chain, false,
+                                           sizeof(FuseInHeader) + sizeof(FuseWriteIn),
+                                           write_in.size);
 
 #ifdef _WIN32
-    LARGE_INTEGER offset;
-    offset.QuadPart = static_cast<LONGLONG>(write_in->offset);
-    
-    OVERLAPPED ov = {};
-    ov.Offset = offset.LowPart;
-    ov.OffsetHigh = offset.HighPart;
-    
-    DWORD bytes_written = 0;
-    if (!WriteFile(fh->handle, write_data, write_in->size, &bytes_written, &ov)) {
-        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
-        return;
+    uint64_t bytes_written = 0;
+    for (const auto& seg : segs) {
+        LARGE_INTEGER offset;
+        offset.QuadPart = static_cast<LONGLONG>(write_in.offset + bytes_written);
+
+        OVERLAPPED ov = {};
+        ov.Offset = offset.LowPart;
+        ov.OffsetHigh = offset.HighPart;
+
+        DWORD put = 0;
+        if (!WriteFile(fh->handle, seg.addr, seg.len, &put, &ov)) {
+            if (bytes_written > 0) break;
+            WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
+            return;
+        }
+        bytes_written += put;
+        if (put < seg.len) break;
     }
 #else
-    ssize_t bytes_written = ::pwrite(fh->handle, write_data, write_in->size,
-                                     static_cast<off_t>(write_in->offset));
+    std::vector<struct iovec> iov(segs.size());
+    for (size_t i = 0; i < segs.size(); i++) {
+        iov[i].iov_base = segs[i].addr;
+        iov[i].iov_len = segs[i].len;
+    }
+    ssize_t bytes_written = ::pwritev(fh->handle, iov.data(), static_cast<int>(iov.size()),
+                                      static_cast<off_t>(write_in.offset));
     if (bytes_written < 0) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
@@ -901,22 +1396,19 @@ void VirtioFsDevice::HandleRelease(const FuseInHeader*, const uint8_t* in_data)
 
 void VirtioFsDevice::HandleOpenDir(const FuseInHeader* in_hdr, const uint8_t*,
                                     std::vector<uint8_t>& out_buf) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     std::string path;
     std::string share_tag;
+    std::shared_ptr<InodeAnchor> anchor;
 
-    if (in_hdr->nodeid == VIRTUAL_ROOT_INODE) {
-        path = "";
-        share_tag = "";
-    } else {
-        auto it = inodes_.find(in_hdr->nodeid);
-        if (it == inodes_.end()) {
+    if (in_hdr->nodeid != VIRTUAL_ROOT_INODE) {
+        InodeInfo info;
+        if (!LookupInode(in_hdr->nodeid, &info)) {
             WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
             return;
         }
-        path = it->second.host_path;
-        share_tag = it->second.share_tag;
+        path = NodePath(info);
+        share_tag = info.share_tag;
+        anchor = info.anchor;
 
 #ifdef _WIN32
         DWORD attrs = GetFileAttributesW(Utf8ToWide(path).c_str());
@@ -941,8 +1433,7 @@ void VirtioFsDevice::HandleOpenDir(const FuseInHeader* in_hdr, const uint8_t*,
 #endif
     }
 
-    uint64_t fh = next_fh_++;
-    file_handles_[fh] = {FS_INVALID_HANDLE, true, path, share_tag};
+    uint64_t fh = AllocFileHandle(FS_INVALID_HANDLE, true, path, share_tag, std::move(anchor));
 
     FuseOutHeader out_hdr;
     FuseOpenOut open_out;
@@ -962,9 +1453,7 @@ void VirtioFsDevice::HandleReadDir(const FuseInHeader* in_hdr, const uint8_t* in
                                     std::vector<uint8_t>& out_buf) {
     auto* read_in = reinterpret_cast<const FuseReadIn*>(in_data);
     
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    FileHandle* fh = GetFileHandle(read_in->fh);
+    auto fh = GetFileHandle(read_in->fh);
     if (!fh) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
         return;
@@ -974,7 +1463,8 @@ void VirtioFsDevice::HandleReadDir(const FuseInHeader* in_hdr, const uint8_t* in
     uint64_t entry_offset = 0;
 
     if (fh->path.empty() && fh->share_tag.empty()) {
-        for (const auto& [tag, share] : shares_) {
+        for (const auto& share : GetShares()) {
+            const std::string& tag = share.tag;
             if (entry_offset < read_in->offset) {
                 entry_offset++;
                 continue;
@@ -1035,21 +1525,7 @@ void VirtioFsDevice::HandleReadDir(const FuseInHeader* in_hdr, const uint8_t* in
             std::string full_path = fh->path + "\\" + name;
             bool is_dir = (fdata.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
             
-            auto path_it = path_to_inode_.find(full_path);
-            uint64_t inode;
-            if (path_it != path_to_inode_.end()) {
-                inode = path_it->second;
-            } else {
-                inode = next_inode_++;
-                InodeInfo info;
-                info.inode = inode;
-                info.host_path = full_path;
-                info.nlookup = 0;
-                info.is_dir = is_dir;
-                info.share_tag = fh->share_tag;
-                inodes_[inode] = info;
-                path_to_inode_[full_path] = inode;
-            }
+            uint64_t inode = GetOrCreateInode(full_path, is_dir, fh->share_tag, false);
 
             dirent.ino = inode;
             dirent.off = entry_offset + 1;
@@ -1066,71 +1542,11 @@ void VirtioFsDevice::HandleReadDir(const FuseInHeader* in_hdr, const uint8_t* in
 
         FindClose(hFind);
 #else
-        DIR* dp = ::opendir(fh->path.c_str());
-        if (!dp) {
-            WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
+        int32_t err = ReadDirStream(*fh, nullptr, *read_in, false, ShareInfo{}, dir_buf);
+        if (err != FUSE_OK) {
+            WriteErrorResponse(out_buf, in_hdr->unique, err);
             return;
         }
-
-        struct dirent* de;
-        while ((de = ::readdir(dp)) != nullptr) {
-            std::string name(de->d_name);
-
-            if (entry_offset < read_in->offset) {
-                entry_offset++;
-                continue;
-            }
-
-            uint32_t name_len = static_cast<uint32_t>(name.size());
-            uint32_t entry_size = sizeof(FuseDirent) + name_len;
-            entry_size = (entry_size + 7) & ~7;
-
-            if (dir_buf.size() + entry_size > read_in->size) {
-                break;
-            }
-
-            FuseDirent fuse_dirent;
-            memset(&fuse_dirent, 0, sizeof(fuse_dirent));
-
-            std::string full_path = fh->path + "/" + name;
-            bool is_dir = (de->d_type == DT_DIR);
-            if (de->d_type == DT_UNKNOWN) {
-                struct stat st;
-                if (::stat(full_path.c_str(), &st) == 0) {
-                    is_dir = S_ISDIR(st.st_mode);
-                }
-            }
-
-            auto path_it = path_to_inode_.find(full_path);
-            uint64_t inode;
-            if (path_it != path_to_inode_.end()) {
-                inode = path_it->second;
-            } else {
-                inode = next_inode_++;
-                InodeInfo info;
-                info.inode = inode;
-                info.host_path = full_path;
-                info.nlookup = 0;
-                info.is_dir = is_dir;
-                info.share_tag = fh->share_tag;
-                inodes_[inode] = info;
-                path_to_inode_[full_path] = inode;
-            }
-
-            fuse_dirent.ino = inode;
-            fuse_dirent.off = entry_offset + 1;
-            fuse_dirent.namelen = name_len;
-            fuse_dirent.type = is_dir ? (FUSE_S_IFDIR >> 12) : (FUSE_S_IFREG >> 12);
-
-            size_t old_size = dir_buf.size();
-            dir_buf.resize(old_size + entry_size);
-            memcpy(dir_buf.data() + old_size, &fuse_dirent, sizeof(fuse_dirent));
-            memcpy(dir_buf.data() + old_size + sizeof(fuse_dirent), name.c_str(), name_len);
-
-            entry_offset++;
-        }
-
-        ::closedir(dp);
 #endif
     }
 
@@ -1150,9 +1566,7 @@ void VirtioFsDevice::HandleReadDirPlus(const FuseInHeader* in_hdr, const uint8_t
                                         std::vector<uint8_t>& out_buf) {
     auto* read_in = reinterpret_cast<const FuseReadIn*>(in_data);
     
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    FileHandle* fh = GetFileHandle(read_in->fh);
+    auto fh = GetFileHandle(read_in->fh);
     if (!fh) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
         return;
@@ -1162,7 +1576,8 @@ void VirtioFsDevice::HandleReadDirPlus(const FuseInHeader* in_hdr, const uint8_t
     uint64_t entry_offset = 0;
 
     if (fh->path.empty() && fh->share_tag.empty()) {
-        for (const auto& [tag, share] : shares_) {
+        for (const auto& share : GetShares()) {
+            const std::string& tag = share.tag;
             if (entry_offset < read_in->offset) {
                 entry_offset++;
                 continue;
@@ -1198,11 +1613,9 @@ void VirtioFsDevice::HandleReadDirPlus(const FuseInHeader* in_hdr, const uint8_t
             entry_offset++;
         }
     } else {
-        bool share_readonly = false;
-        {
-            auto sit = shares_.find(fh->share_tag);
-            if (sit != shares_.end()) share_readonly = sit->second.readonly;
-        }
+        // Left at its defaults (writable) if the share went away.
+        ShareInfo share;
+        FindShare(fh->share_tag, &share);
 
 #ifdef _WIN32
         std::wstring search_path = Utf8ToWide(fh->path + "\\*");
@@ -1233,30 +1646,16 @@ void VirtioFsDevice::HandleReadDirPlus(const FuseInHeader* in_hdr, const uint8_t
             std::string full_path = fh->path + "\\" + name;
             bool is_dir = (fdata.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
             
-            auto path_it = path_to_inode_.find(full_path);
-            uint64_t inode;
-            if (path_it != path_to_inode_.end()) {
-                inode = path_it->second;
-            } else {
-                inode = next_inode_++;
-                InodeInfo info;
-                info.inode = inode;
-                info.host_path = full_path;
-                info.nlookup = 0;
-                info.is_dir = is_dir;
-                info.share_tag = fh->share_tag;
-                inodes_[inode] = info;
-                path_to_inode_[full_path] = inode;
-            }
+            uint64_t inode = GetOrCreateInode(full_path, is_dir, fh->share_tag, false);
 
             FuseDirentplus direntplus;
             memset(&direntplus, 0, sizeof(direntplus));
             
             direntplus.entry_out.nodeid = inode;
             direntplus.entry_out.generation = 1;
-            direntplus.entry_out.entry_valid = 1;
-            direntplus.entry_out.attr_valid = 1;
-            FillAttr(full_path, &direntplus.entry_out.attr, inode, share_readonly);
+            direntplus.entry_out.entry_valid = CacheTimeout(share.cache);
+            direntplus.entry_out.attr_valid = CacheTimeout(share.cache);
+            FillAttr(full_path, &direntplus.entry_out.attr, inode, share.readonly);
 
             direntplus.dirent.ino = inode;
             direntplus.dirent.off = entry_offset + 1;
@@ -1273,91 +1672,149 @@ void VirtioFsDevice::HandleReadDirPlus(const FuseInHeader* in_hdr, const uint8_t
 
         FindClose(hFind);
 #else
-        DIR* dp = ::opendir(fh->path.c_str());
-        if (!dp) {
-            WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
+        InodeInfo parent;
+        if (!LookupInode(in_hdr->nodeid, &parent)) {
+            WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
             return;
         }
+        int32_t err = ReadDirStream(*fh, &parent, *read_in, true, share, dir_buf);
+        if (err != FUSE_OK) {
+            WriteErrorResponse(out_buf, in_hdr->unique, err);
+            return;
+        }
+#endif
+    }
 
-        struct dirent* de;
-        while ((de = ::readdir(dp)) != nullptr) {
-            std::string name(de->d_name);
-
-            if (entry_offset < read_in->offset) {
-                entry_offset++;
-                continue;
-            }
+    FuseOutHeader out_hdr;
+    out_hdr.len = sizeof(FuseOutHeader) + static_cast<uint32_t>(dir_buf.size());
+    out_hdr.error = 0;
+    out_hdr.unique = in_hdr->unique;
 
-            uint32_t name_len = static_cast<uint32_t>(name.size());
-            uint32_t entry_size = sizeof(FuseDirentplus) + name_len;
-            entry_size = (entry_size + 7) & ~7;
+    out_buf.resize(out_hdr.len);
+    memcpy(out_buf.data(), &out_hdr, sizeof(out_hdr));
+    if (!dir_buf.empty()) {
+        memcpy(out_buf.data() + sizeof(out_hdr), dir_buf.data(), dir_buf.size());
+    }
+}
 
-            if (dir_buf.size() + entry_size > read_in->size) {
-                break;
-            }
+#ifndef _WIN32
+// POSIX hosts report the host inode number, so attributes, plain READDIR
+// entries and hard links agree without the directory walk touching the
+// inode table.
+static void FillAttrFromStat(const struct stat& st, FuseAttr* attr, bool share_readonly) {
+    memset(attr, 0, sizeof(*attr));
+    attr->ino = static_cast<uint64_t>(st.st_ino);
+    attr->size = static_cast<uint64_t>(st.st_size);
+    attr->blocks = static_cast<uint64_t>(st.st_blocks);
+    attr->nlink = static_cast<uint32_t>(st.st_nlink);
 
-            std::string full_path = fh->path + "/" + name;
-            bool is_dir = (de->d_type == DT_DIR);
-            if (de->d_type == DT_UNKNOWN) {
-                struct stat st;
-                if (::stat(full_path.c_str(), &st) == 0) {
-                    is_dir = S_ISDIR(st.st_mode);
-                }
-            }
+    // macOS uses st_atimespec/st_mtimespec/st_ctimespec
+    attr->atime = static_cast<uint64_t>(st.st_atimespec.tv_sec);
+    attr->atimensec = static_cast<uint32_t>(st.st_atimespec.tv_nsec);
+    attr->mtime = static_cast<uint64_t>(st.st_mtimespec.tv_sec);
+    attr->mtimensec = static_cast<uint32_t>(st.st_mtimespec.tv_nsec);
+    attr->ctime = static_cast<uint64_t>(st.st_ctimespec.tv_sec);
+    attr->ctimensec = static_cast<uint32_t>(st.st_ctimespec.tv_nsec);
 
-            auto path_it = path_to_inode_.find(full_path);
-            uint64_t inode;
-            if (path_it != path_to_inode_.end()) {
-                inode = path_it->second;
-            } else {
-                inode = next_inode_++;
-                InodeInfo info;
-                info.inode = inode;
-                info.host_path = full_path;
-                info.nlookup = 0;
-                info.is_dir = is_dir;
-                info.share_tag = fh->share_tag;
-                inodes_[inode] = info;
-                path_to_inode_[full_path] = inode;
-            }
+    if (S_ISDIR(st.st_mode)) {
+        attr->mode = FUSE_S_IFDIR | 0777;
+    } else if (S_ISLNK(st.st_mode)) {
+        attr->mode = FUSE_S_IFLNK | 0777;
+    } else {
+        attr->mode = FUSE_S_IFREG | 0666;
+    }
 
-            FuseDirentplus direntplus;
-            memset(&direntplus, 0, sizeof(direntplus));
+    if (share_readonly || !(st.st_mode & S_IWUSR)) {
+        attr->mode &= ~0222;
+    }
 
-            direntplus.entry_out.nodeid = inode;
-            direntplus.entry_out.generation = 1;
-            direntplus.entry_out.entry_valid = 1;
-            direntplus.entry_out.attr_valid = 1;
-            FillAttr(full_path, &direntplus.entry_out.attr, inode, share_readonly);
+    attr->uid = 0;
+    attr->gid = 0;
+    attr->blksize = 4096;
+}
 
-            direntplus.dirent.ino = inode;
-            direntplus.dirent.off = entry_offset + 1;
-            direntplus.dirent.namelen = name_len;
-            direntplus.dirent.type = is_dir ? (FUSE_S_IFDIR >> 12) : (FUSE_S_IFREG >> 12);
+// Continue listing fh.dir from the guest's cookie. The DIR* stays open for
+// the handle's lifetime, so a directory is walked once in total instead of
+// being reopened and skipped forward on every call; cookies are telldir()
+// positions, so seekdir() resumes exactly where the last reply stopped. An
+// entry that does not fit is rewound and returned by the next call.
+int32_t VirtioFsDevice::ReadDirStream(FileHandle& fh, const InodeInfo* parent,
+                                      const FuseReadIn& read_in, bool plus,
+                                      const ShareInfo& share, std::vector<uint8_t>& dir_buf) {
+    std::lock_guard<std::mutex> lock(fh.dir_mutex);
+    if (!fh.dir) {
+        fh.dir = ::opendir(fh.path.c_str());
+        if (!fh.dir) return PlatformErrorToFuse();
+    }
+
+    if (read_in.offset == 0) {
+        ::rewinddir(fh.dir);
+    } else if (static_cast<uint64_t>(::telldir(fh.dir)) != read_in.offset) {
+        ::seekdir(fh.dir, static_cast<long>(read_in.offset));
+    }
+
+    const size_t header_size = plus ? sizeof(FuseDirentplus) : sizeof(FuseDirent);
+    for (;;) {
+        long pos = ::telldir(fh.dir);
+        errno = 0;
+        struct dirent* de = ::readdir(fh.dir);
+        if (!de) {
+            if (errno != 0 && dir_buf.empty()) return PlatformErrorToFuse();
+            break;
+        }
 
-            size_t old_size = dir_buf.size();
-            dir_buf.resize(old_size + entry_size);
-            memcpy(dir_buf.data() + old_size, &direntplus, sizeof(direntplus));
-            memcpy(dir_buf.data() + old_size + sizeof(direntplus), name.c_str(), name_len);
+        std::string name(de->d_name);
+        uint32_t name_len = static_cast<uint32_t>(name.size());
+        uint32_t entry_size = static_cast<uint32_t>(header_size) + name_len;
+        entry_size = (entry_size + 7) & ~7;
 
-            entry_offset++;
+        if (dir_buf.size() + entry_size > read_in.size) {
+            ::seekdir(fh.dir, pos);
+            break;
         }
 
-        ::closedir(dp);
-#endif
-    }
+        FuseDirentplus direntplus;
+        memset(&direntplus, 0, sizeof(direntplus));
+        bool is_dir = de->d_type == DT_DIR;
+        if (plus) {
+            // READDIRPLUS replies are LOOKUPs: each entry takes a lookup
+            // reference the kernel later FORGETs. "." and ".." go out with
+            // nodeid 0, which the kernel never instantiates, and so does an
+            // entry that vanished since readdir() returned it.
+            FuseEntryOut& entry = direntplus.entry_out;
+            bool dot = name == "." || name == "..";
+            if (!dot && parent &&
+                LookupChild(*parent, name, share.readonly, &entry.nodeid, &entry.attr) == FUSE_OK) {
+                entry.generation = 1;
+                entry.entry_valid = CacheTimeout(share.cache);
+                entry.attr_valid = CacheTimeout(share.cache);
+                is_dir = (entry.attr.mode & FUSE_S_IFMT) == FUSE_S_IFDIR;
+            }
+        } else if (de->d_type == DT_UNKNOWN) {
+            // Plain READDIR only stats when the filesystem does not report
+            // d_type.
+            struct stat st;
+            is_dir = ::fstatat(::dirfd(fh.dir), de->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+        }
 
-    FuseOutHeader out_hdr;
-    out_hdr.len = sizeof(FuseOutHeader) + static_cast<uint32_t>(dir_buf.size());
-    out_hdr.error = 0;
-    out_hdr.unique = in_hdr->unique;
+        FuseDirent& fuse_dirent = direntplus.dirent;
+        fuse_dirent.ino = static_cast<uint64_t>(de->d_ino);
+        fuse_dirent.off = static_cast<uint64_t>(::telldir(fh.dir));
+        fuse_dirent.namelen = name_len;
+        fuse_dirent.type = is_dir ? (FUSE_S_IFDIR >> 12) : (FUSE_S_IFREG >> 12);
 
-    out_buf.resize(out_hdr.len);
-    memcpy(out_buf.data(), &out_hdr, sizeof(out_hdr));
-    if (!dir_buf.empty()) {
-        memcpy(out_buf.data() + sizeof(out_hdr), dir_buf.data(), dir_buf.size());
+        size_t old_size = dir_buf.size();
+        dir_buf.resize(old_size + entry_size);
+        if (plus) {
+            memcpy(dir_buf.data() + old_size, &direntplus, sizeof(direntplus));
+        } else {
+            memcpy(dir_buf.data() + old_size, &fuse_dirent, sizeof(fuse_dirent));
+        }
+        memcpy(dir_buf.data() + old_size + header_size, name.c_str(), name_len);
     }
+    return FUSE_OK;
 }
+#endif
 
 void VirtioFsDevice::HandleReleaseDir(const FuseInHeader*, const uint8_t* in_data) {
     auto* release_in = reinterpret_cast<const FuseReleaseIn*>(in_data);
@@ -1369,15 +1826,13 @@ void VirtioFsDevice::HandleStatFs(const FuseInHeader* in_hdr, std::vector<uint8_
     FuseStatfsOut statfs_out;
     memset(&statfs_out, 0, sizeof(statfs_out));
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    
     uint64_t total_blocks = 0;
     uint64_t free_blocks = 0;
     uint64_t avail_blocks = 0;
     uint64_t block_size = 4096;
     bool got_stats = false;
 
-    for (const auto& [tag, share] : shares_) {
+    for (const auto& share : GetShares()) {
 #ifdef _WIN32
         ULARGE_INTEGER free_bytes, total_bytes, total_free;
         if (GetDiskFreeSpaceExW(Utf8ToWide(share.host_path).c_str(), &free_bytes, &total_bytes, &total_free)) {
@@ -1435,23 +1890,22 @@ void VirtioFsDevice::HandleCreate(const FuseInHeader* in_hdr, const uint8_t* in_
         return;
     }
 
-    std::string share_tag = NodeIdToShareTag(in_hdr->nodeid);
-    if (IsShareReadonly(share_tag)) {
-        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
+    InodeInfo parent;
+    if (!LookupInode(in_hdr->nodeid, &parent)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
         return;
     }
-
-    auto* create_in = reinterpret_cast<const FuseCreateIn*>(in_data);
-    const char* name = reinterpret_cast<const char*>(in_data + sizeof(FuseCreateIn));
-    size_t name_len = strnlen(name, in_len - sizeof(FuseCreateIn));
-
-    std::string parent_path = NodeIdToPath(in_hdr->nodeid);
-    if (parent_path.empty()) {
-        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+    ShareInfo share_info;
+    FindShare(parent.share_tag, &share_info);
+    if (share_info.readonly) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
         return;
     }
 
-    std::string file_path = parent_path + kPathSep + std::string(name, name_len);
+    auto* create_in = reinterpret_cast<const FuseCreateIn*>(in_data);
+    const char* name_ptr = reinterpret_cast<const char*>(in_data + sizeof(FuseCreateIn));
+    std::string name(name_ptr, strnlen(name_ptr, in_len - sizeof(FuseCreateIn)));
+    std::string file_path = ChildPath(parent, name);
 
 #ifdef _WIN32
     DWORD access = GENERIC_READ | GENERIC_WRITE;
@@ -1465,15 +1919,16 @@ void VirtioFsDevice::HandleCreate(const FuseInHeader* in_hdr, const uint8_t* in_
     }
 #else
     mode_t mode = create_in->mode ? (create_in->mode & 0777) : 0666;
-    int h = ::open(file_path.c_str(), O_CREAT | O_EXCL | O_RDWR, mode);
+    std::string rel;
+    int dir_fd = ChildAt(parent, name, &rel);
+    int h = ::openat(dir_fd, rel.c_str(), O_CREAT | O_EXCL | O_RDWR, mode);
     if (h < 0) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
 #endif
 
-    uint64_t inode = GetOrCreateInode(file_path, false, share_tag);
-    uint64_t fh = AllocFileHandle(h, false, file_path, share_tag);
+    uint64_t fh = AllocFileHandle(h, false, file_path, parent.share_tag, parent.anchor);
 
     FuseOutHeader out_hdr;
     FuseEntryOut entry_out;
@@ -1481,13 +1936,18 @@ void VirtioFsDevice::HandleCreate(const FuseInHeader* in_hdr, const uint8_t* in_
     memset(&entry_out, 0, sizeof(entry_out));
     memset(&open_out, 0, sizeof(open_out));
 
-    entry_out.nodeid = inode;
+    int32_t err = LookupChild(parent, name, false, &entry_out.nodeid, &entry_out.attr);
+    if (err != FUSE_OK) {
+        CloseFileHandle(fh);
+        WriteErrorResponse(out_buf, in_hdr->unique, err);
+        return;
+    }
     entry_out.generation = 1;
-    entry_out.entry_valid = 1;
-    entry_out.attr_valid = 1;
-    FillAttr(file_path, &entry_out.attr, inode);
+    entry_out.entry_valid = CacheTimeout(share_info.cache);
+    entry_out.attr_valid = CacheTimeout(share_info.cache);
 
     open_out.fh = fh;
+    open_out.open_flags = OpenFlags(share_info, writeback_);
 
     out_hdr.len = sizeof(FuseOutHeader) + sizeof(FuseEntryOut) + sizeof(FuseOpenOut);
     out_hdr.error = 0;
@@ -1506,48 +1966,49 @@ void VirtioFsDevice::HandleMkdir(const FuseInHeader* in_hdr, const uint8_t* in_d
         return;
     }
 
-    std::string share_tag = NodeIdToShareTag(in_hdr->nodeid);
-    if (IsShareReadonly(share_tag)) {
-        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
+    InodeInfo parent;
+    if (!LookupInode(in_hdr->nodeid, &parent)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
         return;
     }
-
-    const char* name = reinterpret_cast<const char*>(in_data + sizeof(FuseMkdirIn));
-    size_t name_len = strnlen(name, in_len - sizeof(FuseMkdirIn));
-
-    std::string parent_path = NodeIdToPath(in_hdr->nodeid);
-    if (parent_path.empty()) {
-        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+    ShareInfo share_info;
+    FindShare(parent.share_tag, &share_info);
+    if (share_info.readonly) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
         return;
     }
 
-    std::string dir_path = parent_path + kPathSep + std::string(name, name_len);
+    const char* name_ptr = reinterpret_cast<const char*>(in_data + sizeof(FuseMkdirIn));
+    std::string name(name_ptr, strnlen(name_ptr, in_len - sizeof(FuseMkdirIn)));
 
 #ifdef _WIN32
-    if (!CreateDirectoryW(Utf8ToWide(dir_path).c_str(), nullptr)) {
+    if (!CreateDirectoryW(Utf8ToWide(ChildPath(parent, name)).c_str(), nullptr)) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
 #else
     auto* mkdir_in = reinterpret_cast<const FuseMkdirIn*>(in_data);
     mode_t mode = mkdir_in->mode ? (mkdir_in->mode & 0777) : 0777;
-    if (::mkdir(dir_path.c_str(), mode) != 0) {
+    std::string rel;
+    int dir_fd = ChildAt(parent, name, &rel);
+    if (::mkdirat(dir_fd, rel.c_str(), mode) != 0) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
 #endif
 
-    uint64_t inode = GetOrCreateInode(dir_path, true, share_tag);
-
     FuseOutHeader out_hdr;
     FuseEntryOut entry_out;
     memset(&entry_out, 0, sizeof(entry_out));
 
-    entry_out.nodeid = inode;
+    int32_t err = LookupChild(parent, name, false, &entry_out.nodeid, &entry_out.attr);
+    if (err != FUSE_OK) {
+        WriteErrorResponse(out_buf, in_hdr->unique, err);
+        return;
+    }
     entry_out.generation = 1;
-    entry_out.entry_valid = 1;
-    entry_out.attr_valid = 1;
-    FillAttr(dir_path, &entry_out.attr, inode);
+    entry_out.entry_valid = CacheTimeout(share_info.cache);
+    entry_out.attr_valid = CacheTimeout(share_info.cache);
 
     out_hdr.len = sizeof(FuseOutHeader) + sizeof(FuseEntryOut);
     out_hdr.error = 0;
@@ -1565,8 +2026,12 @@ void VirtioFsDevice::HandleUnlink(const FuseInHeader* in_hdr, const uint8_t* in_
         return;
     }
 
-    std::string share_tag = NodeIdToShareTag(in_hdr->nodeid);
-    if (IsShareReadonly(share_tag)) {
+    InodeInfo parent;
+    if (!LookupInode(in_hdr->nodeid, &parent)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+        return;
+    }
+    if (IsShareReadonly(parent.share_tag)) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
         return;
     }
@@ -1574,27 +2039,23 @@ void VirtioFsDevice::HandleUnlink(const FuseInHeader* in_hdr, const uint8_t* in_
     std::string name(reinterpret_cast<const char*>(in_data), 
                      strnlen(reinterpret_cast<const char*>(in_data), in_len));
 
-    std::string parent_path = NodeIdToPath(in_hdr->nodeid);
-    if (parent_path.empty()) {
-        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
-        return;
-    }
-
-    std::string file_path = parent_path + kPathSep + name;
-
 #ifdef _WIN32
-    if (!DeleteFileW(Utf8ToWide(file_path).c_str())) {
+    if (!DeleteFileW(Utf8ToWide(ChildPath(parent, name)).c_str())) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
 #else
-    if (::unlink(file_path.c_str()) != 0) {
+    std::string rel;
+    int dir_fd = ChildAt(parent, name, &rel);
+    if (::unlinkat(dir_fd, rel.c_str(), 0) != 0) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
 #endif
 
-    RemoveInodeByPath(file_path);
+#if !defined(__linux__)
+    RemoveInodeByPath(ChildPath(parent, name));
+#endif
     WriteErrorResponse(out_buf, in_hdr->unique, FUSE_OK);
 }
 
@@ -1605,8 +2066,12 @@ void VirtioFsDevice::HandleRmdir(const FuseInHeader* in_hdr, const uint8_t* in_d
         return;
     }
 
-    std::string share_tag = NodeIdToShareTag(in_hdr->nodeid);
-    if (IsShareReadonly(share_tag)) {
+    InodeInfo parent;
+    if (!LookupInode(in_hdr->nodeid, &parent)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+        return;
+    }
+    if (IsShareReadonly(parent.share_tag)) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
         return;
     }
@@ -1614,27 +2079,23 @@ void VirtioFsDevice::HandleRmdir(const FuseInHeader* in_hdr, const uint8_t* in_d
     std::string name(reinterpret_cast<const char*>(in_data), 
                      strnlen(reinterpret_cast<const char*>(in_data), in_len));
 
-    std::string parent_path = NodeIdToPath(in_hdr->nodeid);
-    if (parent_path.empty()) {
-        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
-        return;
-    }
-
-    std::string dir_path = parent_path + kPathSep + name;
-
 #ifdef _WIN32
-    if (!RemoveDirectoryW(Utf8ToWide(dir_path).c_str())) {
+    if (!RemoveDirectoryW(Utf8ToWide(ChildPath(parent, name)).c_str())) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
 #else
-    if (::rmdir(dir_path.c_str()) != 0) {
+    std::string rel;
+    int dir_fd = ChildAt(parent, name, &rel);
+    if (::unlinkat(dir_fd, rel.c_str(), AT_REMOVEDIR) != 0) {
         WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
 #endif
 
-    RemoveInodeByPath(dir_path);
+#if !defined(__linux__)
+    RemoveInodeByPath(ChildPath(parent, name));
+#endif
     WriteErrorResponse(out_buf, in_hdr->unique, FUSE_OK);
 }
 
@@ -1645,13 +2106,19 @@ void VirtioFsDevice::HandleRename(const FuseInHeader* in_hdr, const uint8_t* in_
         return;
     }
 
-    std::string share_tag = NodeIdToShareTag(in_hdr->nodeid);
-    if (IsShareReadonly(share_tag)) {
+    auto* rename_in = reinterpret_cast<const FuseRenameIn*>(in_data);
+    InodeInfo old_parent;
+    InodeInfo new_parent;
+    if (rename_in->newdir == VIRTUAL_ROOT_INODE || !LookupInode(in_hdr->nodeid, &old_parent) ||
+        !LookupInode(rename_in->newdir, &new_parent)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+        return;
+    }
+    if (IsShareReadonly(old_parent.share_tag) || IsShareReadonly(new_parent.share_tag)) {
         WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
         return;
     }
 
-    auto* rename_in = reinterpret_cast<const FuseRenameIn*>(in_data);
     const char* names = reinterpret_cast<const char*>(in_data + sizeof(FuseRenameIn));
     size_t names_len = in_len - sizeof(FuseRenameIn);
 
@@ -1662,37 +2129,30 @@ void VirtioFsDevice::HandleRename(const FuseInHeader* in_hdr, const uint8_t* in_
     size_t remaining = names_len - old_name_len - 1;
     std::string new_name(new_name_ptr, strnlen(new_name_ptr, remaining));
 
-    std::string old_parent_path = NodeIdToPath(in_hdr->nodeid);
-    std::string new_parent_path = NodeIdToPath(rename_in->newdir);
-    
-    if (old_parent_path.empty() || new_parent_path.empty()) {
-        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+#ifdef _WIN32
+    if (!MoveFileExW(Utf8ToWide(ChildPath(old_parent, old_name)).c_str(),
+                     Utf8ToWide(ChildPath(new_parent, new_name)).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
-
-    std::string new_share_tag = NodeIdToShareTag(rename_in->newdir);
-    if (IsShareReadonly(new_share_tag)) {
-        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
+#else
+    std::string old_rel;
+    std::string new_rel;
+    int old_dir_fd = ChildAt(old_parent, old_name, &old_rel);
+    int new_dir_fd = ChildAt(new_parent, new_name, &new_rel);
+    if (::renameat(old_dir_fd, old_rel.c_str(), new_dir_fd, new_rel.c_str()) != 0) {
+        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
         return;
     }
+#endif
 
-    std::string old_path = old_parent_path + kPathSep + old_name;
-    std::string new_path = new_parent_path + kPathSep + new_name;
-
-#ifdef _WIN32
-    if (!MoveFileExW(Utf8ToWide(old_path).c_str(), Utf8ToWide(new_path).c_str(), MOVEFILE_REPLACE_EXISTING)) {
-        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
-        return;
-    }
-#else
-    if (::rename(old_path.c_str(), new_path.c_str()) != 0) {
-        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
-        return;
-    }
-#endif
-
+    // Anchored inodes follow the file through a rename; only the path-keyed
+    // table has to be rewritten.
+#if !defined(__linux__)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::string old_path = ChildPath(old_parent, old_name);
+        std::string new_path = ChildPath(new_parent, new_name);
+        std::lock_guard<std::mutex> lock(inode_mutex_);
 
         auto HasPrefix = [](const std::string& path, const std::string& prefix) -> bool {
             if (path.size() < prefix.size()) return false;
@@ -1736,13 +2196,14 @@ void VirtioFsDevice::HandleRename(const FuseInHeader* in_hdr, const uint8_t* in_
             }
         }
     }
+#endif
 
     WriteErrorResponse(out_buf, in_hdr->unique, FUSE_OK);
 }
 
 void VirtioFsDevice::HandleFlush(const FuseInHeader*, const uint8_t* in_data) {
     auto* release_in = reinterpret_cast<const FuseReleaseIn*>(in_data);
-    FileHandle* fh = GetFileHandle(release_in->fh);
+    auto fh = GetFileHandle(release_in->fh);
     if (fh && fh->handle != FS_INVALID_HANDLE) {
 #ifdef _WIN32
         FlushFileBuffers(fh->handle);
@@ -1754,7 +2215,7 @@ void VirtioFsDevice::HandleFlush(const FuseInHeader*, const uint8_t* in_data) {
 
 void VirtioFsDevice::HandleFsync(const FuseInHeader*, const uint8_t* in_data) {
     auto* release_in = reinterpret_cast<const FuseReleaseIn*>(in_data);
-    FileHandle* fh = GetFileHandle(release_in->fh);
+    auto fh = GetFileHandle(release_in->fh);
     if (fh && fh->handle != FS_INVALID_HANDLE) {
 #ifdef _WIN32
         FlushFileBuffers(fh->handle);
@@ -1764,6 +2225,236 @@ void VirtioFsDevice::HandleFsync(const FuseInHeader*, const uint8_t* in_data) {
     }
 }
 
+void VirtioFsDevice::HandleFallocate(const FuseInHeader* in_hdr, const uint8_t* in_data,
+                                     uint32_t in_len, std::vector<uint8_t>& out_buf) {
+    if (in_len < sizeof(FuseFallocateIn)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+    auto* fallocate_in = reinterpret_cast<const FuseFallocateIn*>(in_data);
+
+    auto fh = GetFileHandle(fallocate_in->fh);
+    if (!fh || fh->handle == FS_INVALID_HANDLE) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+        return;
+    }
+    if (IsShareReadonly(fh->share_tag)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
+        return;
+    }
+
+#if defined(__linux__)
+    // The guest's FALLOC_FL_* bits are the host's: preallocation,
+    // KEEP_SIZE, PUNCH_HOLE and ZERO_RANGE all pass straight through.
+    int32_t result = FUSE_OK;
+    if (::fallocate(fh->handle, static_cast<int>(fallocate_in->mode),
+                    static_cast<off_t>(fallocate_in->offset),
+                    static_cast<off_t>(fallocate_in->length)) != 0) {
+        result = PlatformErrorToFuse();
+    }
+    WriteErrorResponse(out_buf, in_hdr->unique, result);
+#else
+    // No host call with Linux fallocate() semantics. EOPNOTSUPP (unlike
+    // ENOSYS) is passed to the guest caller per request, so
+    // posix_fallocate() falls back to writing zeroes.
+    WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EOPNOTSUPP);
+#endif
+}
+
+void VirtioFsDevice::HandleLseek(const FuseInHeader* in_hdr, const uint8_t* in_data,
+                                 uint32_t in_len, std::vector<uint8_t>& out_buf) {
+    if (in_len < sizeof(FuseLseekIn)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+    auto* lseek_in = reinterpret_cast<const FuseLseekIn*>(in_data);
+    if (lseek_in->whence != FUSE_SEEK_DATA && lseek_in->whence != FUSE_SEEK_HOLE) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+
+    auto fh = GetFileHandle(lseek_in->fh);
+    if (!fh || fh->handle == FS_INVALID_HANDLE) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+        return;
+    }
+
+    FuseLseekOut lseek_out;
+    memset(&lseek_out, 0, sizeof(lseek_out));
+#ifdef _WIN32
+    // Report the whole file as data: always correct, just never sparse.
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fh->handle, &size)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
+        return;
+    }
+    uint64_t file_size = static_cast<uint64_t>(size.QuadPart);
+    if (lseek_in->offset >= file_size) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENXIO);
+        return;
+    }
+    lseek_out.offset = lseek_in->whence == FUSE_SEEK_DATA ? lseek_in->offset : file_size;
+#else
+    // Every read and write uses explicit offsets, so moving the shared
+    // file position here cannot disturb concurrent requests.
+    int whence = lseek_in->whence == FUSE_SEEK_DATA ? SEEK_DATA : SEEK_HOLE;
+    off_t pos = ::lseek(fh->handle, static_cast<off_t>(lseek_in->offset), whence);
+    if (pos < 0) {
+        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
+        return;
+    }
+    lseek_out.offset = static_cast<uint64_t>(pos);
+#endif
+
+    FuseOutHeader out_hdr;
+    out_hdr.len = sizeof(FuseOutHeader) + sizeof(FuseLseekOut);
+    out_hdr.error = 0;
+    out_hdr.unique = in_hdr->unique;
+
+    out_buf.resize(out_hdr.len);
+    memcpy(out_buf.data(), &out_hdr, sizeof(out_hdr));
+    memcpy(out_buf.data() + sizeof(out_hdr), &lseek_out, sizeof(lseek_out));
+}
+
+void VirtioFsDevice::HandleCopyFileRange(const FuseInHeader* in_hdr, const uint8_t* in_data,
+                                         uint32_t in_len, std::vector<uint8_t>& out_buf) {
+    if (in_len < sizeof(FuseCopyFileRangeIn)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+    auto* copy_in = reinterpret_cast<const FuseCopyFileRangeIn*>(in_data);
+    if (copy_in->flags != 0) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+
+    auto src = GetFileHandle(copy_in->fh_in);
+    auto dst = GetFileHandle(copy_in->fh_out);
+    if (!src || src->handle == FS_INVALID_HANDLE || !dst || dst->handle == FS_INVALID_HANDLE) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+        return;
+    }
+    if (IsShareReadonly(dst->share_tag)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
+        return;
+    }
+
+    // The reply count is 32 bits; the guest loops for the remainder.
+    uint64_t len = std::min<uint64_t>(copy_in->len, 1u << 30);
+    uint64_t copied = 0;
+    if (!CopyRangeHost(src->handle, copy_in->off_in, dst->handle, copy_in->off_out, len,
+                       &copied)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
+        return;
+    }
+
+    FuseOutHeader out_hdr;
+    FuseWriteOut write_out;
+    memset(&write_out, 0, sizeof(write_out));
+    write_out.size = static_cast<uint32_t>(copied);
+
+    out_hdr.len = sizeof(FuseOutHeader) + sizeof(FuseWriteOut);
+    out_hdr.error = 0;
+    out_hdr.unique = in_hdr->unique;
+
+    out_buf.resize(out_hdr.len);
+    memcpy(out_buf.data(), &out_hdr, sizeof(out_hdr));
+    memcpy(out_buf.data() + sizeof(out_hdr), &write_out, sizeof(write_out));
+}
+
+void VirtioFsDevice::EnableDax(uint8_t* window, uint64_t size) {
+    dax_window_ = window;
+    dax_window_size_ = size;
+    LOG_INFO("VirtIO FS: DAX window %" PRIu64 " MB", size >> 20);
+}
+
+void VirtioFsDevice::HandleSetupMapping(const FuseInHeader* in_hdr, const uint8_t* in_data,
+                                         uint32_t in_len, std::vector<uint8_t>& out_buf) {
+    if (!dax_window_) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOSYS);
+        return;
+    }
+    if (in_len < sizeof(FuseSetupMappingIn)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+
+    FuseSetupMappingIn map_in;
+    memcpy(&map_in, in_data, sizeof(map_in));
+    if (map_in.len == 0 || map_in.moffset > dax_window_size_ ||
+        map_in.len > dax_window_size_ - map_in.moffset ||
+        ((map_in.moffset | map_in.foffset | map_in.len) & (kPageSize - 1))) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+
+    auto fh = GetFileHandle(map_in.fh);
+    if (!fh || fh->handle == FS_INVALID_HANDLE) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOENT);
+        return;
+    }
+
+    bool writable = (map_in.flags & FUSE_SETUPMAPPING_FLAG_WRITE) != 0;
+    if (writable && IsShareReadonly(fh->share_tag)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EROFS);
+        return;
+    }
+
+#if defined(__linux__)
+    int prot = PROT_READ | (writable ? PROT_WRITE : 0);
+    void* addr = ::mmap(dax_window_ + map_in.moffset, map_in.len, prot,
+                        MAP_SHARED | MAP_FIXED, fh->handle,
+                        static_cast<off_t>(map_in.foffset));
+    if (addr == MAP_FAILED) {
+        WriteErrorResponse(out_buf, in_hdr->unique, PlatformErrorToFuse());
+        return;
+    }
+    WriteErrorResponse(out_buf, in_hdr->unique, FUSE_OK);
+#else
+    WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOSYS);
+#endif
+}
+
+void VirtioFsDevice::HandleRemoveMapping(const FuseInHeader* in_hdr, const uint8_t* in_data,
+                                          uint32_t in_len, std::vector<uint8_t>& out_buf) {
+    if (!dax_window_) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_ENOSYS);
+        return;
+    }
+    if (in_len < sizeof(FuseRemoveMappingIn)) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+
+    FuseRemoveMappingIn remove_in;
+    memcpy(&remove_in, in_data, sizeof(remove_in));
+    size_t avail = (in_len - sizeof(FuseRemoveMappingIn)) / sizeof(FuseRemoveMappingOne);
+    if (remove_in.count > avail) {
+        WriteErrorResponse(out_buf, in_hdr->unique, FUSE_EINVAL);
+        return;
+    }
+
+    int32_t result = FUSE_OK;
+    for (uint32_t i = 0; i < remove_in.count; i++) {
+        FuseRemoveMappingOne one;
+        memcpy(&one, in_data + sizeof(FuseRemoveMappingIn) + i * sizeof(one), sizeof(one));
+        if (one.len == 0 || one.moffset > dax_window_size_ ||
+            one.len > dax_window_size_ - one.moffset ||
+            ((one.moffset | one.len) & (kPageSize - 1))) {
+            result = FUSE_EINVAL;
+            continue;
+        }
+#if defined(__linux__)
+        // Put the PROT_NONE reservation back; the window must never contain a
+        // hole another allocation could land in.
+        void* addr = ::mmap(dax_window_ + one.moffset, one.len, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        if (addr == MAP_FAILED) result = PlatformErrorToFuse();
+#endif
+    }
+    WriteErrorResponse(out_buf, in_hdr->unique, result);
+}
+
 int32_t VirtioFsDevice::FillAttr(const std::string& path, FuseAttr* attr, uint64_t inode, bool share_readonly) {
 #ifdef _WIN32
     WIN32_FILE_ATTRIBUTE_DATA fad;
@@ -1804,47 +2495,38 @@ int32_t VirtioFsDevice::FillAttr(const std::string& path, FuseAttr* attr, uint64
     if (share_readonly || host_readonly) {
         attr->mode &= ~0222;
     }
+
+    attr->uid = 0;
+    attr->gid = 0;
+    attr->blksize = 4096;
+    return FUSE_OK;
 #else
+    (void)inode;
     struct stat st;
     if (::stat(path.c_str(), &st) != 0) {
         return PlatformErrorToFuse();
     }
+    FillAttrFromStat(st, attr, share_readonly);
+    return FUSE_OK;
+#endif
+}
 
-    memset(attr, 0, sizeof(*attr));
-    attr->ino = inode;
-    attr->size = static_cast<uint64_t>(st.st_size);
-    attr->blocks = static_cast<uint64_t>(st.st_blocks);
-    attr->nlink = static_cast<uint32_t>(st.st_nlink);
-
-    // macOS uses st_atimespec/st_mtimespec/st_ctimespec
-    attr->atime = static_cast<uint64_t>(st.st_atimespec.tv_sec);
-    attr->atimensec = static_cast<uint32_t>(st.st_atimespec.tv_nsec);
-    attr->mtime = static_cast<uint64_t>(st.st_mtimespec.tv_sec);
-    attr->mtimensec = static_cast<uint32_t>(st.st_mtimespec.tv_nsec);
-    attr->ctime = static_cast<uint64_t>(st.st_ctimespec.tv_sec);
-    attr->ctimensec = static_cast<uint32_t>(st.st_ctimespec.tv_nsec);
-
-    if (S_ISDIR(st.st_mode)) {
-        attr->mode = FUSE_S_IFDIR | 0777;
-    } else if (S_ISLNK(st.st_mode)) {
-        attr->mode = FUSE_S_IFLNK | 0777;
-    } else {
-        attr->mode = FUSE_S_IFREG | 0666;
-    }
-
-    if (share_readonly || !(st.st_mode & S_IWUSR)) {
-        attr->mode &= ~0222;
+int32_t VirtioFsDevice::GetNodeAttr(const InodeInfo& info, bool share_readonly, FuseAttr* attr) {
+#if defined(__linux__)
+    if (info.anchor) {
+        struct stat st;
+        if (::fstatat(info.anchor->fd, "", &st, AT_EMPTY_PATH) != 0) {
+            return PlatformErrorToFuse();
+        }
+        FillAttrFromStat(st, attr, share_readonly);
+        return FUSE_OK;
     }
 #endif
-
-    attr->uid = 0;
-    attr->gid = 0;
-    attr->blksize = 4096;
-
-    return FUSE_OK;
+    return FillAttr(info.host_path, attr, info.inode, share_readonly);
 }
 
 int32_t VirtioFsDevice::FillVirtualRootAttr(FuseAttr* attr) {
+    std::shared_lock<std::shared_mutex> lock(shares_mutex_);
     memset(attr, 0, sizeof(*attr));
     attr->ino = VIRTUAL_ROOT_INODE;
     attr->mode = FUSE_S_IFDIR | 0755;
@@ -1894,22 +2576,36 @@ int32_t VirtioFsDevice::PlatformErrorToFuse() {
 #endif
 }
 
-uint64_t VirtioFsDevice::AllocInode() {
-    return next_inode_++;
+bool VirtioFsDevice::LookupInode(uint64_t inode, InodeInfo* out) {
+    std::lock_guard<std::mutex> lock(inode_mutex_);
+    auto it = inodes_.find(inode);
+    if (it == inodes_.end()) return false;
+    *out = it->second;
+    return true;
 }
 
-InodeInfo* VirtioFsDevice::GetInode(uint64_t inode) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = inodes_.find(inode);
-    return it != inodes_.end() ? &it->second : nullptr;
+void VirtioFsDevice::ForgetInode(uint64_t nodeid, uint64_t nlookup) {
+    if (nodeid == VIRTUAL_ROOT_INODE) return;
+    if (FindShareByRoot(nodeid, nullptr)) return;
+
+    std::lock_guard<std::mutex> lock(inode_mutex_);
+    auto it = inodes_.find(nodeid);
+    if (it != inodes_.end()) {
+        if (it->second.nlookup > nlookup) {
+            it->second.nlookup -= nlookup;
+        } else {
+            EraseInodeLocked(it);
+        }
+    }
 }
 
-uint64_t VirtioFsDevice::GetOrCreateInode(const std::string& path, bool is_dir, const std::string& share_tag) {
-    std::lock_guard<std::mutex> lock(mutex_);
+uint64_t VirtioFsDevice::GetOrCreateInode(const std::string& path, bool is_dir,
+                                          const std::string& share_tag, bool count_lookup) {
+    std::lock_guard<std::mutex> lock(inode_mutex_);
     
     auto it = path_to_inode_.find(path);
     if (it != path_to_inode_.end()) {
-        inodes_[it->second].nlookup++;
+        if (count_lookup) inodes_[it->second].nlookup++;
         return it->second;
     }
 
@@ -1917,7 +2613,7 @@ uint64_t VirtioFsDevice::GetOrCreateInode(const std::string& path, bool is_dir,
     InodeInfo info;
     info.inode = inode;
     info.host_path = path;
-    info.nlookup = 1;
+    info.nlookup = count_lookup ? 1 : 0;
     info.is_dir = is_dir;
     info.share_tag = share_tag;
     
@@ -1927,17 +2623,128 @@ uint64_t VirtioFsDevice::GetOrCreateInode(const std::string& path, bool is_dir,
     return inode;
 }
 
-void VirtioFsDevice::RemoveInode(uint64_t inode) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = inodes_.find(inode);
-    if (it != inodes_.end()) {
-        path_to_inode_.erase(it->second.host_path);
-        inodes_.erase(it);
+int32_t VirtioFsDevice::LookupChild(const InodeInfo& parent, const std::string& name,
+                                    bool share_readonly, uint64_t* nodeid, FuseAttr* attr) {
+    // Names come from the guest; never let one climb out of the parent.
+    if (name.empty() || name == "." || name == ".." || name.find(kPathSep) != std::string::npos) {
+        return FUSE_EINVAL;
+    }
+#ifdef _WIN32
+    std::string child_path = ChildPath(parent, name);
+    DWORD attrs = GetFileAttributesW(Utf8ToWide(child_path).c_str());
+    if (attrs == INVALID_FILE_ATTRIBUTES) {
+        return PlatformErrorToFuse();
+    }
+    bool is_dir = (attrs & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    uint64_t inode = GetOrCreateInode(child_path, is_dir, parent.share_tag);
+    int32_t err = FillAttr(child_path, attr, inode, share_readonly);
+    if (err != FUSE_OK) {
+        std::lock_guard<std::mutex> lock(inode_mutex_);
+        auto it = inodes_.find(inode);
+        if (it != inodes_.end() && --it->second.nlookup == 0) EraseInodeLocked(it);
+        return err;
+    }
+    *nodeid = inode;
+    return FUSE_OK;
+#elif defined(__linux__)
+    if (!parent.anchor) return FUSE_ENOENT;
+    int fd = ::openat(parent.anchor->fd, name.c_str(), O_PATH | O_CLOEXEC);
+    if (fd < 0) {
+        return PlatformErrorToFuse();
+    }
+    struct stat st;
+    if (::fstatat(fd, "", &st, AT_EMPTY_PATH) != 0) {
+        int32_t err = PlatformErrorToFuse();
+        ::close(fd);
+        return err;
+    }
+    *nodeid = InternAnchoredInode(fd, st.st_dev, st.st_ino, S_ISDIR(st.st_mode), parent.share_tag);
+    FillAttrFromStat(st, attr, share_readonly);
+    return FUSE_OK;
+#else
+    std::string child_path = ChildPath(parent, name);
+    struct stat st;
+    if (::stat(child_path.c_str(), &st) != 0) {
+        return PlatformErrorToFuse();
+    }
+    *nodeid = GetOrCreateInode(child_path, S_ISDIR(st.st_mode), parent.share_tag);
+    FillAttrFromStat(st, attr, share_readonly);
+    return FUSE_OK;
+#endif
+}
+
+uint64_t VirtioFsDevice::InternAnchoredInode(int fd, uint64_t dev, uint64_t ino, bool is_dir,
+                                             const std::string& share_tag) {
+    auto anchor = std::make_shared<InodeAnchor>(fd);
+    std::lock_guard<std::mutex> lock(inode_mutex_);
+
+    auto key = std::make_tuple(dev, ino, share_tag);
+    auto it = host_id_to_inode_.find(key);
+    if (it != host_id_to_inode_.end()) {
+        // Already anchored (another name or a hard link): |anchor| closes
+        // the new descriptor on return.
+        inodes_[it->second].nlookup++;
+        return it->second;
+    }
+
+    uint64_t inode = next_inode_++;
+    InodeInfo info;
+    info.inode = inode;
+    info.nlookup = 1;
+    info.is_dir = is_dir;
+    info.share_tag = share_tag;
+    info.anchor = std::move(anchor);
+    info.host_dev = dev;
+    info.host_ino = ino;
+
+    inodes_[inode] = std::move(info);
+    host_id_to_inode_[std::move(key)] = inode;
+    return inode;
+}
+
+std::unordered_map<uint64_t, InodeInfo>::iterator VirtioFsDevice::EraseInodeLocked(
+    std::unordered_map<uint64_t, InodeInfo>::iterator it) {
+    const InodeInfo& info = it->second;
+    auto key = std::make_tuple(info.host_dev, info.host_ino, info.share_tag);
+    auto host_it = host_id_to_inode_.find(key);
+    if (host_it != host_id_to_inode_.end() && host_it->second == info.inode) {
+        host_id_to_inode_.erase(host_it);
+    }
+    if (!info.host_path.empty()) {
+        auto path_it = path_to_inode_.find(info.host_path);
+        if (path_it != path_to_inode_.end() && path_it->second == info.inode) {
+            path_to_inode_.erase(path_it);
+        }
+    }
+    return inodes_.erase(it);
+}
+
+std::string VirtioFsDevice::NodePath(const InodeInfo& info) {
+#if defined(__linux__)
+    if (info.anchor) return "/proc/self/fd/" + std::to_string(info.anchor->fd);
+#endif
+    return info.host_path;
+}
+
+std::string VirtioFsDevice::ChildPath(const InodeInfo& parent, const std::string& name) {
+    return NodePath(parent) + kPathSep + name;
+}
+
+#ifndef _WIN32
+int VirtioFsDevice::ChildAt(const InodeInfo& parent, const std::string& name, std::string* rel) {
+#if defined(__linux__)
+    if (parent.anchor) {
+        *rel = name;
+        return parent.anchor->fd;
     }
+#endif
+    *rel = ChildPath(parent, name);
+    return AT_FDCWD;
 }
+#endif
 
 void VirtioFsDevice::RemoveInodeByPath(const std::string& path) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(inode_mutex_);
     auto path_it = path_to_inode_.find(path);
     if (path_it == path_to_inode_.end()) {
         return;
@@ -1948,63 +2755,111 @@ void VirtioFsDevice::RemoveInodeByPath(const std::string& path) {
     inodes_.erase(inode);
 }
 
-uint64_t VirtioFsDevice::AllocFileHandle(FsHandle h, bool is_dir, const std::string& path, const std::string& share_tag) {
-    std::lock_guard<std::mutex> lock(mutex_);
+uint64_t VirtioFsDevice::AllocFileHandle(FsHandle h, bool is_dir, const std::string& path, const std::string& share_tag,
+                                         std::shared_ptr<InodeAnchor> anchor) {
+    std::shared_ptr<FileHandle> handle(new FileHandle{h, is_dir, path, share_tag, std::move(anchor)},
+                                       [](FileHandle* f) {
+        if (f->handle != FS_INVALID_HANDLE) {
+#ifdef _WIN32
+            CloseHandle(f->handle);
+#else
+            ::close(f->handle);
+#endif
+        }
+#ifndef _WIN32
+        if (f->dir) ::closedir(f->dir);
+#endif
+        delete f;
+    });
+
+    std::lock_guard<std::mutex> lock(handle_mutex_);
     uint64_t fh = next_fh_++;
-    file_handles_[fh] = {h, is_dir, path, share_tag};
+    file_handles_[fh] = std::move(handle);
     return fh;
 }
 
-FileHandle* VirtioFsDevice::GetFileHandle(uint64_t fh) {
+std::shared_ptr<FileHandle> VirtioFsDevice::GetFileHandle(uint64_t fh) {
+    std::lock_guard<std::mutex> lock(handle_mutex_);
     auto it = file_handles_.find(fh);
-    return it != file_handles_.end() ? &it->second : nullptr;
+    return it != file_handles_.end() ? it->second : nullptr;
 }
 
 void VirtioFsDevice::CloseFileHandle(uint64_t fh) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = file_handles_.find(fh);
-    if (it != file_handles_.end()) {
-        if (it->second.handle != FS_INVALID_HANDLE) {
-#ifdef _WIN32
-            CloseHandle(it->second.handle);
-#else
-            ::close(it->second.handle);
-#endif
-        }
+    std::shared_ptr<FileHandle> handle;
+    {
+        std::lock_guard<std::mutex> lock(handle_mutex_);
+        auto it = file_handles_.find(fh);
+        if (it == file_handles_.end()) return;
+        handle = std::move(it->second);
         file_handles_.erase(it);
     }
+    // |handle| is closed here, outside the table lock, unless a concurrent
+    // request still holds it.
 }
 
-std::string VirtioFsDevice::NodeIdToPath(uint64_t nodeid) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = inodes_.find(nodeid);
-    return it != inodes_.end() ? it->second.host_path : "";
+bool VirtioFsDevice::FindShare(const std::string& tag, ShareInfo* out) const {
+    std::shared_lock<std::shared_mutex> lock(shares_mutex_);
+    auto it = shares_.find(tag);
+    if (it == shares_.end()) return false;
+    if (out) *out = it->second;
+    return true;
 }
 
-std::string VirtioFsDevice::NodeIdToShareTag(uint64_t nodeid) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = inodes_.find(nodeid);
-    return it != inodes_.end() ? it->second.share_tag : "";
+bool VirtioFsDevice::FindShareByRoot(uint64_t root_inode, ShareInfo* out) const {
+    std::shared_lock<std::shared_mutex> lock(shares_mutex_);
+    for (const auto& [tag, share] : shares_) {
+        if (share.root_inode == root_inode) {
+            if (out) *out = share;
+            return true;
+        }
+    }
+    return false;
 }
 
 bool VirtioFsDevice::IsShareReadonly(const std::string& share_tag) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
     if (share_tag.empty()) {
         LOG_WARN("VirtIO FS: IsShareReadonly called with empty share_tag");
         return false;
     }
     
-    auto it = shares_.find(share_tag);
-    if (it == shares_.end()) {
+    ShareInfo share;
+    if (!FindShare(share_tag, &share)) {
         LOG_WARN("VirtIO FS: share '%s' not found in IsShareReadonly", share_tag.c_str());
         return false;
     }
     
-    return it->second.readonly;
+    return share.readonly;
 }
 
 uint32_t VirtioFsDevice::GetOpenHandleCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(handle_mutex_);
     return static_cast<uint32_t>(file_handles_.size());
 }
+
+std::vector<FsShareStats> VirtioFsDevice::GetShareStats() const {
+    std::shared_lock<std::shared_mutex> lock(shares_mutex_);
+    std::vector<FsShareStats> result;
+    result.reserve(shares_.size());
+    for (const auto& [tag, share] : shares_) {
+        FsShareStats stats = share.io ? share.io->Read() : FsShareStats{};
+        stats.tag = tag;
+        result.push_back(std::move(stats));
+    }
+    std::sort(result.begin(), result.end(),
+              [](const FsShareStats& a, const FsShareStats& b) { return a.tag < b.tag; });
+    return result;
+}
+
+bool VirtioFsDevice::SetShareLimits(const std::string& tag, const FsShareLimits& limits) {
+    std::unique_lock<std::shared_mutex> lock(shares_mutex_);
+    auto it = shares_.find(tag);
+    if (it == shares_.end()) {
+        LOG_ERROR("VirtIO FS: share tag '%s' not found", tag.c_str());
+        return false;
+    }
+    it->second.limits = limits;
+    if (it->second.io) it->second.io->SetLimits(limits);
+    LOG_INFO("VirtIO FS: share '%s' limits iops=%" PRIu64 " bytes_per_sec=%" PRIu64,
+             tag.c_str(), limits.iops, limits.bytes_per_sec);
+    return true;
+}
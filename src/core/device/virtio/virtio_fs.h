@@ -1,9 +1,19 @@
 #pragma once
 
 #include "core/device/virtio/virtio_mmio.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
-#include <mutex>
+#include <vector>
 
 #ifdef _WIN32
 #define NOMINMAX
@@ -14,6 +24,7 @@
 using FsHandle = HANDLE;
 #define FS_INVALID_HANDLE INVALID_HANDLE_VALUE
 #else
+#include <dirent.h>
 using FsHandle = int;
 #define FS_INVALID_HANDLE (-1)
 #endif
@@ -30,6 +41,9 @@ constexpr uint64_t VIRTIO_F_VERSION_1 = 1ULL << 32;
 // VirtIO FS feature bits
 constexpr uint64_t VIRTIO_FS_F_NOTIFICATION = 1ULL << 0;
 
+// Shared memory region id of the DAX cache window
+constexpr uint32_t VIRTIO_FS_SHMCAP_ID_CACHE = 0;
+
 // FUSE protocol version
 constexpr uint32_t FUSE_KERNEL_VERSION = 7;
 constexpr uint32_t FUSE_KERNEL_MINOR_VERSION = 31;
@@ -89,8 +103,11 @@ enum FuseOpcode : uint32_t {
 constexpr int32_t FUSE_OK = 0;
 constexpr int32_t FUSE_ENOENT = -2;
 constexpr int32_t FUSE_EIO = -5;
+constexpr int32_t FUSE_ENXIO = -6;
+constexpr int32_t FUSE_EBADF = -9;
 constexpr int32_t FUSE_EACCES = -13;
 constexpr int32_t FUSE_EEXIST = -17;
+constexpr int32_t FUSE_EXDEV = -18;
 constexpr int32_t FUSE_ENOTDIR = -20;
 constexpr int32_t FUSE_EISDIR = -21;
 constexpr int32_t FUSE_EINVAL = -22;
@@ -99,6 +116,7 @@ constexpr int32_t FUSE_EROFS = -30;
 constexpr int32_t FUSE_ENOTEMPTY = -39;
 constexpr int32_t FUSE_ENOSYS = -38;
 constexpr int32_t FUSE_ENODATA = -61;
+constexpr int32_t FUSE_EOPNOTSUPP = -95;
 
 // FUSE file types (for mode)
 constexpr uint32_t FUSE_S_IFMT   = 0170000;
@@ -119,7 +137,24 @@ constexpr uint32_t FUSE_NO_OPEN_SUPPORT  = 1 << 17;
 constexpr uint32_t FUSE_PARALLEL_DIROPS  = 1 << 18;
 constexpr uint32_t FUSE_HANDLE_KILLPRIV  = 1 << 19;
 constexpr uint32_t FUSE_POSIX_ACL        = 1 << 20;
-constexpr uint32_t FUSE_READDIRPLUS_AUTO = 1 << 29;
+constexpr uint32_t FUSE_AUTO_INVAL_DATA  = 1 << 12;
+constexpr uint32_t FUSE_DO_READDIRPLUS   = 1 << 13;
+constexpr uint32_t FUSE_READDIRPLUS_AUTO = 1 << 14;
+constexpr uint32_t FUSE_ASYNC_DIO        = 1 << 15;
+constexpr uint32_t FUSE_MAP_ALIGNMENT    = 1u << 26;
+
+// FUSE_LSEEK whence values (Linux guest ABI; macOS numbers them the other
+// way round)
+constexpr uint32_t FUSE_SEEK_DATA = 3;
+constexpr uint32_t FUSE_SEEK_HOLE = 4;
+
+// FUSE open reply flags (FuseOpenOut::open_flags)
+constexpr uint32_t FOPEN_DIRECT_IO  = 1 << 0;
+constexpr uint32_t FOPEN_KEEP_CACHE = 1 << 1;
+
+// FUSE_SETUPMAPPING flags
+constexpr uint64_t FUSE_SETUPMAPPING_FLAG_WRITE = 1ULL << 0;
+constexpr uint64_t FUSE_SETUPMAPPING_FLAG_READ  = 1ULL << 1;
 
 // FUSE setattr valid bits
 constexpr uint32_t FATTR_MODE  = 1 << 0;
@@ -128,6 +163,7 @@ constexpr uint32_t FATTR_GID   = 1 << 2;
 constexpr uint32_t FATTR_SIZE  = 1 << 3;
 constexpr uint32_t FATTR_ATIME = 1 << 4;
 constexpr uint32_t FATTR_MTIME = 1 << 5;
+constexpr uint32_t FATTR_FH    = 1 << 6;
 
 #pragma pack(push, 1)
 
@@ -326,6 +362,63 @@ struct FuseForgetIn {
     uint64_t nlookup;
 };
 
+struct FuseBatchForgetIn {
+    uint32_t count;
+    uint32_t dummy;
+    // Followed by |count| FuseForgetOne entries.
+};
+
+struct FuseForgetOne {
+    uint64_t nodeid;
+    uint64_t nlookup;
+};
+
+struct FuseFallocateIn {
+    uint64_t fh;
+    uint64_t offset;
+    uint64_t length;
+    uint32_t mode;  // FALLOC_FL_* bits
+    uint32_t padding;
+};
+
+struct FuseLseekIn {
+    uint64_t fh;
+    uint64_t offset;
+    uint32_t whence;  // only SEEK_DATA / SEEK_HOLE reach the device
+    uint32_t padding;
+};
+
+struct FuseLseekOut {
+    uint64_t offset;
+};
+
+struct FuseCopyFileRangeIn {
+    uint64_t fh_in;
+    uint64_t off_in;
+    uint64_t nodeid_out;
+    uint64_t fh_out;
+    uint64_t off_out;
+    uint64_t len;
+    uint64_t flags;
+};
+
+struct FuseSetupMappingIn {
+    uint64_t fh;
+    uint64_t foffset;  // offset into the file
+    uint64_t len;
+    uint64_t flags;
+    uint64_t moffset;  // offset into the DAX window
+};
+
+struct FuseRemoveMappingIn {
+    uint32_t count;  // number of FuseRemoveMappingOne that follow
+};
+
+struct FuseRemoveMappingOne {
+    uint64_t moffset;
+    uint64_t len;
+};
+
 // VirtIO FS config space
 struct VirtioFsConfig {
     char tag[36];
@@ -334,42 +427,157 @@ struct VirtioFsConfig {
 
 #pragma pack(pop)
 
+// How long the guest may cache a share's entries, attributes and file
+// data, after virtiofsd's --cache option:
+//   kNone:   nothing is cached and file I/O bypasses the guest page cache,
+//            for trees the host changes under the guest.
+//   kAuto:   1 s entry/attr timeouts; cached pages are dropped when the
+//            guest sees the size or mtime change.
+//   kAlways: day-long timeouts and page cache kept across opens, for trees
+//            only the guest modifies (build output, package caches).
+enum class FsCachePolicy {
+    kNone,
+    kAuto,
+    kAlways,
+};
+
+// "none" / "auto" / "always". Returns false for anything else.
+bool ParseFsCachePolicy(const std::string& name, FsCachePolicy* out);
+const char* FsCachePolicyName(FsCachePolicy policy);
+
+// Decimal count with an optional K / M / G suffix (powers of 1024), as used
+// by the --share iops= / bps= options. Returns false on anything else.
+bool ParseFsRate(const std::string& text, uint64_t* out);
+
+// Optional per-share I/O limits; 0 means unlimited.
+struct FsShareLimits {
+    uint64_t iops = 0;           // requests per second
+    uint64_t bytes_per_sec = 0;  // READ + WRITE payload bytes per second
+};
+
+// Per-share request counters, as reported by GetShareStats().
+struct FsShareStats {
+    std::string tag;
+    FsShareLimits limits;
+    uint64_t ops = 0;
+    uint64_t read_ops = 0;
+    uint64_t read_bytes = 0;
+    uint64_t write_ops = 0;
+    uint64_t write_bytes = 0;
+    uint64_t throttled = 0;     // requests held back by the limits
+    uint64_t throttled_ns = 0;  // total time they were held back
+};
+
+// Accounting and token-bucket admission for one share. Each bucket holds
+// one second of budget and goes into debt instead of refusing: Admit()
+// always charges the request and returns how long it has to wait, so a
+// share's requests keep their order and the debt is paid off in time.
+class FsShareIo {
+public:
+    explicit FsShareIo(const FsShareLimits& limits);
+
+    // Charge one request of |opcode| moving |bytes| of payload. Returns the
+    // delay in nanoseconds before it may run (0 when within the limits).
+    uint64_t Admit(uint32_t opcode, uint64_t bytes);
+    void SetLimits(const FsShareLimits& limits);
+    FsShareStats Read() const;
+
+private:
+    mutable std::mutex mutex_;
+    FsShareLimits limits_;
+    double op_tokens_ = 0;
+    double byte_tokens_ = 0;
+    uint64_t refill_ns_ = 0;
+    FsShareStats stats_;
+};
+
 // Shared folder info
 struct ShareInfo {
     std::string tag;
     std::string host_path;
-    bool readonly;
-    uint64_t root_inode;  // inode of the share's root directory
+    bool readonly = false;
+    FsCachePolicy cache = FsCachePolicy::kAuto;
+    // Let the guest buffer writes in its page cache (FUSE_WRITEBACK_CACHE)
+    // instead of sending each one through. Only for trees the host does not
+    // write to while the guest has them mounted.
+    bool writeback = false;
+    FsShareLimits limits;
+    std::shared_ptr<FsShareIo> io;
+    uint64_t root_inode = 0;  // inode of the share's root directory
+};
+
+// O_PATH descriptor pinning a host file or directory (Linux hosts). Shared
+// between the inode table and in-flight requests, so a FORGET racing a
+// request never lets the descriptor number be reused under it.
+struct InodeAnchor {
+    int fd = -1;
+
+    explicit InodeAnchor(int f) : fd(f) {}
+    ~InodeAnchor();
+    InodeAnchor(const InodeAnchor&) = delete;
+    InodeAnchor& operator=(const InodeAnchor&) = delete;
 };
 
-// Inode info cached on the host
+// Inode info cached on the host. On Linux every inode below a share root is
+// anchored to an O_PATH descriptor and keyed by its host (dev, ino): lookups
+// resolve relative to the parent's descriptor, and renames or hard links
+// need no table fix-ups. macOS and Windows have no O_PATH and stay keyed by
+// absolute host path.
 struct InodeInfo {
     uint64_t inode;
-    std::string host_path;
+    std::string host_path;  // share roots everywhere; every inode on path-keyed hosts
     uint64_t nlookup;
     bool is_dir;
     std::string share_tag;  // which share this inode belongs to (empty for virtual root)
+    std::shared_ptr<InodeAnchor> anchor;
+    uint64_t host_dev = 0;
+    uint64_t host_ino = 0;
 };
 
-// Open file handle
+// Open file handle. Held by shared_ptr: the host handle is closed when the
+// last reference drops, so a RELEASE racing an in-flight READ on another
+// worker never lets the fd be reused under it.
 struct FileHandle {
     FsHandle handle = FS_INVALID_HANDLE;
     bool is_dir = false;
     std::string path;
     std::string share_tag;
+    // Pins the inode |path| was derived from, so a /proc/self/fd alias
+    // stays valid for the handle's lifetime.
+    std::shared_ptr<InodeAnchor> anchor;
+#ifndef _WIN32
+    // Directory stream opened on the first READDIR and kept until RELEASEDIR.
+    DIR* dir = nullptr;
+#endif
+    std::mutex dir_mutex{};  // serializes READDIRs on this handle
 };
 
 class VirtioFsDevice : public VirtioDeviceOps {
 public:
+    // Request queues advertised to the guest (queue 0 is hiprio).
+    static constexpr uint32_t kDefaultRequestQueues = 4;
+    // Worker threads serving the request queues.
+    static constexpr uint32_t kDefaultWorkers = 4;
+
     // Create a virtiofs device with a fixed tag (e.g., "shared")
     // The device starts empty; use AddShare/RemoveShare to manage shares
-    explicit VirtioFsDevice(const std::string& mount_tag = "shared");
+    explicit VirtioFsDevice(const std::string& mount_tag = "shared",
+                            uint32_t num_request_queues = kDefaultRequestQueues,
+                            uint32_t num_workers = kDefaultWorkers);
     ~VirtioFsDevice() override;
 
     void SetMmioDevice(VirtioMmioDevice* mmio) { mmio_ = mmio; }
 
+    // Drain and join the worker pool. Must run before the transport or guest
+    // RAM goes away; called from ~Vm and again (no-op) from the destructor.
+    void Stop();
+
     // Dynamic share management - can be called at runtime
-    bool AddShare(const std::string& tag, const std::string& host_path, bool readonly = false);
+    bool AddShare(const std::string& tag, const std::string& host_path, bool readonly = false,
+                  FsCachePolicy cache = FsCachePolicy::kAuto, bool writeback = false,
+                  const FsShareLimits& limits = {});
+    // Change a share's I/O limits in place; the guest mount is untouched.
+    bool SetShareLimits(const std::string& tag, const FsShareLimits& limits);
     bool RemoveShare(const std::string& tag);
     std::vector<std::string> GetShareTags() const;
     std::vector<ShareInfo> GetShares() const;
@@ -378,18 +586,44 @@ public:
     // VirtioDeviceOps interface
     uint32_t GetDeviceId() const override { return VIRTIO_ID_FS; }
     uint64_t GetDeviceFeatures() const override;
-    uint32_t GetNumQueues() const override { return 2; }
+    uint32_t GetNumQueues() const override { return 1 + config_.num_request_queues; }
     uint32_t GetQueueMaxSize(uint32_t queue_idx) const override { return 128; }
     void OnQueueNotify(uint32_t queue_idx, VirtQueue& vq) override;
     void ReadConfig(uint32_t offset, uint8_t size, uint32_t* value) override;
     void WriteConfig(uint32_t offset, uint8_t size, uint32_t value) override;
     void OnStatusChange(uint32_t new_status) override;
+    void OnBeforeReset() override;
+
+    // Attach a DAX cache window. |window| is a PROT_NONE host reservation of
+    // |size| bytes that the caller has already mapped into guest-physical
+    // space and advertised as shared memory region VIRTIO_FS_SHMCAP_ID_CACHE.
+    // FUSE_SETUPMAPPING then maps file ranges over it with MAP_FIXED, so the
+    // guest reads them straight out of the host page cache. Linux hosts only.
+    void EnableDax(uint8_t* window, uint64_t size);
 
     // State query
     uint32_t GetOpenHandleCount() const;
+    std::vector<FsShareStats> GetShareStats() const;
 
 private:
-    void ProcessRequest(VirtQueue& vq, uint16_t head_idx);
+    // A popped descriptor chain waiting for a worker.
+    struct PendingRequest {
+        VirtQueue* vq;
+        uint32_t queue_idx;
+        uint16_t head_idx;
+        std::vector<VirtqChainElem> chain;
+        bool admitted = false;  // already charged to its share's limits
+    };
+
+    void WorkerLoop(uint32_t index);
+    // Drop every queued and deferred request and block until the in-flight
+    // ones have completed. Only for a reset, which abandons them anyway.
+    void DrainWorkers();
+    // Charge |req| to its share; returns how long it must be deferred (ns).
+    uint64_t AdmitRequest(const PendingRequest& req);
+    // Run one request and push it to the used ring under its queue lock.
+    void CompleteRequest(PendingRequest& req);
+    uint32_t ProcessRequest(const std::vector<VirtqChainElem>& chain);
     
     // FUSE request handlers
     void HandleInit(const FuseInHeader* in_hdr, const uint8_t* in_data,
@@ -397,15 +631,21 @@ private:
     void HandleLookup(const FuseInHeader* in_hdr, const uint8_t* in_data, uint32_t in_len,
                       std::vector<uint8_t>& out_buf);
     void HandleForget(const FuseInHeader* in_hdr, const uint8_t* in_data);
+    void HandleBatchForget(const uint8_t* in_data, uint32_t in_len);
     void HandleGetAttr(const FuseInHeader* in_hdr, const uint8_t* in_data,
                        std::vector<uint8_t>& out_buf);
     void HandleSetAttr(const FuseInHeader* in_hdr, const uint8_t* in_data,
                        std::vector<uint8_t>& out_buf);
     void HandleOpen(const FuseInHeader* in_hdr, const uint8_t* in_data,
                     std::vector<uint8_t>& out_buf);
-    void HandleRead(const FuseInHeader* in_hdr, const uint8_t* in_data,
-                    std::vector<uint8_t>& out_buf);
-    void HandleWrite(const FuseInHeader* in_hdr, const uint8_t* in_data, uint32_t in_len,
+    // READ and WRITE work on the descriptor chain directly: the payload is
+    // moved with preadv/pwritev between the host file and guest memory, never
+    // staged in a heap buffer. HandleRead returns the used length when it
+    // wrote the reply into |chain| itself, or 0 after filling |out_buf| with
+    // an error reply.
+    uint32_t HandleRead(const FuseInHeader* in_hdr, const std::vector<VirtqChainElem>& chain,
+                        std::vector<uint8_t>& out_buf);
+    void HandleWrite(const FuseInHeader* in_hdr, const std::vector<VirtqChainElem>& chain,
                      std::vector<uint8_t>& out_buf);
     void HandleRelease(const FuseInHeader* in_hdr, const uint8_t* in_data);
     void HandleOpenDir(const FuseInHeader* in_hdr, const uint8_t* in_data,
@@ -415,6 +655,11 @@ private:
     void HandleReadDirPlus(const FuseInHeader* in_hdr, const uint8_t* in_data,
                            std::vector<uint8_t>& out_buf);
     void HandleReleaseDir(const FuseInHeader* in_hdr, const uint8_t* in_data);
+#ifndef _WIN32
+    // |parent| is the directory's inode; READDIRPLUS only.
+    int32_t ReadDirStream(FileHandle& fh, const InodeInfo* parent, const FuseReadIn& read_in,
+                          bool plus, const ShareInfo& share, std::vector<uint8_t>& dir_buf);
+#endif
     void HandleStatFs(const FuseInHeader* in_hdr, std::vector<uint8_t>& out_buf);
     void HandleCreate(const FuseInHeader* in_hdr, const uint8_t* in_data, uint32_t in_len,
                       std::vector<uint8_t>& out_buf);
@@ -428,41 +673,111 @@ private:
                       std::vector<uint8_t>& out_buf);
     void HandleFlush(const FuseInHeader* in_hdr, const uint8_t* in_data);
     void HandleFsync(const FuseInHeader* in_hdr, const uint8_t* in_data);
-
-    // Helper functions
+    void HandleFallocate(const FuseInHeader* in_hdr, const uint8_t* in_data, uint32_t in_len,
+                         std::vector<uint8_t>& out_buf);
+    void HandleLseek(const FuseInHeader* in_hdr, const uint8_t* in_data, uint32_t in_len,
+                     std::vector<uint8_t>& out_buf);
+    // Copies host file to host file; the data never crosses the virtqueue.
+    void HandleCopyFileRange(const FuseInHeader* in_hdr, const uint8_t* in_data, uint32_t in_len,
+                             std::vector<uint8_t>& out_buf);
+    void HandleSetupMapping(const FuseInHeader* in_hdr, const uint8_t* in_data, uint32_t in_len,
+                            std::vector<uint8_t>& out_buf);
+    void HandleRemoveMapping(const FuseInHeader* in_hdr, const uint8_t* in_data, uint32_t in_len,
+                             std::vector<uint8_t>& out_buf);
+
+    // Helper functions. None of them hold a table lock across a host
+    // syscall: lookups copy what they need out under the lock and the
+    // caller does the I/O unlocked.
     void WriteErrorResponse(std::vector<uint8_t>& out_buf, uint64_t unique, int32_t error);
     int32_t FillAttr(const std::string& path, FuseAttr* attr, uint64_t inode, bool share_readonly = false);
+    int32_t GetNodeAttr(const InodeInfo& info, bool share_readonly, FuseAttr* attr);
     int32_t FillVirtualRootAttr(FuseAttr* attr);
     int32_t FillShareRootAttr(const ShareInfo& share, FuseAttr* attr);
     int32_t PlatformErrorToFuse();
-    uint64_t AllocInode();
-    InodeInfo* GetInode(uint64_t inode);
-    uint64_t GetOrCreateInode(const std::string& path, bool is_dir, const std::string& share_tag);
-    void RemoveInode(uint64_t inode);
+    bool LookupInode(uint64_t inode, InodeInfo* out);
+    // Drop |nlookup| references on |nodeid| (FORGET / BATCH_FORGET).
+    void ForgetInode(uint64_t nodeid, uint64_t nlookup);
+    // Returns the inode for |path|, creating it if needed. |count_lookup|
+    // bumps nlookup (LOOKUP/CREATE/MKDIR replies); READDIR does not.
+    uint64_t GetOrCreateInode(const std::string& path, bool is_dir, const std::string& share_tag,
+                              bool count_lookup = true);
+    // Path-keyed hosts only; anchored inodes stay valid until FORGET.
     void RemoveInodeByPath(const std::string& path);
-    uint64_t AllocFileHandle(FsHandle h, bool is_dir, const std::string& path, const std::string& share_tag);
-    FileHandle* GetFileHandle(uint64_t fh);
+    // Resolve |name| under |parent|, take a lookup reference on the result
+    // and fill |attr|. Serves LOOKUP, CREATE, MKDIR and READDIRPLUS.
+    int32_t LookupChild(const InodeInfo& parent, const std::string& name, bool share_readonly,
+                        uint64_t* nodeid, FuseAttr* attr);
+    // Adopt |fd| as the anchor of host inode (dev, ino), or close it and
+    // bump nlookup if that inode is already in the table.
+    uint64_t InternAnchoredInode(int fd, uint64_t dev, uint64_t ino, bool is_dir,
+                                 const std::string& share_tag);
+    // Drop |it| from inodes_ and whichever key table indexes it.
+    std::unordered_map<uint64_t, InodeInfo>::iterator EraseInodeLocked(
+        std::unordered_map<uint64_t, InodeInfo>::iterator it);
+    // Host path that reopens |info|: its /proc/self/fd alias when anchored.
+    // Only valid while |info| (and so the anchor) is held.
+    static std::string NodePath(const InodeInfo& info);
+    static std::string ChildPath(const InodeInfo& parent, const std::string& name);
+#ifndef _WIN32
+    // Directory fd and relative name for a *at() call on |name| under
+    // |parent|: the parent's anchor on Linux, AT_FDCWD and a full path
+    // elsewhere.
+    static int ChildAt(const InodeInfo& parent, const std::string& name, std::string* rel);
+#endif
+    uint64_t AllocFileHandle(FsHandle h, bool is_dir, const std::string& path, const std::string& share_tag,
+                             std::shared_ptr<InodeAnchor> anchor = nullptr);
+    std::shared_ptr<FileHandle> GetFileHandle(uint64_t fh);
     void CloseFileHandle(uint64_t fh);
-    std::string NodeIdToPath(uint64_t nodeid);
-    std::string NodeIdToShareTag(uint64_t nodeid);
+    bool FindShare(const std::string& tag, ShareInfo* out) const;
+    bool FindShareByRoot(uint64_t root_inode, ShareInfo* out) const;
     bool IsShareReadonly(const std::string& share_tag);
 
     VirtioMmioDevice* mmio_ = nullptr;
     std::string mount_tag_;  // virtiofs mount tag (e.g., "shared")
     VirtioFsConfig config_{};
-    bool initialized_ = false;
+    std::atomic<bool> initialized_{false};
+    // FUSE_WRITEBACK_CACHE was negotiated. It is per mount, not per share:
+    // INIT only enables it when every share opted in, and files of shares
+    // added later without opting in are opened FOPEN_DIRECT_IO.
+    std::atomic<bool> writeback_{false};
 
-    mutable std::mutex mutex_;
-    uint64_t next_inode_ = 2;  // inode 1 is reserved for virtual root
+    uint8_t* dax_window_ = nullptr;
+    uint64_t dax_window_size_ = 0;
+
+    // Lock order: shares_mutex_ -> inode_mutex_ -> handle_mutex_.
+    mutable std::shared_mutex shares_mutex_;
     uint64_t shares_version_ = 0;  // bumped on AddShare/RemoveShare
     uint64_t virtual_root_mtime_ = 0;  // updated on share changes for cache invalidation
-    uint64_t next_fh_ = 1;
-    
     // Shares: tag -> ShareInfo
     std::unordered_map<std::string, ShareInfo> shares_;
     
     // Inode management
+    mutable std::mutex inode_mutex_;
+    uint64_t next_inode_ = 2;  // inode 1 is reserved for virtual root
     std::unordered_map<uint64_t, InodeInfo> inodes_;
     std::unordered_map<std::string, uint64_t> path_to_inode_;
-    std::unordered_map<uint64_t, FileHandle> file_handles_;
+    // Anchored inodes by host (dev, ino, share tag). The tag is part of the
+    // key so a directory exported twice keeps each share's readonly flag.
+    std::map<std::tuple<uint64_t, uint64_t, std::string>, uint64_t> host_id_to_inode_;
+
+    mutable std::mutex handle_mutex_;
+    uint64_t next_fh_ = 1;
+    std::unordered_map<uint64_t, std::shared_ptr<FileHandle>> file_handles_;
+
+    // One lock per virtqueue: serializes PopAvail on the notify path with
+    // PushUsed + NotifyUsedBuffer from the workers.
+    std::vector<std::mutex> queue_mutexes_;
+
+    // Worker pool shared by all request queues.
+    std::mutex work_mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<PendingRequest> work_queue_;
+    // Requests held back by their share's limits, by release time. They
+    // wait here rather than in a worker, so other shares keep running.
+    std::multimap<std::chrono::steady_clock::time_point, PendingRequest> deferred_;
+    uint32_t busy_workers_ = 0;
+    bool stop_workers_ = false;
+    // Must be last: the threads start in the constructor and use the members above.
+    std::vector<std::thread> workers_;
 };
@@ -26,6 +26,12 @@ static uint32_t FormatBpp(uint32_t format) {
     }
 }
 
+// Flushes a scanout must receive without a SET_SCANOUT in between before it
+// is moved into the display surface. Guests that page-flip between buffers
+// re-point the scanout every frame and stay on the copying path, where a
+// move would cost two full-frame copies per flip instead of saving one.
+static constexpr uint32_t kSurfaceBindFlushes = 8;
+
 VirtioGpuDevice::VirtioGpuDevice(uint32_t width, uint32_t height)
     : display_width_(width), display_height_(height) {
     gpu_config_.events_read = 0;
@@ -57,6 +63,7 @@ void VirtioGpuDevice::WriteConfig(uint32_t offset, uint8_t size, uint32_t value)
 
 void VirtioGpuDevice::OnStatusChange(uint32_t new_status) {
     if (new_status == 0) {
+        ReleaseScanoutSurface(false);
         resources_.clear();
         scanout_resource_id_ = 0;
         scanout_width_ = 0;
@@ -263,7 +270,7 @@ void VirtioGpuDevice::ProcessCursorQueue(VirtQueue& vq) {
                             auto& res = it->second;
                             info.width = res.width;
                             info.height = res.height;
-                            info.pixels = res.host_pixels;
+                            info.pixels.assign(res.pixels(), res.pixels() + res.pixels_size());
                         }
                     }
 
@@ -338,6 +345,9 @@ void VirtioGpuDevice::CmdResourceUnref(const uint8_t* req, uint32_t req_len,
         WriteResponse(resp, VIRTIO_GPU_RESP_ERR_INVALID_RESOURCE_ID, resp_len);
         return;
     }
+    if (surface_resource_id_ == cmd->resource_id) {
+        ReleaseScanoutSurface(false);
+    }
     if (scanout_resource_id_ == cmd->resource_id) {
         scanout_resource_id_ = 0;
     }
@@ -361,6 +371,11 @@ void VirtioGpuDevice::CmdSetScanout(const uint8_t* req, uint32_t req_len,
     uint32_t old_width = scanout_width_;
     uint32_t old_height = scanout_height_;
 
+    if (cmd->resource_id != old_resource_id) {
+        ReleaseScanoutSurface(true);
+        scanout_flushes_ = 0;
+    }
+
     if (cmd->resource_id == 0) {
         scanout_resource_id_ = 0;
         scanout_width_ = 0;
@@ -425,8 +440,9 @@ void VirtioGpuDevice::CmdTransferToHost2d(const uint8_t* req, uint32_t req_len,
     uint64_t total_backing = 0;
     for (auto& page : res.backing) total_backing += page.length;
 
-    // Copy each row directly from backing pages into host_pixels,
-    // avoiding a full linearization into a temporary buffer.
+    // Copy each row directly from backing pages into the resource pixels
+    // (the display surface for a bound scanout), avoiding a full
+    // linearization into a temporary buffer.
     uint64_t src_offset = cmd->offset;
     for (uint32_t row = 0; row < rh; ++row) {
         uint64_t src_row_off = src_offset + static_cast<uint64_t>(row) * stride;
@@ -435,10 +451,20 @@ void VirtioGpuDevice::CmdTransferToHost2d(const uint8_t* req, uint32_t req_len,
         uint32_t row_bytes = rw * bpp;
 
         if (src_row_off + row_bytes > total_backing) break;
-        if (dst_off + row_bytes > res.host_pixels.size()) break;
+        if (dst_off + row_bytes > res.pixels_size()) break;
 
-        CopyFromBacking(res.backing, src_row_off, row_bytes,
-                        res.host_pixels.data() + dst_off);
+        CopyFromBacking(res.backing, src_row_off, row_bytes, res.pixels() + dst_off);
+    }
+
+    if (res.surface) {
+        if (res.unflushed_x1 == 0) {
+            res.unflushed_x0 = rx;
+            res.unflushed_y0 = ry;
+        }
+        res.unflushed_x0 = std::min(res.unflushed_x0, rx);
+        res.unflushed_y0 = std::min(res.unflushed_y0, ry);
+        res.unflushed_x1 = std::max(res.unflushed_x1, rx + rw);
+        res.unflushed_y1 = std::max(res.unflushed_y1, ry + rh);
     }
 
     WriteResponse(resp, VIRTIO_GPU_RESP_OK_NODATA, resp_len);
@@ -475,6 +501,17 @@ void VirtioGpuDevice::CmdResourceFlush(const uint8_t* req, uint32_t req_len,
         if (dx + dw > res.width) dw = res.width - dx;
         if (dy + dh > res.height) dh = res.height - dy;
 
+        // One attempt per SET_SCANOUT: a display that cannot host this
+        // scanout is not asked again until the guest picks a new one.
+        if (!res.surface && scanout_surface_callback_ &&
+            ++scanout_flushes_ == kSurfaceBindFlushes) {
+            BindScanoutSurface(res);
+        }
+
+        // Hand out the dirty rect in place: rows keep the resource stride,
+        // so the consumer's blit is the only copy (none when bound).
+        uint64_t offset = static_cast<uint64_t>(dy) * full_stride +
+                          static_cast<uint64_t>(dx) * bpp;
         DisplayFrame frame;
         frame.format = res.format;
         frame.resource_width = res.width;
@@ -483,27 +520,21 @@ void VirtioGpuDevice::CmdResourceFlush(const uint8_t* req, uint32_t req_len,
         frame.dirty_y = dy;
         frame.width = dw;
         frame.height = dh;
-        frame.stride = dw * bpp;
-
-        bool full_frame = (dx == 0 && dy == 0 &&
-                           dw == res.width && dh == res.height);
-        if (full_frame) {
-            frame.pixel_ref = res.host_pixels.data();
-            frame.pixel_ref_size = res.host_pixels.size();
-        } else {
-            frame.pixels.resize(static_cast<size_t>(dw) * dh * bpp);
-            for (uint32_t row = 0; row < dh; ++row) {
-                uint64_t src = (static_cast<uint64_t>(dy + row) * full_stride) +
-                               (static_cast<uint64_t>(dx) * bpp);
-                uint64_t dst = static_cast<uint64_t>(row) * dw * bpp;
-                if (src + dw * bpp > res.host_pixels.size()) break;
-                std::memcpy(frame.pixels.data() + dst,
-                            res.host_pixels.data() + src,
-                            dw * bpp);
-            }
+        frame.stride = full_stride;
+        frame.pixel_ref = res.pixels() + offset;
+        frame.pixel_ref_size = res.pixels_size() - offset;
+        frame.in_surface = res.surface != nullptr;
+
+        if (res.unflushed_x0 >= dx && res.unflushed_y0 >= dy &&
+            res.unflushed_x1 <= dx + dw && res.unflushed_y1 <= dy + dh) {
+            res.unflushed_x0 = res.unflushed_y0 = res.unflushed_x1 = res.unflushed_y1 = 0;
         }
 
         frame_callback_(std::move(frame));
+
+        // Publishing the frame may have handed the display a new back
+        // buffer; keep rendering into whatever is current.
+        if (res.surface) FollowScanoutSurface(res);
     }
 
     WriteResponse(resp, VIRTIO_GPU_RESP_OK_NODATA, resp_len);
@@ -562,6 +593,57 @@ void VirtioGpuDevice::CmdDetachBacking(const uint8_t* req, uint32_t req_len,
     WriteResponse(resp, VIRTIO_GPU_RESP_OK_NODATA, resp_len);
 }
 
+void VirtioGpuDevice::BindScanoutSurface(GpuResource& res) {
+    DisplaySurface surface = scanout_surface_callback_(res.width, res.height);
+    uint32_t stride = res.width * FormatBpp(res.format);
+    if (!surface.data || surface.stride != stride ||
+        surface.size < static_cast<size_t>(stride) * res.height) {
+        return;
+    }
+    std::memcpy(surface.data, res.host_pixels.data(), res.host_pixels.size());
+    res.surface = surface.data;
+    res.surface_size = res.host_pixels.size();
+    std::vector<uint8_t>().swap(res.host_pixels);
+    surface_resource_id_ = res.id;
+}
+
+void VirtioGpuDevice::FollowScanoutSurface(GpuResource& res) {
+    DisplaySurface surface = scanout_surface_callback_(res.width, res.height);
+    if (!surface.data || surface.data == res.surface) return;
+    if (surface.size < res.surface_size) return;
+
+    // The new buffer already holds every flushed frame; bring over what
+    // the guest transferred but has not flushed yet.
+    if (res.unflushed_x1 > res.unflushed_x0 && res.unflushed_y1 > res.unflushed_y0) {
+        uint32_t bpp = FormatBpp(res.format);
+        size_t stride = static_cast<size_t>(res.width) * bpp;
+        size_t row_bytes = static_cast<size_t>(res.unflushed_x1 - res.unflushed_x0) * bpp;
+        for (uint32_t y = res.unflushed_y0; y < res.unflushed_y1; ++y) {
+            size_t off = y * stride + static_cast<size_t>(res.unflushed_x0) * bpp;
+            std::memcpy(surface.data + off, res.surface + off, row_bytes);
+        }
+    }
+    res.surface = surface.data;
+}
+
+void VirtioGpuDevice::ReleaseScanoutSurface(bool keep_pixels) {
+    if (surface_resource_id_ == 0) return;
+    auto it = resources_.find(surface_resource_id_);
+    surface_resource_id_ = 0;
+    if (it == resources_.end() || !it->second.surface) return;
+
+    // The surface is about to carry another resource (or go away); move the
+    // pixels back so later partial transfers still land on a full image.
+    // Callers dropping the resource anyway pass keep_pixels = false.
+    auto& res = it->second;
+    if (keep_pixels) {
+        res.host_pixels.assign(res.surface, res.surface + res.surface_size);
+    }
+    res.surface = nullptr;
+    res.surface_size = 0;
+    res.unflushed_x0 = res.unflushed_y0 = res.unflushed_x1 = res.unflushed_y1 = 0;
+}
+
 void VirtioGpuDevice::SetDisplaySize(uint32_t width, uint32_t height) {
     if (width == 0 || height == 0 || width > 16384 || height > 16384) return;
 
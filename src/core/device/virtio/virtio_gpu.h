@@ -160,6 +160,7 @@ public:
     using FrameCallback = std::function<void(DisplayFrame)>;
     using CursorCallback = std::function<void(const CursorInfo&)>;
     using ScanoutStateCallback = std::function<void(bool active, uint32_t width, uint32_t height)>;
+    using ScanoutSurfaceCallback = std::function<DisplaySurface(uint32_t width, uint32_t height)>;
 
     VirtioGpuDevice(uint32_t width, uint32_t height);
     ~VirtioGpuDevice() override = default;
@@ -169,6 +170,7 @@ public:
     void SetFrameCallback(FrameCallback cb) { frame_callback_ = std::move(cb); }
     void SetCursorCallback(CursorCallback cb) { cursor_callback_ = std::move(cb); }
     void SetScanoutStateCallback(ScanoutStateCallback cb) { scanout_state_callback_ = std::move(cb); }
+    void SetScanoutSurfaceCallback(ScanoutSurfaceCallback cb) { scanout_surface_callback_ = std::move(cb); }
 
     // Update display resolution and notify guest to re-query display info
     void SetDisplaySize(uint32_t width, uint32_t height);
@@ -189,6 +191,18 @@ private:
         uint32_t height = 0;
         uint32_t format = 0;
         std::vector<uint8_t> host_pixels;
+        // When set, the pixels live in the display's scanout surface instead
+        // of host_pixels (which is then empty).
+        uint8_t* surface = nullptr;
+        size_t surface_size = 0;
+        // Bounding box of transfers into the surface that no flush has
+        // covered yet; carried over when the display swaps surfaces.
+        uint32_t unflushed_x0 = 0, unflushed_y0 = 0;
+        uint32_t unflushed_x1 = 0, unflushed_y1 = 0;
+
+        uint8_t* pixels() { return surface ? surface : host_pixels.data(); }
+        size_t pixels_size() const { return surface ? surface_size : host_pixels.size(); }
+
         struct BackingPage {
             uint64_t gpa;
             uint32_t length;
@@ -217,6 +231,10 @@ private:
     void CmdDetachBacking(const uint8_t* req, uint32_t req_len,
                           uint8_t* resp, uint32_t* resp_len);
 
+    void BindScanoutSurface(GpuResource& res);
+    void FollowScanoutSurface(GpuResource& res);
+    void ReleaseScanoutSurface(bool keep_pixels);
+
     void WriteResponse(uint8_t* buf, uint32_t type, uint32_t* len);
     uint8_t* GpaToHva(uint64_t gpa) const;
     void CopyFromBacking(const std::vector<GpuResource::BackingPage>& backing,
@@ -227,6 +245,7 @@ private:
     FrameCallback frame_callback_;
     CursorCallback cursor_callback_;
     ScanoutStateCallback scanout_state_callback_;
+    ScanoutSurfaceCallback scanout_surface_callback_;
 
     uint32_t display_width_;
     uint32_t display_height_;
@@ -236,6 +255,10 @@ private:
     uint32_t scanout_resource_id_ = 0;
     uint32_t scanout_width_ = 0;
     uint32_t scanout_height_ = 0;
+    // Flushes of the current scanout since SET_SCANOUT picked it, and the
+    // resource (if any) rendering straight into the display surface.
+    uint32_t scanout_flushes_ = 0;
+    uint32_t surface_resource_id_ = 0;
 
     // Cursor state
     uint32_t cursor_resource_id_ = 0;
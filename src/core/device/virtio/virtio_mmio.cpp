@@ -99,11 +99,19 @@ void VirtioMmioDevice::MmioRead(uint64_t offset, uint8_t size,
     case kSHMLenLow:
     case kSHMLenHigh:
     case kSHMBaseLow:
-    case kSHMBaseHigh:
-        // No shared memory regions supported — return all-ones so the
-        // kernel's virtio_get_shm_region() interprets this as "not present".
+    case kSHMBaseHigh: {
+        // An unknown region id reads as all-ones, which the kernel's
+        // virtio_get_shm_region() interprets as "not present".
         val = 0xFFFFFFFF;
+        for (const auto& region : shm_regions_) {
+            if (region.id != shm_sel_) continue;
+            uint64_t v = (offset == kSHMLenLow || offset == kSHMLenHigh) ? region.len : region.gpa;
+            val = (offset == kSHMLenLow || offset == kSHMBaseLow)
+                ? static_cast<uint32_t>(v) : static_cast<uint32_t>(v >> 32);
+            break;
+        }
         break;
+    }
     default:
         LOG_DEBUG("VirtIO MMIO: unhandled read offset=0x%03X", (uint32_t)offset);
         break;
@@ -180,6 +188,7 @@ void VirtioMmioDevice::MmioWrite(uint64_t offset, uint8_t size,
     }
     case kStatus:
         if (val == 0) {
+            ops_->OnBeforeReset();
             DoReset();
             ops_->OnStatusChange(0);
         } else {
@@ -245,8 +254,22 @@ void VirtioMmioDevice::DispatchQueueNotify(uint32_t queue_idx) {
     ops_->OnQueueNotify(queue_idx, queues_[queue_idx]);
 }
 
+void VirtioMmioDevice::SetShmRegion(uint32_t id, uint64_t gpa, uint64_t len) {
+    for (auto& region : shm_regions_) {
+        if (region.id == id) {
+            region.gpa = gpa;
+            region.len = len;
+            return;
+        }
+    }
+    shm_regions_.push_back({id, gpa, len});
+}
+
 void VirtioMmioDevice::NotifyUsedBuffer(int queue_idx) {
     if (queue_idx >= 0 && queue_idx < static_cast<int>(queues_.size())) {
+        // Reset or disabled: nothing was pushed, so nothing to signal.
+        if (!queues_[queue_idx].IsReady())
+            return;
         if (!queues_[queue_idx].ShouldNotifyGuest())
             return;
     }
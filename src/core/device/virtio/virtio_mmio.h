@@ -18,6 +18,10 @@ public:
     virtual void ReadConfig(uint32_t offset, uint8_t size, uint32_t* value) = 0;
     virtual void WriteConfig(uint32_t offset, uint8_t size, uint32_t value) = 0;
     virtual void OnStatusChange(uint32_t new_status) = 0;
+    // Driver reset, called while the rings are still mapped and before the
+    // transport clears them. Devices that complete requests off the vCPU
+    // thread must have stopped doing so when this returns.
+    virtual void OnBeforeReset() {}
 };
 
 // VirtIO MMIO transport device (spec v1.2, section 4.2).
@@ -83,6 +87,11 @@ public:
 
     uint32_t NumQueues() const { return static_cast<uint32_t>(queues_.size()); }
 
+    // Advertise a shared memory region (spec 2.10) at |gpa|. The caller owns
+    // the backing memory and its hypervisor mapping; the transport only
+    // reports base/length through the SHMSel/SHMLen/SHMBase registers.
+    void SetShmRegion(uint32_t id, uint64_t gpa, uint64_t len);
+
 private:
     void DoReset();
 
@@ -145,4 +154,11 @@ private:
     };
     std::vector<QueueConfig> queue_configs_;
     uint32_t shm_sel_ = 0;
+
+    struct ShmRegion {
+        uint32_t id;
+        uint64_t gpa;
+        uint64_t len;
+    };
+    std::vector<ShmRegion> shm_regions_;
 };
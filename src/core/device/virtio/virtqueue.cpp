@@ -164,6 +164,8 @@ bool VirtQueue::WalkIndirect(uint64_t table_gpa, uint32_t table_len,
 }
 
 void VirtQueue::PushUsed(uint16_t head_idx, uint32_t total_len) {
+    // After a reset the ring addresses are 0, which is guest RAM too.
+    if (!ready_) return;
     auto* used = Used();
     if (!used) return;
 
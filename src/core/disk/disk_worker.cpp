@@ -1,4 +1,5 @@
 #include "core/disk/disk_worker.h"
+#include "core/util/thread_policy.h"
 #include <utility>
 
 DiskWorker::DiskWorker()
@@ -23,6 +24,7 @@ void DiskWorker::Submit(Task task) {
 }
 
 void DiskWorker::Run() {
+    InitVmThread("vm-disk", VmThreadRole::kIo);
     std::vector<Task> batch;
     for (;;) {
         {
@@ -5,6 +5,7 @@
 #include "core/net/net_packet.h"
 #include "core/device/virtio/virtio_net.h"
 #include "core/vmm/types.h"
+#include "core/util/thread_policy.h"
 
 extern "C" {
 #include "lwip/init.h"
@@ -579,6 +580,7 @@ void NetBackend::UpdatePfConnPoll(PfEntry::Conn& conn) {
 // ============================================================
 
 void NetBackend::NetworkThread() {
+    InitVmThread("vm-net", VmThreadRole::kIo);
     lwip_init();
 
     auto* nif = new netif();
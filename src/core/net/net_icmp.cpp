@@ -7,6 +7,7 @@
 #include "core/net/net_packet.h"
 #include "core/net/frame_builder.h"
 #include "core/vmm/types.h"
+#include "core/util/thread_policy.h"
 
 #include <uv.h>
 
@@ -48,6 +49,7 @@ void NetBackend::HandleIcmpOut(uint32_t src_ip, uint32_t dst_ip,
 }
 
 void NetBackend::IcmpWorkerThread() {
+    InitVmThread("vm-icmp", VmThreadRole::kIo);
     while (icmp_running_) {
         IcmpRequest req;
         {
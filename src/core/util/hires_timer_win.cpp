@@ -1,5 +1,6 @@
 #include "core/util/hires_timer.h"
 #include "core/vmm/types.h"
+#include "core/util/thread_policy.h"
 
 #include <windows.h>
 
@@ -109,6 +110,7 @@ public:
 
 private:
     void WorkerLoop() {
+        InitVmThread("vm-timer", VmThreadRole::kIo);
         while (!stop_.load(std::memory_order_acquire)) {
             DWORD r = WaitForSingleObject(handle_, INFINITE);
             if (r != WAIT_OBJECT_0) {
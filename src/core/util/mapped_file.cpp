@@ -0,0 +1,92 @@
+#include "core/util/mapped_file.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+#if defined(_WIN32)
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    std::wstring wpath(wlen > 0 ? wlen - 1 : 0, L'\0');
+    if (wlen > 1) MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wpath.data(), wlen);
+    HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ == 0) return true;
+    mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) {
+        Close();
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        Close();
+        return false;
+    }
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) {
+        ::close(fd);
+        return true;
+    }
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        size_ = 0;
+        return false;
+    }
+    // Boot images are consumed front to back exactly once.
+    ::madvise(p, size_, MADV_SEQUENTIAL);
+    ::madvise(p, size_, MADV_WILLNEED);
+    data_ = static_cast<const uint8_t*>(p);
+    return true;
+#endif
+}
+
+void MappedFile::Close() {
+#if defined(_WIN32)
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool MappedFile::CopyTo(uint8_t* dest, size_t offset, size_t len) const {
+    if (offset > size_ || len > size_ - offset) return false;
+    if (len) memcpy(dest, data_ + offset, len);
+    return true;
+}
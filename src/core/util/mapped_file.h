@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. Boot images (kernel, initrd)
+// are loaded through this so the bytes go page cache -> guest RAM in a
+// single copy instead of being staged in a heap buffer first; concurrent
+// VMs booting the same image also share the page-cache pages.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false (and logs nothing) if the file cannot be opened or
+    // mapped. An empty file opens successfully with size() == 0.
+    bool Open(const std::string& path);
+    void Close();
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // Copy [offset, offset + len) into |dest|. Returns false if the range is
+    // out of bounds.
+    bool CopyTo(uint8_t* dest, size_t offset, size_t len) const;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
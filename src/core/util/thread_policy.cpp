@@ -0,0 +1,122 @@
+#include "core/util/thread_policy.h"
+#include "core/vmm/types.h"
+
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+std::mutex g_policy_mutex;
+ThreadPlacementPolicy g_policy;
+
+ThreadPlacementPolicy CurrentPolicy() {
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    return g_policy;
+}
+
+bool SetCurrentThreadAffinity(const std::vector<uint32_t>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (uint32_t cpu : cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        LOG_WARN("thread affinity failed: %s", strerror(rc));
+        return false;
+    }
+    return true;
+#elif defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (uint32_t cpu : cpus) {
+        if (cpu < sizeof(DWORD_PTR) * 8) mask |= DWORD_PTR{1} << cpu;
+    }
+    if (!mask || !SetThreadAffinityMask(GetCurrentThread(), mask)) {
+        LOG_WARN("thread affinity failed (mask=0x%llx)",
+                 static_cast<unsigned long long>(mask));
+        return false;
+    }
+    return true;
+#else
+    // macOS exposes only affinity tags (scheduling hints), not hard pinning.
+    static std::once_flag warned;
+    std::call_once(warned, [] {
+        LOG_WARN("CPU pinning is not supported on this platform; ignoring");
+    });
+    (void)cpus;
+    return false;
+#endif
+}
+
+void SetCurrentThreadFifo(int priority) {
+#if defined(__linux__)
+    sched_param param{};
+    param.sched_priority = priority;
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0) {
+        LOG_WARN("SCHED_FIFO(%d) failed: %s", priority, strerror(rc));
+    }
+#else
+    (void)priority;
+    static std::once_flag warned;
+    std::call_once(warned, [] {
+        LOG_WARN("real-time vCPU scheduling is only supported on Linux; ignoring");
+    });
+#endif
+}
+
+}  // namespace
+
+void SetThreadPlacementPolicy(const ThreadPlacementPolicy& policy) {
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    g_policy = policy;
+}
+
+void SetCurrentThreadName(const char* name) {
+#if defined(__linux__)
+    char truncated[16];
+    strncpy(truncated, name, sizeof(truncated) - 1);
+    truncated[sizeof(truncated) - 1] = '\0';
+    pthread_setname_np(pthread_self(), truncated);
+#elif defined(__APPLE__)
+    pthread_setname_np(name);
+#elif defined(_WIN32)
+    // SetThreadDescription appeared in Windows 10 1607; resolve it at
+    // runtime so the binary still loads on older builds.
+    using SetThreadDescriptionFn = HRESULT(WINAPI*)(HANDLE, PCWSTR);
+    static auto fn = reinterpret_cast<SetThreadDescriptionFn>(
+        GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription"));
+    if (!fn) return;
+    std::wstring wide(name, name + strlen(name));
+    fn(GetCurrentThread(), wide.c_str());
+#else
+    (void)name;
+#endif
+}
+
+void InitVmThread(const char* name, VmThreadRole role, uint32_t index) {
+    SetCurrentThreadName(name);
+    const ThreadPlacementPolicy policy = CurrentPolicy();
+    if (role == VmThreadRole::kVCpu) {
+        if (!policy.vcpu_cpus.empty()) {
+            uint32_t cpu = policy.vcpu_cpus[index % policy.vcpu_cpus.size()];
+            if (SetCurrentThreadAffinity({cpu})) {
+                LOG_INFO("%s pinned to CPU %u", name, cpu);
+            }
+        }
+        if (policy.vcpu_fifo_priority > 0) {
+            SetCurrentThreadFifo(policy.vcpu_fifo_priority);
+        }
+    } else if (!policy.io_cpus.empty()) {
+        SetCurrentThreadAffinity(policy.io_cpus);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Process-wide thread placement for a VM runtime. One runtime hosts one VM,
+// so the policy is installed once at runtime startup and every thread the VM
+// spawns applies it to itself on entry via InitVmThread(). Keeping it global
+// avoids threading the policy through every device that owns a worker
+// (DiskWorker, NetBackend, ...).
+struct ThreadPlacementPolicy {
+    // vCPU i is pinned to vcpu_cpus[i % size]. Empty = no pinning.
+    std::vector<uint32_t> vcpu_cpus;
+    // Affinity mask for device / I/O threads (io loop, disk workers, network,
+    // IPC). Empty = inherit the process mask.
+    std::vector<uint32_t> io_cpus;
+    // Run vCPU threads under SCHED_FIFO at this priority (0 = normal
+    // scheduling). Linux only; needs CAP_SYS_NICE or an RLIMIT_RTPRIO grant.
+    int vcpu_fifo_priority = 0;
+};
+
+enum class VmThreadRole {
+    kVCpu,
+    kIo,
+};
+
+void SetThreadPlacementPolicy(const ThreadPlacementPolicy& policy);
+
+// Best-effort thread name (truncated to 15 chars on Linux).
+void SetCurrentThreadName(const char* name);
+
+// Name the calling thread and apply the placement policy for |role|.
+// |index| selects the CPU for vCPU threads. Failures are logged and
+// otherwise ignored: placement is an optimisation, never a reason to fail.
+void InitVmThread(const char* name, VmThreadRole role, uint32_t index = 0);
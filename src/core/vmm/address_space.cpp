@@ -1,39 +1,91 @@
 #include "core/vmm/address_space.h"
+#include "core/vmm/vcpu_stats.h"
 
-void AddressSpace::AddPioDevice(uint16_t base, uint16_t size, Device* device) {
-    pio_devices_.push_back({base, size, device});
+void AddressSpace::AddPioDevice(uint16_t base, uint16_t size, Device* device,
+                                const char* name) {
+    pio_devices_.push_back({base, size, device, name});
 }
 
-void AddressSpace::AddMmioDevice(uint64_t base, uint64_t size, Device* device) {
-    mmio_devices_.push_back({base, size, device});
+void AddressSpace::AddMmioDevice(uint64_t base, uint64_t size, Device* device,
+                                 const char* name) {
+    mmio_devices_.push_back({base, size, device, name});
 }
 
-Device* AddressSpace::FindPioDevice(uint16_t port, uint16_t* offset) const {
+const PioEntry* AddressSpace::FindPioDevice(uint16_t port, uint16_t* offset) const {
     for (auto& entry : pio_devices_) {
         if (port >= entry.base && port < entry.base + entry.size) {
             *offset = port - entry.base;
-            return entry.device;
+            return &entry;
         }
     }
     return nullptr;
 }
 
-Device* AddressSpace::FindMmioDevice(uint64_t addr, uint64_t* offset) const {
+const MmioEntry* AddressSpace::FindMmioDevice(uint64_t addr, uint64_t* offset) const {
     for (auto& entry : mmio_devices_) {
         if (addr >= entry.base && addr < entry.base + entry.size) {
             *offset = addr - entry.base;
-            return entry.device;
+            return &entry;
         }
     }
     return nullptr;
 }
 
+size_t AddressSpace::PioDeviceCount() const {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    return pio_devices_.size();
+}
+
+size_t AddressSpace::MmioDeviceCount() const {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    return mmio_devices_.size();
+}
+
+std::vector<std::string> AddressSpace::PioDeviceNames() const {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    std::vector<std::string> names;
+    names.reserve(pio_devices_.size());
+    for (auto& entry : pio_devices_) {
+        char buf[48];
+        if (entry.name) {
+            snprintf(buf, sizeof(buf), "%s@0x%X", entry.name, entry.base);
+        } else {
+            snprintf(buf, sizeof(buf), "pio@0x%X", entry.base);
+        }
+        names.emplace_back(buf);
+    }
+    return names;
+}
+
+std::vector<std::string> AddressSpace::MmioDeviceNames() const {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    std::vector<std::string> names;
+    names.reserve(mmio_devices_.size());
+    for (auto& entry : mmio_devices_) {
+        char buf[64];
+        if (entry.name) {
+            snprintf(buf, sizeof(buf), "%s@0x%" PRIX64, entry.name, entry.base);
+        } else {
+            snprintf(buf, sizeof(buf), "mmio@0x%" PRIX64, entry.base);
+        }
+        names.emplace_back(buf);
+    }
+    return names;
+}
+
+// Device handlers below are timed only on vCPU threads (VCpuStats::Current()
+// is null elsewhere). The measured span includes io_mutex_ contention,
+// since that is time the vCPU spends out of the guest too.
+
 bool AddressSpace::HandlePortIn(uint16_t port, uint8_t size, uint32_t* value) {
+    VCpuStats* stats = VCpuStats::Current();
+    uint64_t t0 = stats ? StatsNowNs() : 0;
     std::lock_guard<std::mutex> lock(io_mutex_);
     uint16_t offset = 0;
-    Device* dev = FindPioDevice(port, &offset);
-    if (dev) {
-        dev->PioRead(offset, size, value);
+    const PioEntry* entry = FindPioDevice(port, &offset);
+    if (entry) {
+        entry->device->PioRead(offset, size, value);
+        if (stats) stats->RecordPio(entry - pio_devices_.data(), StatsNowNs() - t0);
         return true;
     }
     *value = 0xFFFFFFFF;
@@ -42,11 +94,14 @@ bool AddressSpace::HandlePortIn(uint16_t port, uint8_t size, uint32_t* value) {
 }
 
 bool AddressSpace::HandlePortOut(uint16_t port, uint8_t size, uint32_t value) {
+    VCpuStats* stats = VCpuStats::Current();
+    uint64_t t0 = stats ? StatsNowNs() : 0;
     std::lock_guard<std::mutex> lock(io_mutex_);
     uint16_t offset = 0;
-    Device* dev = FindPioDevice(port, &offset);
-    if (dev) {
-        dev->PioWrite(offset, size, value);
+    const PioEntry* entry = FindPioDevice(port, &offset);
+    if (entry) {
+        entry->device->PioWrite(offset, size, value);
+        if (stats) stats->RecordPio(entry - pio_devices_.data(), StatsNowNs() - t0);
         return true;
     }
     LOG_DEBUG("Unhandled PIO write: port=0x%X size=%u val=0x%X",
@@ -62,11 +117,14 @@ bool AddressSpace::IsMmioAddress(uint64_t addr) const {
 
 bool AddressSpace::HandleMmioRead(uint64_t addr, uint8_t size,
                                    uint64_t* value) {
+    VCpuStats* stats = VCpuStats::Current();
+    uint64_t t0 = stats ? StatsNowNs() : 0;
     std::lock_guard<std::mutex> lock(io_mutex_);
     uint64_t offset = 0;
-    Device* dev = FindMmioDevice(addr, &offset);
-    if (dev) {
-        dev->MmioRead(offset, size, value);
+    const MmioEntry* entry = FindMmioDevice(addr, &offset);
+    if (entry) {
+        entry->device->MmioRead(offset, size, value);
+        if (stats) stats->RecordMmio(entry - mmio_devices_.data(), StatsNowNs() - t0);
         return true;
     }
     *value = 0;
@@ -76,11 +134,14 @@ bool AddressSpace::HandleMmioRead(uint64_t addr, uint8_t size,
 
 bool AddressSpace::HandleMmioWrite(uint64_t addr, uint8_t size,
                                     uint64_t value) {
+    VCpuStats* stats = VCpuStats::Current();
+    uint64_t t0 = stats ? StatsNowNs() : 0;
     std::lock_guard<std::mutex> lock(io_mutex_);
     uint64_t offset = 0;
-    Device* dev = FindMmioDevice(addr, &offset);
-    if (dev) {
-        dev->MmioWrite(offset, size, value);
+    const MmioEntry* entry = FindMmioDevice(addr, &offset);
+    if (entry) {
+        entry->device->MmioWrite(offset, size, value);
+        if (stats) stats->RecordMmio(entry - mmio_devices_.data(), StatsNowNs() - t0);
         return true;
     }
     LOG_DEBUG("Unhandled MMIO write: addr=0x%" PRIX64 " size=%u val=0x%" PRIX64,
@@ -2,6 +2,7 @@
 
 #include "core/vmm/types.h"
 #include "core/device/device.h"
+#include <string>
 #include <vector>
 #include <mutex>
 
@@ -9,18 +10,24 @@ struct PioEntry {
     uint16_t base;
     uint16_t size;
     Device*  device;
+    const char* name;   // label for exit stats; may be null
 };
 
 struct MmioEntry {
     uint64_t base;
     uint64_t size;
     Device*  device;
+    const char* name;   // label for exit stats; may be null
 };
 
 class AddressSpace {
 public:
-    void AddPioDevice(uint16_t base, uint16_t size, Device* device);
-    void AddMmioDevice(uint64_t base, uint64_t size, Device* device);
+    // |name| must outlive the AddressSpace (string literals in practice).
+    // It only labels the slot in per-vCPU exit stats.
+    void AddPioDevice(uint16_t base, uint16_t size, Device* device,
+                      const char* name = nullptr);
+    void AddMmioDevice(uint64_t base, uint64_t size, Device* device,
+                       const char* name = nullptr);
 
     bool HandlePortIn(uint16_t port, uint8_t size, uint32_t* value);
     bool HandlePortOut(uint16_t port, uint8_t size, uint32_t value);
@@ -29,9 +36,16 @@ public:
 
     bool IsMmioAddress(uint64_t addr) const;
 
+    // Slot labels in registration order, indexed like the per-device
+    // histograms in VCpuStats. Unnamed slots are labelled by address.
+    size_t PioDeviceCount() const;
+    size_t MmioDeviceCount() const;
+    std::vector<std::string> PioDeviceNames() const;
+    std::vector<std::string> MmioDeviceNames() const;
+
 private:
-    Device* FindPioDevice(uint16_t port, uint16_t* offset) const;
-    Device* FindMmioDevice(uint64_t addr, uint64_t* offset) const;
+    const PioEntry* FindPioDevice(uint16_t port, uint16_t* offset) const;
+    const MmioEntry* FindMmioDevice(uint64_t addr, uint64_t* offset) const;
 
     mutable std::mutex io_mutex_;
     std::vector<PioEntry>  pio_devices_;
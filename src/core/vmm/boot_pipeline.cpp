@@ -0,0 +1,80 @@
+#include "core/vmm/boot_pipeline.h"
+#include "core/vmm/types.h"
+#include "core/vmm/vcpu_stats.h"
+#include "core/util/thread_policy.h"
+
+BootPipeline::BootPipeline() : t0_ns_(StatsNowNs()) {}
+
+BootPipeline::~BootPipeline() {
+    WaitAll();
+}
+
+BootPipeline::Stage& BootPipeline::Add(const char* name, bool async, StageId* id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id) *id = stages_.size();
+    stages_.push_back(std::make_unique<Stage>());
+    Stage& stage = *stages_.back();
+    stage.name = name;
+    stage.async = async;
+    return stage;
+}
+
+BootPipeline::StageId BootPipeline::Launch(const char* name, std::function<bool()> fn) {
+    StageId id;
+    Stage& stage = Add(name, true, &id);
+    stage.thread = std::thread([&stage, fn = std::move(fn)]() {
+        InitVmThread("vm-boot", VmThreadRole::kIo);
+        stage.start_ns = StatsNowNs();
+        stage.ok = fn();
+        stage.end_ns = StatsNowNs();
+    });
+    return id;
+}
+
+bool BootPipeline::Run(const char* name, const std::function<bool()>& fn) {
+    Stage& stage = Add(name, false, nullptr);
+    stage.start_ns = StatsNowNs();
+    stage.ok = fn();
+    stage.end_ns = StatsNowNs();
+    return stage.ok;
+}
+
+bool BootPipeline::Wait(StageId id) {
+    Stage* stage;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (id >= stages_.size()) return false;
+        stage = stages_[id].get();
+    }
+    if (stage->thread.joinable()) stage->thread.join();
+    return stage->ok;
+}
+
+bool BootPipeline::WaitAll() {
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        count = stages_.size();
+    }
+    bool ok = true;
+    for (StageId id = 0; id < count; ++id) {
+        ok = Wait(id) && ok;
+    }
+    return ok;
+}
+
+void BootPipeline::LogSummary(const char* milestone) {
+    WaitAll();
+    const uint64_t now = StatsNowNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& stage : stages_) {
+        LOG_INFO("boot stage %-15s +%7.1f ms .. +%7.1f ms  %7.1f ms%s%s",
+                 stage->name.c_str(),
+                 (stage->start_ns - t0_ns_) / 1e6,
+                 (stage->end_ns - t0_ns_) / 1e6,
+                 (stage->end_ns - stage->start_ns) / 1e6,
+                 stage->async ? "  [async]" : "",
+                 stage->ok ? "" : "  FAILED");
+    }
+    LOG_INFO("boot: %s at +%.1f ms", milestone, (now - t0_ns_) / 1e6);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Small task graph for VM bring-up. Independent stages (disk open, boot
+// image prefetch, net backend start, kernel load) run on their own short-
+// lived threads while the caller carries on with order-sensitive work such
+// as MMIO registration; edges are expressed by Wait()ing on a stage before
+// the work that needs its result. Every stage, inline or async, is timed
+// relative to pipeline construction so LogSummary() can report where
+// start-to-first-instruction latency went.
+class BootPipeline {
+public:
+    using StageId = size_t;
+
+    BootPipeline();
+    // Joins any stage that is still running.
+    ~BootPipeline();
+
+    BootPipeline(const BootPipeline&) = delete;
+    BootPipeline& operator=(const BootPipeline&) = delete;
+
+    // Start |fn| on a new thread and return immediately.
+    StageId Launch(const char* name, std::function<bool()> fn);
+    // Run |fn| on the calling thread, timed as a stage. Returns its result.
+    bool Run(const char* name, const std::function<bool()>& fn);
+    // Block until |id| has finished; returns its result.
+    bool Wait(StageId id);
+    // Wait for every launched stage; true if all succeeded.
+    bool WaitAll();
+
+    // Log one line per stage and the elapsed time at |milestone|.
+    void LogSummary(const char* milestone);
+
+private:
+    struct Stage {
+        std::string name;
+        bool async = false;
+        uint64_t start_ns = 0;
+        uint64_t end_ns = 0;
+        bool ok = false;
+        std::thread thread;
+    };
+
+    Stage& Add(const char* name, bool async, StageId* id);
+
+    uint64_t t0_ns_;
+    std::mutex mutex_;
+    // unique_ptr keeps Stage addresses stable while worker threads write
+    // to them and the vector grows.
+    std::vector<std::unique_ptr<Stage>> stages_;
+};
@@ -0,0 +1,59 @@
+#include "core/vmm/halt_poll.h"
+#include "core/vmm/vcpu_stats.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static inline void CpuRelax() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+HaltPoller::HaltPoller(const HaltPollConfig& config) : config_(config) {
+    if (config_.grow_start_ns > config_.max_ns) {
+        config_.grow_start_ns = config_.max_ns;
+    }
+}
+
+bool HaltPoller::Poll(HypervisorVCpu& vcpu) {
+    if (window_ns_ == 0) return false;
+    const uint64_t deadline = StatsNowNs() + window_ns_;
+    do {
+        if (vcpu.HasPendingInterrupt()) return true;
+        for (int i = 0; i < 16; ++i) CpuRelax();
+    } while (StatsNowNs() < deadline);
+    return vcpu.HasPendingInterrupt();
+}
+
+void HaltPoller::Update(uint64_t halt_ns, bool woken) {
+    if (config_.max_ns == 0) return;
+    if (!woken) {
+        // Timed out with nothing to do: the guest is idle.
+        Shrink();
+    } else if (halt_ns <= window_ns_) {
+        // Caught by polling; the window is about right.
+    } else if (window_ns_ && halt_ns > config_.max_ns) {
+        Shrink();
+    } else if (window_ns_ < config_.max_ns && halt_ns < config_.max_ns) {
+        Grow();
+    }
+}
+
+void HaltPoller::Grow() {
+    uint64_t next = static_cast<uint64_t>(window_ns_) * config_.grow;
+    if (next < config_.grow_start_ns) next = config_.grow_start_ns;
+    if (next > config_.max_ns) next = config_.max_ns;
+    window_ns_ = static_cast<uint32_t>(next);
+}
+
+void HaltPoller::Shrink() {
+    uint32_t next = config_.shrink ? window_ns_ / config_.shrink : 0;
+    if (next < config_.grow_start_ns) next = 0;
+    window_ns_ = next;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core/vmm/hypervisor_vcpu.h"
+#include <cstdint>
+
+// Bounds for userspace halt polling. Mirrors KVM's halt_poll_ns /
+// halt_poll_ns_grow / halt_poll_ns_grow_start / halt_poll_ns_shrink knobs.
+struct HaltPollConfig {
+    uint32_t max_ns = 200000;        // upper bound of the poll window; 0 disables
+    uint32_t grow_start_ns = 10000;  // first non-zero window
+    uint32_t grow = 2;               // multiplicative growth factor
+    uint32_t shrink = 0;             // divisor on shrink; 0 resets the window
+};
+
+// Per-vCPU adaptive poll window. After a HLT exit the vCPU thread spins for
+// up to window_ns() checking for a pending interrupt before falling back to
+// the blocking WaitForInterrupt(). The window grows while halts are short
+// enough that polling would have caught them and collapses when halts run
+// past the bound, so idle guests do not burn a host core.
+//
+// Only used on backends that queue interrupts in userspace
+// (HypervisorVCpu::SupportsHaltPoll()); with an in-kernel irqchip KVM does
+// its own polling and a userspace HLT exit is rare.
+class HaltPoller {
+public:
+    explicit HaltPoller(const HaltPollConfig& config);
+
+    // Spin for the current window waiting for |vcpu| to have an interrupt
+    // pending. Returns true if one showed up. Returns false immediately when
+    // the window is zero.
+    bool Poll(HypervisorVCpu& vcpu);
+
+    // Feed back the total halt duration (poll + block) and whether the vCPU
+    // was woken by an interrupt rather than a timeout.
+    void Update(uint64_t halt_ns, bool woken);
+
+    uint32_t window_ns() const { return window_ns_; }
+
+private:
+    void Grow();
+    void Shrink();
+
+    HaltPollConfig config_;
+    uint32_t window_ns_ = 0;
+};
@@ -25,6 +25,11 @@ public:
     // Returns true if woken by an interrupt, false on timeout.
     virtual bool WaitForInterrupt(uint32_t timeout_ms) { (void)timeout_ms; return false; }
 
+    // Non-blocking check used by halt polling. Backends that queue interrupts
+    // in userspace override both; others are never polled.
+    virtual bool SupportsHaltPoll() const { return false; }
+    virtual bool HasPendingInterrupt() { return false; }
+
     // Hardware APIC ID as assigned by the hypervisor. Defaults to Index().
     virtual uint32_t ApicId() const { return Index(); }
 
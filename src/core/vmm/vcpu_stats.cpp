@@ -0,0 +1,205 @@
+#include "core/vmm/vcpu_stats.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace {
+
+thread_local VCpuStats* t_current_stats = nullptr;
+
+size_t BucketFor(uint64_t ns) {
+    size_t b = 0;
+    while (ns > 1 && b + 1 < LatencyHistogram::kBuckets) {
+        ns >>= 1;
+        ++b;
+    }
+    return b;
+}
+
+void AppendU64(std::string* out, const char* key, uint64_t v, bool comma = true) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s\"%s\":%" PRIu64, comma ? "," : "", key, v);
+    out->append(buf);
+}
+
+void AppendHistogram(std::string* out, const LatencyHistogram::Snapshot& s) {
+    out->push_back('{');
+    AppendU64(out, "count", s.count, false);
+    AppendU64(out, "total_ns", s.total_ns);
+    AppendU64(out, "max_ns", s.max_ns);
+    AppendU64(out, "p50_ns", s.PercentileNs(50));
+    AppendU64(out, "p99_ns", s.PercentileNs(99));
+    // Trailing empty buckets are dropped; bucket i is [2^i, 2^(i+1)) ns.
+    size_t last = 0;
+    for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+        if (s.buckets[i]) last = i + 1;
+    }
+    out->append(",\"log2_buckets\":[");
+    for (size_t i = 0; i < last; ++i) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%s%" PRIu64, i ? "," : "", s.buckets[i]);
+        out->append(buf);
+    }
+    out->append("]}");
+}
+
+void AppendJsonString(std::string* out, const std::string& s) {
+    out->push_back('"');
+    for (char c : s) {
+        if (c == '"' || c == '\\') out->push_back('\\');
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out->push_back(c);
+    }
+    out->push_back('"');
+}
+
+void AppendSlots(std::string* out, const char* key,
+                 const LatencyHistogram* slots, size_t count,
+                 const std::vector<std::string>& names) {
+    out->append(",\"");
+    out->append(key);
+    out->append("\":{");
+    bool first = true;
+    for (size_t i = 0; i < count; ++i) {
+        auto snap = slots[i].Read();
+        if (!snap.count) continue;
+        if (!first) out->push_back(',');
+        first = false;
+        std::string name = i < names.size() ? names[i] : "slot" + std::to_string(i);
+        AppendJsonString(out, name);
+        out->push_back(':');
+        AppendHistogram(out, snap);
+    }
+    out->push_back('}');
+}
+
+}  // namespace
+
+const char* VCpuExitKindName(VCpuExitKind kind) {
+    switch (kind) {
+    case VCpuExitKind::kMmio:      return "mmio";
+    case VCpuExitKind::kPio:       return "pio";
+    case VCpuExitKind::kHalt:      return "hlt";
+    case VCpuExitKind::kIrqWindow: return "irq_window";
+    case VCpuExitKind::kIntr:      return "intr";
+    case VCpuExitKind::kOther:     return "other";
+    default:                       return "unknown";
+    }
+}
+
+void LatencyHistogram::Record(uint64_t ns) {
+    Bump(count_, 1);
+    Bump(total_ns_, ns);
+    if (ns > max_ns_.load(std::memory_order_relaxed)) {
+        max_ns_.store(ns, std::memory_order_relaxed);
+    }
+    Bump(buckets_[BucketFor(ns)], 1);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Read() const {
+    Snapshot s;
+    s.count = count_.load(std::memory_order_relaxed);
+    s.total_ns = total_ns_.load(std::memory_order_relaxed);
+    s.max_ns = max_ns_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kBuckets; ++i) {
+        s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+uint64_t LatencyHistogram::Snapshot::PercentileNs(double pct) const {
+    uint64_t total = 0;
+    for (auto b : buckets) total += b;
+    if (!total) return 0;
+    uint64_t target = static_cast<uint64_t>(total * pct / 100.0);
+    if (target >= total) target = total - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets[i];
+        if (seen > target) {
+            uint64_t upper = (i + 1 < 64) ? (uint64_t{1} << (i + 1)) - 1 : UINT64_MAX;
+            return upper < max_ns ? upper : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+VCpuStats::VCpuStats(uint32_t vcpu_index, size_t mmio_slots, size_t pio_slots)
+    : index_(vcpu_index),
+      mmio_(new LatencyHistogram[mmio_slots ? mmio_slots : 1]),
+      pio_(new LatencyHistogram[pio_slots ? pio_slots : 1]),
+      mmio_slots_(mmio_slots),
+      pio_slots_(pio_slots) {}
+
+VCpuStats* VCpuStats::Current() {
+    return t_current_stats;
+}
+
+void VCpuStats::SetCurrent(VCpuStats* stats) {
+    t_current_stats = stats;
+}
+
+void VCpuStats::RecordMmio(size_t slot, uint64_t ns) {
+    if (slot < mmio_slots_) mmio_[slot].Record(ns);
+    pending_kind_ = VCpuExitKind::kMmio;
+    pending_ns_ += ns;
+}
+
+void VCpuStats::RecordPio(size_t slot, uint64_t ns) {
+    if (slot < pio_slots_) pio_[slot].Record(ns);
+    pending_kind_ = VCpuExitKind::kPio;
+    pending_ns_ += ns;
+}
+
+void VCpuStats::RecordHalt(uint64_t ns) {
+    pending_kind_ = VCpuExitKind::kHalt;
+    pending_ns_ += ns;
+}
+
+void VCpuStats::RecordHaltPoll(bool success, uint64_t poll_ns, uint32_t window_ns) {
+    auto& counter = success ? halt_poll_success_ : halt_poll_fail_;
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+    halt_poll_ns_.store(halt_poll_ns_.load(std::memory_order_relaxed) + poll_ns,
+                        std::memory_order_relaxed);
+    halt_poll_window_ns_.store(window_ns, std::memory_order_relaxed);
+}
+
+void VCpuStats::CompleteExit(uint64_t run_ns) {
+    exits_.store(exits_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+    run_ns_.store(run_ns_.load(std::memory_order_relaxed) + run_ns,
+                  std::memory_order_relaxed);
+    kinds_[static_cast<size_t>(pending_kind_)].Record(pending_ns_);
+    pending_kind_ = VCpuExitKind::kOther;
+    pending_ns_ = 0;
+}
+
+void VCpuStats::AppendJson(std::string* out,
+                           const std::vector<std::string>& mmio_names,
+                           const std::vector<std::string>& pio_names) const {
+    out->push_back('{');
+    AppendU64(out, "index", index_, false);
+    AppendU64(out, "exits", exits_.load(std::memory_order_relaxed));
+    AppendU64(out, "run_ns", run_ns_.load(std::memory_order_relaxed));
+
+    out->append(",\"exit_kinds\":{");
+    for (size_t i = 0; i < kinds_.size(); ++i) {
+        if (i) out->push_back(',');
+        AppendJsonString(out, VCpuExitKindName(static_cast<VCpuExitKind>(i)));
+        out->push_back(':');
+        AppendHistogram(out, kinds_[i].Read());
+    }
+    out->push_back('}');
+
+    out->append(",\"halt_poll\":{");
+    AppendU64(out, "success", halt_poll_success_.load(std::memory_order_relaxed), false);
+    AppendU64(out, "fail", halt_poll_fail_.load(std::memory_order_relaxed));
+    AppendU64(out, "poll_ns", halt_poll_ns_.load(std::memory_order_relaxed));
+    AppendU64(out, "window_ns", halt_poll_window_ns_.load(std::memory_order_relaxed));
+    out->push_back('}');
+
+    AppendSlots(out, "mmio", mmio_.get(), mmio_slots_, mmio_names);
+    AppendSlots(out, "pio", pio_.get(), pio_slots_, pio_names);
+    out->push_back('}');
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Why a vCPU came back to userspace. MMIO / PIO are attributed by
+// AddressSpace when it dispatches to a device; HLT by the Vm run loop;
+// IRQ-window and interrupted-run exits by the hypervisor backend. Anything
+// nobody claimed is counted as kOther.
+enum class VCpuExitKind : uint8_t {
+    kMmio = 0,
+    kPio,
+    kHalt,
+    kIrqWindow,
+    kIntr,
+    kOther,
+    kCount,
+};
+
+const char* VCpuExitKindName(VCpuExitKind kind);
+
+inline uint64_t StatsNowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Log2-bucketed latency histogram. Bucket i covers [2^i, 2^(i+1)) ns
+// (bucket 0 also takes 0 ns). Single writer (the owning vCPU thread), any
+// number of concurrent readers: the writer uses plain relaxed load+store
+// instead of locked RMW so recording stays a handful of instructions on
+// the exit path.
+class LatencyHistogram {
+public:
+    static constexpr size_t kBuckets = 40;  // up to ~9 minutes
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        std::array<uint64_t, kBuckets> buckets{};
+
+        // Upper bound of the bucket holding the given percentile (0..100).
+        uint64_t PercentileNs(double pct) const;
+    };
+
+    void Record(uint64_t ns);
+    Snapshot Read() const;
+
+private:
+    static void Bump(std::atomic<uint64_t>& v, uint64_t delta) {
+        v.store(v.load(std::memory_order_relaxed) + delta,
+                std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+};
+
+// Per-vCPU exit accounting. Owned by Vm, written only from the vCPU thread
+// it belongs to (reachable there through Current()), read from anywhere.
+class VCpuStats {
+public:
+    VCpuStats(uint32_t vcpu_index, size_t mmio_slots, size_t pio_slots);
+
+    // Thread-local pointer to the stats of the vCPU running on this thread.
+    // Null on non-vCPU threads, so device code called from I/O threads is
+    // never charged to a vCPU.
+    static VCpuStats* Current();
+    static void SetCurrent(VCpuStats* stats);
+
+    // Convenience for hypervisor backends: classify the exit currently
+    // being handled on this thread, if it belongs to a vCPU.
+    static void NoteExit(VCpuExitKind kind) {
+        if (auto* s = Current()) s->pending_kind_ = kind;
+    }
+
+    // Charge a device access (time spent in the userspace handler) to an
+    // AddressSpace slot. Marks the current exit as MMIO / PIO.
+    void RecordMmio(size_t slot, uint64_t ns);
+    void RecordPio(size_t slot, uint64_t ns);
+
+    // Time the vCPU thread spent blocked after a HLT exit.
+    void RecordHalt(uint64_t ns);
+
+    // Outcome of one halt-poll attempt (see HaltPoller). |window_ns| is the
+    // poll window after adjusting for this halt.
+    void RecordHaltPoll(bool success, uint64_t poll_ns, uint32_t window_ns);
+
+    // Close out one RunOnce() round trip. |run_ns| is the wall time of the
+    // RunOnce call (guest time plus in-backend handling).
+    void CompleteExit(uint64_t run_ns);
+
+    uint32_t index() const { return index_; }
+
+    // Append this vCPU's counters as a JSON object. Slot names come from
+    // AddressSpace::MmioDeviceNames()/PioDeviceNames(); idle slots are
+    // omitted.
+    void AppendJson(std::string* out,
+                    const std::vector<std::string>& mmio_names,
+                    const std::vector<std::string>& pio_names) const;
+
+private:
+    uint32_t index_;
+    std::atomic<uint64_t> exits_{0};
+    std::atomic<uint64_t> run_ns_{0};
+    std::array<LatencyHistogram, static_cast<size_t>(VCpuExitKind::kCount)> kinds_;
+    std::atomic<uint64_t> halt_poll_success_{0};
+    std::atomic<uint64_t> halt_poll_fail_{0};
+    std::atomic<uint64_t> halt_poll_ns_{0};
+    std::atomic<uint32_t> halt_poll_window_ns_{0};
+    std::unique_ptr<LatencyHistogram[]> mmio_;
+    std::unique_ptr<LatencyHistogram[]> pio_;
+    size_t mmio_slots_;
+    size_t pio_slots_;
+
+    // Owner-thread scratch for the exit in progress.
+    VCpuExitKind pending_kind_ = VCpuExitKind::kOther;
+    uint64_t pending_ns_ = 0;
+};
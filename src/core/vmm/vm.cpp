@@ -1,11 +1,15 @@
 #include "core/vmm/vm.h"
 #include "core/vmm/vm_platform.h"
+#include "core/util/mapped_file.h"
+#include "core/util/thread_policy.h"
 #include <algorithm>
+#include <optional>
 
 #if defined(__linux__)
 #include <cerrno>
 #include <cstring>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
@@ -53,7 +57,22 @@ static std::string GetDefaultCmdline(bool debug_mode) {
 #endif
 }
 
+// Pull a boot image into the page cache while the rest of the VM is being
+// built, so FinalizeBoot's copy into guest RAM later runs at memory speed.
+// Missing files are left for LoadKernel to report.
+static bool PrefetchBootImage(const std::string& path) {
+    if (path.empty()) return true;
+    MappedFile file;
+    if (!file.Open(path)) return true;
+    volatile uint8_t sink = 0;
+    for (size_t off = 0; off < file.size(); off += kPageSize) {
+        sink = sink + file.data()[off];
+    }
+    return true;
+}
+
 Vm::~Vm() {
+    boot_pipeline_.reset();
     running_ = false;
     if (console_input_thread_.joinable()) {
         console_input_thread_.join();
@@ -78,11 +97,15 @@ Vm::~Vm() {
         virtio_gpu_->SetFrameCallback(nullptr);
         virtio_gpu_->SetCursorCallback(nullptr);
         virtio_gpu_->SetScanoutStateCallback(nullptr);
+        virtio_gpu_->SetScanoutSurfaceCallback(nullptr);
     }
 
     if (net_backend_) {
         net_backend_->Stop();
     }
+    if (virtio_fs_) {
+        virtio_fs_->Stop();
+    }
 
     vcpus_.clear();
     hv_vm_.reset();
@@ -90,6 +113,12 @@ Vm::~Vm() {
         VmPlatform::FreeRam(mem_.base, mem_.alloc_size);
         mem_.base = nullptr;
     }
+#if defined(__linux__)
+    if (fs_dax_window_) {
+        ::munmap(fs_dax_window_, fs_dax_window_size_);
+        fs_dax_window_ = nullptr;
+    }
+#endif
 }
 
 std::unique_ptr<Vm> Vm::Create(const VmConfig& config) {
@@ -99,6 +128,24 @@ std::unique_ptr<Vm> Vm::Create(const VmConfig& config) {
     }
 
     auto vm = std::unique_ptr<Vm>(new Vm());
+    vm->boot_pipeline_ = std::make_unique<BootPipeline>();
+    BootPipeline& boot = *vm->boot_pipeline_;
+
+    // Stages that need neither the hypervisor nor guest RAM start first and
+    // overlap with everything below until their results are needed.
+    BootPipeline::StageId disk_open = 0;
+    if (!config.disk_path.empty()) {
+        vm->virtio_blk_ = std::make_unique<VirtioBlkDevice>();
+        disk_open = boot.Launch("disk-open",
+            [blk = vm->virtio_blk_.get(), path = config.disk_path]() {
+                return blk->Open(path);
+            });
+    }
+    boot.Launch("image-prefetch",
+        [kernel = config.kernel_path, initrd = config.initrd_path]() {
+            return PrefetchBootImage(kernel) && PrefetchBootImage(initrd);
+        });
+
     vm->console_port_ = config.console_port;
     vm->input_port_ = config.input_port;
     vm->display_port_ = config.display_port;
@@ -114,20 +161,27 @@ std::unique_ptr<Vm> Vm::Create(const VmConfig& config) {
     vm->machine_ = CreateMachineModel();
     if (!vm->machine_) return nullptr;
 
-    vm->hv_vm_ = VmPlatform::CreateHypervisor(config.cpu_count);
-    if (!vm->hv_vm_) return nullptr;
+    if (!boot.Run("hypervisor", [&]() {
+            vm->hv_vm_ = VmPlatform::CreateHypervisor(config.cpu_count);
+            return vm->hv_vm_ != nullptr;
+        })) {
+        return nullptr;
+    }
 
     uint64_t ram_bytes = config.memory_mb * 1024 * 1024;
-    if (!vm->AllocateMemory(ram_bytes)) return nullptr;
+    if (!boot.Run("ram", [&]() { return vm->AllocateMemory(ram_bytes); }))
+        return nullptr;
 
     vm->hv_vm_->SetGuestMemMap(&vm->mem_);
 
-    if (!vm->machine_->SetupPlatformDevices(
-            vm->addr_space_, vm->mem_, vm->hv_vm_.get(),
-            vm->console_port_,
-            &vm->io_loop_,
-            [&vm_ref = *vm]() { vm_ref.RequestStop(); },
-            [&vm_ref = *vm]() { vm_ref.RequestReboot(); })) {
+    if (!boot.Run("platform-devices", [&]() {
+            return vm->machine_->SetupPlatformDevices(
+                vm->addr_space_, vm->mem_, vm->hv_vm_.get(),
+                vm->console_port_,
+                &vm->io_loop_,
+                [&vm_ref = *vm]() { vm_ref.RequestStop(); },
+                [&vm_ref = *vm]() { vm_ref.RequestReboot(); });
+        })) {
         LOG_ERROR("Failed to set up platform devices");
         return nullptr;
     }
@@ -178,31 +232,49 @@ std::unique_ptr<Vm> Vm::Create(const VmConfig& config) {
 
     auto slots = vm->machine_->GetVirtioSlots();
 
+    // MMIO registration stays on this thread and in slot order: the order
+    // fixes the per-device stats slot indices and the ACPI/FDT node order.
     if (!config.disk_path.empty()) {
-        if (!vm->SetupVirtioBlk(config.disk_path, slots[0])) return nullptr;
+        if (!boot.Wait(disk_open) || !vm->SetupVirtioBlk(slots[0])) return nullptr;
     }
 
-    if (!vm->SetupVirtioNet(config.net_link_up, config.host_forwards, config.guest_forwards, slots[1]))
-        return nullptr;
-
-    if (!vm->SetupVirtioInput(slots[2], slots[3])) return nullptr;
-
-    if (!vm->SetupVirtioGpu(config.display_width, config.display_height, slots[4]))
-        return nullptr;
-
-    if (!vm->SetupVirtioSerial(slots[5]))
+    if (!vm->SetupVirtioNet(config.net_link_up, slots[1]))
         return nullptr;
+    BootPipeline::StageId net_start = boot.Launch("net-start",
+        [&vm_ref = *vm, forwards = config.host_forwards,
+         guest_forwards = config.guest_forwards, irq = slots[1].irq]() {
+            return vm_ref.StartNetBackend(forwards, guest_forwards, irq);
+        });
 
-    if (!vm->SetupVirtioFs(config.shared_folders, slots[6]))
+    if (!boot.Run("devices", [&]() {
+            return vm->SetupVirtioInput(slots[2], slots[3]) &&
+                   vm->SetupVirtioGpu(config.display_width, config.display_height, slots[4]) &&
+                   vm->SetupVirtioSerial(slots[5]) &&
+                   vm->SetupVirtioFs(config.shared_folders, slots[6],
+                                     config.fs_dax_window_mb) &&
+                   vm->SetupVirtioSnd(slots[7]);
+        })) {
         return nullptr;
+    }
 
-    if (!vm->SetupVirtioSnd(slots[7]))
+    if (!boot.Wait(net_start)) {
+        LOG_ERROR("Failed to start network backend");
         return nullptr;
+    }
 
     vm->cpu_count_ = config.cpu_count;
     // Resize the vCPU slot vector; actual vCPU objects are created per-thread.
     vm->vcpus_.resize(config.cpu_count);
 
+    // Every device slot is registered by now, so the per-vCPU exit stats
+    // can size their per-device histograms once and never reallocate.
+    size_t mmio_slots = vm->addr_space_.MmioDeviceCount();
+    size_t pio_slots = vm->addr_space_.PioDeviceCount();
+    for (uint32_t i = 0; i < config.cpu_count; i++) {
+        vm->vcpu_stats_.push_back(
+            std::make_unique<VCpuStats>(i, mmio_slots, pio_slots));
+    }
+
     // Save config for FinalizeBoot (called inside Run after all vCPUs are ready).
     vm->boot_config_ = config;
     if (vm->boot_config_.cmdline.empty()) {
@@ -262,7 +334,7 @@ void Vm::SetupVCpuCallbacks(uint32_t vcpu_index) {
 #endif
 }
 
-void Vm::FinalizeBoot(const VmConfig& config) {
+bool Vm::FinalizeBoot(const VmConfig& config) {
 #if defined(_WIN32) || (defined(__APPLE__) && defined(__x86_64__)) || (defined(__linux__) && defined(__x86_64__))
     {
         auto* x86m = dynamic_cast<X86Machine*>(machine_.get());
@@ -279,12 +351,13 @@ void Vm::FinalizeBoot(const VmConfig& config) {
     if (!machine_->LoadKernel(config, mem_, active_virtio_slots_)) {
         LOG_ERROR("Failed to load kernel");
         RequestStop();
-        return;
+        return false;
     }
 
     // NOTE: SetupBootVCpu is called from vCPU 0's own thread (after
     // boot_complete_) because HVF requires register writes to happen on the
     // thread that created the vCPU.
+    return true;
 }
 
 bool Vm::AllocateMemory(uint64_t size) {
@@ -537,10 +610,7 @@ void Vm::ShutdownIoEventFds() {
 #endif
 }
 
-bool Vm::SetupVirtioBlk(const std::string& disk_path, const VirtioDeviceSlot& slot) {
-    virtio_blk_ = std::make_unique<VirtioBlkDevice>();
-    if (!virtio_blk_->Open(disk_path)) return false;
-
+bool Vm::SetupVirtioBlk(const VirtioDeviceSlot& slot) {
     virtio_mmio_ = std::make_unique<VirtioMmioDevice>();
     virtio_mmio_->Init(virtio_blk_.get(), mem_);
     virtio_mmio_->SetIrqCallback([this, irq = slot.irq]() { InjectIrq(irq); });
@@ -550,14 +620,13 @@ bool Vm::SetupVirtioBlk(const std::string& disk_path, const VirtioDeviceSlot& sl
     virtio_blk_->SetMmioDevice(virtio_mmio_.get());
 
     addr_space_.AddMmioDevice(
-        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_.get());
+        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_.get(),
+        "virtio-blk");
     active_virtio_slots_.push_back(slot);
     return true;
 }
 
-bool Vm::SetupVirtioNet(bool link_up, const std::vector<HostForward>& forwards,
-                        const std::vector<GuestForward>& guest_forwards,
-                        const VirtioDeviceSlot& slot) {
+bool Vm::SetupVirtioNet(bool link_up, const VirtioDeviceSlot& slot) {
     net_backend_ = std::make_unique<NetBackend>();
     virtio_net_ = std::make_unique<VirtioNetDevice>(link_up);
     net_backend_->SetLinkUp(link_up);
@@ -575,18 +644,20 @@ bool Vm::SetupVirtioNet(bool link_up, const std::vector<HostForward>& forwards,
     });
 
     addr_space_.AddMmioDevice(
-        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_net_.get());
-
-    if (!net_backend_->Start(virtio_net_.get(),
-                              [this, irq = slot.irq]() { InjectIrq(irq); },
-                              forwards, guest_forwards)) {
-        LOG_ERROR("Failed to start network backend");
-        return false;
-    }
+        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_net_.get(),
+        "virtio-net");
     active_virtio_slots_.push_back(slot);
     return true;
 }
 
+bool Vm::StartNetBackend(const std::vector<HostForward>& forwards,
+                         const std::vector<GuestForward>& guest_forwards,
+                         uint8_t irq) {
+    return net_backend_->Start(virtio_net_.get(),
+                               [this, irq]() { InjectIrq(irq); },
+                               forwards, guest_forwards);
+}
+
 bool Vm::SetupVirtioInput(const VirtioDeviceSlot& kbd_slot,
                           const VirtioDeviceSlot& tablet_slot) {
     virtio_kbd_ = std::make_unique<VirtioInputDevice>(VirtioInputDevice::SubType::kKeyboard);
@@ -598,7 +669,8 @@ bool Vm::SetupVirtioInput(const VirtioDeviceSlot& kbd_slot,
     TryEnableIoEventFd(virtio_mmio_kbd_.get(), kbd_slot.mmio_base, virtio_mmio_kbd_->NumQueues());
     virtio_kbd_->SetMmioDevice(virtio_mmio_kbd_.get());
     addr_space_.AddMmioDevice(
-        kbd_slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_kbd_.get());
+        kbd_slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_kbd_.get(),
+        "virtio-kbd");
     active_virtio_slots_.push_back(kbd_slot);
 
     virtio_tablet_ = std::make_unique<VirtioInputDevice>(VirtioInputDevice::SubType::kTablet);
@@ -610,7 +682,8 @@ bool Vm::SetupVirtioInput(const VirtioDeviceSlot& kbd_slot,
     TryEnableIoEventFd(virtio_mmio_tablet_.get(), tablet_slot.mmio_base, virtio_mmio_tablet_->NumQueues());
     virtio_tablet_->SetMmioDevice(virtio_mmio_tablet_.get());
     addr_space_.AddMmioDevice(
-        tablet_slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_tablet_.get());
+        tablet_slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_tablet_.get(),
+        "virtio-tablet");
     active_virtio_slots_.push_back(tablet_slot);
 
     return true;
@@ -630,6 +703,9 @@ bool Vm::SetupVirtioGpu(uint32_t width, uint32_t height, const VirtioDeviceSlot&
         virtio_gpu_->SetScanoutStateCallback([this](bool active, uint32_t w, uint32_t h) {
             display_port_->SubmitScanoutState(active, w, h);
         });
+        virtio_gpu_->SetScanoutSurfaceCallback([this](uint32_t w, uint32_t h) {
+            return display_port_->AcquireScanoutSurface(w, h);
+        });
     }
 
     virtio_mmio_gpu_ = std::make_unique<VirtioMmioDevice>();
@@ -643,7 +719,8 @@ bool Vm::SetupVirtioGpu(uint32_t width, uint32_t height, const VirtioDeviceSlot&
     // audited for concurrent OnQueueNotify.
     virtio_gpu_->SetMmioDevice(virtio_mmio_gpu_.get());
     addr_space_.AddMmioDevice(
-        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_gpu_.get());
+        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_gpu_.get(),
+        "virtio-gpu");
     active_virtio_slots_.push_back(slot);
 
     return true;
@@ -689,7 +766,8 @@ bool Vm::SetupVirtioSerial(const VirtioDeviceSlot& slot) {
     TryEnableIoEventFd(virtio_mmio_serial_.get(), slot.mmio_base, virtio_mmio_serial_->NumQueues());
     virtio_serial_->SetMmioDevice(virtio_mmio_serial_.get());
     addr_space_.AddMmioDevice(
-        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_serial_.get());
+        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_serial_.get(),
+        "virtio-serial");
     active_virtio_slots_.push_back(slot);
 
     LOG_INFO("VirtIO Serial device initialized (vdagent + guest-agent)");
@@ -697,7 +775,7 @@ bool Vm::SetupVirtioSerial(const VirtioDeviceSlot& slot) {
 }
 
 bool Vm::SetupVirtioFs(const std::vector<VmSharedFolder>& initial_folders,
-                       const VirtioDeviceSlot& slot) {
+                       const VirtioDeviceSlot& slot, uint64_t dax_window_mb) {
     virtio_fs_ = std::make_unique<VirtioFsDevice>("shared");
 
     virtio_mmio_fs_ = std::make_unique<VirtioMmioDevice>();
@@ -707,12 +785,17 @@ bool Vm::SetupVirtioFs(const std::vector<VmSharedFolder>& initial_folders,
     TryEnableIrqFd(virtio_mmio_fs_.get(), slot.irq);
     TryEnableIoEventFd(virtio_mmio_fs_.get(), slot.mmio_base, virtio_mmio_fs_->NumQueues());
     virtio_fs_->SetMmioDevice(virtio_mmio_fs_.get());
+    if (dax_window_mb) {
+        SetupFsDaxWindow(dax_window_mb << 20);
+    }
 
-    addr_space_.AddMmioDevice(slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_fs_.get());
+    addr_space_.AddMmioDevice(slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_fs_.get(),
+                             "virtio-fs");
     active_virtio_slots_.push_back(slot);
 
     for (const auto& folder : initial_folders) {
-        if (!virtio_fs_->AddShare(folder.tag, folder.host_path, folder.readonly)) {
+        if (!virtio_fs_->AddShare(folder.tag, folder.host_path, folder.readonly, folder.cache,
+                                  folder.writeback, folder.limits)) {
             LOG_WARN("Failed to add initial share: %s -> %s", folder.tag.c_str(), folder.host_path.c_str());
         }
     }
@@ -721,6 +804,48 @@ bool Vm::SetupVirtioFs(const std::vector<VmSharedFolder>& initial_folders,
     return true;
 }
 
+// Reserve the virtio-fs DAX window and place it in guest-physical space just
+// above RAM. The whole window is one hypervisor memory slot backed by a
+// PROT_NONE reservation; VirtioFsDevice mmaps file ranges over it on
+// FUSE_SETUPMAPPING and KVM follows the host mapping through its MMU
+// notifier, so no per-mapping slot updates are needed. Failure only costs the
+// guest DAX support.
+void Vm::SetupFsDaxWindow(uint64_t size) {
+#if defined(__linux__)
+    constexpr uint64_t kWindowAlign = 1ULL << 30;
+    size = AlignUp(size, 2ULL << 20);  // the guest maps in 2 MiB chunks
+
+    GPA ram_end = mem_.high_size ? mem_.high_base + mem_.high_size
+                                 : mem_.ram_base + mem_.low_size;
+    GPA gpa = AlignUp(std::max<GPA>(ram_end, 1ULL << 32), kWindowAlign);
+
+    void* window = ::mmap(nullptr, size, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (window == MAP_FAILED) {
+        LOG_WARN("virtio-fs: cannot reserve %" PRIu64 " MB DAX window: %s",
+                 size >> 20, strerror(errno));
+        return;
+    }
+    if (!hv_vm_->MapMemory(gpa, window, size, true)) {
+        LOG_WARN("virtio-fs: DAX window not mapped into the guest; DAX disabled");
+        ::munmap(window, size);
+        return;
+    }
+
+    fs_dax_window_ = static_cast<uint8_t*>(window);
+    fs_dax_window_size_ = size;
+    virtio_mmio_fs_->SetShmRegion(VIRTIO_FS_SHMCAP_ID_CACHE, gpa, size);
+    virtio_fs_->EnableDax(fs_dax_window_, size);
+    LOG_INFO("virtio-fs: DAX window [0x%" PRIX64 "-0x%" PRIX64 "]",
+             gpa, gpa + size - 1);
+#else
+    // HVF / WHVP would need every SETUPMAPPING registered with the
+    // hypervisor as its own mapping. Not wired up yet.
+    (void)size;
+    LOG_WARN("virtio-fs: DAX window is only supported with KVM; ignoring");
+#endif
+}
+
 bool Vm::SetupVirtioSnd(const VirtioDeviceSlot& slot) {
     virtio_snd_ = std::make_unique<VirtioSndDevice>();
     virtio_snd_->SetMemMap(mem_);
@@ -738,7 +863,8 @@ bool Vm::SetupVirtioSnd(const VirtioDeviceSlot& slot) {
     TryEnableIoEventFd(virtio_mmio_snd_.get(), slot.mmio_base, virtio_mmio_snd_->NumQueues());
     virtio_snd_->SetMmioDevice(virtio_mmio_snd_.get());
     addr_space_.AddMmioDevice(
-        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_snd_.get());
+        slot.mmio_base, VirtioMmioDevice::kMmioSize, virtio_mmio_snd_.get(),
+        "virtio-snd");
     active_virtio_slots_.push_back(slot);
 
     LOG_INFO("VirtIO Sound device initialized (playback)");
@@ -746,6 +872,10 @@ bool Vm::SetupVirtioSnd(const VirtioDeviceSlot& slot) {
 }
 
 void Vm::VCpuThreadFunc(uint32_t vcpu_index) {
+    char thread_name[16];
+    snprintf(thread_name, sizeof(thread_name), "vm-vcpu%u", vcpu_index);
+    InitVmThread(thread_name, VmThreadRole::kVCpu, vcpu_index);
+
     // Phase 1: create vCPU on this thread (required by HVF; harmless on WHVP).
     auto created = hv_vm_->CreateVCpu(vcpu_index, &addr_space_);
     if (!created) {
@@ -757,6 +887,7 @@ void Vm::VCpuThreadFunc(uint32_t vcpu_index) {
 
     // Perform any thread-local initialisation (e.g. LocalApic::SetCurrentCpu).
     vcpus_[vcpu_index]->OnThreadInit();
+    VCpuStats::SetCurrent(vcpu_stats_[vcpu_index].get());
 
     // Install platform-specific callbacks (PSCI on ARM64; no-op elsewhere).
     SetupVCpuCallbacks(vcpu_index);
@@ -793,19 +924,45 @@ void Vm::VCpuThreadFunc(uint32_t vcpu_index) {
     }
 
     auto& vcpu = vcpus_[vcpu_index];
+    VCpuStats& stats = *vcpu_stats_[vcpu_index];
+    HaltPoller halt_poller(boot_config_.halt_poll);
+    const bool halt_poll = vcpu->SupportsHaltPoll() && boot_config_.halt_poll.max_ns;
     uint64_t exit_count = 0;
 
     while (running_) {
+        uint64_t run_start = StatsNowNs();
         auto action = vcpu->RunOnce();
+        uint64_t run_ns = StatsNowNs() - run_start;
         exit_count++;
 
         switch (action) {
         case VCpuExitAction::kContinue:
+            stats.CompleteExit(run_ns);
             break;
 
-        case VCpuExitAction::kHalt:
-            vcpu->WaitForInterrupt(100);
+        case VCpuExitAction::kHalt: {
+            uint64_t halt_start = StatsNowNs();
+            if (halt_poll) {
+                // Spin briefly before blocking so an interrupt raised by an
+                // I/O completion right after HLT is picked up without a
+                // condition-variable wake and reschedule.
+                const bool attempted = halt_poller.window_ns() > 0;
+                const bool polled = halt_poller.Poll(*vcpu);
+                const uint64_t poll_ns = StatsNowNs() - halt_start;
+                const bool woken = polled || vcpu->WaitForInterrupt(100);
+                const uint64_t halt_ns = StatsNowNs() - halt_start;
+                halt_poller.Update(halt_ns, woken);
+                if (attempted) {
+                    stats.RecordHaltPoll(polled, poll_ns, halt_poller.window_ns());
+                }
+                stats.RecordHalt(halt_ns);
+            } else {
+                vcpu->WaitForInterrupt(100);
+                stats.RecordHalt(StatsNowNs() - halt_start);
+            }
+            stats.CompleteExit(run_ns);
             break;
+        }
 
         case VCpuExitAction::kShutdown:
             LOG_INFO("vCPU %u: shutdown (after %" PRIu64 " exits)",
@@ -826,12 +983,47 @@ void Vm::VCpuThreadFunc(uint32_t vcpu_index) {
              vcpu_index, exit_count);
 }
 
+std::string Vm::GetStatsJson() const {
+    auto mmio_names = addr_space_.MmioDeviceNames();
+    auto pio_names = addr_space_.PioDeviceNames();
+    std::string out = "{\"vcpus\":[";
+    for (size_t i = 0; i < vcpu_stats_.size(); i++) {
+        if (i) out.push_back(',');
+        vcpu_stats_[i]->AppendJson(&out, mmio_names, pio_names);
+    }
+    out += "],\"shares\":[";
+    if (virtio_fs_) {
+        bool first = true;
+        for (const auto& s : virtio_fs_->GetShareStats()) {
+            if (!first) out.push_back(',');
+            first = false;
+            out += "{\"tag\":\"";
+            for (char c : s.tag) {
+                if (c == '"' || c == '\\') out.push_back('\\');
+                if (static_cast<unsigned char>(c) >= 0x20) out.push_back(c);
+            }
+            char buf[384];
+            snprintf(buf, sizeof(buf),
+                     "\",\"ops\":%" PRIu64 ",\"read_ops\":%" PRIu64 ",\"read_bytes\":%" PRIu64
+                     ",\"write_ops\":%" PRIu64 ",\"write_bytes\":%" PRIu64
+                     ",\"throttled\":%" PRIu64 ",\"throttled_ns\":%" PRIu64
+                     ",\"iops_limit\":%" PRIu64 ",\"bps_limit\":%" PRIu64 "}",
+                     s.ops, s.read_ops, s.read_bytes, s.write_ops, s.write_bytes, s.throttled,
+                     s.throttled_ns, s.limits.iops, s.limits.bytes_per_sec);
+            out += buf;
+        }
+    }
+    out += "]}";
+    return out;
+}
+
 int Vm::Run() {
     running_ = true;
     LOG_INFO("Starting VM execution...");
 
     if (owned_console_input_ && console_port_) {
         console_input_thread_ = std::thread([this]() {
+            InitVmThread("vm-console-in", VmThreadRole::kIo);
             uint8_t buf[64];
             while (running_.load()) {
                 size_t n = console_port_->Read(buf, sizeof(buf));
@@ -842,22 +1034,28 @@ int Vm::Run() {
         });
     }
 
+    BootPipeline& boot = *boot_pipeline_;
+
     // Phase 1: launch threads; each creates its vCPU then signals ready.
-    for (uint32_t i = 0; i < cpu_count_; i++) {
-        vcpu_threads_.emplace_back(&Vm::VCpuThreadFunc, this, i);
-    }
+    boot.Run("vcpu-create", [this]() {
+        for (uint32_t i = 0; i < cpu_count_; i++) {
+            vcpu_threads_.emplace_back(&Vm::VCpuThreadFunc, this, i);
+        }
 
-    // Wait until all vCPUs are created (or a failure triggers RequestStop).
-    {
+        // Wait until all vCPUs are created (or a failure triggers RequestStop).
         std::unique_lock<std::mutex> lock(boot_mutex_);
         boot_cv_.wait(lock, [this] {
             return vcpus_ready_.load() >= cpu_count_ || !running_;
         });
-    }
+        return running_.load();
+    });
 
+    std::optional<BootPipeline::StageId> kernel_load;
     if (running_) {
-        // Load the kernel, set APIC IDs in ACPI MADT, and configure BSP registers.
-        FinalizeBoot(boot_config_);
+        // Load the kernel and build ACPI/FDT (needs the APIC IDs of the
+        // vCPUs just created) while this thread brings up the I/O loop.
+        kernel_load = boot.Launch("kernel-load",
+            [this]() { return FinalizeBoot(boot_config_); });
     }
 
     if (running_) {
@@ -874,10 +1072,16 @@ int Vm::Run() {
         // Bring up the central device I/O loop, then register each virtio
         // slot's irqfd + ioeventfd with it. Slots that fail to register stay
         // on the classic KVM_IRQ_LINE / MmioWrite fallback.
-        io_loop_.Start();
-        InstallIrqFds();
-        InstallIoEventFds();
+        boot.Run("io-loop", [this]() {
+            io_loop_.Start();
+            InstallIrqFds();
+            InstallIoEventFds();
+            return true;
+        });
     }
+    if (kernel_load) boot.Wait(*kernel_load);
+
+    if (running_) boot.LogSummary("vCPUs released");
 
     // Phase 2: release all threads into their run loops.
     {
@@ -1013,12 +1217,21 @@ void Vm::SendClipboardRelease() {
     }
 }
 
-bool Vm::AddSharedFolder(const std::string& tag, const std::string& host_path, bool readonly) {
+bool Vm::AddSharedFolder(const std::string& tag, const std::string& host_path, bool readonly,
+                         FsCachePolicy cache, bool writeback, const FsShareLimits& limits) {
+    if (!virtio_fs_) {
+        LOG_ERROR("VirtIO FS device not initialized");
+        return false;
+    }
+    return virtio_fs_->AddShare(tag, host_path, readonly, cache, writeback, limits);
+}
+
+bool Vm::SetSharedFolderLimits(const std::string& tag, const FsShareLimits& limits) {
     if (!virtio_fs_) {
         LOG_ERROR("VirtIO FS device not initialized");
         return false;
     }
-    return virtio_fs_->AddShare(tag, host_path, readonly);
+    return virtio_fs_->SetShareLimits(tag, limits);
 }
 
 bool Vm::RemoveSharedFolder(const std::string& tag) {
@@ -1048,6 +1261,9 @@ std::vector<VmSharedFolder> Vm::GetSharedFolders() const {
         f.tag = s.tag;
         f.host_path = s.host_path;
         f.readonly = s.readonly;
+        f.cache = s.cache;
+        f.writeback = s.writeback;
+        f.limits = s.limits;
         result.push_back(std::move(f));
     }
     return result;
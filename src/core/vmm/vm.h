@@ -5,7 +5,10 @@
 #include "core/vmm/hypervisor_vm.h"
 #include "core/vmm/machine_model.h"
 #include "core/vmm/vcpu_startup_state.h"
+#include "core/vmm/vcpu_stats.h"
+#include "core/vmm/halt_poll.h"
 #include "core/vmm/vm_io_loop.h"
+#include "core/vmm/boot_pipeline.h"
 #include "core/device/virtio/virtio_mmio.h"
 #include "core/device/virtio/virtio_blk.h"
 #include "core/device/virtio/virtio_net.h"
@@ -30,6 +33,9 @@ struct VmSharedFolder {
     std::string tag;
     std::string host_path;
     bool readonly = false;
+    FsCachePolicy cache = FsCachePolicy::kAuto;
+    bool writeback = false;
+    FsShareLimits limits;
 };
 
 struct VmConfig {
@@ -52,6 +58,9 @@ struct VmConfig {
     std::shared_ptr<AudioPort> audio_port;
     uint32_t display_width = 1024;
     uint32_t display_height = 768;
+    HaltPollConfig halt_poll;
+    // virtio-fs DAX cache window in MB (0 = off). Linux/KVM hosts only.
+    uint64_t fs_dax_window_mb = 0;
 };
 
 class Vm {
@@ -82,7 +91,10 @@ public:
     void SendClipboardRequest(uint32_t type);
     void SendClipboardRelease();
 
-    bool AddSharedFolder(const std::string& tag, const std::string& host_path, bool readonly = false);
+    bool AddSharedFolder(const std::string& tag, const std::string& host_path, bool readonly = false,
+                         FsCachePolicy cache = FsCachePolicy::kAuto, bool writeback = false,
+                         const FsShareLimits& limits = {});
+    bool SetSharedFolderLimits(const std::string& tag, const FsShareLimits& limits);
     bool RemoveSharedFolder(const std::string& tag);
     std::vector<std::string> GetSharedFolderTags() const;
     std::vector<VmSharedFolder> GetSharedFolders() const;
@@ -92,22 +104,36 @@ public:
     void GuestAgentShutdown(const std::string& mode = "powerdown");
     void GuestAgentSyncTime();
 
+    // Per-vCPU exit counters and latency histograms, plus per-share
+    // virtio-fs I/O counters, as a JSON document ({"vcpus":[...],
+    // "shares":[...]}). Safe to call from any thread while the VM runs.
+    std::string GetStatsJson() const;
+
 private:
     Vm() = default;
 
     bool AllocateMemory(uint64_t size);
-    bool SetupVirtioBlk(const std::string& disk_path, const VirtioDeviceSlot& slot);
-    bool SetupVirtioNet(bool link_up, const std::vector<HostForward>& forwards,
-                        const std::vector<GuestForward>& guest_forwards, const VirtioDeviceSlot& slot);
+    // Wires up virtio_blk_, which the "disk-open" boot stage has already
+    // opened off the main thread.
+    bool SetupVirtioBlk(const VirtioDeviceSlot& slot);
+    // Registers virtio-net; the backend itself is started by the
+    // "net-start" boot stage (StartNetBackend) in parallel with the
+    // remaining device setup.
+    bool SetupVirtioNet(bool link_up, const VirtioDeviceSlot& slot);
+    bool StartNetBackend(const std::vector<HostForward>& forwards,
+                         const std::vector<GuestForward>& guest_forwards,
+                         uint8_t irq);
     bool SetupVirtioInput(const VirtioDeviceSlot& kbd_slot, const VirtioDeviceSlot& tablet_slot);
     bool SetupVirtioGpu(uint32_t width, uint32_t height, const VirtioDeviceSlot& slot);
     bool SetupVirtioSerial(const VirtioDeviceSlot& slot);
-    bool SetupVirtioFs(const std::vector<VmSharedFolder>& initial_folders, const VirtioDeviceSlot& slot);
+    bool SetupVirtioFs(const std::vector<VmSharedFolder>& initial_folders, const VirtioDeviceSlot& slot,
+                       uint64_t dax_window_mb);
+    void SetupFsDaxWindow(uint64_t size);
     bool SetupVirtioSnd(const VirtioDeviceSlot& slot);
 
     void VCpuThreadFunc(uint32_t vcpu_index);
     void SetupVCpuCallbacks(uint32_t vcpu_index);
-    void FinalizeBoot(const VmConfig& config);
+    bool FinalizeBoot(const VmConfig& config);
     void InjectIrq(uint8_t irq);
     void SetIrqLevel(uint8_t irq, bool asserted);
 
@@ -163,6 +189,8 @@ private:
 
     std::unique_ptr<VirtioFsDevice> virtio_fs_;
     std::unique_ptr<VirtioMmioDevice> virtio_mmio_fs_;
+    uint8_t* fs_dax_window_ = nullptr;  // PROT_NONE reservation, see SetupFsDaxWindow
+    uint64_t fs_dax_window_size_ = 0;
 
     std::unique_ptr<VirtioSndDevice> virtio_snd_;
     std::unique_ptr<VirtioMmioDevice> virtio_mmio_snd_;
@@ -200,6 +228,10 @@ private:
 
     // Saved config for FinalizeBoot (cmdline, kernel path, etc.)
     VmConfig boot_config_;
+    // Bring-up stages from Create() through vCPU release in Run(). Reset in
+    // ~Vm before anything else so no stage thread outlives the devices it
+    // touches.
+    std::unique_ptr<BootPipeline> boot_pipeline_;
     std::shared_ptr<ConsolePort> console_port_;
     std::shared_ptr<InputPort> input_port_;
     std::shared_ptr<DisplayPort> display_port_;
@@ -208,6 +240,7 @@ private:
     uint32_t inject_prev_buttons_ = 0;
 
     std::vector<std::unique_ptr<VCpuStartupState>> vcpu_startup_;
+    std::vector<std::unique_ptr<VCpuStats>> vcpu_stats_;
 
     // Input pump thread for locally-created ConsolePort (CLI interactive mode).
     // Inactive when running under an external IPC controller that injects
@@ -2,6 +2,7 @@
 
 #include "core/device/virtio/virtio_mmio.h"
 #include "core/vmm/types.h"
+#include "core/util/thread_policy.h"
 
 #if defined(__linux__)
 #include <unistd.h>
@@ -74,6 +75,7 @@ void VmIoLoop::Stop() {
 }
 
 void VmIoLoop::ThreadMain() {
+    InitVmThread("vm-io", VmThreadRole::kIo);
     uv_run(&loop_, UV_RUN_DEFAULT);
     while (uv_run(&loop_, UV_RUN_NOWAIT) != 0) {}
     (void)uv_loop_close(&loop_);
@@ -0,0 +1,269 @@
+#include "daemon/boot_image_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+#include <zstd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace tenbox::daemon {
+namespace fs = std::filesystem;
+
+namespace {
+
+// Refuse to inflate past this; a boot image this large is either broken or
+// hostile, and the runtime would not fit it in guest RAM anyway.
+constexpr uint64_t kMaxInflatedBytes = 4ull << 30;
+// Total size kept under cache/boot before least-recently-used entries go.
+constexpr uint64_t kMaxCacheBytes = 4ull << 30;
+constexpr size_t kChunk = 1 << 20;
+
+enum class Compression { kNone, kGzip, kZstd };
+
+Compression Detect(const uint8_t* p, size_t n) {
+    if (n >= 2 && p[0] == 0x1f && p[1] == 0x8b) return Compression::kGzip;
+    if (n >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd) {
+        return Compression::kZstd;
+    }
+    return Compression::kNone;
+}
+
+uint64_t Fnv1a(const std::string& s) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// Read-only whole-file mapping; the daemon is Linux-only.
+struct Mapping {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    ~Mapping() {
+        if (data) ::munmap(const_cast<uint8_t*>(data), size);
+    }
+    bool Open(const std::string& path, struct stat* st) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        if (::fstat(fd, st) != 0 || !S_ISREG(st->st_mode) || st->st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = ::mmap(nullptr, static_cast<size_t>(st->st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        data = static_cast<const uint8_t*>(p);
+        size = static_cast<size_t>(st->st_size);
+        ::madvise(p, size, MADV_SEQUENTIAL);
+        return true;
+    }
+};
+
+bool InflateGzip(const uint8_t* data, size_t size, std::ofstream& out, std::string* error) {
+    z_stream zs{};
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        *error = "inflateInit2 failed";
+        return false;
+    }
+    std::vector<uint8_t> buf(kChunk);
+    size_t consumed = 0;
+    uint64_t produced = 0;
+    int rc = Z_OK;
+    while (consumed < size) {
+        const size_t in_len = std::min<size_t>(size - consumed, UINT32_MAX);
+        zs.next_in = const_cast<Bytef*>(data + consumed);
+        zs.avail_in = static_cast<uInt>(in_len);
+        do {
+            zs.next_out = buf.data();
+            zs.avail_out = static_cast<uInt>(buf.size());
+            rc = inflate(&zs, Z_NO_FLUSH);
+            if (rc == Z_BUF_ERROR) break;  // needs more input
+            if (rc != Z_OK && rc != Z_STREAM_END) {
+                inflateEnd(&zs);
+                *error = std::string("gzip: ") + (zs.msg ? zs.msg : "corrupt stream");
+                return false;
+            }
+            const size_t have = buf.size() - zs.avail_out;
+            produced += have;
+            if (produced > kMaxInflatedBytes) {
+                inflateEnd(&zs);
+                *error = "gzip: inflated size exceeds limit";
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(have));
+        } while (zs.avail_out == 0 && rc != Z_STREAM_END);
+        consumed += in_len - zs.avail_in;
+        if (rc == Z_STREAM_END) {
+            // Concatenated members are legal (and common for initramfs
+            // built with several compressed parts); trailing zero padding
+            // is tolerated.
+            while (consumed < size && data[consumed] == 0) ++consumed;
+            if (consumed < size) inflateReset(&zs);
+        } else if (zs.avail_in == 0 && consumed >= size) {
+            break;
+        }
+    }
+    inflateEnd(&zs);
+    if (rc != Z_STREAM_END) {
+        *error = "gzip: truncated stream";
+        return false;
+    }
+    return true;
+}
+
+bool InflateZstd(const uint8_t* data, size_t size, std::ofstream& out, std::string* error) {
+    ZSTD_DCtx* dctx = ZSTD_createDCtx();
+    if (!dctx) {
+        *error = "ZSTD_createDCtx failed";
+        return false;
+    }
+    std::vector<uint8_t> buf(ZSTD_DStreamOutSize());
+    ZSTD_inBuffer input = {data, size, 0};
+    uint64_t produced = 0;
+    size_t ret = 0;
+    while (input.pos < input.size) {
+        ZSTD_outBuffer output = {buf.data(), buf.size(), 0};
+        ret = ZSTD_decompressStream(dctx, &output, &input);
+        if (ZSTD_isError(ret)) {
+            *error = std::string("zstd: ") + ZSTD_getErrorName(ret);
+            ZSTD_freeDCtx(dctx);
+            return false;
+        }
+        produced += output.pos;
+        if (produced > kMaxInflatedBytes) {
+            *error = "zstd: inflated size exceeds limit";
+            ZSTD_freeDCtx(dctx);
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(output.pos));
+    }
+    ZSTD_freeDCtx(dctx);
+    if (ret != 0) {
+        *error = "zstd: truncated stream";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+BootImageCache::BootImageCache(std::string data_dir) : data_dir_(std::move(data_dir)) {}
+
+fs::path BootImageCache::CacheDir() const {
+    return fs::path(data_dir_) / "cache" / "boot";
+}
+
+std::string BootImageCache::Resolve(const std::string& source, std::string* note) {
+    if (note) note->clear();
+    if (source.empty()) return source;
+    Mapping src;
+    struct stat st{};
+    if (!src.Open(source, &st)) return source;
+    if (Detect(src.data, src.size) == Compression::kNone) return source;
+
+    std::error_code ec;
+    const fs::path canonical = fs::weakly_canonical(source, ec);
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx",
+             static_cast<unsigned long long>(Fnv1a(
+                 (ec ? source : canonical.string()) + "|" + std::to_string(st.st_size) + "|" +
+                 std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec))));
+    const fs::path cached = CacheDir() / (std::string(key) + ".img");
+
+    std::shared_ptr<std::mutex> entry_lock;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = entry_locks_[key];
+        if (!slot) slot = std::make_shared<std::mutex>();
+        entry_lock = slot;
+    }
+    std::lock_guard<std::mutex> entry_guard(*entry_lock);
+
+    if (fs::is_regular_file(cached, ec)) {
+        // Touch for LRU pruning.
+        fs::last_write_time(cached, fs::file_time_type::clock::now(), ec);
+        if (note) *note = "boot cache hit: " + source + " -> " + cached.string();
+        return cached.string();
+    }
+
+    fs::create_directories(CacheDir(), ec);
+    std::string error;
+    if (!Inflate(src.data, src.size, cached, &error)) {
+        if (note) *note = "boot cache: cannot inflate " + source + " (" + error + "), using it as-is";
+        return source;
+    }
+    if (note) {
+        *note = "boot cache: inflated " + source + " -> " + cached.string() + " (" +
+                std::to_string(fs::file_size(cached, ec)) + " bytes)";
+    }
+    Prune();
+    return cached.string();
+}
+
+bool BootImageCache::Inflate(const uint8_t* data, size_t size, const fs::path& dest,
+                             std::string* error) {
+    // Write to a private temp name and rename into place so a crash or a
+    // concurrent reader never sees a partial image.
+    const fs::path tmp = dest.string() + ".tmp." + std::to_string(::getpid());
+    bool ok = false;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            *error = "cannot create " + tmp.string();
+            return false;
+        }
+        ok = Detect(data, size) == Compression::kGzip ? InflateGzip(data, size, out, error)
+                                                      : InflateZstd(data, size, out, error);
+        out.flush();
+        if (ok && !out) {
+            *error = "write failed";
+            ok = false;
+        }
+    }
+    std::error_code ec;
+    if (ok) {
+        fs::rename(tmp, dest, ec);
+        if (ec) {
+            *error = "rename failed: " + ec.message();
+            ok = false;
+        }
+    }
+    if (!ok) fs::remove(tmp, ec);
+    return ok;
+}
+
+void BootImageCache::Prune() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type mtime;
+        uint64_t size;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (const auto& it : fs::directory_iterator(CacheDir(), ec)) {
+        if (!it.is_regular_file(ec) || it.path().extension() != ".img") continue;
+        Entry e{it.path(), it.last_write_time(ec), it.file_size(ec)};
+        total += e.size;
+        entries.push_back(std::move(e));
+    }
+    if (total <= kMaxCacheBytes) return;
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.mtime < b.mtime; });
+    // Never evict the newest entry: it is the one about to be booted.
+    // Running VMs keep their own mapping, so unlinking under them is safe.
+    for (size_t i = 0; i + 1 < entries.size() && total > kMaxCacheBytes; ++i) {
+        if (fs::remove(entries[i].path, ec)) total -= entries[i].size;
+    }
+}
+
+}  // namespace tenbox::daemon
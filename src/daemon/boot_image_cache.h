@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace tenbox::daemon {
+
+// Host-wide cache of pre-decompressed boot images under
+// `<data_dir>/cache/boot/`. A gzip- or zstd-compressed kernel (arm64
+// Image.gz) or initramfs is inflated once and every later VM start
+// hands the runtime the cached raw file, which it mmaps straight into
+// guest RAM. Concurrent starts of the same image share one inflation and
+// then share the cached file's page-cache pages.
+//
+// Entries are keyed by source path + size + mtime, so replacing an image
+// in place yields a fresh entry; stale entries age out via the size cap.
+class BootImageCache {
+public:
+    explicit BootImageCache(std::string data_dir);
+
+    // Path the runtime should load for |source|. Uncompressed images (x86
+    // bzImage, raw Image, plain cpio) and any image that fails to inflate
+    // are returned unchanged, so a start never fails because of the cache.
+    // |note|, when given, receives a one-line description of what happened
+    // (cache hit, inflation, or why inflation failed) for runtime.log.
+    std::string Resolve(const std::string& source, std::string* note = nullptr);
+
+private:
+    std::filesystem::path CacheDir() const;
+    bool Inflate(const uint8_t* data, size_t size, const std::filesystem::path& dest,
+                 std::string* error);
+    void Prune();
+
+    std::string data_dir_;
+    std::mutex mutex_;
+    // Per-entry lock so one image is inflated once while unrelated images
+    // inflate in parallel.
+    std::map<std::string, std::shared_ptr<std::mutex>> entry_locks_;
+};
+
+}  // namespace tenbox::daemon
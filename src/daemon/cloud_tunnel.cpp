@@ -987,7 +987,7 @@ bool ProbeH264Encoder(H264Profile profile, PixelFormat pixel_format = PixelForma
     config.h264_profile = profile;
     config.input_format = pixel_format;
 
-    FfmpegH264VideoEncoder encoder;
+    FfmpegVideoEncoder encoder;
     std::string error;
     return encoder.Open(config, &error);
 }
@@ -1002,12 +1002,18 @@ const nlohmann::json& EncoderCapabilitiesCached() {
             {"h264_main", false},
             {"h264_baseline", false},
             {"h264_yuv444", false},
+            {"vp8", false},
+            {"vp9", false},
+            {"av1", false},
             {"opus", false},
         };
         out["h264_high"] = ProbeH264Encoder(H264Profile::kHigh);
         out["h264_main"] = ProbeH264Encoder(H264Profile::kMain);
         out["h264_baseline"] = ProbeH264Encoder(H264Profile::kConstrainedBaseline);
         out["h264_yuv444"] = ProbeH264Encoder(H264Profile::kHigh, PixelFormat::kYuv444p);
+        out["vp8"] = FfmpegVideoEncoder::IsAvailable(VideoCodec::kVp8);
+        out["vp9"] = FfmpegVideoEncoder::IsAvailable(VideoCodec::kVp9);
+        out["av1"] = FfmpegVideoEncoder::IsAvailable(VideoCodec::kAv1);
         const AVCodec* opus = avcodec_find_encoder_by_name("libopus");
         if (!opus) opus = avcodec_find_encoder(AV_CODEC_ID_OPUS);
         if (opus) out["opus"] = true;
@@ -1634,18 +1640,26 @@ nlohmann::json CloudTunnel::CancelImageDownload(const nlohmann::json& payload) {
 std::shared_ptr<WebRtcPeer> CloudTunnel::CreateRemotePeer(
     const std::string& session_id,
     const std::string& vm_id,
-    PixelFormat preferred_video_format) {
+    PixelFormat preferred_video_format,
+    bool view_only) {
+    // Every peer on the VM shares one video pump keyed by vm_id, so a
+    // second viewer adds packets, not another encode.
     auto peer = CreateWebRtcPeer(
         [this, vm_id](RemoteVideoFrame* frame, bool need_full,
                       std::chrono::milliseconds wait_timeout) {
             if (!frame) return false;
             return runtime_manager_.ReadRemoteFrame(vm_id, frame, need_full, wait_timeout);
         },
-        preferred_video_format);
+        preferred_video_format,
+        vm_id);
     if (peer) {
-        peer->SetDataChannelHandler([this, vm_id](const nlohmann::json& message) {
-            HandleDataChannelMessage(vm_id, message);
-        });
+        // View-only peers get video, audio and the cursor but nothing they
+        // send reaches the guest.
+        if (!view_only) {
+            peer->SetDataChannelHandler([this, vm_id](const nlohmann::json& message) {
+                HandleDataChannelMessage(vm_id, message);
+            });
+        }
         // Trickle host-side ICE candidates back to the browser through the
         // existing `remote_signal.candidate` cloud relay envelope. The
         // browser-side hostBus router (`remote_signal.candidate` listener
@@ -1669,12 +1683,12 @@ std::shared_ptr<WebRtcPeer> CloudTunnel::CreateRemotePeer(
         // inside its callback deadlocks. A detached worker keeps the
         // peer alive until the callback returns, then performs the
         // removal on a fresh stack.
-        peer->SetPeerClosedHandler([this, session_id, vm_id](std::string reason) {
+        peer->SetPeerClosedHandler([this, session_id, vm_id, view_only](std::string reason) {
             std::fprintf(stdout,
                          "[INFO]  cloud_tunnel: tearing down remote session %s on vm %s (reason=%s)\n",
                          session_id.c_str(), vm_id.c_str(), reason.c_str());
             std::fflush(stdout);
-            std::thread([this, session_id, vm_id, reason]() {
+            std::thread([this, session_id, vm_id, view_only, reason]() {
                 pthread_setname_np(pthread_self(), "webrtc-close");
                 if (fd_ >= 0) {
                     (void)SendJson({
@@ -1696,7 +1710,7 @@ std::shared_ptr<WebRtcPeer> CloudTunnel::CreateRemotePeer(
                     std::lock_guard<std::mutex> lock(remote_peers_mu_);
                     remote_peers_.erase(session_id);
                 }
-                runtime_manager_.ClearClipboardCallback(vm_id);
+                if (!view_only) runtime_manager_.ClearClipboardCallback(vm_id);
                 (void)remote_sessions_.Close(vm_id, session_id);
             }).detach();
         });
@@ -1739,6 +1753,7 @@ std::shared_ptr<WebRtcPeer> CloudTunnel::CreateRemotePeer(
                 {"cursor", std::move(cursor)},
             }.dump());
         });
+        if (view_only) return peer;
         // Bridge guest-originated clipboard events into the browser by
         // looking up the peer that owns this session_id and writing a JSON
         // text frame onto its `control` data channel. We intentionally
@@ -1871,7 +1886,10 @@ nlohmann::json CloudTunnel::CreateRemoteSession(const std::string& vm_id, const
     }
     const std::string owner = payload.value("owner_user_id", "cloud");
     const bool force = payload.value("force", false);
-    if (force) {
+    // A view-only session (e.g. a supervisor watching an agent) sits
+    // alongside whoever controls the VM instead of taking it over.
+    const bool view_only = payload.value("view_only", false);
+    if (force && !view_only) {
         if (auto existing = remote_sessions_.GetByVm(vm_id)) {
             const std::string old_session_id = existing->session_id;
             {
@@ -1902,17 +1920,22 @@ nlohmann::json CloudTunnel::CreateRemoteSession(const std::string& vm_id, const
             }
         }
     }
-    auto session = remote_sessions_.Create(vm_id, owner, force);
+    auto session = remote_sessions_.Create(vm_id, owner, force, view_only);
     if (!session) return Error("remote_session_conflict", "VM already has an active remote session");
-    const uint32_t display_width = AlignDisplaySize(payload.value("width", static_cast<uint32_t>(1280)));
-    const uint32_t display_height = AlignDisplaySize(payload.value("height", static_cast<uint32_t>(720)));
     const uint32_t video_bitrate_bps = ClampVideoBitrate(payload.value("video_bitrate_bps", static_cast<uint32_t>(4'000'000)));
-    const PixelFormat video_pixel_format = ParseRemoteVideoPixelFormat(payload);
-    (void)runtime_manager_.SetDisplaySize(vm_id, display_width, display_height);
-    (void)runtime_manager_.SetRemoteVideoPixelFormat(vm_id, video_pixel_format);
+    // Display size and pixel format belong to the controlling session; a
+    // viewer watches whatever that session set up.
+    PixelFormat video_pixel_format = runtime_manager_.RemoteVideoPixelFormat(vm_id);
+    if (!view_only) {
+        const uint32_t display_width = AlignDisplaySize(payload.value("width", static_cast<uint32_t>(1280)));
+        const uint32_t display_height = AlignDisplaySize(payload.value("height", static_cast<uint32_t>(720)));
+        video_pixel_format = ParseRemoteVideoPixelFormat(payload);
+        (void)runtime_manager_.SetDisplaySize(vm_id, display_width, display_height);
+        (void)runtime_manager_.SetRemoteVideoPixelFormat(vm_id, video_pixel_format);
+    }
     {
         std::lock_guard<std::mutex> lock(remote_peers_mu_);
-        auto peer = CreateRemotePeer(session->session_id, vm_id, video_pixel_format);
+        auto peer = CreateRemotePeer(session->session_id, vm_id, video_pixel_format, view_only);
         peer->SetVideoBitrate(video_bitrate_bps);
         remote_peers_[session->session_id] = std::move(peer);
     }
@@ -1953,9 +1976,10 @@ nlohmann::json CloudTunnel::CreateRemoteSession(const std::string& vm_id, const
 
 nlohmann::json CloudTunnel::ResizeRemoteSession(const std::string& vm_id, const nlohmann::json& payload) {
     const std::string session_id = payload.value("session_id", "");
-    auto session = remote_sessions_.GetByVm(vm_id);
-    if (!session || session->session_id != session_id) {
-        return Error("remote_session_not_found", "remote session not found");
+    auto session = remote_sessions_.Get(vm_id, session_id);
+    if (!session) return Error("remote_session_not_found", "remote session not found");
+    if (session->view_only) {
+        return Error("remote_session_view_only", "view-only sessions cannot resize the display");
     }
     const uint32_t width = AlignDisplaySize(payload.value("width", static_cast<uint32_t>(1280)));
     const uint32_t height = AlignDisplaySize(payload.value("height", static_cast<uint32_t>(720)));
@@ -1967,7 +1991,8 @@ nlohmann::json CloudTunnel::ResizeRemoteSession(const std::string& vm_id, const
 
 nlohmann::json CloudTunnel::CloseRemoteSession(const std::string& vm_id, const nlohmann::json& payload) {
     const std::string session_id = payload.value("session_id", "");
-    if (!remote_sessions_.Close(vm_id, session_id)) {
+    auto session = remote_sessions_.Get(vm_id, session_id);
+    if (!session || !remote_sessions_.Close(vm_id, session_id)) {
         return Error("remote_session_not_found", "remote session not found");
     }
     {
@@ -1975,8 +2000,8 @@ nlohmann::json CloudTunnel::CloseRemoteSession(const std::string& vm_id, const n
         remote_peers_.erase(session_id);
     }
     // Drop the per-VM clipboard subscriber so a future session can re-attach
-    // without inheriting a stale capture.
-    runtime_manager_.ClearClipboardCallback(vm_id);
+    // without inheriting a stale capture. Viewers never had it.
+    if (!session->view_only) runtime_manager_.ClearClipboardCallback(vm_id);
     return {{"session_id", session_id}, {"closed", true}};
 }
 
@@ -1985,17 +2010,18 @@ nlohmann::json CloudTunnel::HandleRemoteSignal(
     const std::string& type,
     const nlohmann::json& payload) {
     const std::string session_id = payload.value("session_id", "");
-    auto session = remote_sessions_.GetByVm(vm_id);
-    if (!session || session->session_id != session_id) {
-        return Error("remote_session_not_found", "remote session not found");
-    }
+    auto session = remote_sessions_.Get(vm_id, session_id);
+    if (!session) return Error("remote_session_not_found", "remote session not found");
     if (type == "remote_signal.offer") {
         std::shared_ptr<WebRtcPeer> peer;
         {
             std::lock_guard<std::mutex> lock(remote_peers_mu_);
             auto it = remote_peers_.find(session_id);
             if (it == remote_peers_.end()) {
-                it = remote_peers_.emplace(session_id, CreateRemotePeer(session_id, vm_id)).first;
+                it = remote_peers_.emplace(session_id, CreateRemotePeer(
+                    session_id, vm_id,
+                    runtime_manager_.RemoteVideoPixelFormat(vm_id),
+                    session->view_only)).first;
             }
             peer = it->second;
         }
@@ -2026,7 +2052,7 @@ nlohmann::json CloudTunnel::HandleRemoteSignal(
         const uint32_t video_bitrate_bps = ClampVideoBitrate(
             payload.value("video_bitrate_bps", static_cast<uint32_t>(4'000'000)));
         std::string video_pixel_format_name;
-        if (payload.contains("video_pixel_format")) {
+        if (payload.contains("video_pixel_format") && !session->view_only) {
             const PixelFormat video_pixel_format = ParseRemoteVideoPixelFormat(payload);
             (void)runtime_manager_.SetRemoteVideoPixelFormat(vm_id, video_pixel_format);
             video_pixel_format_name = RemoteVideoPixelFormatName(video_pixel_format);
@@ -2063,8 +2089,8 @@ nlohmann::json CloudTunnel::HandleRemoteSignal(
 }
 
 void CloudTunnel::PublishRemoteCursor(const std::string& vm_id, nlohmann::json cursor) {
-    auto session = remote_sessions_.GetByVm(vm_id);
-    if (!session) return;
+    const auto sessions = remote_sessions_.ListByVm(vm_id);
+    if (sessions.empty()) return;
 
     // Cursor frames piggyback on the per-session WebRTC `control` DataChannel
     // rather than the cloud websocket: it's a direct host<->browser path so
@@ -2072,18 +2098,20 @@ void CloudTunnel::PublishRemoteCursor(const std::string& vm_id, nlohmann::json c
     // with how clipboard.* events are delivered. Source-side dedup
     // (virtio_gpu) already guarantees we only get here when the cursor
     // actually changed, so we don't repeat the comparison here.
-    std::shared_ptr<WebRtcPeer> peer;
+    std::vector<std::shared_ptr<WebRtcPeer>> peers;
     {
         std::lock_guard<std::mutex> lock(remote_peers_mu_);
-        auto it = remote_peers_.find(session->session_id);
-        if (it != remote_peers_.end()) peer = it->second;
+        for (const auto& session : sessions) {
+            auto it = remote_peers_.find(session.session_id);
+            if (it != remote_peers_.end()) peers.push_back(it->second);
+        }
     }
-    if (!peer) return;
-    nlohmann::json out = {
+    if (peers.empty()) return;
+    const std::string out = nlohmann::json{
         {"type", "cursor"},
         {"cursor", std::move(cursor)},
-    };
-    (void)peer->SendOnDataChannel("control", out.dump());
+    }.dump();
+    for (const auto& peer : peers) (void)peer->SendOnDataChannel("control", out);
 }
 
 void CloudTunnel::TickMain() {
@@ -2328,15 +2356,21 @@ void CloudTunnel::PushDownloadTerminal(const DownloadJob& job) {
 }
 
 void CloudTunnel::PublishRemoteAudio(const std::string& vm_id, RemoteAudioChunk chunk) {
-    auto session = remote_sessions_.GetByVm(vm_id);
-    if (!session) return;
-    std::shared_ptr<WebRtcPeer> peer;
+    const auto sessions = remote_sessions_.ListByVm(vm_id);
+    if (sessions.empty()) return;
+    std::vector<std::shared_ptr<WebRtcPeer>> peers;
     {
         std::lock_guard<std::mutex> lock(remote_peers_mu_);
-        auto it = remote_peers_.find(session->session_id);
-        if (it != remote_peers_.end()) peer = it->second;
+        for (const auto& session : sessions) {
+            auto it = remote_peers_.find(session.session_id);
+            if (it != remote_peers_.end()) peers.push_back(it->second);
+        }
+    }
+    // Each peer runs its own Opus encoder; at 48kHz stereo that is cheap
+    // next to video, so only the chunk is shared.
+    for (size_t i = 0; i < peers.size(); ++i) {
+        peers[i]->PushAudio(i + 1 == peers.size() ? std::move(chunk) : chunk);
     }
-    if (peer) peer->PushAudio(std::move(chunk));
 }
 
 nlohmann::json CloudTunnel::CreateVm(const nlohmann::json& payload) {
@@ -2469,6 +2503,13 @@ nlohmann::json CloudTunnel::EditVm(const std::string& vm_id, const nlohmann::jso
             sf.tag = item.value("tag", "");
             sf.host_path = item.value("host_path", "");
             sf.readonly = item.value("readonly", false);
+            sf.cache = item.value("cache", "auto");
+            sf.writeback = item.value("writeback", false);
+            sf.iops_limit = item.value("iops_limit", uint64_t{0});
+            sf.bps_limit = item.value("bps_limit", uint64_t{0});
+            if (sf.cache != "none" && sf.cache != "auto" && sf.cache != "always") {
+                return Error("vm_edit_invalid", "shared folder cache must be none, auto or always");
+            }
             if (!sf.tag.empty() && !sf.host_path.empty()) {
                 spec.shared_folders.push_back(std::move(sf));
             }
@@ -100,7 +100,8 @@ private:
     std::shared_ptr<WebRtcPeer> CreateRemotePeer(
         const std::string& session_id,
         const std::string& vm_id,
-        PixelFormat preferred_video_format = PixelFormat::kYuv420p);
+        PixelFormat preferred_video_format = PixelFormat::kYuv420p,
+        bool view_only = false);
     void HandleDataChannelMessage(const std::string& vm_id, const nlohmann::json& message);
     void PublishRemoteCursor(const std::string& vm_id, nlohmann::json cursor);
     void PublishRemoteAudio(const std::string& vm_id, RemoteAudioChunk chunk);
@@ -0,0 +1,421 @@
+#include "daemon/congestion_control.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tenbox::daemon {
+
+namespace {
+
+constexpr uint8_t kRtcpSr = 200;
+constexpr uint8_t kRtcpRr = 201;
+constexpr uint8_t kRtcpRtpfb = 205;
+constexpr uint8_t kTransportFeedbackFmt = 15;
+constexpr size_t kReportBlockBytes = 24;
+
+// Packets sent closer together than this are one group (one frame, in
+// practice); the delay trend is measured between groups.
+constexpr int64_t kGroupSpanUs = 5'000;
+constexpr size_t kTrendWindow = 20;
+constexpr double kTrendSmoothing = 0.9;
+constexpr double kTrendGain = 4.0;
+constexpr int64_t kHistoryUs = 2'000'000;
+constexpr int64_t kAckedWindowUs = 500'000;
+constexpr int64_t kDecreaseIntervalUs = 200'000;
+constexpr int64_t kLossIntervalUs = 300'000;
+// Receiver reports only count while transport feedback is not arriving.
+constexpr int64_t kFeedbackTimeoutUs = 2'000'000;
+// Encoded bits a frame should get before a higher frame rate is worth it.
+constexpr uint32_t kMinBitsPerFrame = 25'000;
+// Lets a frame through a little early so pump jitter does not halve the rate.
+constexpr int64_t kFrameIntervalSlackUs = 4'000;
+
+uint16_t ReadU16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t ReadU24(const uint8_t* p) {
+    return (uint32_t{p[0]} << 16) | (uint32_t{p[1]} << 8) | p[2];
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+    return (uint32_t{p[0]} << 24) | ReadU24(p + 1);
+}
+
+void ParseReportBlocks(const uint8_t* p, size_t count, uint32_t media_ssrc,
+                       std::vector<RtcpReportBlock>* reports) {
+    for (size_t i = 0; i < count; ++i, p += kReportBlockBytes) {
+        RtcpReportBlock block;
+        block.ssrc = ReadU32(p);
+        if (block.ssrc != media_ssrc) continue;
+        block.fraction_lost = p[4];
+        // 24-bit signed.
+        block.cumulative_lost = static_cast<int32_t>(ReadU24(p + 5) << 8) >> 8;
+        block.highest_seq = ReadU32(p + 8);
+        block.jitter = ReadU32(p + 12);
+        reports->push_back(block);
+    }
+}
+
+bool ParseTransportFeedback(const uint8_t* p, size_t size, TransportFeedback* out) {
+    // Past the common header and the two SSRCs.
+    if (size < 8) return false;
+    out->base_seq = ReadU16(p);
+    const uint16_t status_count = ReadU16(p + 2);
+    const int64_t reference_us =
+        static_cast<int64_t>(static_cast<int32_t>(ReadU24(p + 4) << 8) >> 8) * 64'000;
+    out->feedback_count = p[7];
+    size_t pos = 8;
+
+    // Packet status chunks: run length, or a vector of 1- or 2-bit symbols.
+    // 0 = not received, 1 = small delta, 2 = large delta.
+    std::vector<uint8_t> symbols;
+    symbols.reserve(status_count);
+    while (symbols.size() < status_count) {
+        if (pos + 2 > size) return false;
+        const uint16_t chunk = ReadU16(p + pos);
+        pos += 2;
+        if ((chunk & 0x8000) == 0) {
+            const uint8_t symbol = (chunk >> 13) & 0x3;
+            const size_t run = std::min<size_t>(chunk & 0x1fff, status_count - symbols.size());
+            symbols.insert(symbols.end(), run, symbol);
+        } else if ((chunk & 0x4000) == 0) {
+            for (int bit = 13; bit >= 0 && symbols.size() < status_count; --bit) {
+                symbols.push_back((chunk >> bit) & 0x1);
+            }
+        } else {
+            for (int shift = 12; shift >= 0 && symbols.size() < status_count; shift -= 2) {
+                symbols.push_back((chunk >> shift) & 0x3);
+            }
+        }
+    }
+
+    out->arrival_us.assign(status_count, TransportFeedback::kNotReceived);
+    int64_t arrival_us = reference_us;
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        int64_t delta = 0;
+        if (symbols[i] == 1) {
+            if (pos + 1 > size) return false;
+            delta = p[pos];
+            pos += 1;
+        } else if (symbols[i] == 2) {
+            if (pos + 2 > size) return false;
+            delta = static_cast<int16_t>(ReadU16(p + pos));
+            pos += 2;
+        } else {
+            continue;
+        }
+        arrival_us += delta * 250;
+        out->arrival_us[i] = arrival_us;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool ParseRtcpFeedback(std::span<const uint8_t> packet,
+                       uint32_t media_ssrc,
+                       std::vector<RtcpReportBlock>* reports,
+                       std::vector<TransportFeedback>* feedback) {
+    size_t offset = 0;
+    while (offset + 4 <= packet.size()) {
+        const uint8_t* p = packet.data() + offset;
+        if ((p[0] >> 6) != 2) return false;
+        const uint8_t count = p[0] & 0x1f;
+        const uint8_t type = p[1];
+        const size_t length = (size_t{ReadU16(p + 2)} + 1) * 4;
+        if (offset + length > packet.size()) return false;
+
+        if (type == kRtcpRr && reports) {
+            if (8 + count * kReportBlockBytes > length) return false;
+            ParseReportBlocks(p + 8, count, media_ssrc, reports);
+        } else if (type == kRtcpSr && reports) {
+            if (28 + count * kReportBlockBytes > length) return false;
+            ParseReportBlocks(p + 28, count, media_ssrc, reports);
+        } else if (type == kRtcpRtpfb && count == kTransportFeedbackFmt && feedback) {
+            if (length < 12) return false;
+            TransportFeedback parsed;
+            if (!ParseTransportFeedback(p + 12, length - 12, &parsed)) return false;
+            feedback->push_back(std::move(parsed));
+        }
+        offset += length;
+    }
+    return offset == packet.size();
+}
+
+SendSideCongestionController::SendSideCongestionController(CongestionControlConfig config)
+    : config_(config),
+      max_bitrate_bps_(config.max_bitrate_bps),
+      delay_target_bps_(config.start_bitrate_bps),
+      loss_target_bps_(config.start_bitrate_bps),
+      target_bps_(config.start_bitrate_bps),
+      target_fps_(config.max_framerate) {
+    UpdateTargetLocked();
+}
+
+void SendSideCongestionController::OnPacketSent(uint16_t seq, size_t bytes, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mu_);
+    const int64_t unwrapped = last_sent_seq_ < 0 ? seq : UnwrapLocked(seq);
+    if (history_.empty()) history_first_seq_ = unwrapped;
+    // Sequence numbers are assigned in send order; anything else is a
+    // resend of a packet we already track.
+    if (unwrapped != history_first_seq_ + static_cast<int64_t>(history_.size())) return;
+    history_.push_back({now_us, bytes});
+    last_sent_seq_ = unwrapped;
+    while (!history_.empty() && now_us - history_.front().send_us > kHistoryUs) {
+        history_.pop_front();
+        ++history_first_seq_;
+    }
+}
+
+int64_t SendSideCongestionController::UnwrapLocked(uint16_t seq) const {
+    const auto delta = static_cast<int16_t>(seq - static_cast<uint16_t>(last_sent_seq_));
+    return last_sent_seq_ + delta;
+}
+
+void SendSideCongestionController::OnTransportFeedback(const TransportFeedback& feedback,
+                                                       int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (last_sent_seq_ < 0) return;
+    last_feedback_us_ = now_us;
+
+    const int64_t base = UnwrapLocked(feedback.base_seq);
+    uint32_t lost = 0;
+    uint32_t total = 0;
+    for (size_t i = 0; i < feedback.arrival_us.size(); ++i) {
+        const int64_t index = base + static_cast<int64_t>(i) - history_first_seq_;
+        if (index < 0 || index >= static_cast<int64_t>(history_.size())) continue;
+        const SentPacket& sent = history_[static_cast<size_t>(index)];
+        ++total;
+        if (feedback.arrival_us[i] == TransportFeedback::kNotReceived) {
+            ++lost;
+            continue;
+        }
+        OnReceivedPacketLocked(sent.send_us, feedback.arrival_us[i], sent.bytes);
+    }
+
+    UpdateDelayBasedLocked(now_us);
+    loss_lost_ += lost;
+    loss_total_ += total;
+    if (loss_total_ >= 20 &&
+        (last_loss_update_us_ < 0 || now_us - last_loss_update_us_ >= kLossIntervalUs)) {
+        UpdateLossBasedLocked(static_cast<double>(loss_lost_) / loss_total_, now_us);
+        loss_lost_ = 0;
+        loss_total_ = 0;
+    }
+    UpdateTargetLocked();
+}
+
+void SendSideCongestionController::OnReceiverReport(const RtcpReportBlock& report,
+                                                    int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (last_feedback_us_ >= 0 && now_us - last_feedback_us_ < kFeedbackTimeoutUs) return;
+    UpdateLossBasedLocked(report.fraction_lost / 256.0, now_us);
+    UpdateTargetLocked();
+}
+
+void SendSideCongestionController::OnReceivedPacketLocked(int64_t send_us, int64_t arrival_us,
+                                                          size_t bytes) {
+    acked_.emplace_back(arrival_us, bytes);
+    acked_bytes_ += bytes;
+    while (!acked_.empty() && arrival_us - acked_.front().first > kAckedWindowUs) {
+        acked_bytes_ -= acked_.front().second;
+        acked_.pop_front();
+    }
+
+    if (!current_group_.valid) {
+        current_group_ = {send_us, send_us, arrival_us, true};
+        return;
+    }
+    if (send_us < current_group_.first_send_us) return;  // reordered
+    if (send_us - current_group_.first_send_us <= kGroupSpanUs) {
+        current_group_.last_send_us = std::max(current_group_.last_send_us, send_us);
+        current_group_.last_arrival_us = std::max(current_group_.last_arrival_us, arrival_us);
+        return;
+    }
+    if (previous_group_.valid) {
+        OnGroupDeltaLocked(current_group_.last_send_us - previous_group_.last_send_us,
+                           current_group_.last_arrival_us - previous_group_.last_arrival_us,
+                           current_group_.last_arrival_us);
+    }
+    previous_group_ = current_group_;
+    current_group_ = {send_us, send_us, arrival_us, true};
+}
+
+void SendSideCongestionController::OnGroupDeltaLocked(int64_t send_delta_us,
+                                                      int64_t arrival_delta_us,
+                                                      int64_t arrival_us) {
+    // Trendline filter: the slope of the smoothed accumulated one-way delay
+    // over the last groups says whether a queue is building somewhere.
+    const double arrival_ms = arrival_us / 1000.0;
+    accumulated_delay_ms_ += (arrival_delta_us - send_delta_us) / 1000.0;
+    smoothed_delay_ms_ = kTrendSmoothing * smoothed_delay_ms_ +
+                         (1 - kTrendSmoothing) * accumulated_delay_ms_;
+    delay_samples_.push_back({arrival_ms, smoothed_delay_ms_});
+    if (delay_samples_.size() > kTrendWindow) delay_samples_.pop_front();
+    ++num_deltas_;
+    if (delay_samples_.size() < kTrendWindow) return;
+
+    double mean_x = 0;
+    double mean_y = 0;
+    for (const auto& sample : delay_samples_) {
+        mean_x += sample.arrival_ms;
+        mean_y += sample.smoothed_delay_ms;
+    }
+    mean_x /= delay_samples_.size();
+    mean_y /= delay_samples_.size();
+    double numerator = 0;
+    double denominator = 0;
+    for (const auto& sample : delay_samples_) {
+        numerator += (sample.arrival_ms - mean_x) * (sample.smoothed_delay_ms - mean_y);
+        denominator += (sample.arrival_ms - mean_x) * (sample.arrival_ms - mean_x);
+    }
+    const double slope = denominator > 0 ? numerator / denominator : 0;
+    const double trend = std::min<uint32_t>(num_deltas_, 60) * slope * kTrendGain;
+
+    const double dt_ms = last_detect_ms_ < 0 ? 0 : std::min(arrival_ms - last_detect_ms_, 100.0);
+    last_detect_ms_ = arrival_ms;
+    if (trend > threshold_ms_) {
+        time_over_using_ms_ = time_over_using_ms_ < 0 ? dt_ms / 2 : time_over_using_ms_ + dt_ms;
+        ++overuse_count_;
+        if (time_over_using_ms_ > 10 && overuse_count_ > 1 && trend >= previous_trend_) {
+            usage_ = Usage::kOverusing;
+            time_over_using_ms_ = 0;
+            overuse_count_ = 0;
+        }
+    } else if (trend < -threshold_ms_) {
+        usage_ = Usage::kUnderusing;
+        time_over_using_ms_ = -1;
+        overuse_count_ = 0;
+    } else {
+        usage_ = Usage::kNormal;
+        time_over_using_ms_ = -1;
+        overuse_count_ = 0;
+    }
+    previous_trend_ = trend;
+
+    // Adaptive threshold, so competing TCP flows do not starve us.
+    const double magnitude = std::fabs(trend);
+    if (magnitude <= threshold_ms_ + 15) {
+        const double k = magnitude < threshold_ms_ ? 0.039 : 0.0087;
+        threshold_ms_ = std::clamp(threshold_ms_ + k * (magnitude - threshold_ms_) * dt_ms, 6.0, 600.0);
+    }
+}
+
+void SendSideCongestionController::UpdateDelayBasedLocked(int64_t now_us) {
+    const int64_t acked_span_us =
+        acked_.size() >= 2 ? acked_.back().first - acked_.front().first : 0;
+    const double acked_bps = acked_span_us >= 100'000
+        ? acked_bytes_ * 8.0 * 1e6 / static_cast<double>(acked_span_us)
+        : 0;
+
+    switch (usage_) {
+    case Usage::kOverusing:
+        if (last_decrease_us_ < 0 || now_us - last_decrease_us_ >= kDecreaseIntervalUs) {
+            const double base = acked_bps > 0 ? std::min(acked_bps, delay_target_bps_)
+                                              : delay_target_bps_;
+            delay_target_bps_ = 0.85 * base;
+            last_decrease_us_ = now_us;
+        }
+        last_increase_us_ = now_us;
+        break;
+    case Usage::kUnderusing:
+        // Queues are draining; hold until they are gone.
+        last_increase_us_ = now_us;
+        break;
+    case Usage::kNormal: {
+        const double dt_s = last_increase_us_ < 0
+            ? 0 : std::min<int64_t>(now_us - last_increase_us_, 1'000'000) / 1e6;
+        double next = delay_target_bps_ * std::pow(1.08, dt_s);
+        // Do not run far ahead of what is actually getting through; an idle
+        // desktop sends little, which must not pull the estimate down.
+        if (acked_bps > 0) next = std::min(next, std::max(delay_target_bps_, 1.5 * acked_bps + 100'000));
+        delay_target_bps_ = next;
+        last_increase_us_ = now_us;
+        break;
+    }
+    }
+    delay_target_bps_ = std::clamp<double>(delay_target_bps_, config_.min_bitrate_bps, max_bitrate_bps_);
+}
+
+void SendSideCongestionController::UpdateLossBasedLocked(double loss, int64_t now_us) {
+    const double dt_s = last_loss_update_us_ < 0
+        ? 0 : std::min<int64_t>(now_us - last_loss_update_us_, 1'000'000) / 1e6;
+    last_loss_update_us_ = now_us;
+    if (loss > 0.10) {
+        loss_target_bps_ *= 1 - 0.5 * loss;
+    } else if (loss < 0.02) {
+        loss_target_bps_ *= std::pow(1.08, dt_s);
+    }
+    loss_target_bps_ = std::clamp<double>(loss_target_bps_, config_.min_bitrate_bps, max_bitrate_bps_);
+}
+
+void SendSideCongestionController::UpdateTargetLocked() {
+    const double target = std::min(delay_target_bps_, loss_target_bps_);
+    target_bps_ = static_cast<uint32_t>(
+        std::clamp<double>(target, config_.min_bitrate_bps, max_bitrate_bps_));
+    target_fps_ = std::clamp(target_bps_ / kMinBitsPerFrame, config_.min_framerate, config_.max_framerate);
+}
+
+void SendSideCongestionController::DrainLocked(int64_t now_us) {
+    if (last_drain_us_ >= 0 && now_us > last_drain_us_) {
+        queued_bytes_ -= target_bps_ / 8.0 * (now_us - last_drain_us_) / 1e6;
+        queued_bytes_ = std::max(queued_bytes_, 0.0);
+    }
+    last_drain_us_ = now_us;
+}
+
+bool SendSideCongestionController::ReadyForFrame(int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mu_);
+    DrainLocked(now_us);
+    const int64_t interval_us = 1'000'000 / target_fps_;
+    if (last_frame_us_ >= 0 && now_us - last_frame_us_ < interval_us - kFrameIntervalSlackUs) {
+        return false;
+    }
+    if (queued_bytes_ * 8 * 1e6 / target_bps_ > config_.max_queue_delay_us) {
+        // One drop per frame interval, however often the caller asks.
+        if (last_drop_us_ < 0 || now_us - last_drop_us_ >= interval_us) {
+            ++frames_dropped_;
+            last_drop_us_ = now_us;
+        }
+        return false;
+    }
+    return true;
+}
+
+void SendSideCongestionController::OnFrameSent(size_t bytes, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mu_);
+    DrainLocked(now_us);
+    queued_bytes_ += bytes;
+    last_frame_us_ = now_us;
+}
+
+void SendSideCongestionController::SetMaxBitrate(uint32_t bitrate_bps) {
+    std::lock_guard<std::mutex> lock(mu_);
+    max_bitrate_bps_ = std::clamp(bitrate_bps, config_.min_bitrate_bps, config_.max_bitrate_bps);
+    if (last_feedback_us_ < 0 && last_loss_update_us_ < 0) {
+        // Nothing measured yet: start at the cap.
+        delay_target_bps_ = max_bitrate_bps_;
+        loss_target_bps_ = max_bitrate_bps_;
+    }
+    delay_target_bps_ = std::min<double>(delay_target_bps_, max_bitrate_bps_);
+    loss_target_bps_ = std::min<double>(loss_target_bps_, max_bitrate_bps_);
+    UpdateTargetLocked();
+}
+
+uint32_t SendSideCongestionController::target_bitrate_bps() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return target_bps_;
+}
+
+uint32_t SendSideCongestionController::target_framerate() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return target_fps_;
+}
+
+uint64_t SendSideCongestionController::frames_dropped() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return frames_dropped_;
+}
+
+}  // namespace tenbox::daemon
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace tenbox::daemon {
+
+// One RTCP report block (RFC 3550 6.4.1) about a stream we send.
+struct RtcpReportBlock {
+    uint32_t ssrc = 0;
+    uint8_t fraction_lost = 0;  // of 256, since the previous report
+    int32_t cumulative_lost = 0;
+    uint32_t highest_seq = 0;
+    uint32_t jitter = 0;
+};
+
+// Transport-wide congestion control feedback
+// (draft-holmer-rmcat-transport-wide-cc-extensions-01), unpacked.
+struct TransportFeedback {
+    uint16_t base_seq = 0;
+    uint8_t feedback_count = 0;
+    // Receiver clock; only differences between packets mean anything.
+    // arrival_us[i] belongs to base_seq + i, or is kNotReceived.
+    std::vector<int64_t> arrival_us;
+
+    static constexpr int64_t kNotReceived = -1;
+};
+
+// Walk a compound RTCP packet and collect the report blocks about
+// |media_ssrc| (from SR and RR) plus every transport-wide feedback
+// message. Returns false if the packet is malformed; whatever was parsed
+// before the bad part is kept.
+bool ParseRtcpFeedback(std::span<const uint8_t> packet,
+                       uint32_t media_ssrc,
+                       std::vector<RtcpReportBlock>* reports,
+                       std::vector<TransportFeedback>* feedback);
+
+struct CongestionControlConfig {
+    uint32_t min_bitrate_bps = 250'000;
+    uint32_t max_bitrate_bps = 20'000'000;
+    uint32_t start_bitrate_bps = 4'000'000;
+    uint32_t min_framerate = 10;
+    uint32_t max_framerate = 60;
+    // Frames are dropped while more than this much is queued at the
+    // target rate.
+    int64_t max_queue_delay_us = 100'000;
+};
+
+// Sender-side bandwidth estimation for one peer, after Google Congestion
+// Control: a delay-based estimate from the one-way delay trend seen in
+// transport-wide feedback, a loss-based one from the same feedback (or
+// receiver reports when the browser does not send it), and the smaller of
+// the two as the target. The target also sets the frame rate, and a
+// virtual send queue drained at the target rate drops whole frames when
+// the encoder runs ahead of the link, so a poor link lowers quality and
+// smoothness instead of building latency.
+//
+// All times are microseconds on one monotonic clock. Thread-safe.
+class SendSideCongestionController {
+public:
+    explicit SendSideCongestionController(CongestionControlConfig config = {});
+
+    // A media packet carrying transport-wide sequence number |seq| left.
+    void OnPacketSent(uint16_t seq, size_t bytes, int64_t now_us);
+    void OnTransportFeedback(const TransportFeedback& feedback, int64_t now_us);
+    void OnReceiverReport(const RtcpReportBlock& report, int64_t now_us);
+
+    // Frame pacing: ask before encoding a frame, report what was sent.
+    // May be polled often; a full queue counts one dropped frame per frame
+    // interval, not per call.
+    bool ReadyForFrame(int64_t now_us);
+    void OnFrameSent(size_t bytes, int64_t now_us);
+
+    // Upper bound from outside (the session's quality setting). Until any
+    // feedback has arrived it is also where the estimate starts.
+    void SetMaxBitrate(uint32_t bitrate_bps);
+
+    uint32_t target_bitrate_bps() const;
+    uint32_t target_framerate() const;
+    uint64_t frames_dropped() const;
+
+private:
+    enum class Usage { kNormal, kUnderusing, kOverusing };
+
+    struct SentPacket {
+        int64_t send_us = 0;
+        size_t bytes = 0;
+    };
+    struct PacketGroup {
+        int64_t first_send_us = 0;
+        int64_t last_send_us = 0;
+        int64_t last_arrival_us = 0;
+        bool valid = false;
+    };
+    struct DelaySample {
+        double arrival_ms = 0;
+        double smoothed_delay_ms = 0;
+    };
+
+    int64_t UnwrapLocked(uint16_t seq) const;
+    void OnReceivedPacketLocked(int64_t send_us, int64_t arrival_us, size_t bytes);
+    void OnGroupDeltaLocked(int64_t send_delta_us, int64_t arrival_delta_us, int64_t arrival_us);
+    void UpdateDelayBasedLocked(int64_t now_us);
+    void UpdateLossBasedLocked(double loss, int64_t now_us);
+    void UpdateTargetLocked();
+    void DrainLocked(int64_t now_us);
+
+    mutable std::mutex mu_;
+    CongestionControlConfig config_;
+    uint32_t max_bitrate_bps_;
+
+    // Sent packets still awaiting feedback, by unwrapped sequence number.
+    std::deque<SentPacket> history_;
+    int64_t history_first_seq_ = 0;
+    int64_t last_sent_seq_ = -1;
+
+    // Delay trend over packet groups (packets sent within 5ms of each other).
+    PacketGroup current_group_;
+    PacketGroup previous_group_;
+    double accumulated_delay_ms_ = 0;
+    double smoothed_delay_ms_ = 0;
+    std::deque<DelaySample> delay_samples_;
+    uint32_t num_deltas_ = 0;
+    double threshold_ms_ = 12.5;
+    double previous_trend_ = 0;
+    double time_over_using_ms_ = -1;
+    uint32_t overuse_count_ = 0;
+    double last_detect_ms_ = -1;
+    Usage usage_ = Usage::kNormal;
+
+    // Throughput the receiver acknowledged, over a sliding window.
+    std::deque<std::pair<int64_t, size_t>> acked_;
+    uint64_t acked_bytes_ = 0;
+
+    double delay_target_bps_;
+    double loss_target_bps_;
+    int64_t last_increase_us_ = -1;
+    int64_t last_decrease_us_ = -1;
+    uint32_t loss_lost_ = 0;
+    uint32_t loss_total_ = 0;
+    int64_t last_loss_update_us_ = -1;
+    int64_t last_feedback_us_ = -1;
+    uint32_t target_bps_;
+    uint32_t target_fps_;
+
+    // Virtual send queue, drained at the target rate.
+    double queued_bytes_ = 0;
+    int64_t last_drain_us_ = -1;
+    int64_t last_frame_us_ = -1;
+    int64_t last_drop_us_ = -1;
+    uint64_t frames_dropped_ = 0;
+};
+
+}  // namespace tenbox::daemon
@@ -60,6 +60,10 @@ nlohmann::json ToJson(const SharedFolder& folder) {
         {"tag", folder.tag},
         {"host_path", folder.host_path},
         {"readonly", folder.readonly},
+        {"cache", folder.cache},
+        {"writeback", folder.writeback},
+        {"iops_limit", folder.iops_limit},
+        {"bps_limit", folder.bps_limit},
     };
 }
 
@@ -71,7 +75,7 @@ nlohmann::json ToJson(const VmSpec& spec) {
     nlohmann::json shared_folders = nlohmann::json::array();
     for (const auto& sf : spec.shared_folders) shared_folders.push_back(ToJson(sf));
 
-    return {
+    nlohmann::json json = {
         {"id", spec.vm_id},
         {"name", spec.name},
         {"vm_dir", spec.vm_dir},
@@ -90,6 +94,18 @@ nlohmann::json ToJson(const VmSpec& spec) {
         {"guest_forwards", std::move(guest_forwards)},
         {"shared_folders", std::move(shared_folders)},
     };
+    if (spec.halt_poll_max_ns) {
+        json["halt_poll_max_ns"] = *spec.halt_poll_max_ns;
+    }
+    if (!spec.placement.IsDefault()) {
+        json["placement"] = {
+            {"vcpu_cpus", spec.placement.vcpu_cpus},
+            {"io_cpus", spec.placement.io_cpus},
+            {"vcpu_fifo_priority", spec.placement.vcpu_fifo_priority},
+            {"cpu_quota_pct", spec.placement.cpu_quota_pct},
+        };
+    }
+    return json;
 }
 
 nlohmann::json ToJson(const FailureInfo& failure) {
@@ -128,6 +144,16 @@ bool FromJson(const nlohmann::json& value, VmSpec& spec, std::string* error) {
     spec.dpi_scaled = value.value("dpi_scaled", false);
     spec.creation_time = value.value("creation_time", static_cast<int64_t>(0));
     spec.last_boot_time = value.value("last_boot_time", static_cast<int64_t>(0));
+    if (value.contains("halt_poll_max_ns") && value["halt_poll_max_ns"].is_number_unsigned()) {
+        spec.halt_poll_max_ns = value["halt_poll_max_ns"].get<uint32_t>();
+    }
+    if (value.contains("placement") && value["placement"].is_object()) {
+        const auto& placement = value["placement"];
+        spec.placement.vcpu_cpus = placement.value("vcpu_cpus", "");
+        spec.placement.io_cpus = placement.value("io_cpus", "");
+        spec.placement.vcpu_fifo_priority = placement.value("vcpu_fifo_priority", 0);
+        spec.placement.cpu_quota_pct = placement.value("cpu_quota_pct", 0u);
+    }
     if (spec.name.empty()) spec.name = value.value("id", "");
 
     // Read the new `host_forwards` key, falling back to the legacy
@@ -173,6 +199,10 @@ bool FromJson(const nlohmann::json& value, VmSpec& spec, std::string* error) {
             sf.tag = item.value("tag", "");
             sf.host_path = item.value("host_path", "");
             sf.readonly = item.value("readonly", false);
+            sf.cache = item.value("cache", "auto");
+            sf.writeback = item.value("writeback", false);
+            sf.iops_limit = item.value("iops_limit", uint64_t{0});
+            sf.bps_limit = item.value("bps_limit", uint64_t{0});
             if (!sf.tag.empty() && !sf.host_path.empty()) {
                 spec.shared_folders.push_back(std::move(sf));
             }
@@ -51,6 +51,13 @@ struct DaemonConfig {
     std::string socket_path;
     std::string runtime_path = "tenbox-vm-runtime";
     std::string cloud_url;
+    // CPUs reserved for host housekeeping and VM I/O threads. Never handed
+    // out to `placement.vcpu_cpus = "auto"` VMs; default I/O affinity.
+    std::string housekeeping_cpus;
+    // Delegated cgroup v2 directory (with +cpu in cgroup.subtree_control)
+    // under which per-VM groups are created for `placement.cpu_quota_pct`.
+    // Empty disables quotas.
+    std::string cgroup_root;
 };
 
 std::string VmStateToString(VmState state);
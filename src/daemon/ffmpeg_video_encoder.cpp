@@ -8,11 +8,13 @@ extern "C" {
 }
 
 #include <algorithm>
+#include <array>
 #include <charconv>
 #include <cstdlib>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -26,9 +28,38 @@ std::string AvError(int code) {
     return buffer;
 }
 
-std::vector<std::string> H264EncoderCandidates(const VideoEncoderConfig& config) {
-    if (!config.h264_encoder_candidates.empty()) return config.h264_encoder_candidates;
-    return {"h264_nvenc", "libx264"};
+const char* VideoCodecName(VideoCodec codec) {
+    switch (codec) {
+    case VideoCodec::kVp8:
+        return "VP8";
+    case VideoCodec::kVp9:
+        return "VP9";
+    case VideoCodec::kAv1:
+        return "AV1";
+    case VideoCodec::kH264:
+    default:
+        return "H.264";
+    }
+}
+
+std::vector<std::string> EncoderCandidates(const VideoEncoderConfig& config) {
+    switch (config.codec) {
+    case VideoCodec::kVp8:
+        return {"libvpx"};
+    case VideoCodec::kVp9:
+        return {"libvpx-vp9"};
+    case VideoCodec::kAv1:
+        if (!config.av1_encoder_candidates.empty()) return config.av1_encoder_candidates;
+        return {"av1_nvenc", "libsvtav1", "libaom-av1"};
+    case VideoCodec::kH264:
+    default:
+        if (!config.h264_encoder_candidates.empty()) return config.h264_encoder_candidates;
+        return {"h264_nvenc", "libx264"};
+    }
+}
+
+bool IsNvencEncoder(const std::string& encoder_name) {
+    return encoder_name == "h264_nvenc" || encoder_name == "av1_nvenc";
 }
 
 const char* H264ProfileName(H264Profile profile) {
@@ -66,14 +97,27 @@ AVPixelFormat AvPixelFormatFor(PixelFormat format) {
     }
 }
 
-void ConfigureCommonH264Context(AVCodecContext* codec, const VideoEncoderConfig& config) {
+// libx264 and the nvenc encoders compare these against their live rate
+// control before every frame and reconfigure in place when they moved
+// (x264_encoder_reconfig / nvEncReconfigureEncoder), so for them they can
+// also be changed on an open context. The libvpx, SVT-AV1 and libaom
+// wrappers only read them in avcodec_open2().
+void ApplyRateControl(AVCodecContext* codec, const VideoEncoderConfig& config) {
+    codec->bit_rate = static_cast<int64_t>(config.bitrate_bps);
+    codec->rc_max_rate = static_cast<int64_t>(config.bitrate_bps);
+    codec->rc_buffer_size = static_cast<int>(std::max<uint32_t>(config.bitrate_bps / 2, 1));
+}
+
+bool SupportsLiveRateControl(const std::string& encoder_name) {
+    return encoder_name == "libx264" || IsNvencEncoder(encoder_name);
+}
+
+void ConfigureCommonContext(AVCodecContext* codec, const VideoEncoderConfig& config) {
     codec->width = static_cast<int>(config.width);
     codec->height = static_cast<int>(config.height);
     codec->time_base = AVRational{1, static_cast<int>(std::max<uint32_t>(config.framerate, 1))};
     codec->framerate = AVRational{static_cast<int>(std::max<uint32_t>(config.framerate, 1)), 1};
-    codec->bit_rate = static_cast<int64_t>(config.bitrate_bps);
-    codec->rc_max_rate = static_cast<int64_t>(config.bitrate_bps);
-    codec->rc_buffer_size = static_cast<int>(std::max<uint32_t>(config.bitrate_bps / 2, 1));
+    ApplyRateControl(codec, config);
     codec->gop_size = static_cast<int>(std::max<uint32_t>(config.framerate * 240, 1));
     codec->max_b_frames = 0;
     // Single-threaded encoding minimizes per-frame latency for remote desktop.
@@ -155,6 +199,75 @@ bool ConfigureH264Nvenc(AVCodecContext* codec, const VideoEncoderConfig& config,
     return true;
 }
 
+// Realtime, no lookahead, and the screen content tools: palette and intra
+// block copy modes plus rate control tuned for mostly static text.
+bool ConfigureLibvpx(AVCodecContext* codec, const VideoEncoderConfig& config, std::string* error) {
+    const bool vp9 = config.codec == VideoCodec::kVp9;
+    if (config.input_format == PixelFormat::kYuv444p) {
+        // VP9 profile 1 could carry it, but peers only negotiate profile 0.
+        if (error) *error = vp9 ? "VP9 is negotiated at profile 0 (4:2:0)" : "VP8 has no 4:4:4 mode";
+        return false;
+    }
+    if (!codec->priv_data) return true;
+    SetOptionalOption(codec, "deadline", "realtime");
+    SetOptionalOption(codec, "lag-in-frames", "0");
+    SetOptionalOption(codec, "cpu-used", "8");
+    SetOptionalOption(codec, "static-thresh", "100");
+    if (vp9) {
+        SetOptionalOption(codec, "tune-content", "screen");
+        SetOptionalOption(codec, "row-mt", "1");
+        SetOptionalOption(codec, "aq-mode", "3");
+    } else {
+        SetOptionalOption(codec, "screen-content-mode", "1");
+    }
+    return true;
+}
+
+bool ConfigureLibsvtav1(AVCodecContext* codec, const VideoEncoderConfig& config, std::string* error) {
+    if (config.input_format == PixelFormat::kYuv444p) {
+        if (error) *error = "SVT-AV1 only encodes 4:2:0";
+        return false;
+    }
+    if (!codec->priv_data) return true;
+    // Fastest preset, low-delay prediction structure, screen content mode.
+    SetOptionalOption(codec, "preset", "12");
+    SetOptionalOption(codec, "svtav1-params", "pred-struct=1:scm=1:fast-decode=1");
+    return true;
+}
+
+bool ConfigureLibaom(AVCodecContext* codec, const VideoEncoderConfig& config, std::string* error) {
+    if (config.input_format == PixelFormat::kYuv444p) {
+        // AV1 High profile could carry it, but peers only negotiate Main.
+        if (error) *error = "AV1 is negotiated at Main profile (4:2:0)";
+        return false;
+    }
+    if (!codec->priv_data) return true;
+    SetOptionalOption(codec, "usage", "realtime");
+    SetOptionalOption(codec, "cpu-used", "8");
+    SetOptionalOption(codec, "lag-in-frames", "0");
+    SetOptionalOption(codec, "row-mt", "1");
+    SetOptionalOption(codec, "aom-params", "tune-content=screen");
+    return true;
+}
+
+bool ConfigureAv1Nvenc(AVCodecContext* codec, const VideoEncoderConfig& config, std::string* error) {
+    if (config.input_format == PixelFormat::kYuv444p) {
+        if (error) *error = "av1_nvenc only encodes 4:2:0";
+        return false;
+    }
+    if (!codec->priv_data) return true;
+    // Same low-latency capped VBR as h264_nvenc.
+    SetOptionalOption(codec, "preset", "p1");
+    SetOptionalOption(codec, "tune", "ull");
+    SetOptionalOption(codec, "rc", "vbr");
+    SetOptionalOption(codec, "cq", "24");
+    SetOptionalOption(codec, "rc-lookahead", "0");
+    SetOptionalOption(codec, "delay", "0");
+    SetOptionalOption(codec, "zerolatency", "1");
+    SetOptionalOption(codec, "forced-idr", "1");
+    return true;
+}
+
 bool ConfigureEncoderOptions(AVCodecContext* codec,
                              const std::string& encoder_name,
                              const VideoEncoderConfig& config,
@@ -165,7 +278,22 @@ bool ConfigureEncoderOptions(AVCodecContext* codec,
     if (encoder_name == "h264_nvenc") {
         return ConfigureH264Nvenc(codec, config, error);
     }
-    if (error) *error = "unsupported FFmpeg H.264 encoder '" + encoder_name + "'";
+    if (encoder_name == "libvpx" || encoder_name == "libvpx-vp9") {
+        return ConfigureLibvpx(codec, config, error);
+    }
+    if (encoder_name == "libsvtav1") {
+        return ConfigureLibsvtav1(codec, config, error);
+    }
+    if (encoder_name == "libaom-av1") {
+        return ConfigureLibaom(codec, config, error);
+    }
+    if (encoder_name == "av1_nvenc") {
+        return ConfigureAv1Nvenc(codec, config, error);
+    }
+    if (error) {
+        *error = std::string("unsupported FFmpeg ") + VideoCodecName(config.codec) +
+                 " encoder '" + encoder_name + "'";
+    }
     return false;
 }
 
@@ -224,7 +352,7 @@ bool AnnexBToLengthPrefixed(std::span<const uint8_t> input, std::vector<uint8_t>
 
 }  // namespace
 
-struct FfmpegH264VideoEncoder::Impl {
+struct FfmpegVideoEncoder::Impl {
     AVCodecContext* codec = nullptr;
     AVFrame* frame = nullptr;
     AVPacket* packet = nullptr;
@@ -233,6 +361,7 @@ struct FfmpegH264VideoEncoder::Impl {
     std::vector<uint8_t> encoded_;
     int64_t next_pts = 0;
     bool output_annexb = false;
+    bool live_rate_control = false;
     bool force_keyframe = true;
     // True once a (0,0,W,H) slice has been applied to `frame`. The slice
     // pipeline refuses to encode before that, since partial slices on a zeroed
@@ -240,13 +369,13 @@ struct FfmpegH264VideoEncoder::Impl {
     bool frame_initialized = false;
 };
 
-FfmpegH264VideoEncoder::FfmpegH264VideoEncoder() : impl_(std::make_unique<Impl>()) {}
+FfmpegVideoEncoder::FfmpegVideoEncoder() : impl_(std::make_unique<Impl>()) {}
 
-FfmpegH264VideoEncoder::~FfmpegH264VideoEncoder() {
+FfmpegVideoEncoder::~FfmpegVideoEncoder() {
     Close();
 }
 
-bool FfmpegH264VideoEncoder::Open(const VideoEncoderConfig& config, std::string* error) {
+bool FfmpegVideoEncoder::Open(const VideoEncoderConfig& config, std::string* error) {
     Close();
     const AVPixelFormat frame_format = AvPixelFormatFor(config.input_format);
     if (frame_format == AV_PIX_FMT_NONE) {
@@ -257,7 +386,7 @@ bool FfmpegH264VideoEncoder::Open(const VideoEncoderConfig& config, std::string*
     state->config = config;
 
     std::string attempts;
-    for (const auto& encoder_name : H264EncoderCandidates(config)) {
+    for (const auto& encoder_name : EncoderCandidates(config)) {
         if (encoder_name.empty()) continue;
         const AVCodec* codec = avcodec_find_encoder_by_name(encoder_name.c_str());
         if (!codec) {
@@ -271,7 +400,7 @@ bool FfmpegH264VideoEncoder::Open(const VideoEncoderConfig& config, std::string*
             continue;
         }
 
-        ConfigureCommonH264Context(candidate, config);
+        ConfigureCommonContext(candidate, config);
         std::string option_error;
         if (!ConfigureEncoderOptions(candidate, encoder_name, config, &option_error)) {
             AppendAttempt(&attempts, encoder_name, option_error);
@@ -289,12 +418,13 @@ bool FfmpegH264VideoEncoder::Open(const VideoEncoderConfig& config, std::string*
         state->codec = candidate;
         state->selected_encoder_name = encoder_name;
         state->output_annexb = encoder_name == "h264_nvenc";
+        state->live_rate_control = SupportsLiveRateControl(encoder_name);
         break;
     }
 
     if (!state->codec) {
         if (error) {
-            *error = "failed to open any FFmpeg H.264 encoder";
+            *error = std::string("failed to open any FFmpeg ") + VideoCodecName(config.codec) + " encoder";
             if (!attempts.empty()) *error += " (" + attempts + ")";
         }
         return false;
@@ -336,7 +466,32 @@ bool FfmpegH264VideoEncoder::Open(const VideoEncoderConfig& config, std::string*
     return true;
 }
 
-bool FfmpegH264VideoEncoder::ApplySlice(const VideoSlice& slice, std::string* error) {
+bool FfmpegVideoEncoder::Reconfigure(const VideoEncoderConfig& config, std::string* error) {
+    if (!impl_ || !impl_->codec) {
+        if (error) *error = "FFmpeg encoder is not open";
+        return false;
+    }
+    const auto& current = impl_->config;
+    if (config.width != current.width ||
+        config.height != current.height ||
+        config.framerate != current.framerate ||
+        config.input_format != current.input_format ||
+        config.codec != current.codec ||
+        config.h264_profile != current.h264_profile) {
+        if (error) *error = "only the bitrate can change without reopening the encoder";
+        return false;
+    }
+    if (config.bitrate_bps == current.bitrate_bps) return true;
+    if (!impl_->live_rate_control) {
+        if (error) *error = impl_->selected_encoder_name + " cannot retune its bitrate in place";
+        return false;
+    }
+    ApplyRateControl(impl_->codec, config);
+    impl_->config.bitrate_bps = config.bitrate_bps;
+    return true;
+}
+
+bool FfmpegVideoEncoder::ApplySlice(const VideoSlice& slice, std::string* error) {
     if (!impl_ || !impl_->frame) {
         if (error) *error = "FFmpeg encoder is not open";
         return false;
@@ -403,7 +558,36 @@ bool FfmpegH264VideoEncoder::ApplySlice(const VideoSlice& slice, std::string* er
     return true;
 }
 
-bool FfmpegH264VideoEncoder::EncodeFrame(int64_t pts_us, EncodedVideoFrame* output, std::string* error) {
+bool FfmpegVideoEncoder::WritableInput(VideoPlanes* planes, std::string* error) {
+    if (!impl_ || !impl_->frame || !planes) {
+        if (error) *error = "FFmpeg encoder is not open";
+        return false;
+    }
+    // Copies the picture only if the encoder still holds a reference to it.
+    const int rc = av_frame_make_writable(impl_->frame);
+    if (rc < 0) {
+        if (error) *error = "failed to make FFmpeg frame writable: " + AvError(rc);
+        return false;
+    }
+    planes->width = static_cast<uint32_t>(impl_->frame->width);
+    planes->height = static_cast<uint32_t>(impl_->frame->height);
+    for (int i = 0; i < 3; ++i) {
+        planes->planes[i] = impl_->frame->data[i];
+        planes->strides[i] = impl_->frame->linesize[i];
+    }
+    return true;
+}
+
+void FfmpegVideoEncoder::CommitInput(const VideoSlice& region) {
+    if (!impl_ || !impl_->frame) return;
+    if (region.x == 0 && region.y == 0 &&
+        region.width == static_cast<uint32_t>(impl_->frame->width) &&
+        region.height == static_cast<uint32_t>(impl_->frame->height)) {
+        impl_->frame_initialized = true;
+    }
+}
+
+bool FfmpegVideoEncoder::EncodeFrame(int64_t pts_us, EncodedVideoFrame* output, std::string* error) {
     if (!impl_ || !impl_->codec || !impl_->frame || !impl_->packet) {
         if (error) *error = "FFmpeg encoder is not open";
         return false;
@@ -450,7 +634,7 @@ bool FfmpegH264VideoEncoder::EncodeFrame(int64_t pts_us, EncodedVideoFrame* outp
             }
             payload = std::span<const uint8_t>(impl_->encoded_.data(), impl_->encoded_.size());
         }
-        output->codec = VideoCodec::kH264;
+        output->codec = impl_->config.codec;
         output->data = payload;
         output->keyframe = keyframe;
         output->pts_us = pts_us;
@@ -458,19 +642,45 @@ bool FfmpegH264VideoEncoder::EncodeFrame(int64_t pts_us, EncodedVideoFrame* outp
     return true;
 }
 
-bool FfmpegH264VideoEncoder::HasFullSeed() const {
+bool FfmpegVideoEncoder::IsAvailable(VideoCodec codec) {
+    // Open a small encoder once per codec, so hardware wrappers only count
+    // where the host can actually run them.
+    static std::mutex mu;
+    static std::array<int, 4> cached = {-1, -1, -1, -1};
+    const auto index = static_cast<size_t>(codec);
+    if (index >= cached.size()) return false;
+    std::lock_guard<std::mutex> lock(mu);
+    if (cached[index] < 0) {
+        VideoEncoderConfig config;
+        config.width = 256;
+        config.height = 256;
+        config.bitrate_bps = 500'000;
+        config.framerate = 30;
+        config.codec = codec;
+        FfmpegVideoEncoder encoder;
+        std::string error;
+        cached[index] = encoder.Open(config, &error) ? 1 : 0;
+    }
+    return cached[index] == 1;
+}
+
+bool FfmpegVideoEncoder::HasFullSeed() const {
     return impl_ && impl_->frame_initialized;
 }
 
-std::string FfmpegH264VideoEncoder::SelectedEncoderName() const {
+std::string FfmpegVideoEncoder::SelectedEncoderName() const {
     return impl_ ? impl_->selected_encoder_name : std::string();
 }
 
-void FfmpegH264VideoEncoder::RequestKeyframe() {
+bool FfmpegVideoEncoder::SupportsLiveBitrate() const {
+    return impl_ && impl_->live_rate_control;
+}
+
+void FfmpegVideoEncoder::RequestKeyframe() {
     if (impl_) impl_->force_keyframe = true;
 }
 
-void FfmpegH264VideoEncoder::Close() {
+void FfmpegVideoEncoder::Close() {
     if (!impl_) return;
     if (impl_->packet) {
         av_packet_unref(impl_->packet);
@@ -26,6 +26,9 @@ void PrintUsage(const char* prog) {
         << "  --data-dir <path>      Override data directory for development/testing\n"
         << "  --socket <path>        Override Unix socket path for development/testing\n"
         << "  --runtime <path>       Override path to the tenbox-vm-runtime binary\n"
+        << "  --housekeeping-cpus <list>\n"
+        << "                         Host CPUs kept free of auto-pinned vCPUs; default I/O thread affinity\n"
+        << "  --cgroup-root <dir>    Delegated cgroup v2 directory for per-VM cpu.max quotas\n"
         << "  --cloud-url <url>      Cloud tunnel WS/WSS URL (default: " << kDefaultCloudUrl << ")\n"
         << "                         Also reads TENBOX_CLOUD_URL when --cloud-url is omitted.\n"
         << "                         Pass an empty value to disable cloud connectivity.\n"
@@ -62,6 +65,10 @@ int main(int argc, char** argv) {
             config.socket_path = next();
         } else if (arg == "--runtime") {
             config.runtime_path = next();
+        } else if (arg == "--housekeeping-cpus") {
+            config.housekeeping_cpus = next();
+        } else if (arg == "--cgroup-root") {
+            config.cgroup_root = next();
         } else if (arg == "--cloud-url") {
             config.cloud_url = next();
             cloud_url_explicit = true;
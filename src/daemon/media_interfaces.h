@@ -43,6 +43,15 @@ struct VideoSlice {
     int strides[3] = {};
 };
 
+// Writable view of the encoder's persistent input picture, for producers
+// that convert straight into it (see WritableInput / CommitInput).
+struct VideoPlanes {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t* planes[3] = {};
+    int strides[3] = {};
+};
+
 struct EncodedVideoFrame {
     VideoCodec codec = VideoCodec::kH264;
     std::span<const uint8_t> data;
@@ -59,6 +68,7 @@ struct VideoEncoderConfig {
     VideoCodec codec = VideoCodec::kH264;
     H264Profile h264_profile = H264Profile::kConstrainedBaseline;
     std::vector<std::string> h264_encoder_candidates = {"h264_nvenc", "libx264"};
+    std::vector<std::string> av1_encoder_candidates = {"av1_nvenc", "libsvtav1", "libaom-av1"};
 };
 
 struct AudioChunk {
@@ -82,7 +92,11 @@ public:
     virtual void Close() = 0;
 };
 
-// Slice-mode H.264 encoder backed by FFmpeg's libavcodec encoders.
+// Slice-mode video encoder backed by FFmpeg's libavcodec encoders: H.264
+// (h264_nvenc, libx264), VP8 and VP9 (libvpx), AV1 (av1_nvenc, libsvtav1,
+// libaom-av1). VP8, VP9 and the software AV1 encoders run in their screen
+// content modes. H.264 output is AVCC (length-prefixed NALUs), AV1 is a
+// temporal unit of low-overhead OBUs, VP8/VP9 are plain frames.
 //
 // Pipeline (mirrors x264's persistent input picture):
 //   ApplySlice(slice)       -- stamp a planar YUV patch onto the persistent input.
@@ -90,16 +104,35 @@ public:
 // The caller is responsible for driving these in pairs: apply N slices that
 // together cover at least the first full frame (HasFullSeed() turns true once
 // a (0,0,W,H) slice has been applied), then call EncodeFrame.
-class FfmpegH264VideoEncoder {
+//
+// Producers that can convert straight into the input picture use
+//   WritableInput(&planes)  -- writable view of the whole persistent input.
+//   CommitInput(region)     -- report a region written there (seeds likewise).
+// instead of ApplySlice, saving the intermediate slice buffer and copy.
+//
+// Reconfigure(config) retargets the bitrate of the open encoder in place:
+// no new keyframe, and the input picture stays seeded. Any other change
+// (size, format, framerate, codec, profile), or an encoder that cannot
+// retune live (libvpx, libsvtav1, libaom; see SupportsLiveBitrate()),
+// needs Open() again.
+class FfmpegVideoEncoder {
 public:
-    FfmpegH264VideoEncoder();
-    ~FfmpegH264VideoEncoder();
+    FfmpegVideoEncoder();
+    ~FfmpegVideoEncoder();
+
+    // Whether an encoder for |codec| opens on this host, probed once.
+    static bool IsAvailable(VideoCodec codec);
 
     bool Open(const VideoEncoderConfig& config, std::string* error);
+    bool Reconfigure(const VideoEncoderConfig& config, std::string* error);
     bool ApplySlice(const VideoSlice& slice, std::string* error);
+    bool WritableInput(VideoPlanes* planes, std::string* error);
+    void CommitInput(const VideoSlice& region);
     bool EncodeFrame(int64_t pts_us, EncodedVideoFrame* output, std::string* error);
     bool HasFullSeed() const;
     std::string SelectedEncoderName() const;
+    // Whether the open encoder takes bitrate changes through Reconfigure().
+    bool SupportsLiveBitrate() const;
     void RequestKeyframe();
     void Close();
 
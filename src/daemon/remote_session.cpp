@@ -2,28 +2,46 @@
 
 #include "daemon/daemon_types.h"
 
+#include <algorithm>
+
 namespace tenbox::daemon {
 
 std::optional<RemoteSession> RemoteSessionRegistry::Create(
     const std::string& vm_id,
     const std::string& owner_user_id,
-    bool force) {
-    if (!force && by_vm_.count(vm_id)) return std::nullopt;
+    bool force,
+    bool view_only) {
+    if (!view_only && !force && by_vm_.count(vm_id)) return std::nullopt;
 
     RemoteSession session;
     session.session_id = GenerateUuid();
     session.vm_id = vm_id;
     session.owner_user_id = owner_user_id;
     session.created_at = UnixNow();
-    by_vm_[vm_id] = session;
+    session.view_only = view_only;
+    if (view_only) {
+        viewers_by_vm_[vm_id].push_back(session);
+    } else {
+        by_vm_[vm_id] = session;
+    }
     return session;
 }
 
 bool RemoteSessionRegistry::Close(const std::string& vm_id, const std::string& session_id) {
     auto it = by_vm_.find(vm_id);
-    if (it == by_vm_.end()) return false;
-    if (it->second.session_id != session_id) return false;
-    by_vm_.erase(it);
+    if (it != by_vm_.end() && it->second.session_id == session_id) {
+        by_vm_.erase(it);
+        return true;
+    }
+    auto viewers = viewers_by_vm_.find(vm_id);
+    if (viewers == viewers_by_vm_.end()) return false;
+    auto& list = viewers->second;
+    auto viewer = std::find_if(list.begin(), list.end(), [&](const RemoteSession& session) {
+        return session.session_id == session_id;
+    });
+    if (viewer == list.end()) return false;
+    list.erase(viewer);
+    if (list.empty()) viewers_by_vm_.erase(viewers);
     return true;
 }
 
@@ -33,12 +51,30 @@ std::optional<RemoteSession> RemoteSessionRegistry::GetByVm(const std::string& v
     return it->second;
 }
 
+std::optional<RemoteSession> RemoteSessionRegistry::Get(const std::string& vm_id,
+                                                        const std::string& session_id) const {
+    for (const auto& session : ListByVm(vm_id)) {
+        if (session.session_id == session_id) return session;
+    }
+    return std::nullopt;
+}
+
+std::vector<RemoteSession> RemoteSessionRegistry::ListByVm(const std::string& vm_id) const {
+    std::vector<RemoteSession> sessions;
+    if (auto it = by_vm_.find(vm_id); it != by_vm_.end()) sessions.push_back(it->second);
+    if (auto it = viewers_by_vm_.find(vm_id); it != viewers_by_vm_.end()) {
+        sessions.insert(sessions.end(), it->second.begin(), it->second.end());
+    }
+    return sessions;
+}
+
 nlohmann::json ToJson(const RemoteSession& session) {
     return {
         {"session_id", session.session_id},
         {"vm_id", session.vm_id},
         {"owner_user_id", session.owner_user_id},
         {"created_at", session.created_at},
+        {"view_only", session.view_only},
     };
 }
 
@@ -4,6 +4,7 @@
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace tenbox::daemon {
 
@@ -12,18 +13,29 @@ struct RemoteSession {
     std::string vm_id;
     std::string owner_user_id;
     int64_t created_at = 0;
+    // Watches the desktop without controlling it: no input, clipboard or
+    // resize, and any number of them can sit alongside the VM's one
+    // controlling session.
+    bool view_only = false;
 };
 
 class RemoteSessionRegistry {
 public:
     std::optional<RemoteSession> Create(const std::string& vm_id,
                                         const std::string& owner_user_id,
-                                        bool force);
+                                        bool force,
+                                        bool view_only = false);
     bool Close(const std::string& vm_id, const std::string& session_id);
+    // The VM's controlling session.
     std::optional<RemoteSession> GetByVm(const std::string& vm_id) const;
+    // Controlling or view-only session by id.
+    std::optional<RemoteSession> Get(const std::string& vm_id, const std::string& session_id) const;
+    // Every session on the VM, controlling one first.
+    std::vector<RemoteSession> ListByVm(const std::string& vm_id) const;
 
 private:
     std::unordered_map<std::string, RemoteSession> by_vm_;
+    std::unordered_map<std::string, std::vector<RemoteSession>> viewers_by_vm_;
 };
 
 nlohmann::json ToJson(const RemoteSession& session);
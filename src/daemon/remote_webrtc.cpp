@@ -1,9 +1,11 @@
 #include "daemon/remote_webrtc.h"
+#include "daemon/congestion_control.h"
 #include "daemon/media_interfaces.h"
 
 #include <rtc/rtc.hpp>
 #include <rtc/plihandler.hpp>
 
+#include <algorithm>
 #include <atomic>
 #include <cctype>
 #include <chrono>
@@ -14,13 +16,16 @@
 #include <cstring>
 #include <deque>
 #include <exception>
+#include <functional>
 #include <inttypes.h>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <pthread.h>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -33,6 +38,39 @@ bool PreferConstrainedBaselineH264() {
     return value && std::string_view(value) == "baseline";
 }
 
+// A software VP9 screen-content encode of a desktop takes about a core;
+// below this many the host keeps them for the VMs and uses H.264.
+constexpr unsigned kScreenCodecMinCores = 8;
+
+// Video codecs, most preferred first; the first one the browser offers and
+// this host can encode is used. TENBOX_WEBRTC_VIDEO_CODECS overrides the
+// order, e.g. "av1,vp9,h264". By default VP9 in screen content mode leads
+// when the CPU budget allows, since text stays sharper per bit than with
+// H.264, which otherwise stays (and may run on the GPU). AV1 and VP8 are
+// opt-in: software AV1 is too slow to default to, VP8 has nothing on VP9.
+const std::vector<VideoCodec>& VideoCodecPreference() {
+    static const std::vector<VideoCodec> preference = []() {
+        std::vector<VideoCodec> out;
+        if (const char* value = std::getenv("TENBOX_WEBRTC_VIDEO_CODECS"); value && value[0] != '\0') {
+            std::string_view rest(value);
+            while (!rest.empty()) {
+                const auto comma = rest.find(',');
+                const std::string_view name = rest.substr(0, comma);
+                rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+                if (name == "h264") out.push_back(VideoCodec::kH264);
+                else if (name == "vp8") out.push_back(VideoCodec::kVp8);
+                else if (name == "vp9") out.push_back(VideoCodec::kVp9);
+                else if (name == "av1") out.push_back(VideoCodec::kAv1);
+            }
+            if (!out.empty()) return out;
+        }
+        if (std::thread::hardware_concurrency() >= kScreenCodecMinCores) out.push_back(VideoCodec::kVp9);
+        out.push_back(VideoCodec::kH264);
+        return out;
+    }();
+    return preference;
+}
+
 // Verbose webrtc logging is off by default to keep the daemon log readable
 // in production. Set TENBOX_WEBRTC_VERBOSE=1 (or build with _DEBUG) to get
 // every SDP payload negotiation, data channel attach/close, peer state
@@ -51,6 +89,12 @@ bool VerboseWebRtcLogging() {
 #endif
 }
 
+// Clock shared by the congestion controller and everything feeding it.
+int64_t SteadyNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 // Like fprintf(stdout, ...) but no-op unless VerboseWebRtcLogging() is on.
 // Use for events that fire on every session attach / SDP negotiation or
 // faster (PLI, data channel lifecycle); the production user does not care
@@ -276,6 +320,84 @@ std::string StripLipSyncGroups(std::string sdp) {
     return filtered;
 }
 
+const char* VideoCodecLogName(VideoCodec codec) {
+    switch (codec) {
+    case VideoCodec::kVp8:
+        return "vp8";
+    case VideoCodec::kVp9:
+        return "vp9";
+    case VideoCodec::kAv1:
+        return "av1";
+    case VideoCodec::kH264:
+    default:
+        return "h264";
+    }
+}
+
+const char* H264ProfileLogName(H264Profile profile) {
+    switch (profile) {
+    case H264Profile::kHigh:
+        return "high";
+    case H264Profile::kMain:
+        return "main";
+    case H264Profile::kConstrainedBaseline:
+    default:
+        return "constrained-baseline";
+    }
+}
+
+const char* PixelFormatLogName(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::kYuv444p:
+        return "yuv444p";
+    case PixelFormat::kYuv420p:
+        return "yuv420p";
+    case PixelFormat::kRgba:
+        return "rgba";
+    case PixelFormat::kBgra:
+        return "bgra";
+    default:
+        return "unknown";
+    }
+}
+
+size_t ChromaPlaneHeight(PixelFormat format, uint32_t height) {
+    return format == PixelFormat::kYuv444p
+        ? static_cast<size_t>(height)
+        : static_cast<size_t>((height + 1) / 2);
+}
+
+// The codec is fixed at negotiation but the VM's pixel format is not
+// (remote_session.configure). Only H.264 has a 4:4:4 profile a peer can
+// agree to; VP8, VP9 and AV1 are negotiated at profile 0, so those streams
+// stay on 4:2:0 and subsample 4:4:4 slices themselves.
+PixelFormat EncoderInputFormat(VideoCodec codec, PixelFormat source_format) {
+    return codec == VideoCodec::kH264 ? source_format : PixelFormat::kYuv420p;
+}
+
+// 2x2 box filter from a full-resolution chroma plane to a half-resolution
+// one. An odd last row or column is averaged with itself.
+void SubsampleChroma(const uint8_t* src, int src_stride, uint32_t width, uint32_t height,
+                     uint8_t* dst, uint32_t dst_stride) {
+    for (uint32_t y = 0; y < (height + 1) / 2; ++y) {
+        const uint8_t* row0 = src + static_cast<size_t>(2 * y) * src_stride;
+        const uint8_t* row1 = 2 * y + 1 < height ? row0 + src_stride : row0;
+        uint8_t* out = dst + static_cast<size_t>(y) * dst_stride;
+        for (uint32_t x = 0; x < (width + 1) / 2; ++x) {
+            const uint32_t x0 = 2 * x;
+            const uint32_t x1 = std::min(x0 + 1, width - 1);
+            out[x] = static_cast<uint8_t>((row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) / 4);
+        }
+    }
+}
+
+bool IsFullFrame(const RemoteVideoFrame& frame) {
+    if (frame.slices.size() != 1) return false;
+    const auto& slice = frame.slices.front();
+    return slice.x == 0 && slice.y == 0 &&
+           slice.width == frame.width && slice.height == frame.height;
+}
+
 }  // namespace
 
 // Wire libdatachannel's internal logger into our stdout the first time
@@ -315,12 +437,561 @@ void EnsureLibDatachannelLoggerInstalled() {
     });
 }
 
+// Where one peer's share of a VideoFanout goes. Both run on the fan-out
+// thread: `ready` returning false holds the peer's stream back while its
+// transport is still draining, `deliver` sends one encoded frame.
+struct VideoSink {
+    std::function<bool()> ready;
+    std::function<void(const EncodedVideoFrame&)> deliver;
+};
+
+// The video pump of one source (VM), shared by every peer watching it so
+// encoding costs the same for one viewer or several.
+//
+// Each tick drains the source once and feeds one encoder per stream -- a
+// (codec and H.264 profile, bitrate tier) pair -- whose output goes to
+// every peer on that stream. Resolution and pixel format come from the
+// source, so all streams share them. A stream encodes at the lowest
+// bitrate any of its peers asked for, and keyframe requests from its peers
+// (PLIs, a peer joining) collapse into one keyframe on its next encode.
+class VideoFanout {
+public:
+    // Shared per |source_id|; an empty id gets a private fan-out.
+    static std::shared_ptr<VideoFanout> ForSource(const std::string& source_id,
+                                                  RemoteFrameReader frame_reader);
+
+    explicit VideoFanout(RemoteFrameReader frame_reader)
+        : frame_reader_(std::move(frame_reader)),
+          thread_([this]() { PumpMain(); }) {}
+
+    ~VideoFanout() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    VideoFanout(const VideoFanout&) = delete;
+    VideoFanout& operator=(const VideoFanout&) = delete;
+
+    // |profile| only matters for H.264.
+    uint64_t Subscribe(VideoCodec codec, H264Profile profile, uint32_t bitrate_bps, VideoSink sink) {
+        std::lock_guard<std::mutex> lock(mu_);
+        const uint64_t id = next_id_++;
+        if (codec != VideoCodec::kH264) profile = H264Profile::kConstrainedBaseline;
+        AddSubscriberLocked(codec, profile, Subscriber{
+            id, bitrate_bps, std::make_shared<VideoSink>(std::move(sink))});
+        cv_.notify_all();
+        return id;
+    }
+
+    void Unsubscribe(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (auto& stream : streams_) {
+            std::erase_if(stream->subscribers, [id](const Subscriber& subscriber) {
+                return subscriber.id == id;
+            });
+        }
+    }
+
+    // Moves the subscriber to another stream if |bitrate_bps| falls in a
+    // different tier. A subscriber alone on its stream takes the stream
+    // along instead, so its encoder is only retuned.
+    void SetBitrate(uint64_t id, uint32_t bitrate_bps) {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (auto& stream : streams_) {
+            auto it = std::find_if(stream->subscribers.begin(), stream->subscribers.end(),
+                                   [id](const Subscriber& subscriber) { return subscriber.id == id; });
+            if (it == stream->subscribers.end()) continue;
+            it->bitrate_bps = bitrate_bps;
+            const uint32_t tier = BitrateTier(bitrate_bps);
+            if (tier == stream->tier) return;
+            const bool tier_taken = std::any_of(streams_.begin(), streams_.end(), [&](const auto& other) {
+                return other->codec == stream->codec && other->profile == stream->profile &&
+                       other->tier == tier;
+            });
+            if (stream->subscribers.size() == 1 && !tier_taken) {
+                stream->tier = tier;
+                return;
+            }
+            Subscriber moved = std::move(*it);
+            stream->subscribers.erase(it);
+            const VideoCodec codec = stream->codec;
+            const H264Profile profile = stream->profile;
+            AddSubscriberLocked(codec, profile, std::move(moved));
+            return;
+        }
+    }
+
+    void RequestKeyframe(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (auto& stream : streams_) {
+            for (const auto& subscriber : stream->subscribers) {
+                if (subscriber.id != id) continue;
+                ++stream->keyframe_requests;
+                return;
+            }
+        }
+    }
+
+private:
+    struct Subscriber {
+        uint64_t id = 0;
+        uint32_t bitrate_bps = 0;
+        std::shared_ptr<VideoSink> sink;
+    };
+
+    struct Stream {
+        VideoCodec codec = VideoCodec::kH264;
+        H264Profile profile = H264Profile::kConstrainedBaseline;
+        uint32_t tier = 0;
+        // Guarded by mu_.
+        std::vector<Subscriber> subscribers;
+        uint32_t keyframe_requests = 0;
+        // Fan-out thread only.
+        FfmpegVideoEncoder encoder;
+        VideoEncoderConfig config;
+        bool encoder_open = false;
+        // The encoder's persistent input buffer is empty after Open(); the
+        // next drain must request a full-frame slice from the producer to
+        // seed it.
+        bool needs_full_seed = true;
+        std::chrono::steady_clock::time_point retry_open_at;
+        std::chrono::steady_clock::time_point opened_at;
+        // 4:2:0 chroma of the current slice when the VM sends 4:4:4 to a
+        // 4:2:0-only codec (see EncoderInputFormat).
+        std::vector<uint8_t> chroma_scratch;
+        // Track what we last logged for the "encoder opened" line so that
+        // pure bitrate adjustments (which retrigger encoder.Open() but are
+        // not interesting on a per-event basis) do not spam the log; a real
+        // INFO line only fires when the resolution / pixel format / encoder
+        // backend / codec / H.264 profile actually changes.
+        uint32_t last_logged_width = 0;
+        uint32_t last_logged_height = 0;
+        PixelFormat last_logged_input_format = PixelFormat::kYuv420p;
+        VideoCodec last_logged_codec = VideoCodec::kH264;
+        H264Profile last_logged_profile = H264Profile::kConstrainedBaseline;
+        std::string last_logged_encoder_name;
+    };
+
+    // One stream's share of a tick, snapshotted under mu_.
+    struct StreamTick {
+        Stream* stream = nullptr;
+        uint32_t bitrate_bps = 0;
+        uint32_t keyframe_requests = 0;
+        std::vector<std::shared_ptr<VideoSink>> sinks;
+    };
+
+    // Encoders that cannot retune live pay a keyframe and a full reseed
+    // for every bitrate change, so they follow the target only when it
+    // leaves a band around the open bitrate, and not more often than this.
+    // In between, the peers' pacers hold the rate by dropping frames.
+    static constexpr double kReopenBitrateRatio = 1.5;
+    static constexpr std::chrono::seconds kMinBitrateReopenInterval{5};
+
+    static bool WorthReopeningForBitrate(const Stream& stream, uint32_t bitrate_bps) {
+        const double ratio = static_cast<double>(bitrate_bps) / stream.config.bitrate_bps;
+        return (ratio > kReopenBitrateRatio || ratio < 1 / kReopenBitrateRatio) &&
+               std::chrono::steady_clock::now() - stream.opened_at >= kMinBitrateReopenInterval;
+    }
+
+    // Peers within a factor of two of each other share a stream.
+    static uint32_t BitrateTier(uint32_t bitrate_bps) {
+        uint32_t tier = 0;
+        for (uint64_t ceiling = 1'000'000; bitrate_bps >= ceiling; ceiling *= 2) ++tier;
+        return tier;
+    }
+
+    void AddSubscriberLocked(VideoCodec codec, H264Profile profile, Subscriber subscriber) {
+        const uint32_t tier = BitrateTier(subscriber.bitrate_bps);
+        auto it = std::find_if(streams_.begin(), streams_.end(), [&](const auto& stream) {
+            return stream->codec == codec && stream->profile == profile && stream->tier == tier;
+        });
+        if (it == streams_.end()) {
+            auto stream = std::make_unique<Stream>();
+            stream->codec = codec;
+            stream->profile = profile;
+            stream->tier = tier;
+            it = streams_.insert(streams_.end(), std::move(stream));
+        }
+        // A newcomer cannot start decoding mid-GOP.
+        ++(*it)->keyframe_requests;
+        (*it)->subscribers.push_back(std::move(subscriber));
+    }
+
+    void PumpMain();
+    bool EncodeStream(const StreamTick& tick,
+                      const RemoteVideoFrame& frame,
+                      bool got_slices,
+                      int64_t pts_us,
+                      std::chrono::milliseconds* backoff);
+    bool OpenEncoder(Stream& stream, const RemoteVideoFrame& frame, uint32_t bitrate_bps);
+    bool ApplyFrame(Stream& stream, const RemoteVideoFrame& frame);
+
+    RemoteFrameReader frame_reader_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    // Only the fan-out thread removes streams, so it can use them unlocked
+    // for the length of a tick.
+    std::vector<std::unique_ptr<Stream>> streams_;
+    uint64_t next_id_ = 1;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+std::shared_ptr<VideoFanout> VideoFanout::ForSource(const std::string& source_id,
+                                                    RemoteFrameReader frame_reader) {
+    if (source_id.empty()) return std::make_shared<VideoFanout>(std::move(frame_reader));
+    static std::mutex mu;
+    static std::unordered_map<std::string, std::weak_ptr<VideoFanout>> by_source;
+    std::lock_guard<std::mutex> lock(mu);
+    std::erase_if(by_source, [](const auto& entry) { return entry.second.expired(); });
+    auto& slot = by_source[source_id];
+    if (auto fanout = slot.lock()) return fanout;
+    auto fanout = std::make_shared<VideoFanout>(std::move(frame_reader));
+    slot = fanout;
+    return fanout;
+}
+
+void VideoFanout::PumpMain() {
+    pthread_setname_np(pthread_self(), "webrtc-video");
+    bool waiting_logged = false;
+    const auto start = std::chrono::steady_clock::now();
+    const auto base_frame_interval = std::chrono::microseconds(16'667);
+    const auto idle_frame_interval = std::chrono::milliseconds(500);
+    const auto recovery_grace_period = std::chrono::milliseconds(2000);
+    std::optional<std::chrono::steady_clock::time_point> last_slice_time;
+    // Fixed upper frame-rate cap. Below it, each peer's congestion
+    // controller thins frames through its sink's ready().
+    auto next_encode_time = start;
+    RemoteVideoFrame remote_frame;
+    std::vector<StreamTick> ticks;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            // Streams whose last peer left are dropped here, on the only
+            // thread that touches their encoders.
+            std::erase_if(streams_, [](const auto& stream) { return stream->subscribers.empty(); });
+            cv_.wait(lock, [this] { return stopping_ || !streams_.empty(); });
+            if (stopping_) return;
+        }
+
+        const auto pacing_now = std::chrono::steady_clock::now();
+        if (pacing_now < next_encode_time) std::this_thread::sleep_until(next_encode_time);
+
+        ticks.clear();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (stopping_) return;
+            for (const auto& stream : streams_) {
+                if (stream->subscribers.empty()) continue;
+                StreamTick tick;
+                tick.stream = stream.get();
+                tick.bitrate_bps = stream->subscribers.front().bitrate_bps;
+                tick.keyframe_requests = stream->keyframe_requests;
+                for (const auto& subscriber : stream->subscribers) {
+                    tick.bitrate_bps = std::min(tick.bitrate_bps, subscriber.bitrate_bps);
+                    tick.sinks.push_back(subscriber.sink);
+                }
+                ticks.push_back(std::move(tick));
+            }
+        }
+        if (ticks.empty()) continue;
+
+        // After motion stops, keep re-encoding the settled frame briefly so
+        // low-bitrate streams can recover detail before falling to idle.
+        const auto read_now = std::chrono::steady_clock::now();
+        const bool in_recovery_window =
+            last_slice_time.has_value() &&
+            read_now - *last_slice_time < recovery_grace_period;
+        const auto frame_wait_timeout =
+            in_recovery_window ? std::chrono::milliseconds(0) : idle_frame_interval;
+
+        // Block on the producer's CV until new slices arrive (or timeout).
+        // This replaces the old sleep-then-poll pattern so a fresh slice
+        // wakes the encoder thread immediately, while the recovery window
+        // avoids dropping straight to 2fps after recent motion.
+        // remote_frame lives across iterations so the reader can reuse
+        // its slice buffers. A lone open encoder also lends its input
+        // picture so the damage is converted straight into it; with several
+        // streams every encoder needs its own copy, so they take slices.
+        remote_frame.target = VideoPlanes{};
+        Stream& lone = *ticks.front().stream;
+        if (ticks.size() == 1 && lone.encoder_open) {
+            std::string input_error;
+            if (lone.encoder.WritableInput(&remote_frame.target, &input_error)) {
+                remote_frame.target_format = lone.config.input_format;
+            } else {
+                remote_frame.target = VideoPlanes{};
+            }
+        }
+        const bool need_full_frame = std::any_of(ticks.begin(), ticks.end(), [](const StreamTick& tick) {
+            return tick.stream->needs_full_seed;
+        });
+        const bool got_slices = frame_reader_ &&
+            frame_reader_(&remote_frame, need_full_frame, frame_wait_timeout) &&
+            !remote_frame.slices.empty();
+        if (got_slices) {
+            last_slice_time = std::chrono::steady_clock::now();
+        }
+
+        // Without a seeded encoder we cannot produce a heartbeat frame;
+        // wait for the producer to deliver the first full-frame slice.
+        const bool any_seeded = std::any_of(ticks.begin(), ticks.end(), [](const StreamTick& tick) {
+            return tick.stream->encoder_open && tick.stream->encoder.HasFullSeed();
+        });
+        if (!got_slices && !any_seeded) {
+            if (!waiting_logged) {
+                // First-time-only when we cannot start because the
+                // producer hasn't pushed any framebuffer yet. After the
+                // session goes live this should not recur, so leaving
+                // it at INFO is safe.
+                std::fprintf(stdout, "[INFO]  remote_webrtc: waiting for framebuffer\n");
+                std::fflush(stdout);
+                waiting_logged = true;
+            }
+            continue;
+        }
+        waiting_logged = false;
+
+        const auto now = std::chrono::steady_clock::now();
+        const auto pts_us = std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+        bool sent = false;
+        std::chrono::milliseconds backoff{0};
+        for (const auto& tick : ticks) {
+            std::chrono::milliseconds stream_backoff{0};
+            if (EncodeStream(tick, remote_frame, got_slices, pts_us, &stream_backoff)) {
+                sent = true;
+            } else {
+                backoff = std::max(backoff, stream_backoff);
+            }
+        }
+        if (sent) {
+            next_encode_time = now + base_frame_interval;
+        } else if (backoff.count() > 0) {
+            std::this_thread::sleep_for(backoff);
+        }
+    }
+}
+
+bool VideoFanout::EncodeStream(const StreamTick& tick,
+                               const RemoteVideoFrame& frame,
+                               bool got_slices,
+                               int64_t pts_us,
+                               std::chrono::milliseconds* backoff) {
+    Stream& stream = *tick.stream;
+    // Bitrate moves are applied to the live encoder, so bandwidth
+    // adaptation costs neither a keyframe nor a reseed. If that is not
+    // possible the mismatch below falls back to a reopen -- for encoders
+    // that never retune live, only on a large move (see
+    // WorthReopeningForBitrate).
+    uint32_t bitrate_bps = tick.bitrate_bps;
+    if (stream.encoder_open && stream.config.bitrate_bps != bitrate_bps &&
+        !stream.encoder.SupportsLiveBitrate()) {
+        if (!WorthReopeningForBitrate(stream, bitrate_bps)) bitrate_bps = stream.config.bitrate_bps;
+    } else if (stream.encoder_open && stream.config.bitrate_bps != bitrate_bps) {
+        VideoEncoderConfig retuned = stream.config;
+        retuned.bitrate_bps = bitrate_bps;
+        std::string error;
+        if (stream.encoder.Reconfigure(retuned, &error)) {
+            stream.config = retuned;
+            VerboseLog("[INFO]  remote_webrtc: encoder retuned bitrate=%u\n", retuned.bitrate_bps);
+        } else {
+            VerboseLog("[INFO]  remote_webrtc: encoder retune failed: %s\n", error.c_str());
+        }
+    }
+    if (got_slices) {
+        const auto& config = stream.config;
+        if (!stream.encoder_open ||
+            config.width != frame.width ||
+            config.height != frame.height ||
+            config.bitrate_bps != bitrate_bps ||
+            config.input_format != EncoderInputFormat(stream.codec, frame.format)) {
+            if (!OpenEncoder(stream, frame, tick.bitrate_bps)) {
+                if (!stream.encoder_open) *backoff = std::chrono::milliseconds(10);
+                return false;
+            }
+        }
+        if (!ApplyFrame(stream, frame)) return false;
+    } else if (!stream.encoder_open || !stream.encoder.HasFullSeed()) {
+        return false;
+    }
+
+    // The slowest peer paces the stream. Its input picture is already up
+    // to date, so a skipped encode loses nothing.
+    for (const auto& sink : tick.sinks) {
+        if (sink->ready && !sink->ready()) {
+            *backoff = std::chrono::milliseconds(10);
+            return false;
+        }
+    }
+
+    if (tick.keyframe_requests > 0) {
+        stream.encoder.RequestKeyframe();
+        if (tick.keyframe_requests > 1) {
+            VerboseLog("[INFO]  remote_webrtc: %u keyframe requests coalesced\n",
+                       tick.keyframe_requests);
+        }
+    }
+    EncodedVideoFrame encoded;
+    std::string error;
+    if (!stream.encoder.EncodeFrame(pts_us, &encoded, &error) || encoded.data.empty()) {
+        if (!error.empty()) {
+            std::fprintf(stdout, "[WARN]  remote_webrtc: encode failed: %s\n", error.c_str());
+            std::fflush(stdout);
+        }
+        *backoff = std::chrono::milliseconds(10);
+        return false;
+    }
+    if (tick.keyframe_requests > 0) {
+        std::lock_guard<std::mutex> lock(mu_);
+        stream.keyframe_requests -= std::min(stream.keyframe_requests, tick.keyframe_requests);
+    }
+    for (const auto& sink : tick.sinks) {
+        if (sink->deliver) sink->deliver(encoded);
+    }
+    return true;
+}
+
+bool VideoFanout::OpenEncoder(Stream& stream, const RemoteVideoFrame& frame, uint32_t bitrate_bps) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now < stream.retry_open_at) return false;
+    auto& config = stream.config;
+    config.width = frame.width;
+    config.height = frame.height;
+    config.input_format = EncoderInputFormat(stream.codec, frame.format);
+    config.codec = stream.codec;
+    config.framerate = 60;
+    config.bitrate_bps = bitrate_bps;
+    config.h264_profile = stream.profile;
+    std::string error;
+    stream.encoder_open = stream.encoder.Open(config, &error);
+    if (!stream.encoder_open) {
+        std::fprintf(stdout, "[WARN]  remote_webrtc: encoder open failed: %s\n", error.c_str());
+        std::fflush(stdout);
+        stream.retry_open_at = now + std::chrono::seconds(1);
+        return false;
+    }
+    stream.opened_at = now;
+    const std::string encoder_name = stream.encoder.SelectedEncoderName();
+    // Promote the "encoder opened" line to INFO only when one of the
+    // user-visible knobs (resolution / pixel format / backend / codec /
+    // H.264 profile) actually changed since the last print. Bitrate changes
+    // normally go through Reconfigure(); a reopen that only moved the
+    // bitrate is interesting at debug level, but logging it at INFO would
+    // flood the journal whenever the bandwidth controller adapts.
+    const bool material_change =
+        frame.width != stream.last_logged_width ||
+        frame.height != stream.last_logged_height ||
+        config.input_format != stream.last_logged_input_format ||
+        config.codec != stream.last_logged_codec ||
+        config.h264_profile != stream.last_logged_profile ||
+        encoder_name != stream.last_logged_encoder_name;
+    // The newly opened encoder has zeroed input planes; the slices we just
+    // drained may be partial (or were converted into the previous encoder's
+    // picture), so request a full-frame reseed on the next tick before
+    // encoding.
+    const bool awaiting_seed = !stream.encoder.HasFullSeed() &&
+        (frame.converted_in_place || !IsFullFrame(frame));
+    if (material_change) {
+        std::fprintf(stdout,
+                     "[INFO]  remote_webrtc: encoder opened %ux%u bitrate=%u codec=%s profile=%s format=%s encoder=%s%s\n",
+                     frame.width,
+                     frame.height,
+                     config.bitrate_bps,
+                     VideoCodecLogName(config.codec),
+                     config.codec == VideoCodec::kH264 ? H264ProfileLogName(config.h264_profile) : "-",
+                     PixelFormatLogName(config.input_format),
+                     encoder_name.c_str(),
+                     awaiting_seed ? " (awaiting full seed)" : "");
+        std::fflush(stdout);
+    } else {
+        VerboseLog("[INFO]  remote_webrtc: encoder reconfigured bitrate=%u%s\n",
+                   config.bitrate_bps,
+                   awaiting_seed ? " (awaiting full seed)" : "");
+    }
+    stream.last_logged_width = frame.width;
+    stream.last_logged_height = frame.height;
+    stream.last_logged_input_format = config.input_format;
+    stream.last_logged_codec = config.codec;
+    stream.last_logged_profile = config.h264_profile;
+    stream.last_logged_encoder_name = encoder_name;
+    if (awaiting_seed) {
+        stream.needs_full_seed = true;
+        return false;
+    }
+    return true;
+}
+
+bool VideoFanout::ApplyFrame(Stream& stream, const RemoteVideoFrame& frame) {
+    // Apply every accumulated YUV slice to the encoder's persistent input
+    // frame, mirroring sweet's DrawSlices step. When no slices arrived this
+    // round we leave the persistent input untouched and re-encode it as a
+    // heartbeat (faster during recovery, then 2fps idle).
+    std::string apply_error;
+    for (const auto& s : frame.slices) {
+        VideoSlice vs;
+        vs.x = s.x;
+        vs.y = s.y;
+        vs.width = s.width;
+        vs.height = s.height;
+        if (frame.converted_in_place) {
+            // Already in the input picture; only track the seed.
+            stream.encoder.CommitInput(vs);
+            continue;
+        }
+        const size_t y_size = static_cast<size_t>(s.strides[0]) * s.height;
+        const size_t uv_h = ChromaPlaneHeight(frame.format, s.height);
+        const size_t uv_size = static_cast<size_t>(s.strides[1]) * uv_h;
+        vs.planes[0] = s.data.data();
+        vs.planes[1] = s.data.data() + y_size;
+        vs.planes[2] = s.data.data() + y_size + uv_size;
+        vs.strides[0] = s.strides[0];
+        vs.strides[1] = s.strides[1];
+        vs.strides[2] = s.strides[2];
+        if (frame.format == PixelFormat::kYuv444p &&
+            stream.config.input_format == PixelFormat::kYuv420p) {
+            const uint32_t sub_w = (s.width + 1) / 2;
+            const size_t sub_size = static_cast<size_t>(sub_w) * ((s.height + 1) / 2);
+            stream.chroma_scratch.resize(sub_size * 2);
+            uint8_t* sub_u = stream.chroma_scratch.data();
+            uint8_t* sub_v = sub_u + sub_size;
+            SubsampleChroma(vs.planes[1], s.strides[1], s.width, s.height, sub_u, sub_w);
+            SubsampleChroma(vs.planes[2], s.strides[2], s.width, s.height, sub_v, sub_w);
+            vs.planes[1] = sub_u;
+            vs.planes[2] = sub_v;
+            vs.strides[1] = static_cast<int>(sub_w);
+            vs.strides[2] = static_cast<int>(sub_w);
+        }
+        if (!stream.encoder.ApplySlice(vs, &apply_error)) {
+            std::fprintf(stdout, "[WARN]  remote_webrtc: apply slice failed: %s\n", apply_error.c_str());
+            std::fflush(stdout);
+            stream.needs_full_seed = true;
+            return false;
+        }
+    }
+    if (!stream.encoder.HasFullSeed()) {
+        // Slices applied but the encoder still lacks a full reference; ask
+        // for a reseed and retry next round.
+        stream.needs_full_seed = true;
+        return false;
+    }
+    stream.needs_full_seed = false;
+    return true;
+}
+
 class NativeWebRtcPeer final
     : public WebRtcPeer,
       public std::enable_shared_from_this<NativeWebRtcPeer> {
 public:
-    explicit NativeWebRtcPeer(RemoteFrameReader frame_reader, PixelFormat preferred_video_format)
+    NativeWebRtcPeer(RemoteFrameReader frame_reader,
+                     PixelFormat preferred_video_format,
+                     std::string video_source_id)
         : frame_reader_(std::move(frame_reader)),
+          video_source_id_(std::move(video_source_id)),
           preferred_video_format_(preferred_video_format) {
         EnsureLibDatachannelLoggerInstalled();
         rtc::Configuration config;
@@ -579,12 +1250,13 @@ public:
 
     void SetVideoBitrate(uint32_t bitrate_bps) override {
         bitrate_bps = std::max<uint32_t>(500'000, std::min<uint32_t>(20'000'000, bitrate_bps));
-        video_bitrate_bps_ = bitrate_bps;
-        force_keyframe_requested_ = true;
+        // An upper bound; the congestion controller picks the rate below it.
+        congestion_->SetMaxBitrate(bitrate_bps);
+        ApplyVideoBitrate(true);
         // Bitrate is set at the start of every session and on every client
         // resize; the value also shows up in the next "encoder opened" line
         // (if encoding actually reconfigures), so default to verbose.
-        VerboseLog("[INFO]  remote_webrtc: video bitrate target=%u bps\n", bitrate_bps);
+        VerboseLog("[INFO]  remote_webrtc: video bitrate cap=%u bps\n", bitrate_bps);
     }
 
     void SetDataChannelHandler(DataChannelMessageHandler handler) override {
@@ -793,6 +1465,52 @@ private:
     }
 
 private:
+    // Appends one RFC 8285 element to the packet's header extension block,
+    // creating the block if needed.
+    static void AddRtpHeaderExtension(rtc::Message& message,
+                                      uint8_t extension_id,
+                                      const uint8_t* value,
+                                      size_t value_size) {
+        if (extension_id == 0 || !value || value_size == 0 || value_size > 255) return;
+        auto* header = reinterpret_cast<rtc::RtpHeader*>(message.data());
+        const size_t rtp_header_size = header->getSize();
+        const bool has_extension = header->extension();
+        const size_t old_extension_size = header->getExtensionHeaderSize();
+        const bool use_two_byte = has_extension &&
+            header->getExtensionHeader() &&
+            header->getExtensionHeader()->profileSpecificId() == 0x1000;
+        if (!use_two_byte && extension_id > 14) return;
+
+        const size_t old_body_size = old_extension_size >= sizeof(rtc::RtpExtensionHeader)
+            ? old_extension_size - sizeof(rtc::RtpExtensionHeader)
+            : 0;
+        const size_t element_size = use_two_byte ? (2 + value_size) : (1 + value_size);
+        const size_t new_body_size = (old_body_size + element_size + 3) & ~size_t{3};
+        const size_t new_extension_size = sizeof(rtc::RtpExtensionHeader) + new_body_size;
+        const size_t insert_at = rtp_header_size + old_extension_size;
+        const size_t insert_size = has_extension
+            ? new_extension_size - old_extension_size
+            : new_extension_size;
+        message.insert(message.begin() + static_cast<std::ptrdiff_t>(insert_at), insert_size, std::byte{0});
+
+        header = reinterpret_cast<rtc::RtpHeader*>(message.data());
+        header->setExtension(true);
+        auto* extension = header->getExtensionHeader();
+        extension->setProfileSpecificId(use_two_byte ? 0x1000 : 0xbede);
+        extension->setHeaderLength(static_cast<uint16_t>(new_body_size / 4));
+        auto* body = reinterpret_cast<uint8_t*>(extension->getBody());
+        if (!has_extension) std::memset(body, 0, new_body_size);
+        if (use_two_byte) {
+            body[old_body_size] = extension_id;
+            body[old_body_size + 1] = static_cast<uint8_t>(value_size);
+            std::memcpy(body + old_body_size + 2, value, value_size);
+        } else {
+            if (value_size > 16) return;
+            body[old_body_size] = static_cast<uint8_t>((extension_id << 4) | (value_size - 1));
+            std::memcpy(body + old_body_size + 1, value, value_size);
+        }
+    }
+
     class VideoMetadataExtensionHandler final : public rtc::MediaHandler {
     public:
         VideoMetadataExtensionHandler(uint8_t color_space_id,
@@ -839,69 +1557,171 @@ private:
         }
 
     private:
-        static void AddRtpHeaderExtension(rtc::Message& message,
-                                          uint8_t extension_id,
-                                          const uint8_t* value,
-                                          size_t value_size) {
-            if (extension_id == 0 || !value || value_size == 0 || value_size > 255) return;
-            auto* header = reinterpret_cast<rtc::RtpHeader*>(message.data());
-            const size_t rtp_header_size = header->getSize();
-            const bool has_extension = header->extension();
-            const size_t old_extension_size = header->getExtensionHeaderSize();
-            const bool use_two_byte = has_extension &&
-                header->getExtensionHeader() &&
-                header->getExtensionHeader()->profileSpecificId() == 0x1000;
-            if (!use_two_byte && extension_id > 14) return;
-
-            const size_t old_body_size = old_extension_size >= sizeof(rtc::RtpExtensionHeader)
-                ? old_extension_size - sizeof(rtc::RtpExtensionHeader)
-                : 0;
-            const size_t element_size = use_two_byte ? (2 + value_size) : (1 + value_size);
-            const size_t new_body_size = (old_body_size + element_size + 3) & ~size_t{3};
-            const size_t new_extension_size = sizeof(rtc::RtpExtensionHeader) + new_body_size;
-            const size_t insert_at = rtp_header_size + old_extension_size;
-            const size_t insert_size = has_extension
-                ? new_extension_size - old_extension_size
-                : new_extension_size;
-            message.insert(message.begin() + static_cast<std::ptrdiff_t>(insert_at), insert_size, std::byte{0});
-
-            header = reinterpret_cast<rtc::RtpHeader*>(message.data());
-            header->setExtension(true);
-            auto* extension = header->getExtensionHeader();
-            extension->setProfileSpecificId(use_two_byte ? 0x1000 : 0xbede);
-            extension->setHeaderLength(static_cast<uint16_t>(new_body_size / 4));
-            auto* body = reinterpret_cast<uint8_t*>(extension->getBody());
-            if (!has_extension) std::memset(body, 0, new_body_size);
-            if (use_two_byte) {
-                body[old_body_size] = extension_id;
-                body[old_body_size + 1] = static_cast<uint8_t>(value_size);
-                std::memcpy(body + old_body_size + 2, value, value_size);
-            } else {
-                if (value_size > 16) return;
-                body[old_body_size] = static_cast<uint8_t>((extension_id << 4) | (value_size - 1));
-                std::memcpy(body + old_body_size + 1, value, value_size);
+        uint8_t color_space_id_ = 0;
+        uint8_t playout_delay_id_ = 0;
+    };
+
+    // Stamps every outgoing video packet with a transport-wide sequence
+    // number and hands the RTCP the browser sends back (receiver reports,
+    // transport-cc feedback) to the peer's congestion controller.
+    // |on_feedback| runs on the libdatachannel thread after each RTCP
+    // packet that carried any.
+    class CongestionControlHandler final : public rtc::MediaHandler {
+    public:
+        CongestionControlHandler(uint8_t transport_cc_id,
+                                 std::shared_ptr<SendSideCongestionController> controller,
+                                 std::function<void()> on_feedback)
+            : transport_cc_id_(transport_cc_id),
+              controller_(std::move(controller)),
+              on_feedback_(std::move(on_feedback)) {}
+
+        void outgoing(rtc::message_vector& messages, const rtc::message_callback& /*send*/) override {
+            if (transport_cc_id_ == 0) return;
+            const int64_t now_us = SteadyNowUs();
+            for (auto& message : messages) {
+                if (!message || message->type != rtc::Message::Binary || message->size() < sizeof(rtc::RtpHeader)) {
+                    continue;
+                }
+                const uint16_t seq = next_seq_++;
+                const uint8_t value[] = {static_cast<uint8_t>(seq >> 8), static_cast<uint8_t>(seq)};
+                AddRtpHeaderExtension(*message, transport_cc_id_, value, sizeof(value));
+                controller_->OnPacketSent(seq, message->size(), now_us);
             }
         }
 
-        uint8_t color_space_id_ = 0;
-        uint8_t playout_delay_id_ = 0;
+        void incoming(rtc::message_vector& messages, const rtc::message_callback& /*send*/) override {
+            for (const auto& message : messages) {
+                if (!message || message->type != rtc::Message::Control) continue;
+                reports_.clear();
+                feedback_.clear();
+                ParseRtcpFeedback({reinterpret_cast<const uint8_t*>(message->data()), message->size()},
+                                  kVideoSsrc, &reports_, &feedback_);
+                if (reports_.empty() && feedback_.empty()) continue;
+                const int64_t now_us = SteadyNowUs();
+                for (const auto& report : reports_) controller_->OnReceiverReport(report, now_us);
+                for (const auto& feedback : feedback_) controller_->OnTransportFeedback(feedback, now_us);
+                if (on_feedback_) on_feedback_();
+            }
+        }
+
+    private:
+        uint8_t transport_cc_id_ = 0;
+        uint16_t next_seq_ = 0;
+        std::shared_ptr<SendSideCongestionController> controller_;
+        std::function<void()> on_feedback_;
+        std::vector<RtcpReportBlock> reports_;
+        std::vector<TransportFeedback> feedback_;
     };
 
+    // Splits one frame into RTP payloads of at most kMaxVideoFragmentBytes,
+    // each behind a |descriptor_size|-byte payload descriptor that
+    // |fill_descriptor| writes for the first / last fragment.
+    static std::vector<rtc::binary> FragmentWithDescriptor(
+        const rtc::binary& frame,
+        size_t descriptor_size,
+        const std::function<void(std::byte* descriptor, bool first, bool last)>& fill_descriptor) {
+        std::vector<rtc::binary> fragments;
+        const size_t chunk = kMaxVideoFragmentBytes - descriptor_size;
+        for (size_t offset = 0; offset < frame.size(); offset += chunk) {
+            const size_t size = std::min(chunk, frame.size() - offset);
+            rtc::binary fragment(descriptor_size + size);
+            fill_descriptor(fragment.data(), offset == 0, offset + size == frame.size());
+            std::memcpy(fragment.data() + descriptor_size, frame.data() + offset, size);
+            fragments.push_back(std::move(fragment));
+        }
+        return fragments;
+    }
+
+    // RFC 7741 payload descriptor with a 15-bit picture ID.
+    class Vp8RtpPacketizer final : public rtc::RtpPacketizer {
+    public:
+        using rtc::RtpPacketizer::RtpPacketizer;
+
+    protected:
+        std::vector<rtc::binary> fragment(rtc::binary frame) override {
+            const uint16_t picture_id = next_picture_id_++ & 0x7fff;
+            return FragmentWithDescriptor(frame, 4, [&](std::byte* d, bool first, bool /*last*/) {
+                d[0] = std::byte{static_cast<uint8_t>(0x80 | (first ? 0x10 : 0))};  // X, S
+                d[1] = std::byte{0x80};                                               // I
+                d[2] = std::byte{static_cast<uint8_t>(0x80 | (picture_id >> 8))};    // M
+                d[3] = std::byte{static_cast<uint8_t>(picture_id & 0xff)};
+            });
+        }
+
+    private:
+        uint16_t next_picture_id_ = 0;
+    };
+
+    // RFC 9628 payload descriptor, non-flexible mode with a 15-bit picture
+    // ID. libvpx runs without lag or layers here, so every frame is one
+    // picture and only keyframes are not inter-predicted.
+    class Vp9RtpPacketizer final : public rtc::RtpPacketizer {
+    public:
+        using rtc::RtpPacketizer::RtpPacketizer;
+
+    protected:
+        std::vector<rtc::binary> fragment(rtc::binary frame) override {
+            const uint16_t picture_id = next_picture_id_++ & 0x7fff;
+            const bool inter = !IsKeyframe(frame);
+            return FragmentWithDescriptor(frame, 3, [&](std::byte* d, bool first, bool last) {
+                d[0] = std::byte{static_cast<uint8_t>(
+                    0x80 | (inter ? 0x40 : 0) | (first ? 0x08 : 0) | (last ? 0x04 : 0))};  // I, P, B, E
+                d[1] = std::byte{static_cast<uint8_t>(0x80 | (picture_id >> 8))};          // M
+                d[2] = std::byte{static_cast<uint8_t>(picture_id & 0xff)};
+            });
+        }
+
+    private:
+        // From the uncompressed header: frame_marker, profile bits,
+        // reserved bit (profile 3 only), show_existing_frame, frame_type.
+        static bool IsKeyframe(const rtc::binary& frame) {
+            if (frame.empty()) return false;
+            const auto b = std::to_integer<uint8_t>(frame[0]);
+            if ((b >> 6) != 2) return false;
+            const int profile = ((b >> 5) & 1) | (((b >> 4) & 1) << 1);
+            const int show_existing_bit = profile == 3 ? 2 : 3;
+            if ((b >> show_existing_bit) & 1) return false;
+            return ((b >> (show_existing_bit - 1)) & 1) == 0;
+        }
+
+        uint16_t next_picture_id_ = 0;
+    };
+
+    static std::shared_ptr<rtc::RtpPacketizer> CreateVideoPacketizer(
+        VideoCodec codec,
+        std::shared_ptr<rtc::RtpPacketizationConfig> rtp_config) {
+        switch (codec) {
+        case VideoCodec::kVp8:
+            return std::make_shared<Vp8RtpPacketizer>(std::move(rtp_config));
+        case VideoCodec::kVp9:
+            return std::make_shared<Vp9RtpPacketizer>(std::move(rtp_config));
+        case VideoCodec::kAv1:
+            // FFmpeg hands out one temporal unit of low-overhead OBUs per frame.
+            return std::make_shared<rtc::AV1RtpPacketizer>(
+                rtc::AV1RtpPacketizer::Packetization::TemporalUnit, std::move(rtp_config));
+        case VideoCodec::kH264:
+        default:
+            return std::make_shared<rtc::H264RtpPacketizer>(
+                rtc::NalUnit::Separator::Length, std::move(rtp_config));
+        }
+    }
+
     void ConfigureVideoTrack(std::shared_ptr<rtc::Track> track) {
         video_track_ = std::move(track);
         auto video = video_track_->description();
         video.addSSRC(kVideoSsrc, "tenbox-video", "tenbox-stream", "tenbox-video");
-        const auto selection = ChooseH264Payload(video, preferred_video_format_).value_or(
-            H264PayloadSelection{kFallbackVideoPayloadType, H264Profile::kConstrainedBaseline});
+        const auto selection = ChooseVideoPayload(video, preferred_video_format_).value_or(
+            VideoPayloadSelection{kFallbackVideoPayloadType, VideoCodec::kH264, H264Profile::kConstrainedBaseline});
         const uint8_t payload_type = selection.payload_type;
+        negotiated_video_codec_.store(selection.codec, std::memory_order_relaxed);
         negotiated_h264_profile_.store(selection.profile, std::memory_order_relaxed);
         const uint8_t color_space_id = FindExtMapId(video, "color-space").value_or(0);
         const uint8_t playout_delay_id = FindExtMapId(video, "playout-delay").value_or(0);
+        const uint8_t transport_cc_id = FindExtMapId(video, "transport-wide-cc").value_or(0);
         video_track_->setDescription(std::move(video));
         auto rtp_config = std::make_shared<rtc::RtpPacketizationConfig>(
-            kVideoSsrc, "tenbox-video", payload_type, rtc::H264RtpPacketizer::ClockRate);
-        auto packetizer = std::make_shared<rtc::H264RtpPacketizer>(
-            rtc::NalUnit::Separator::Length, rtp_config);
+            kVideoSsrc, "tenbox-video", payload_type, kVideoClockRate);
+        auto packetizer = CreateVideoPacketizer(selection.codec, rtp_config);
         if (color_space_id != 0 || playout_delay_id != 0) {
             packetizer->addToChain(std::make_shared<VideoMetadataExtensionHandler>(
                 color_space_id, playout_delay_id));
@@ -915,24 +1735,33 @@ private:
         // so audio playback is unaffected. Side effect: per-RTP-stream RTT
         // estimation via LSR/DLSR is gone for video; ICE candidate-pair RTT
         // (browser getStats) is unaffected.
-        packetizer->addToChain(std::make_shared<rtc::RtcpNackResponder>());
         std::weak_ptr<NativeWebRtcPeer> weak = weak_from_this();
+        // Ahead of the NACK responder so retransmissions keep their
+        // transport-wide sequence number. Without the extension only
+        // receiver reports (loss) reach the controller.
+        packetizer->addToChain(std::make_shared<CongestionControlHandler>(
+            transport_cc_id, congestion_, [weak]() {
+                if (auto self = weak.lock()) self->ApplyVideoBitrate(false);
+            }));
+        packetizer->addToChain(std::make_shared<rtc::RtcpNackResponder>());
         packetizer->addToChain(std::make_shared<rtc::PliHandler>([weak]() {
             auto self = weak.lock();
             if (!self) return;
-            self->force_keyframe_requested_ = true;
+            self->RequestVideoKeyframe();
             // Receivers fire PLI on every key frame loss / freeze recovery,
-            // sometimes several times per second. Default to verbose; even
-            // verbose users get rate-limited info aggregated below by the
-            // encoder thread (request count is reflected via force_keyframe).
+            // sometimes several times per second. Default to verbose; the
+            // fan-out folds requests that land between two encodes into one
+            // keyframe and reports how many it coalesced.
             VerboseLog("[INFO]  remote_webrtc: keyframe requested by receiver\n");
         }));
         video_track_->setMediaHandler(packetizer);
-        VerboseLog("[INFO]  remote_webrtc: video payload type=%u mid=%s color_ext=%u playout_ext=%u\n",
+        VerboseLog("[INFO]  remote_webrtc: video payload type=%u codec=%s mid=%s color_ext=%u playout_ext=%u twcc_ext=%u\n",
                    payload_type,
+                   VideoCodecLogName(selection.codec),
                    video_track_->mid().c_str(),
                    color_space_id,
-                   playout_delay_id);
+                   playout_delay_id,
+                   transport_cc_id);
         video_track_->onOpen([weak]() {
             auto self = weak.lock();
             if (!self) return;
@@ -965,45 +1794,69 @@ private:
         });
     }
 
-    struct H264PayloadSelection {
+    struct VideoPayloadSelection {
         uint8_t payload_type;
-        H264Profile profile;
-        bool high444 = false;
-        bool constrained_baseline = false;
+        VideoCodec codec;
+        H264Profile profile;  // H.264 only
     };
 
-    static const char* H264ProfileLogName(H264Profile profile) {
-        switch (profile) {
-        case H264Profile::kHigh:
-            return "high";
-        case H264Profile::kMain:
-            return "main";
-        case H264Profile::kConstrainedBaseline:
-        default:
-            return "constrained-baseline";
+    // The first codec of VideoCodecPreference() that the offer carries and
+    // this host can encode. 4:4:4 sessions stay on H.264: High 4:4:4 is the
+    // only 4:4:4 profile browsers offer.
+    static std::optional<VideoPayloadSelection> ChooseVideoPayload(
+        const rtc::Description::Media& media,
+        PixelFormat preferred_video_format) {
+        for (const VideoCodec codec : VideoCodecPreference()) {
+            if (codec == VideoCodec::kH264) {
+                if (const auto h264 = ChooseH264Payload(media, preferred_video_format)) {
+                    return VideoPayloadSelection{h264->payload_type, codec, h264->profile};
+                }
+                continue;
+            }
+            if (preferred_video_format == PixelFormat::kYuv444p) continue;
+            const auto payload_type = FindBaseProfilePayload(media, codec);
+            if (payload_type && FfmpegVideoEncoder::IsAvailable(codec)) {
+                return VideoPayloadSelection{*payload_type, codec, H264Profile::kConstrainedBaseline};
+            }
         }
+        return std::nullopt;
     }
 
-    static const char* PixelFormatLogName(PixelFormat format) {
-        switch (format) {
-        case PixelFormat::kYuv444p:
-            return "yuv444p";
-        case PixelFormat::kYuv420p:
-            return "yuv420p";
-        case PixelFormat::kRgba:
-            return "rgba";
-        case PixelFormat::kBgra:
-            return "bgra";
-        default:
-            return "unknown";
+    // Payload type of VP8, or of VP9 / AV1 in their 8-bit 4:2:0 profile 0
+    // (`profile-id` / `profile` absent or 0).
+    static std::optional<uint8_t> FindBaseProfilePayload(const rtc::Description::Media& media,
+                                                         VideoCodec codec) {
+        const std::string_view name = codec == VideoCodec::kVp8 ? "VP8"
+                                    : codec == VideoCodec::kVp9 ? "VP9"
+                                                                : "AV1";
+        const std::string_view profile_key = codec == VideoCodec::kVp9 ? "profile-id=" : "profile=";
+        auto same_name = [&](const std::string& format) {
+            return format.size() == name.size() &&
+                   std::equal(format.begin(), format.end(), name.begin(), [](char a, char b) {
+                       return std::toupper(static_cast<unsigned char>(a)) == b;
+                   });
+        };
+        for (int payload_type : media.payloadTypes()) {
+            if (payload_type < 0 || payload_type > 127) continue;
+            const auto* rtp_map = media.rtpMap(payload_type);
+            if (!rtp_map || !same_name(rtp_map->format)) continue;
+            bool base_profile = true;
+            for (const auto& fmtp : rtp_map->fmtps) {
+                const auto pos = fmtp.find(profile_key);
+                if (pos == std::string::npos) continue;
+                base_profile = fmtp.compare(pos + profile_key.size(), 1, "0") == 0;
+            }
+            if (base_profile) return static_cast<uint8_t>(payload_type);
         }
+        return std::nullopt;
     }
 
-    static size_t ChromaPlaneHeight(PixelFormat format, uint32_t height) {
-        return format == PixelFormat::kYuv444p
-            ? static_cast<size_t>(height)
-            : static_cast<size_t>((height + 1) / 2);
-    }
+    struct H264PayloadSelection {
+        uint8_t payload_type;
+        H264Profile profile;
+        bool high444 = false;
+        bool constrained_baseline = false;
+    };
 
     // Walk the offer's H.264 payload types and parse each fmtp's
     // `profile-level-id` (6 hex digits: profile_idc | constraint_flags |
@@ -1128,17 +1981,81 @@ private:
         return std::nullopt;
     }
 
+    // Join the source's shared video pump. The sink holds the track, not
+    // the peer, so the pump never ends up owning the last reference to us.
     void StartVideoPump() {
-        bool expected = false;
-        if (!video_running_.compare_exchange_strong(expected, true)) return;
-        video_thread_ = std::thread([this]() {
-            VideoPumpMain();
-        });
+        std::lock_guard<std::mutex> lock(video_mu_);
+        if (video_fanout_ || !video_track_) return;
+        std::shared_ptr<rtc::Track> track = video_track_;
+        std::shared_ptr<SendSideCongestionController> congestion = congestion_;
+        VideoSink sink;
+        // The congestion controller drops frames while the link is behind
+        // and thins the frame rate at low bitrates.
+        sink.ready = [track, congestion]() {
+            return track->bufferedAmount() <= kMaxVideoBufferedBytes &&
+                   congestion->ReadyForFrame(SteadyNowUs());
+        };
+        sink.deliver = [track, congestion, sent_frames = uint64_t{0}](const EncodedVideoFrame& encoded) mutable {
+            // The FFmpeg encoder wrapper returns what the track's packetizer
+            // consumes verbatim (AVCC NALUs for H.264, an OBU temporal unit
+            // for AV1, a plain VP8/VP9 frame). We still allocate a fresh
+            // rtc::binary per peer because libdatachannel takes ownership
+            // of the buffer for the RTP send.
+            const auto* video_bytes = reinterpret_cast<const std::byte*>(encoded.data.data());
+            rtc::binary sample(video_bytes, video_bytes + encoded.data.size());
+            try {
+                track->sendFrame(std::move(sample),
+                                 std::chrono::duration<double, std::micro>(encoded.pts_us));
+                congestion->OnFrameSent(encoded.data.size(), SteadyNowUs());
+                ++sent_frames;
+            } catch (const std::exception& e) {
+                if (sent_frames == 0) {
+                    std::fprintf(stdout, "[WARN]  remote_webrtc: sendFrame failed: %s\n", e.what());
+                    std::fflush(stdout);
+                }
+            }
+        };
+        video_fanout_ = VideoFanout::ForSource(video_source_id_, frame_reader_);
+        applied_bitrate_bps_ = congestion_->target_bitrate_bps();
+        video_subscription_ = video_fanout_->Subscribe(
+            negotiated_video_codec_.load(std::memory_order_relaxed),
+            negotiated_h264_profile_.load(std::memory_order_relaxed),
+            applied_bitrate_bps_,
+            std::move(sink));
     }
 
     void StopVideoPump() {
-        video_running_ = false;
-        if (video_thread_.joinable()) video_thread_.join();
+        std::shared_ptr<VideoFanout> fanout;
+        uint64_t subscription = 0;
+        {
+            std::lock_guard<std::mutex> lock(video_mu_);
+            fanout = std::move(video_fanout_);
+            subscription = std::exchange(video_subscription_, 0);
+        }
+        // Dropping the last reference joins the pump thread; do that
+        // outside video_mu_.
+        if (fanout) fanout->Unsubscribe(subscription);
+    }
+
+    void RequestVideoKeyframe() {
+        std::lock_guard<std::mutex> lock(video_mu_);
+        if (video_fanout_) video_fanout_->RequestKeyframe(video_subscription_);
+    }
+
+    // Hand the congestion controller's current target to the fan-out.
+    // Feedback arrives several times a second; moves under 5% are not
+    // worth retuning the encoder for unless |force| is set.
+    void ApplyVideoBitrate(bool force) {
+        const uint32_t target = congestion_->target_bitrate_bps();
+        std::lock_guard<std::mutex> lock(video_mu_);
+        const uint64_t applied = applied_bitrate_bps_;
+        if (!force && uint64_t{target} * 20 > applied * 19 && uint64_t{target} * 20 < applied * 21) return;
+        applied_bitrate_bps_ = target;
+        if (video_fanout_) video_fanout_->SetBitrate(video_subscription_, target);
+        if (!force) {
+            VerboseLog("[INFO]  remote_webrtc: congestion target=%u bps fps=%u dropped=%" PRIu64 "\n",
+                       target, congestion_->target_framerate(), congestion_->frames_dropped());
+        }
     }
 
     void StartAudioPump() {
@@ -1288,273 +2205,13 @@ private:
         }
     }
 
-    void VideoPumpMain() {
-        pthread_setname_np(pthread_self(), "webrtc-video");
-        FfmpegH264VideoEncoder encoder;
-        VideoEncoderConfig config;
-        bool encoder_open = false;
-        // The encoder's persistent input buffer is empty after Open(); the next
-        // drain must request a full-frame slice from the producer to seed it.
-        bool needs_full_seed = true;
-        uint64_t sent_frames = 0;
-        bool waiting_logged = false;
-        // Track what we last logged for the "encoder opened" line so that
-        // pure bitrate adjustments (which retrigger encoder.Open() but are
-        // not interesting on a per-event basis) do not spam the log; a real
-        // INFO line only fires when the resolution / pixel format / encoder
-        // backend / H.264 profile actually changes.
-        uint32_t last_logged_width = 0;
-        uint32_t last_logged_height = 0;
-        PixelFormat last_logged_input_format = PixelFormat::kYuv420p;
-        H264Profile last_logged_profile = H264Profile::kConstrainedBaseline;
-        std::string last_logged_encoder_name;
-        const auto start = std::chrono::steady_clock::now();
-        const auto base_frame_interval = std::chrono::microseconds(16'667);
-        const auto idle_frame_interval = std::chrono::milliseconds(500);
-        const auto recovery_grace_period = std::chrono::milliseconds(2000);
-        std::optional<std::chrono::steady_clock::time_point> last_slice_time;
-        // Fixed upper frame-rate cap. Bitrate pressure is handled by the encoder,
-        // but we still avoid sending faster than the negotiated 60fps cadence.
-        auto next_encode_time = start;
-
-        while (video_running_) {
-            const auto pacing_now = std::chrono::steady_clock::now();
-            if (pacing_now < next_encode_time) {
-                std::this_thread::sleep_until(next_encode_time);
-                if (!video_running_) break;
-            }
-
-            // After motion stops, keep re-encoding the settled frame briefly so
-            // low-bitrate streams can recover detail before falling to idle.
-            const auto read_now = std::chrono::steady_clock::now();
-            const bool in_recovery_window =
-                last_slice_time.has_value() &&
-                read_now - *last_slice_time < recovery_grace_period;
-            const auto frame_wait_timeout =
-                in_recovery_window ? std::chrono::milliseconds(0) : idle_frame_interval;
-
-            // Block on the producer's CV until new slices arrive (or timeout).
-            // This replaces the old sleep-then-poll pattern so a fresh slice
-            // wakes the encoder thread immediately, while the recovery window
-            // avoids dropping straight to 2fps after recent motion.
-            RemoteVideoFrame remote_frame;
-            const bool got_slices = frame_reader_ &&
-                frame_reader_(&remote_frame, needs_full_seed, frame_wait_timeout) &&
-                !remote_frame.slices.empty();
-            if (got_slices) {
-                last_slice_time = std::chrono::steady_clock::now();
-            }
-
-            // Without a seeded encoder we cannot produce a heartbeat frame;
-            // wait for the producer to deliver the first full-frame slice.
-            if (!got_slices && (!encoder_open || !encoder.HasFullSeed())) {
-                if (!waiting_logged) {
-                    // First-time-only when we cannot start because the
-                    // producer hasn't pushed any framebuffer yet. After the
-                    // session goes live this should not recur, so leaving
-                    // it at INFO is safe.
-                    std::fprintf(stdout, "[INFO]  remote_webrtc: waiting for framebuffer\n");
-                    std::fflush(stdout);
-                    waiting_logged = true;
-                }
-                continue;
-            }
-            waiting_logged = false;
-
-            const bool force_keyframe = force_keyframe_requested_.exchange(false);
-            const auto now = std::chrono::steady_clock::now();
-
-            if (video_track_ && video_track_->bufferedAmount() > kMaxVideoBufferedBytes) {
-                if (force_keyframe) force_keyframe_requested_ = true;
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
-            }
-
-            const uint32_t target_bitrate_bps = video_bitrate_bps_.load();
-            const H264Profile target_profile =
-                negotiated_h264_profile_.load(std::memory_order_relaxed);
-            if (got_slices &&
-                (!encoder_open ||
-                 config.width != remote_frame.width ||
-                 config.height != remote_frame.height ||
-                 config.bitrate_bps != target_bitrate_bps ||
-                 config.input_format != remote_frame.format ||
-                 config.h264_profile != target_profile)) {
-                config.width = remote_frame.width;
-                config.height = remote_frame.height;
-                config.input_format = remote_frame.format;
-                config.codec = VideoCodec::kH264;
-                config.framerate = 60;
-                config.bitrate_bps = target_bitrate_bps;
-                config.h264_profile = target_profile;
-                std::string error;
-                encoder_open = encoder.Open(config, &error);
-                if (!encoder_open) {
-                    std::fprintf(stdout, "[WARN]  remote_webrtc: encoder open failed: %s\n", error.c_str());
-                    std::fflush(stdout);
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                    continue;
-                }
-                const std::string encoder_name = encoder.SelectedEncoderName();
-                // Promote the "encoder opened" line to INFO only when one
-                // of the user-visible knobs (resolution / pixel format /
-                // backend / H.264 profile) actually changed since the last
-                // print. Bitrate-only retunes still re-Open() the encoder
-                // and are interesting at debug level, but logging them at
-                // INFO would flood the journal whenever the bandwidth
-                // controller adapts.
-                const bool material_change =
-                    remote_frame.width != last_logged_width ||
-                    remote_frame.height != last_logged_height ||
-                    config.input_format != last_logged_input_format ||
-                    config.h264_profile != last_logged_profile ||
-                    encoder_name != last_logged_encoder_name;
-                // The newly opened encoder has zeroed input planes; the slices
-                // we just drained may be partial, so request a full-frame
-                // reseed on the next iteration before encoding.
-                if (!encoder.HasFullSeed() &&
-                    !(remote_frame.slices.size() == 1 &&
-                      remote_frame.slices.front().x == 0 &&
-                      remote_frame.slices.front().y == 0 &&
-                      remote_frame.slices.front().width == remote_frame.width &&
-                      remote_frame.slices.front().height == remote_frame.height)) {
-                    needs_full_seed = true;
-                    if (material_change) {
-                        std::fprintf(stdout,
-                                     "[INFO]  remote_webrtc: encoder opened %ux%u bitrate=%u profile=%s format=%s encoder=%s (awaiting full seed)\n",
-                                     remote_frame.width,
-                                     remote_frame.height,
-                                     config.bitrate_bps,
-                                     H264ProfileLogName(config.h264_profile),
-                                     PixelFormatLogName(config.input_format),
-                                     encoder_name.c_str());
-                        std::fflush(stdout);
-                    } else {
-                        VerboseLog("[INFO]  remote_webrtc: encoder reconfigured bitrate=%u (awaiting full seed)\n",
-                                   config.bitrate_bps);
-                    }
-                    last_logged_width = remote_frame.width;
-                    last_logged_height = remote_frame.height;
-                    last_logged_input_format = config.input_format;
-                    last_logged_profile = config.h264_profile;
-                    last_logged_encoder_name = encoder_name;
-                    continue;
-                }
-                if (material_change) {
-                    std::fprintf(stdout,
-                                 "[INFO]  remote_webrtc: encoder opened %ux%u bitrate=%u profile=%s format=%s encoder=%s\n",
-                                 remote_frame.width,
-                                 remote_frame.height,
-                                 config.bitrate_bps,
-                                 H264ProfileLogName(config.h264_profile),
-                                 PixelFormatLogName(config.input_format),
-                                 encoder_name.c_str());
-                    std::fflush(stdout);
-                } else {
-                    VerboseLog("[INFO]  remote_webrtc: encoder reconfigured bitrate=%u\n",
-                               config.bitrate_bps);
-                }
-                last_logged_width = remote_frame.width;
-                last_logged_height = remote_frame.height;
-                last_logged_input_format = config.input_format;
-                last_logged_profile = config.h264_profile;
-                last_logged_encoder_name = encoder_name;
-            }
-
-            // Apply every accumulated YUV slice to the encoder's persistent
-            // input frame, mirroring sweet's DrawSlices step. When no slices
-            // arrived this round we leave the persistent input untouched and
-            // re-encode it as a heartbeat (faster during recovery, then 2fps idle).
-            uint32_t total_pixels = 0;
-            uint32_t slice_count = 0;
-            if (got_slices) {
-                std::string apply_error;
-                bool apply_ok = true;
-                for (const auto& s : remote_frame.slices) {
-                    VideoSlice vs;
-                    vs.x = s.x;
-                    vs.y = s.y;
-                    vs.width = s.width;
-                    vs.height = s.height;
-                    const size_t y_size = static_cast<size_t>(s.strides[0]) * s.height;
-                    const size_t uv_h = ChromaPlaneHeight(remote_frame.format, s.height);
-                    const size_t uv_size = static_cast<size_t>(s.strides[1]) * uv_h;
-                    vs.planes[0] = s.data.data();
-                    vs.planes[1] = s.data.data() + y_size;
-                    vs.planes[2] = s.data.data() + y_size + uv_size;
-                    vs.strides[0] = s.strides[0];
-                    vs.strides[1] = s.strides[1];
-                    vs.strides[2] = s.strides[2];
-                    if (!encoder.ApplySlice(vs, &apply_error)) {
-                        apply_ok = false;
-                        break;
-                    }
-                    total_pixels += s.width * s.height;
-                    ++slice_count;
-                }
-                if (!apply_ok) {
-                    std::fprintf(stdout, "[WARN]  remote_webrtc: apply slice failed: %s\n", apply_error.c_str());
-                    std::fflush(stdout);
-                    needs_full_seed = true;
-                    continue;
-                }
-                if (!encoder.HasFullSeed()) {
-                    // Slices applied but the encoder still lacks a full
-                    // reference; ask for a reseed and retry next round.
-                    needs_full_seed = true;
-                    continue;
-                }
-                needs_full_seed = false;
-            }
-
-            if (force_keyframe) {
-                encoder.RequestKeyframe();
-            }
-            const auto pts_us = std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
-
-            EncodedVideoFrame encoded;
-            std::string error;
-            if (!encoder.EncodeFrame(pts_us, &encoded, &error) || encoded.data.empty()) {
-                if (!error.empty()) {
-                    std::fprintf(stdout, "[WARN]  remote_webrtc: encode failed: %s\n", error.c_str());
-                    std::fflush(stdout);
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
-            }
-            if (!video_track_) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                continue;
-            }
-
-            // The FFmpeg encoder wrapper returns AVCC (length-prefixed) NALUs
-            // that the H264RtpPacketizer can consume verbatim. We still
-            // allocate a fresh rtc::binary because libdatachannel takes
-            // ownership of the buffer for the RTP send.
-            const auto* video_bytes = reinterpret_cast<const std::byte*>(encoded.data.data());
-            rtc::binary sample(video_bytes, video_bytes + encoded.data.size());
-            if (sample.empty()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
-            }
-            try {
-                video_track_->sendFrame(sample, std::chrono::duration<double, std::micro>(encoded.pts_us));
-            } catch (const std::exception& e) {
-                if (sent_frames == 0) {
-                    std::fprintf(stdout, "[WARN]  remote_webrtc: sendFrame failed: %s\n", e.what());
-                    std::fflush(stdout);
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                continue;
-            }
-            next_encode_time = now + base_frame_interval;
-            ++sent_frames;
-        }
-    }
-
     static constexpr uint8_t kFallbackVideoPayloadType = 102;
     static constexpr uint8_t kFallbackAudioPayloadType = 111;
     static constexpr rtc::SSRC kVideoSsrc = 0x54424f58;
+    static constexpr uint32_t kVideoClockRate = 90'000;
+    // Leaves room under a 1200-byte MTU budget for the RTP header, header
+    // extensions and SRTP.
+    static constexpr size_t kMaxVideoFragmentBytes = 1100;
     static constexpr rtc::SSRC kAudioSsrc = 0x54424f41;
     static constexpr size_t kMaxQueuedAudioChunks = 100;
     static constexpr size_t kMaxVideoBufferedBytes = 0;
@@ -1562,6 +2219,7 @@ private:
     static constexpr size_t kMaxAudioBufferedBytes = 128 * 1024;
 
     RemoteFrameReader frame_reader_;
+    std::string video_source_id_;
     std::shared_ptr<rtc::PeerConnection> peer_;
     // Browser may open one or more channels (input-fast, control, ...). The
     // peer has no business inspecting the labels - it just forwards every
@@ -1575,12 +2233,15 @@ private:
     bool peer_closed_dispatched_ = false;
     std::shared_ptr<rtc::Track> video_track_;
     std::shared_ptr<rtc::Track> audio_track_;
-    std::thread video_thread_;
     std::thread audio_thread_;
-    std::atomic<bool> video_running_{false};
     std::atomic<bool> audio_running_{false};
-    std::atomic<bool> force_keyframe_requested_{false};
-    std::atomic<uint32_t> video_bitrate_bps_{4'000'000};
+    std::mutex video_mu_;
+    std::shared_ptr<VideoFanout> video_fanout_;
+    uint64_t video_subscription_ = 0;
+    std::shared_ptr<SendSideCongestionController> congestion_ =
+        std::make_shared<SendSideCongestionController>();
+    uint32_t applied_bitrate_bps_ = 0;  // guarded by video_mu_
+    std::atomic<VideoCodec> negotiated_video_codec_{VideoCodec::kH264};
     std::atomic<H264Profile> negotiated_h264_profile_{H264Profile::kConstrainedBaseline};
     PixelFormat preferred_video_format_ = PixelFormat::kYuv420p;
     std::mutex audio_mu_;
@@ -1597,10 +2258,12 @@ private:
 
 std::shared_ptr<WebRtcPeer> CreateWebRtcPeer(
     RemoteFrameReader frame_reader,
-    PixelFormat preferred_video_format) {
+    PixelFormat preferred_video_format,
+    std::string video_source_id) {
     auto peer = std::make_shared<NativeWebRtcPeer>(
         std::move(frame_reader),
-        preferred_video_format);
+        preferred_video_format,
+        std::move(video_source_id));
     peer->InstallCallbacks();
     return peer;
 }
@@ -33,6 +33,13 @@ struct RemoteVideoFrame {
     PixelFormat format = PixelFormat::kYuv420p;
     std::vector<RemoteVideoSlice> slices;
     uint64_t seq = 0;
+    // Optional, set by the consumer: the encoder's input picture. When it
+    // matches the frame's size and `target_format`, the producer converts
+    // straight into it, sets `converted_in_place`, and the slices carry
+    // only their geometry (their data is not filled).
+    VideoPlanes target;
+    PixelFormat target_format = PixelFormat::kYuv420p;
+    bool converted_in_place = false;
 };
 
 struct RemoteAudioChunk {
@@ -44,7 +51,8 @@ struct RemoteAudioChunk {
 
 // `need_full_frame` asks the producer to discard pending partial slices and
 // emit a single full-frame slice (e.g. after the encoder is reopened so its
-// internal reference buffer must be re-seeded). When `wait_timeout` is
+// internal reference buffer must be re-seeded). Slice buffers already in the
+// frame are reused, so readers should pass the same frame every time. When `wait_timeout` is
 // non-zero and there are no pending slices, the reader blocks on the
 // producer's condition variable until either new slices arrive, the timeout
 // expires, or `need_full_frame` lets it synthesize one immediately.
@@ -104,9 +112,14 @@ public:
     virtual bool SendOnDataChannel(const std::string& label, const std::string& text) = 0;
 };
 
+// Peers created with the same non-empty `video_source_id` (the VM id) share
+// one video pump: the source is read and encoded once per stream and the
+// packets fan out to every peer on it, so only the first peer's
+// `frame_reader` is used. An empty id gives the peer a pump of its own.
 std::shared_ptr<WebRtcPeer> CreateWebRtcPeer(
     RemoteFrameReader frame_reader = {},
-    PixelFormat preferred_video_format = PixelFormat::kYuv420p);
+    PixelFormat preferred_video_format = PixelFormat::kYuv420p,
+    std::string video_source_id = {});
 bool NativeWebRtcAvailable();
 
 // One ICE server entry in the W3C `RTCIceServer`-shaped form we also
@@ -277,6 +277,14 @@ nlohmann::json RpcServer::HandleRequest(const nlohmann::json& request) {
     if (type == "vm.logs") {
         return Ok(runtime_manager_.Logs(request.value("vm_id", ""), request.value("lines", 200)));
     }
+    if (type == "vm.stats") {
+        nlohmann::json stats;
+        std::string error;
+        if (!runtime_manager_.Stats(request.value("vm_id", ""), &stats, &error)) {
+            return Error("vm_stats_failed", error);
+        }
+        return Ok(std::move(stats));
+    }
     if (type == "remote_session.create") {
         const auto session = remote_sessions_.Create(
             request.value("vm_id", ""),
@@ -402,6 +410,13 @@ nlohmann::json RpcServer::EditVm(const nlohmann::json& request) {
             sf.tag = item.value("tag", "");
             sf.host_path = item.value("host_path", "");
             sf.readonly = item.value("readonly", false);
+            sf.cache = item.value("cache", "auto");
+            sf.writeback = item.value("writeback", false);
+            sf.iops_limit = item.value("iops_limit", uint64_t{0});
+            sf.bps_limit = item.value("bps_limit", uint64_t{0});
+            if (sf.cache != "none" && sf.cache != "auto" && sf.cache != "always") {
+                return Error("vm_edit_invalid", "shared folder cache must be none, auto or always");
+            }
             if (!sf.tag.empty() && !sf.host_path.empty()) {
                 spec.shared_folders.push_back(std::move(sf));
             }
@@ -1,12 +1,11 @@
 #include "daemon/runtime_manager.h"
 
 #include "daemon/resource_monitor.h"
-
-#ifdef TENBOX_ENABLE_LIBYUV
-#include <libyuv.h>
-#endif
+#include "common/cpu_list.h"
+#include "ipc/damage_region.h"
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <signal.h>
 #include <pthread.h>
@@ -126,7 +125,7 @@ std::string PathToUtf8(const fs::path& path) {
 }  // namespace
 
 RuntimeManager::RuntimeManager(DaemonConfig config, VmStore& store)
-    : config_(std::move(config)), store_(store) {
+    : config_(std::move(config)), store_(store), boot_cache_(config_.data_dir) {
     reboot_worker_ = std::thread(&RuntimeManager::RebootWorkerLoop, this);
 }
 
@@ -279,6 +278,25 @@ bool PathReadable(const std::string& path) {
     return ::access(path.c_str(), R_OK) == 0;
 }
 
+std::vector<uint32_t> OnlineHostCpus() {
+    std::ifstream in("/sys/devices/system/cpu/online");
+    std::string line;
+    std::vector<uint32_t> cpus;
+    if (in && std::getline(in, line) && ParseCpuList(line, &cpus) && !cpus.empty()) {
+        return cpus;
+    }
+    const uint32_t n = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t i = 0; i < n; ++i) cpus.push_back(i);
+    return cpus;
+}
+
+bool WriteSmallFile(const fs::path& path, const std::string& value) {
+    std::ofstream out(path);
+    out << value;
+    out.flush();
+    return static_cast<bool>(out);
+}
+
 }  // namespace
 
 std::optional<RuntimeManager::StartFailure> RuntimeManager::ValidateStart(const VmSpec& spec) const {
@@ -335,8 +353,119 @@ std::optional<RuntimeManager::StartFailure> RuntimeManager::ValidateStart(const
     return std::nullopt;
 }
 
+std::optional<RuntimeManager::StartFailure> RuntimeManager::ResolvePlacement(
+    const VmSpec& spec, ResolvedPlacement* out) {
+    const CpuPlacement& placement = spec.placement;
+    *out = ResolvedPlacement{};
+    out->vcpu_fifo_priority = placement.vcpu_fifo_priority;
+    if (placement.vcpu_fifo_priority < 0 || placement.vcpu_fifo_priority > 99) {
+        return StartFailure{"invalid_placement", "vcpu_fifo_priority must be 0-99"};
+    }
+
+    const std::vector<uint32_t> online = OnlineHostCpus();
+    auto is_online = [&](uint32_t cpu) {
+        return std::binary_search(online.begin(), online.end(), cpu);
+    };
+    std::vector<uint32_t> housekeeping;
+    if (!config_.housekeeping_cpus.empty()) {
+        ParseCpuList(config_.housekeeping_cpus, &housekeeping);
+    }
+
+    if (placement.io_cpus.empty()) {
+        out->io_cpus = housekeeping;
+    } else if (!ParseCpuList(placement.io_cpus, &out->io_cpus)) {
+        return StartFailure{"invalid_placement", "bad io_cpus list: " + placement.io_cpus};
+    }
+    for (uint32_t cpu : out->io_cpus) {
+        if (!is_online(cpu)) {
+            return StartFailure{"cpu_unavailable",
+                                "io_cpus names offline CPU " + std::to_string(cpu)};
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (placement.vcpu_cpus == "auto") {
+        std::vector<uint32_t> taken = housekeeping;
+        for (const auto& [id, cpus] : cpu_reservations_) {
+            if (id != spec.vm_id) taken.insert(taken.end(), cpus.begin(), cpus.end());
+        }
+        std::sort(taken.begin(), taken.end());
+        for (uint32_t cpu : online) {
+            if (out->vcpu_cpus.size() == spec.cpu_count) break;
+            if (!std::binary_search(taken.begin(), taken.end(), cpu)) {
+                out->vcpu_cpus.push_back(cpu);
+            }
+        }
+        if (out->vcpu_cpus.size() < spec.cpu_count) {
+            std::ostringstream msg;
+            msg << "not enough free host CPUs to pin " << spec.cpu_count << " vCPUs: "
+                << out->vcpu_cpus.size() << " available outside housekeeping ("
+                << (config_.housekeeping_cpus.empty() ? "none" : config_.housekeeping_cpus)
+                << ") and other pinned VMs";
+            return StartFailure{"cpu_unavailable", msg.str()};
+        }
+    } else if (!placement.vcpu_cpus.empty()) {
+        if (!ParseCpuList(placement.vcpu_cpus, &out->vcpu_cpus) || out->vcpu_cpus.empty()) {
+            return StartFailure{"invalid_placement", "bad vcpu_cpus list: " + placement.vcpu_cpus};
+        }
+        for (uint32_t cpu : out->vcpu_cpus) {
+            if (!is_online(cpu)) {
+                return StartFailure{"cpu_unavailable",
+                                    "vcpu_cpus names offline CPU " + std::to_string(cpu)};
+            }
+        }
+    }
+    // Explicit lists are honoured even when they overlap another VM (the
+    // user asked for it); they are still recorded so "auto" avoids them.
+    if (!out->vcpu_cpus.empty()) cpu_reservations_[spec.vm_id] = out->vcpu_cpus;
+    return std::nullopt;
+}
+
+void RuntimeManager::ReleasePlacement(const std::string& vm_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cpu_reservations_.erase(vm_id);
+}
+
+int RuntimeManager::PrepareCgroup(RuntimeSession& session) {
+    const uint32_t pct = session.spec.placement.cpu_quota_pct;
+    if (pct == 0) return -1;
+    auto note = [&](const std::string& line) {
+        if (session.log_file) session.log_file << "[tenboxd] " << line << "\n";
+    };
+    if (config_.cgroup_root.empty()) {
+        note("cpu_quota_pct ignored: tenboxd was started without --cgroup-root");
+        return -1;
+    }
+    const fs::path dir = fs::path(config_.cgroup_root) / ("vm-" + session.spec.vm_id);
+    std::error_code ec;
+    fs::create_directory(dir, ec);
+    if (ec) {
+        note("cannot create cgroup " + dir.string() + ": " + ec.message());
+        return -1;
+    }
+    // cpu.max is "<quota> <period>" in microseconds; 100% == one full CPU.
+    const uint64_t period_us = 100000;
+    const uint64_t quota_us = static_cast<uint64_t>(pct) * period_us / 100;
+    if (!WriteSmallFile(dir / "cpu.max", std::to_string(quota_us) + " " + std::to_string(period_us))) {
+        note("cannot write " + (dir / "cpu.max").string() + " (is +cpu delegated?)");
+        fs::remove(dir, ec);
+        return -1;
+    }
+    const int fd = ::open((dir / "cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        note("cannot open " + (dir / "cgroup.procs").string());
+        fs::remove(dir, ec);
+        return -1;
+    }
+    session.cgroup_dir = dir.string();
+    note("cgroup " + session.cgroup_dir + " cpu.max=" + std::to_string(quota_us) + " " +
+         std::to_string(period_us));
+    return fd;
+}
+
 std::vector<std::string> RuntimeManager::BuildRuntimeArgs(
     const VmSpec& spec,
+    const ResolvedPlacement& placement,
     const std::string& control_socket) const {
     std::vector<std::string> args = {
         config_.runtime_path,
@@ -366,6 +495,10 @@ std::vector<std::string> RuntimeManager::BuildRuntimeArgs(
     if (spec.debug_mode) {
         args.push_back("--debug");
     }
+    if (spec.halt_poll_max_ns) {
+        args.push_back("--halt-poll-ns");
+        args.push_back(std::to_string(*spec.halt_poll_max_ns));
+    }
     for (const auto& pf : spec.host_forwards) {
         args.push_back("--hostfwd");
         args.push_back(pf.ToHostfwd());
@@ -376,7 +509,23 @@ std::vector<std::string> RuntimeManager::BuildRuntimeArgs(
     }
     for (const auto& sf : spec.shared_folders) {
         args.push_back("--share");
-        args.push_back(sf.tag + ":" + sf.host_path + (sf.readonly ? ":ro" : ""));
+        args.push_back(sf.tag + ":" + sf.host_path + (sf.readonly ? ":ro" : "") +
+                       (sf.cache != "auto" ? ":cache=" + sf.cache : "") +
+                       (sf.writeback ? ":writeback" : "") +
+                       (sf.iops_limit ? ":iops=" + std::to_string(sf.iops_limit) : "") +
+                       (sf.bps_limit ? ":bps=" + std::to_string(sf.bps_limit) : ""));
+    }
+    if (!placement.vcpu_cpus.empty()) {
+        args.push_back("--vcpu-cpus");
+        args.push_back(FormatCpuList(placement.vcpu_cpus));
+    }
+    if (!placement.io_cpus.empty()) {
+        args.push_back("--io-cpus");
+        args.push_back(FormatCpuList(placement.io_cpus));
+    }
+    if (placement.vcpu_fifo_priority > 0) {
+        args.push_back("--vcpu-fifo");
+        args.push_back(std::to_string(placement.vcpu_fifo_priority));
     }
     return args;
 }
@@ -458,14 +607,46 @@ bool RuntimeManager::StartVm(const std::string& vm_id, std::string* error) {
         session->log_file.flush();
     }
 
+    ResolvedPlacement placement;
+    if (auto failure = ResolvePlacement(record->spec, &placement)) {
+        if (error) *error = failure->message;
+        store_.SetFailure(vm_id, FailureInfo{.code = failure->code, .message = failure->message});
+        return false;
+    }
+    if (session->log_file && (!placement.vcpu_cpus.empty() || !placement.io_cpus.empty())) {
+        session->log_file << "[tenboxd] placement vcpu_cpus="
+                          << (placement.vcpu_cpus.empty() ? "-" : FormatCpuList(placement.vcpu_cpus))
+                          << " io_cpus="
+                          << (placement.io_cpus.empty() ? "-" : FormatCpuList(placement.io_cpus))
+                          << " fifo=" << placement.vcpu_fifo_priority << "\n";
+    }
+    const int cgroup_fd = PrepareCgroup(*session);
+    session->log_file.flush();
+    auto abort_spawn = [&](const std::string& detail) {
+        if (cgroup_fd >= 0) ::close(cgroup_fd);
+        if (!session->cgroup_dir.empty()) fs::remove(session->cgroup_dir, ec);
+        ReleasePlacement(vm_id);
+        if (error) *error = detail;
+        store_.SetFailure(vm_id, FailureInfo{.code = "runtime_spawn_failed", .message = detail});
+        return false;
+    };
+
     int log_pipe[2];
     if (::pipe(log_pipe) != 0) {
-        if (error) *error = "failed to create runtime log pipe";
-        store_.SetFailure(vm_id, FailureInfo{.code = "runtime_spawn_failed", .message = "failed to create runtime log pipe"});
-        return false;
+        return abort_spawn("failed to create runtime log pipe");
     }
 
-    const auto args = BuildRuntimeArgs(record->spec, session->control_socket);
+    // Compressed kernels / initramfs are handed to the runtime as cached
+    // raw images so it can map them straight into guest RAM.
+    VmSpec launch_spec = record->spec;
+    for (std::string* path : {&launch_spec.kernel_path, &launch_spec.initrd_path}) {
+        std::string note;
+        *path = boot_cache_.Resolve(*path, &note);
+        if (!note.empty() && session->log_file) session->log_file << "[tenboxd] " << note << "\n";
+    }
+    session->log_file.flush();
+
+    const auto args = BuildRuntimeArgs(launch_spec, placement, session->control_socket);
     std::vector<char*> argv;
     argv.reserve(args.size() + 1);
     for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
@@ -475,14 +656,15 @@ bool RuntimeManager::StartVm(const std::string& vm_id, std::string* error) {
     if (pid < 0) {
         ::close(log_pipe[0]);
         ::close(log_pipe[1]);
-        if (error) *error = "failed to fork runtime process";
-        store_.SetFailure(vm_id, FailureInfo{.code = "runtime_spawn_failed", .message = "failed to fork runtime process"});
-        return false;
+        return abort_spawn("failed to fork runtime process");
     }
     if (pid == 0) {
         // Ensure runtime exits if tenboxd dies unexpectedly.
         ::prctl(PR_SET_PDEATHSIG, SIGTERM);
         if (::getppid() == 1) _exit(128);
+        // Join the quota cgroup before exec so no runtime thread ever runs
+        // outside it. A failed write leaves the runtime unthrottled.
+        if (cgroup_fd >= 0) (void)!::write(cgroup_fd, "0", 1);
         ::dup2(log_pipe[1], STDOUT_FILENO);
         ::dup2(log_pipe[1], STDERR_FILENO);
         ::close(log_pipe[0]);
@@ -492,6 +674,7 @@ bool RuntimeManager::StartVm(const std::string& vm_id, std::string* error) {
     }
 
     ::close(log_pipe[1]);
+    if (cgroup_fd >= 0) ::close(cgroup_fd);
     session->process_pid = pid;
     session->log_pipe_fd = log_pipe[0];
     session->running = true;
@@ -594,6 +777,10 @@ void RuntimeManager::ReadRuntime(std::shared_ptr<RuntimeSession> session) {
     }
     session->running = false;
     session->remote_frame_cv.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(session->reply_mutex);
+        session->reply_cv.notify_all();
+    }
 }
 
 void RuntimeManager::ReadLogs(std::shared_ptr<RuntimeSession> session) {
@@ -653,6 +840,11 @@ void RuntimeManager::ReadLogs(std::shared_ptr<RuntimeSession> session) {
         (void)::waitpid(session->process_pid, &status, 0);
         process_sampler_.Forget(session->process_pid);
     }
+    ReleasePlacement(session->spec.vm_id);
+    if (!session->cgroup_dir.empty()) {
+        std::error_code ec;
+        fs::remove(session->cgroup_dir, ec);
+    }
     // Distinguish "process exited normally with status N" (WIFEXITED) from
     // "killed by signal N" (WIFSIGNALED). The previous fallback bucketed
     // signal kills into exit_code=128, colliding with the runtime's own
@@ -715,6 +907,15 @@ void RuntimeManager::ReadLogs(std::shared_ptr<RuntimeSession> session) {
 }
 
 void RuntimeManager::HandleRuntimeMessage(std::shared_ptr<RuntimeSession> session, ipc::Message message) {
+    if (message.kind == ipc::Kind::kResponse && message.request_id != 0) {
+        std::lock_guard<std::mutex> lock(session->reply_mutex);
+        auto it = session->pending_replies.find(message.request_id);
+        if (it != session->pending_replies.end()) {
+            it->second = std::move(message);
+            session->reply_cv.notify_all();
+            return;
+        }
+    }
     if (message.type == "runtime.state") {
         session->info.state = VmStateFromString(message.fields["state"]);
         if (message.fields.count("exit_code")) {
@@ -782,8 +983,8 @@ void RuntimeManager::HandleRuntimeMessage(std::shared_ptr<RuntimeSession> sessio
                     {"updated_at", UnixNow()},
                 };
             }
-            // libyuv ARGB->YUV conversion lives under frame_mutex so it does not block
-            // log readers, console output, or RemoteRuntimeSnapshot.
+            // Only the damage is recorded here; the conversion runs when the
+            // remote video consumer drains it, off this reader thread.
             std::lock_guard<std::mutex> frame_lock(session->frame_mutex);
             UpdateRemoteVideoFrameLocked(*session, message);
         } else if (message.type == "display.shm_init") {
@@ -791,7 +992,7 @@ void RuntimeManager::HandleRuntimeMessage(std::shared_ptr<RuntimeSession> sessio
             const uint32_t width = FieldU32(message, "width");
             const uint32_t height = FieldU32(message, "height");
             if (shm_it != message.fields.end() && width > 0 && height > 0) {
-                auto framebuffer = std::make_unique<ipc::SharedFramebuffer>();
+                auto framebuffer = std::make_shared<ipc::SharedFramebuffer>();
                 const bool opened = framebuffer->Open(shm_it->second, width, height);
                 {
                     std::lock_guard<std::mutex> lock(session->console_mutex);
@@ -805,7 +1006,7 @@ void RuntimeManager::HandleRuntimeMessage(std::shared_ptr<RuntimeSession> sessio
                 if (opened) {
                     std::lock_guard<std::mutex> frame_lock(session->frame_mutex);
                     session->framebuffer = std::move(framebuffer);
-                    session->remote_frame = RemoteVideoFrame{};
+                    session->remote_damage.Clear();
                     session->remote_frame_force_full = true;
                 }
             }
@@ -912,6 +1113,27 @@ bool RuntimeManager::SendRuntime(std::shared_ptr<RuntimeSession> session, const
     return session->runtime_conn->Send(ipc::Encode(message));
 }
 
+std::optional<ipc::Message> RuntimeManager::RequestRuntime(std::shared_ptr<RuntimeSession> session,
+                                                           ipc::Message message,
+                                                           std::chrono::milliseconds timeout) {
+    if (!session) return std::nullopt;
+    const uint64_t id = session->next_request_id.fetch_add(1);
+    message.request_id = id;
+    std::unique_lock<std::mutex> lock(session->reply_mutex);
+    session->pending_replies[id];
+    lock.unlock();
+    const bool sent = SendRuntime(session, message);
+    lock.lock();
+    if (sent) {
+        session->reply_cv.wait_for(lock, timeout, [&] {
+            return session->pending_replies[id].has_value() || !session->running;
+        });
+    }
+    auto reply = std::move(session->pending_replies[id]);
+    session->pending_replies.erase(id);
+    return reply;
+}
+
 bool RuntimeManager::SendConsoleInput(const std::string& vm_id, const std::vector<uint8_t>& bytes) {
     auto session = FindSession(vm_id);
     if (!session) return false;
@@ -1031,7 +1253,9 @@ bool RuntimeManager::ApplySharedFolders(const std::string& vm_id) {
     for (size_t i = 0; i < record->spec.shared_folders.size(); ++i) {
         const auto& folder = record->spec.shared_folders[i];
         message.fields["folder_" + std::to_string(i)] =
-            folder.tag + "|" + folder.host_path + "|" + (folder.readonly ? "1" : "0");
+            folder.tag + "|" + folder.host_path + "|" + (folder.readonly ? "1" : "0") + "|" +
+            folder.cache + "|" + (folder.writeback ? "1" : "0") + "|" +
+            std::to_string(folder.iops_limit) + "|" + std::to_string(folder.bps_limit);
     }
     return SendRuntime(session, message);
 }
@@ -1077,13 +1301,19 @@ bool RuntimeManager::SetRemoteVideoPixelFormat(const std::string& vm_id, PixelFo
     std::lock_guard<std::mutex> lock(session->frame_mutex);
     if (session->remote_video_format == format) return true;
     session->remote_video_format = format;
-    session->remote_frame = RemoteVideoFrame{};
-    session->remote_frame.format = format;
+    session->remote_damage.Clear();
     session->remote_frame_force_full = true;
     session->remote_frame_cv.notify_all();
     return true;
 }
 
+PixelFormat RuntimeManager::RemoteVideoPixelFormat(const std::string& vm_id) const {
+    auto session = FindSession(vm_id);
+    if (!session) return PixelFormat::kYuv420p;
+    std::lock_guard<std::mutex> lock(session->frame_mutex);
+    return session->remote_video_format;
+}
+
 nlohmann::json RuntimeManager::RemoteRuntimeSnapshot(const std::string& vm_id,
                                                      SnapshotScope scope) const {
     auto session = FindSession(vm_id);
@@ -1244,161 +1474,27 @@ void RuntimeManager::NotifyStateChanged(const std::string& vm_id, const VmRuntim
     if (callback) callback(vm_id, info);
 }
 
-namespace {
-
-// Allocate a freshly-converted planar YUV slice from a sub-rectangle of a BGRA
-// framebuffer. Returns an empty slice (data.empty()) on failure.
-RemoteVideoSlice MakeSliceFromBgra(const uint8_t* bgra_base,
-                                   int bgra_stride,
-                                   uint32_t x,
-                                   uint32_t y,
-                                   uint32_t width,
-                                   uint32_t height,
-                                   PixelFormat format) {
-    RemoteVideoSlice slice;
-#ifdef TENBOX_ENABLE_LIBYUV
-    if (!bgra_base || bgra_stride <= 0 || width == 0 || height == 0) return slice;
-    if (format != PixelFormat::kYuv420p && format != PixelFormat::kYuv444p) return slice;
-
-    slice.x = x;
-    slice.y = y;
-    slice.width = width;
-    slice.height = height;
-    slice.strides[0] = static_cast<int>(width);
-    slice.strides[1] = static_cast<int>(
-        format == PixelFormat::kYuv444p ? width : (width + 1) / 2);
-    slice.strides[2] = slice.strides[1];
-
-    const size_t y_size = static_cast<size_t>(slice.strides[0]) * height;
-    const size_t uv_h = format == PixelFormat::kYuv444p
-        ? static_cast<size_t>(height)
-        : static_cast<size_t>((height + 1) / 2);
-    const size_t uv_size = static_cast<size_t>(slice.strides[1]) * uv_h;
-    slice.data.assign(y_size + uv_size * 2, 0);
-
-    const uint8_t* src = bgra_base +
-        static_cast<size_t>(y) * static_cast<size_t>(bgra_stride) +
-        static_cast<size_t>(x) * 4;
-    uint8_t* dst_y = slice.data.data();
-    uint8_t* dst_u = slice.data.data() + y_size;
-    uint8_t* dst_v = slice.data.data() + y_size + uv_size;
-    const int rc = format == PixelFormat::kYuv444p
-        ? libyuv::ARGBToI444(
-            src, bgra_stride,
-            dst_y, slice.strides[0],
-            dst_u, slice.strides[1],
-            dst_v, slice.strides[2],
-            static_cast<int>(width),
-            static_cast<int>(height))
-        : libyuv::ARGBToI420(
-            src, bgra_stride,
-            dst_y, slice.strides[0],
-            dst_u, slice.strides[1],
-            dst_v, slice.strides[2],
-            static_cast<int>(width),
-            static_cast<int>(height));
-    if (rc != 0) {
-        return RemoteVideoSlice{};
-    }
-#else
-    (void)bgra_base;
-    (void)bgra_stride;
-    (void)x;
-    (void)y;
-    (void)width;
-    (void)height;
-    (void)format;
-#endif
-    return slice;
-}
-
-}  // namespace
-
 void RuntimeManager::UpdateRemoteVideoFrameLocked(RuntimeSession& session, const ipc::Message& message) {
     if (!session.framebuffer || !session.framebuffer->IsValid()) return;
 
-    const uint32_t frame_width = session.framebuffer->width();
-    const uint32_t frame_height = session.framebuffer->height();
-    if (frame_width == 0 || frame_height == 0 || session.framebuffer->size() == 0) return;
-
-    RemoteVideoFrame& frame = session.remote_frame;
-    const PixelFormat target_format = session.remote_video_format;
-    const bool reinitialize =
-        frame.width != frame_width ||
-        frame.height != frame_height ||
-        frame.format != target_format;
-
-    if (reinitialize) {
-        frame = RemoteVideoFrame{};
-        frame.width = frame_width;
-        frame.height = frame_height;
-        frame.format = target_format;
-        // The encoder must be re-seeded after a resize; force the next reader
-        // drain to emit a full-frame slice.
-        session.remote_frame_force_full = true;
-    }
-
-    // The producer either accumulates partial slices that update the encoder's
-    // persistent input frame, OR (when explicitly requested) emits a single
-    // full-frame slice that supersedes the queue. Mirrors sweet's
-    // CreateEncodeSlice / DrawSlices pipeline.
-    const bool emit_full = session.remote_frame_force_full || reinitialize;
-
-    if (emit_full) {
-        RemoteVideoSlice full = MakeSliceFromBgra(
-            session.framebuffer->data(),
-            static_cast<int>(session.framebuffer->stride()),
-            0, 0, frame_width, frame_height,
-            target_format);
-        if (!full.data.empty()) {
-            frame.slices.clear();
-            frame.slices.push_back(std::move(full));
-            session.remote_frame_force_full = false;
-        }
-    } else {
-        const DirtyRect dirty = NormalizeDirtyRect(
-            FieldU32(message, "dirty_x"),
-            FieldU32(message, "dirty_y"),
-            FieldU32(message, "dirty_width", FieldU32(message, "width")),
-            FieldU32(message, "dirty_height", FieldU32(message, "height")),
-            frame_width,
-            frame_height,
-            /*force_full_frame=*/false);
-
-        if (dirty.width == frame_width && dirty.height == frame_height) {
-            // A full-screen dirty rect supersedes any pending partials.
-            frame.slices.clear();
-        }
-
-        RemoteVideoSlice slice = MakeSliceFromBgra(
-            session.framebuffer->data(),
-            static_cast<int>(session.framebuffer->stride()),
-            dirty.x, dirty.y, dirty.width, dirty.height,
-            target_format);
-        if (!slice.data.empty()) {
-            frame.slices.push_back(std::move(slice));
-        }
-
-        // If consumers fall too far behind, collapse the queue into a single
-        // full-frame slice instead of growing memory unboundedly.
-        constexpr size_t kMaxPendingSlices = 256;
-        if (frame.slices.size() > kMaxPendingSlices) {
-            RemoteVideoSlice full = MakeSliceFromBgra(
-                session.framebuffer->data(),
-                static_cast<int>(session.framebuffer->stride()),
-                0, 0, frame_width, frame_height,
-                target_format);
-            if (!full.data.empty()) {
-                frame.slices.clear();
-                frame.slices.push_back(std::move(full));
-            }
-        }
-    }
-
-    frame.seq = FieldU64(message, "seq");
+    // The runtime ships the damage accumulated since its last notification
+    // as a rect list; older runtimes send one rect. It is folded into what
+    // the consumer has not drained yet, so a slow consumer converts the
+    // union once from the latest frame instead of every intermediate one.
+    std::vector<ipc::DamageRect> rects;
+    if (message.fields.count("rect_count") == 0 ||
+        !ipc::DecodeDamageRects(message.payload.data(), message.payload.size(), &rects) ||
+        rects.empty()) {
+        rects = {{FieldU32(message, "dirty_x"),
+                  FieldU32(message, "dirty_y"),
+                  FieldU32(message, "dirty_width", FieldU32(message, "width")),
+                  FieldU32(message, "dirty_height", FieldU32(message, "height"))}};
+    }
+    for (const auto& rect : rects) session.remote_damage.Add(rect);
+    session.remote_frame_seq = FieldU64(message, "seq");
 
     // Wake any consumer blocked in ReadRemoteFrame. The caller already owns
-    // session.console_mutex; notifying under the lock is safe.
+    // session.frame_mutex; notifying under the lock is safe.
     session.remote_frame_cv.notify_all();
 }
 
@@ -1408,54 +1504,102 @@ bool RuntimeManager::ReadRemoteFrame(const std::string& vm_id,
                                      std::chrono::milliseconds wait_timeout) {
     auto session = FindSession(vm_id);
     if (!session || !frame) return false;
-    std::unique_lock<std::mutex> lock(session->frame_mutex);
-
-    // Block the consumer until either the producer queues new slices or the
-    // timeout expires. need_full_frame short-circuits the wait because we can
-    // synthesize a full-frame slice from the shared framebuffer regardless of
-    // whether new partials have arrived.
-    if (wait_timeout.count() > 0 &&
-        !need_full_frame &&
-        session->remote_frame.slices.empty() &&
-        session->running.load()) {
-        session->remote_frame_cv.wait_for(lock, wait_timeout, [&] {
-            return !session->remote_frame.slices.empty() ||
-                   session->remote_frame_force_full ||
-                   !session->running.load();
-        });
-    }
 
-    if ((need_full_frame || session->remote_frame_force_full) &&
-        session->framebuffer &&
-        session->framebuffer->IsValid() &&
-        session->framebuffer->width() > 0 &&
-        session->framebuffer->height() > 0) {
-        const PixelFormat target_format = session->remote_video_format;
-        RemoteVideoSlice full = MakeSliceFromBgra(
-            session->framebuffer->data(),
-            static_cast<int>(session->framebuffer->stride()),
-            0, 0,
-            session->framebuffer->width(),
-            session->framebuffer->height(),
-            target_format);
-        if (!full.data.empty()) {
-            session->remote_frame.slices.clear();
-            session->remote_frame.slices.push_back(std::move(full));
-            session->remote_frame.width = session->framebuffer->width();
-            session->remote_frame.height = session->framebuffer->height();
-            session->remote_frame.format = target_format;
-            session->remote_frame_force_full = false;
+    std::shared_ptr<ipc::SharedFramebuffer> framebuffer;
+    std::vector<ipc::DamageRect> damage;
+    PixelFormat format = PixelFormat::kYuv420p;
+    bool emit_full = false;
+    uint64_t seq = 0;
+    {
+        std::unique_lock<std::mutex> lock(session->frame_mutex);
+
+        // Block the consumer until either the runtime reports damage or the
+        // timeout expires. need_full_frame short-circuits the wait because we
+        // can convert a full frame from the shared framebuffer regardless.
+        if (wait_timeout.count() > 0 &&
+            !need_full_frame &&
+            session->remote_damage.empty() &&
+            !session->remote_frame_force_full &&
+            session->running.load()) {
+            session->remote_frame_cv.wait_for(lock, wait_timeout, [&] {
+                return !session->remote_damage.empty() ||
+                       session->remote_frame_force_full ||
+                       !session->running.load();
+            });
         }
-    }
 
-    if (session->remote_frame.slices.empty()) return false;
+        if (!session->framebuffer || !session->framebuffer->IsValid() ||
+            session->framebuffer->width() == 0 || session->framebuffer->height() == 0) {
+            return false;
+        }
+        emit_full = need_full_frame || session->remote_frame_force_full;
+        if (!emit_full && session->remote_damage.empty()) return false;
+
+        framebuffer = session->framebuffer;
+        damage = session->remote_damage.rects();
+        format = session->remote_video_format;
+        seq = session->remote_frame_seq;
+        session->remote_damage.Clear();
+        session->remote_frame_force_full = false;
+    }
+
+    const uint32_t frame_width = framebuffer->width();
+    const uint32_t frame_height = framebuffer->height();
+    std::vector<DirtyRect> rects;
+    if (!emit_full) {
+        for (const auto& rect : damage) {
+            const DirtyRect dirty = NormalizeDirtyRect(
+                rect.x, rect.y, rect.width, rect.height,
+                frame_width,
+                frame_height,
+                /*force_full_frame=*/false);
+            if (dirty.width == frame_width && dirty.height == frame_height) {
+                rects.clear();
+                break;
+            }
+            rects.push_back(dirty);
+        }
+    }
+    if (rects.empty()) rects.push_back({0, 0, frame_width, frame_height});
+
+    // Reuse the buffers of the slices the caller handed back in.
+    frame->slices.resize(rects.size());
+    for (size_t i = 0; i < rects.size(); ++i) {
+        frame->slices[i].x = rects[i].x;
+        frame->slices[i].y = rects[i].y;
+        frame->slices[i].width = rects[i].width;
+        frame->slices[i].height = rects[i].height;
+    }
+
+    // Convert out of the latest published frame, straight into the
+    // encoder's input picture when the consumer handed over a matching
+    // one. If the runtime kept recycling that buffer underneath us, fall
+    // back to a full frame on the next drain.
+    const VideoPlanes& target = frame->target;
+    frame->converted_in_place = target.planes[0] && target.width == frame_width &&
+                                target.height == frame_height && frame->target_format == format;
+    constexpr int kMaxReadAttempts = 3;
+    bool converted = false;
+    for (int attempt = 0; attempt < kMaxReadAttempts && !converted; ++attempt) {
+        ipc::SharedFramebuffer::FrameView view;
+        if (!framebuffer->BeginRead(&view)) break;
+        const int stride = static_cast<int>(framebuffer->stride());
+        converted = (frame->converted_in_place
+                         ? yuv_converter_.ConvertInto(view.data, stride, format, target, frame->slices)
+                         : yuv_converter_.Convert(view.data, stride, format, &frame->slices)) &&
+                    framebuffer->EndRead(view);
+    }
+    if (!converted) {
+        std::lock_guard<std::mutex> lock(session->frame_mutex);
+        if (session->framebuffer == framebuffer) session->remote_frame_force_full = true;
+        frame->slices.clear();
+        return false;
+    }
 
-    frame->width = session->remote_frame.width;
-    frame->height = session->remote_frame.height;
-    frame->format = session->remote_frame.format;
-    frame->seq = session->remote_frame.seq;
-    frame->slices = std::move(session->remote_frame.slices);
-    session->remote_frame.slices.clear();
+    frame->width = frame_width;
+    frame->height = frame_height;
+    frame->format = format;
+    frame->seq = seq;
     return true;
 }
 
@@ -1590,6 +1734,36 @@ nlohmann::json RuntimeManager::Logs(const std::string& vm_id, size_t max_lines)
     return {{"lines", std::move(lines)}};
 }
 
+bool RuntimeManager::Stats(const std::string& vm_id, nlohmann::json* out, std::string* error) {
+    auto session = FindSession(vm_id);
+    if (!session) {
+        if (error) *error = "VM is not running";
+        return false;
+    }
+    ipc::Message message;
+    message.channel = ipc::Channel::kControl;
+    message.kind = ipc::Kind::kRequest;
+    message.type = "runtime.stats";
+    message.vm_id = vm_id;
+    auto reply = RequestRuntime(session, std::move(message), std::chrono::seconds(1));
+    if (!reply) {
+        if (error) *error = "runtime did not answer stats request";
+        return false;
+    }
+    if (reply->fields["ok"] != "true") {
+        if (error) *error = reply->fields["error"];
+        return false;
+    }
+    auto stats = nlohmann::json::parse(reply->payload.begin(), reply->payload.end(), nullptr, false);
+    if (stats.is_discarded()) {
+        if (error) *error = "runtime returned malformed stats";
+        return false;
+    }
+    stats["vm_id"] = vm_id;
+    *out = std::move(stats);
+    return true;
+}
+
 ProcessResources RuntimeManager::SampleProcessResources(const std::string& vm_id) const {
     auto session = FindSession(vm_id);
     if (!session || session->process_pid <= 0) return {};
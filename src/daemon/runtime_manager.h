@@ -1,9 +1,12 @@
 #pragma once
 
+#include "daemon/boot_image_cache.h"
 #include "daemon/kvm_doctor.h"
 #include "daemon/remote_webrtc.h"
 #include "daemon/resource_monitor.h"
 #include "daemon/vm_store.h"
+#include "daemon/yuv_converter.h"
+#include "ipc/damage_region.h"
 #include "ipc/protocol_v1.h"
 #include "ipc/shared_framebuffer.h"
 #include "ipc/unix_socket.h"
@@ -51,6 +54,7 @@ public:
     bool SendWheelEvent(const std::string& vm_id, int delta);
     bool SetDisplaySize(const std::string& vm_id, uint32_t width, uint32_t height);
     bool SetRemoteVideoPixelFormat(const std::string& vm_id, PixelFormat format);
+    PixelFormat RemoteVideoPixelFormat(const std::string& vm_id) const;
 
     // Push the current spec's forward set to a running runtime via the
     // `runtime.update_network` control message. Reads the latest spec from
@@ -76,12 +80,14 @@ public:
     // if the VM isn't running; the persisted spec is authoritative so the
     // next start will pick up the change either way.
     bool ApplyNetLink(const std::string& vm_id, bool up);
-    // Drain pending YUV slices for this VM into `frame`. When `need_full_frame`
-    // is true, the producer regenerates a single full-frame slice from the
-    // current shared framebuffer state and discards any partial slices.
-    // When `wait_timeout` is non-zero and no slices are pending, this blocks
-    // on the per-session condition variable until either a producer signals new
-    // slices, the timeout expires, or `need_full_frame` lets us synthesize one
+    // Convert the damage pending for this VM into YUV slices in `frame`,
+    // reading the latest shared framebuffer frame. Slice buffers `frame`
+    // already holds are reused, so callers should keep one frame around
+    // across reads. When `need_full_frame` is true, a single full-frame
+    // slice is produced instead of the pending damage.
+    // When `wait_timeout` is non-zero and no damage is pending, this blocks
+    // on the per-session condition variable until either the runtime reports
+    // new damage, the timeout expires, or `need_full_frame` lets us convert
     // immediately from the shared framebuffer.
     bool ReadRemoteFrame(const std::string& vm_id,
                          RemoteVideoFrame* frame,
@@ -155,6 +161,11 @@ public:
 
     nlohmann::json Logs(const std::string& vm_id, size_t max_lines) const;
 
+    // Per-vCPU exit counters and latency histograms, fetched live from the
+    // runtime via `runtime.stats`. Returns false (with `error` set) if the VM
+    // is not running or the runtime does not answer within a second.
+    bool Stats(const std::string& vm_id, nlohmann::json* out, std::string* error);
+
     // Returns a fresh `ProcessResources` for the VM (rss + cpu_percent),
     // sampling /proc using the shared `ProcessSampler` so consecutive callers
     // see meaningful CPU% values. Returns an empty struct if the VM is not
@@ -175,10 +186,9 @@ private:
         std::thread log_thread;
         std::mutex send_mutex;
         // `console_mutex` covers console history / log lines / cursor /
-        // last_frame / last_audio / last_clipboard / display_state. Hot-path
-        // video conversion lives under `frame_mutex` instead so that libyuv
-        // ARGB→YUV conversion (a few ms per 1080p frame) does not block readers of
-        // those status fields, console output, or RemoteRuntimeSnapshot.
+        // last_frame / last_audio / last_clipboard / display_state. Remote
+        // video damage lives under `frame_mutex` instead; the ARGB→YUV
+        // conversion itself runs in ReadRemoteFrame with neither held.
         std::mutex console_mutex;
         std::mutex frame_mutex;
         std::vector<std::shared_ptr<ipc::UnixSocketConnection>> console_clients;
@@ -197,16 +207,21 @@ private:
         std::ofstream log_file;
         nlohmann::json display_state = nlohmann::json::object();
         nlohmann::json last_frame = nlohmann::json::object();
-        // `framebuffer`, `remote_frame`, and `remote_frame_force_full` are
-        // protected by `frame_mutex`.
-        std::unique_ptr<ipc::SharedFramebuffer> framebuffer;
-        RemoteVideoFrame remote_frame;
+        // `framebuffer`, `remote_damage`, `remote_frame_seq`,
+        // `remote_video_format` and `remote_frame_force_full` are protected
+        // by `frame_mutex`. A drain holds its own reference to the
+        // framebuffer so a resize cannot unmap it mid-conversion.
+        std::shared_ptr<ipc::SharedFramebuffer> framebuffer;
+        // Damage announced by the runtime since the last drain; converted
+        // from the latest frame when the consumer asks for it.
+        ipc::DamageRegion remote_damage;
+        uint64_t remote_frame_seq = 0;
         PixelFormat remote_video_format = PixelFormat::kYuv420p;
         // When true, the next reader drain will emit a full-frame slice. Set
         // on resize so the encoder's persistent input buffer can be reseeded.
         bool remote_frame_force_full = true;
-        // Producers (UpdateRemoteVideoFrameLocked) notify this CV after queueing
-        // new slices so consumers waiting in ReadRemoteFrame wake up immediately
+        // UpdateRemoteVideoFrameLocked notifies this CV after recording new
+        // damage so consumers waiting in ReadRemoteFrame wake up immediately
         // instead of polling. Tied to `frame_mutex`.
         std::condition_variable remote_frame_cv;
         nlohmann::json cursor = nlohmann::json::object();
@@ -214,11 +229,30 @@ private:
         nlohmann::json last_clipboard = nlohmann::json::object();
         std::atomic<bool> running{false};
         std::atomic<bool> stop_requested{false};
+        // Outstanding request/response exchanges started by RequestRuntime.
+        // An entry is created (empty) before the request is sent; the reader
+        // thread fills it in when the matching response arrives.
+        std::mutex reply_mutex;
+        std::condition_variable reply_cv;
+        std::map<uint64_t, std::optional<ipc::Message>> pending_replies;
+        std::atomic<uint64_t> next_request_id{1};
+        // Per-VM cgroup created for `placement.cpu_quota_pct`; removed
+        // once the runtime has been reaped. Empty when no quota applies.
+        std::string cgroup_dir;
+    };
+
+    // Host CPUs handed to one runtime, after "auto" / housekeeping
+    // defaults have been resolved against the rest of the host.
+    struct ResolvedPlacement {
+        std::vector<uint32_t> vcpu_cpus;
+        std::vector<uint32_t> io_cpus;
+        int vcpu_fifo_priority = 0;
     };
 
     // Structured preflight failure. `code` is one of `kvm_unsupported`,
     // `kernel_missing`, `initrd_missing`, `disk_missing`, `permission_denied`,
-    // `insufficient_memory`, `port_conflict`. `message` is human-readable
+    // `insufficient_memory`, `port_conflict`, `cpu_unavailable`,
+    // `invalid_placement`. `message` is human-readable
     // detail (with paths, requested vs available bytes, host:port that
     // collided, etc.).
     struct StartFailure {
@@ -226,7 +260,17 @@ private:
         std::string message;
     };
     std::optional<StartFailure> ValidateStart(const VmSpec& spec) const;
-    std::vector<std::string> BuildRuntimeArgs(const VmSpec& spec, const std::string& control_socket) const;
+    // Resolves `spec.placement` and reserves the vCPU cores for `vm_id` in
+    // `cpu_reservations_` so concurrent "auto" starts never share a core.
+    // The reservation is dropped by ReleasePlacement.
+    std::optional<StartFailure> ResolvePlacement(const VmSpec& spec, ResolvedPlacement* out);
+    void ReleasePlacement(const std::string& vm_id);
+    // Creates `<cgroup_root>/vm-<id>` with the requested cpu.max and returns
+    // an O_CLOEXEC fd on its cgroup.procs for the child to join, or -1.
+    int PrepareCgroup(RuntimeSession& session);
+    std::vector<std::string> BuildRuntimeArgs(const VmSpec& spec,
+                                              const ResolvedPlacement& placement,
+                                              const std::string& control_socket) const;
     // Combines the persisted guest_forwards with the auto-injected LLM
     // proxy guestfwd (10.0.2.3:80 -> host 127.0.0.1:<llm_port>) when one
     // is currently bound. Used by both BuildRuntimeArgs (initial start)
@@ -239,6 +283,11 @@ private:
     void HandleRuntimeMessage(std::shared_ptr<RuntimeSession> session, ipc::Message message);
     void UpdateRemoteVideoFrameLocked(RuntimeSession& session, const ipc::Message& message);
     bool SendRuntime(std::shared_ptr<RuntimeSession> session, const ipc::Message& message);
+    // Send `message` with a fresh request_id and block until the runtime's
+    // response arrives, the session dies, or `timeout` elapses.
+    std::optional<ipc::Message> RequestRuntime(std::shared_ptr<RuntimeSession> session,
+                                               ipc::Message message,
+                                               std::chrono::milliseconds timeout);
     void BroadcastConsole(std::shared_ptr<RuntimeSession> session, const std::string& data);
     void ReadConsoleClient(std::shared_ptr<RuntimeSession> session,
                            std::shared_ptr<ipc::UnixSocketConnection> client);
@@ -247,6 +296,9 @@ private:
 
     DaemonConfig config_;
     VmStore& store_;
+    BootImageCache boot_cache_;
+    // Shared by every session's remote video drain.
+    YuvSliceConverter yuv_converter_;
     mutable ProcessSampler process_sampler_;
     mutable std::mutex mutex_;
     mutable std::mutex callback_mutex_;
@@ -259,6 +311,8 @@ private:
     // for the lifetime of a remote session.
     std::map<std::string, ClipboardCallback> clipboard_callbacks_;
     std::map<std::string, std::shared_ptr<RuntimeSession>> sessions_;
+    // vCPU cores pinned by each starting/running VM, guarded by `mutex_`.
+    std::map<std::string, std::vector<uint32_t>> cpu_reservations_;
 
     // Background worker that re-launches a runtime after the guest issues a
     // reboot (see ReadLogs). We deliberately use one long-lived thread instead
@@ -0,0 +1,202 @@
+#include "daemon/yuv_converter.h"
+
+#ifdef TENBOX_ENABLE_LIBYUV
+#include <libyuv.h>
+#endif
+
+#include <pthread.h>
+
+#include <algorithm>
+
+namespace tenbox::daemon {
+
+namespace {
+
+// Below this many pixels a band is not worth handing to another thread.
+constexpr uint64_t kMinBandPixels = 256 * 1024;
+constexpr unsigned kMaxWorkers = 3;
+
+size_t ChromaRows(PixelFormat format, uint32_t rows) {
+    return format == PixelFormat::kYuv444p ? rows : (rows + 1) / 2;
+}
+
+const uint8_t* SourceAt(const uint8_t* bgra, int bgra_stride, uint32_t x, uint32_t y) {
+    return bgra + static_cast<size_t>(y) * static_cast<size_t>(bgra_stride) +
+           static_cast<size_t>(x) * 4;
+}
+
+}  // namespace
+
+struct YuvSliceConverter::Batch {
+    size_t remaining = 0;
+    bool ok = true;
+    std::condition_variable done;
+};
+
+YuvSliceConverter::YuvSliceConverter() {
+    // Leave most cores to the encoder and the VMs themselves.
+    const unsigned cores = std::thread::hardware_concurrency();
+    const unsigned workers = cores >= 4 ? std::min(kMaxWorkers, cores / 2 - 1) : 0;
+    for (unsigned i = 0; i < workers; ++i) {
+        workers_.emplace_back(&YuvSliceConverter::WorkerLoop, this);
+    }
+}
+
+YuvSliceConverter::~YuvSliceConverter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+}
+
+bool YuvSliceConverter::Convert(const uint8_t* bgra, int bgra_stride, PixelFormat format,
+                                std::vector<RemoteVideoSlice>* slices) {
+    if (!bgra || bgra_stride <= 0 || !slices) return false;
+    if (format != PixelFormat::kYuv420p && format != PixelFormat::kYuv444p) return false;
+
+    std::vector<Band> bands;
+    for (auto& slice : *slices) {
+        if (slice.width == 0 || slice.height == 0) return false;
+        slice.strides[0] = static_cast<int>(slice.width);
+        slice.strides[1] = static_cast<int>(
+            format == PixelFormat::kYuv444p ? slice.width : (slice.width + 1) / 2);
+        slice.strides[2] = slice.strides[1];
+        const size_t y_size = static_cast<size_t>(slice.strides[0]) * slice.height;
+        const size_t uv_size = static_cast<size_t>(slice.strides[1]) * ChromaRows(format, slice.height);
+        slice.data.resize(y_size + uv_size * 2);
+
+        uint8_t* const dst[3] = {slice.data.data(), slice.data.data() + y_size,
+                                 slice.data.data() + y_size + uv_size};
+        Split(format, SourceAt(bgra, bgra_stride, slice.x, slice.y), bgra_stride,
+              dst, slice.strides, slice.width, slice.height, &bands);
+    }
+    return Run(bands);
+}
+
+bool YuvSliceConverter::ConvertInto(const uint8_t* bgra, int bgra_stride, PixelFormat format,
+                                    const VideoPlanes& target,
+                                    const std::vector<RemoteVideoSlice>& slices) {
+    if (!bgra || bgra_stride <= 0) return false;
+    if (format != PixelFormat::kYuv420p && format != PixelFormat::kYuv444p) return false;
+    if (!target.planes[0] || !target.planes[1] || !target.planes[2]) return false;
+
+    const bool yuv444 = format == PixelFormat::kYuv444p;
+    std::vector<Band> bands;
+    for (const auto& slice : slices) {
+        if (slice.width == 0 || slice.height == 0) return false;
+        if (slice.x + slice.width > target.width || slice.y + slice.height > target.height) return false;
+        if (!yuv444 && ((slice.x & 1) || (slice.y & 1))) return false;
+        const size_t uv_x = yuv444 ? slice.x : slice.x / 2;
+        const size_t uv_y = yuv444 ? slice.y : slice.y / 2;
+        uint8_t* const dst[3] = {
+            target.planes[0] + static_cast<size_t>(slice.y) * target.strides[0] + slice.x,
+            target.planes[1] + uv_y * target.strides[1] + uv_x,
+            target.planes[2] + uv_y * target.strides[2] + uv_x,
+        };
+        Split(format, SourceAt(bgra, bgra_stride, slice.x, slice.y), bgra_stride,
+              dst, target.strides, slice.width, slice.height, &bands);
+    }
+    return Run(bands);
+}
+
+void YuvSliceConverter::Split(PixelFormat format, const uint8_t* src, int src_stride,
+                              uint8_t* const dst[3], const int dst_strides[3],
+                              uint32_t width, uint32_t height, std::vector<Band>* bands) const {
+    // Bands start on even rows so 4:2:0 chroma rows are never shared.
+    const uint64_t pixels = static_cast<uint64_t>(width) * height;
+    const uint64_t count = std::clamp<uint64_t>(pixels / kMinBandPixels, 1, workers_.size() + 1);
+    uint32_t band_rows = static_cast<uint32_t>((height + count - 1) / count);
+    band_rows = (band_rows + 1) & ~uint32_t{1};
+    for (uint32_t row = 0; row < height; row += band_rows) {
+        const size_t uv_row = format == PixelFormat::kYuv444p ? row : row / 2;
+        Band band;
+        band.format = format;
+        band.src = src + static_cast<size_t>(row) * src_stride;
+        band.src_stride = src_stride;
+        band.dst[0] = dst[0] + static_cast<size_t>(row) * dst_strides[0];
+        band.dst[1] = dst[1] + uv_row * dst_strides[1];
+        band.dst[2] = dst[2] + uv_row * dst_strides[2];
+        std::copy(dst_strides, dst_strides + 3, band.dst_strides);
+        band.width = width;
+        band.height = std::min(band_rows, height - row);
+        bands->push_back(band);
+    }
+}
+
+bool YuvSliceConverter::Run(std::vector<Band>& bands) {
+    if (workers_.empty() || bands.size() <= 1) {
+        for (const auto& band : bands) {
+            if (!ConvertBand(band)) return false;
+        }
+        return true;
+    }
+
+    // Queue everything, then work through our own bands alongside the
+    // workers until the batch is done.
+    Batch batch;
+    for (auto& band : bands) band.batch = &batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    batch.remaining = bands.size();
+    for (const auto& band : bands) bands_.push_back(band);
+    lock.unlock();
+    cv_.notify_all();
+    lock.lock();
+    for (;;) {
+        auto it = std::find_if(bands_.begin(), bands_.end(),
+                               [&](const Band& band) { return band.batch == &batch; });
+        if (it == bands_.end()) break;
+        Band band = *it;
+        bands_.erase(it);
+        lock.unlock();
+        const bool ok = ConvertBand(band);
+        lock.lock();
+        if (!ok) batch.ok = false;
+        --batch.remaining;
+    }
+    batch.done.wait(lock, [&] { return batch.remaining == 0; });
+    return batch.ok;
+}
+
+void YuvSliceConverter::WorkerLoop() {
+    pthread_setname_np(pthread_self(), "yuv-convert");
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stopping_ || !bands_.empty(); });
+        if (stopping_) return;
+        Band band = bands_.front();
+        bands_.pop_front();
+        lock.unlock();
+        const bool ok = ConvertBand(band);
+        lock.lock();
+        if (!ok) band.batch->ok = false;
+        if (--band.batch->remaining == 0) band.batch->done.notify_all();
+    }
+}
+
+bool YuvSliceConverter::ConvertBand(const Band& band) {
+#ifdef TENBOX_ENABLE_LIBYUV
+    const int rc = band.format == PixelFormat::kYuv444p
+        ? libyuv::ARGBToI444(
+            band.src, band.src_stride,
+            band.dst[0], band.dst_strides[0],
+            band.dst[1], band.dst_strides[1],
+            band.dst[2], band.dst_strides[2],
+            static_cast<int>(band.width),
+            static_cast<int>(band.height))
+        : libyuv::ARGBToI420(
+            band.src, band.src_stride,
+            band.dst[0], band.dst_strides[0],
+            band.dst[1], band.dst_strides[1],
+            band.dst[2], band.dst_strides[2],
+            static_cast<int>(band.width),
+            static_cast<int>(band.height));
+    return rc == 0;
+#else
+    (void)band;
+    return false;
+#endif
+}
+
+}  // namespace tenbox::daemon
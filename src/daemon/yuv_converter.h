@@ -0,0 +1,71 @@
+#pragma once
+
+#include "daemon/remote_webrtc.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tenbox::daemon {
+
+// BGRA -> planar YUV conversion for remote video slices.
+//
+// Rects big enough to matter (a full 4K frame takes several ms on one core)
+// are cut into horizontal bands that a few worker threads convert in
+// parallel with the calling thread; small rects are converted inline. Safe
+// to call from several threads at once; each call waits only for its own
+// bands.
+class YuvSliceConverter {
+public:
+    YuvSliceConverter();
+    ~YuvSliceConverter();
+
+    YuvSliceConverter(const YuvSliceConverter&) = delete;
+    YuvSliceConverter& operator=(const YuvSliceConverter&) = delete;
+
+    // Fill every slice in |slices| from the BGRA image at |bgra|. Callers set
+    // x/y/width/height; strides and data are filled in here, reusing
+    // whatever capacity slice.data already has. Returns false if a
+    // conversion failed or libyuv is not compiled in.
+    bool Convert(const uint8_t* bgra, int bgra_stride, PixelFormat format,
+                 std::vector<RemoteVideoSlice>* slices);
+
+    // Convert the regions named by |slices| (geometry only; 4:2:0 regions
+    // must start on even coordinates) straight into the full-frame planes
+    // of |target|, at the same position. slice.data is left alone.
+    bool ConvertInto(const uint8_t* bgra, int bgra_stride, PixelFormat format,
+                     const VideoPlanes& target, const std::vector<RemoteVideoSlice>& slices);
+
+private:
+    struct Batch;
+    struct Band {
+        Batch* batch = nullptr;
+        PixelFormat format = PixelFormat::kYuv420p;
+        const uint8_t* src = nullptr;
+        int src_stride = 0;
+        uint8_t* dst[3] = {};
+        int dst_strides[3] = {};
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    // Cut one region into bands and append them to |bands|. |dst| points
+    // at the region's first row in each plane.
+    void Split(PixelFormat format, const uint8_t* src, int src_stride,
+               uint8_t* const dst[3], const int dst_strides[3],
+               uint32_t width, uint32_t height, std::vector<Band>* bands) const;
+    bool Run(std::vector<Band>& bands);
+    static bool ConvertBand(const Band& band);
+    void WorkerLoop();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Band> bands_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+};
+
+}  // namespace tenbox::daemon
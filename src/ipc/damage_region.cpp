@@ -0,0 +1,124 @@
+#include "ipc/damage_region.h"
+
+#include <algorithm>
+
+namespace ipc {
+
+namespace {
+
+uint64_t Area(const DamageRect& r) {
+    return static_cast<uint64_t>(r.width) * r.height;
+}
+
+DamageRect Union(const DamageRect& a, const DamageRect& b) {
+    uint32_t x0 = std::min(a.x, b.x);
+    uint32_t y0 = std::min(a.y, b.y);
+    uint32_t x1 = std::max(a.x + a.width, b.x + b.width);
+    uint32_t y1 = std::max(a.y + a.height, b.y + b.height);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+bool Overlaps(const DamageRect& a, const DamageRect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// Side by side (or stacked) with the same span: the union adds no area.
+bool Adjoins(const DamageRect& a, const DamageRect& b) {
+    if (a.y == b.y && a.height == b.height) {
+        return a.x + a.width == b.x || b.x + b.width == a.x;
+    }
+    if (a.x == b.x && a.width == b.width) {
+        return a.y + a.height == b.y || b.y + b.height == a.y;
+    }
+    return false;
+}
+
+void PutU16(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v & 0xff));
+    out.push_back(static_cast<uint8_t>((v >> 8) & 0xff));
+}
+
+uint32_t GetU16(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8);
+}
+
+}  // namespace
+
+void DamageRegion::Add(const DamageRect& rect) {
+    if (rect.width == 0 || rect.height == 0) return;
+
+    // Absorb every rect the new one touches; the grown rect may reach
+    // others, so rescan until nothing merges.
+    DamageRect merged = rect;
+    for (bool again = true; again;) {
+        again = false;
+        for (size_t i = 0; i < rects_.size(); ++i) {
+            if (Overlaps(rects_[i], merged) || Adjoins(rects_[i], merged)) {
+                merged = Union(rects_[i], merged);
+                rects_.erase(rects_.begin() + static_cast<std::ptrdiff_t>(i));
+                again = true;
+                break;
+            }
+        }
+    }
+    rects_.push_back(merged);
+
+    while (rects_.size() > kMaxRects) {
+        size_t best_i = 0, best_j = 1;
+        uint64_t best_cost = UINT64_MAX;
+        for (size_t i = 0; i < rects_.size(); ++i) {
+            for (size_t j = i + 1; j < rects_.size(); ++j) {
+                // Rects in the list never overlap, so this is the area
+                // the merge adds.
+                uint64_t cost = Area(Union(rects_[i], rects_[j])) -
+                                Area(rects_[i]) - Area(rects_[j]);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        DamageRect u = Union(rects_[best_i], rects_[best_j]);
+        rects_.erase(rects_.begin() + static_cast<std::ptrdiff_t>(best_j));
+        rects_.erase(rects_.begin() + static_cast<std::ptrdiff_t>(best_i));
+        // The merged rect may now overlap others; re-add it through the
+        // normal path.
+        Add(u);
+    }
+}
+
+DamageRect DamageRegion::Bounds() const {
+    if (rects_.empty()) return {};
+    DamageRect bounds = rects_.front();
+    for (const auto& r : rects_) bounds = Union(bounds, r);
+    return bounds;
+}
+
+std::vector<uint8_t> EncodeDamageRects(const std::vector<DamageRect>& rects) {
+    std::vector<uint8_t> out;
+    out.reserve(rects.size() * 8);
+    for (const auto& r : rects) {
+        if (r.x > 0xffff || r.y > 0xffff || r.width > 0xffff || r.height > 0xffff) return {};
+        PutU16(out, r.x);
+        PutU16(out, r.y);
+        PutU16(out, r.width);
+        PutU16(out, r.height);
+    }
+    return out;
+}
+
+bool DecodeDamageRects(const uint8_t* data, size_t size, std::vector<DamageRect>* out) {
+    if (size % 8 != 0) return false;
+    out->clear();
+    out->reserve(size / 8);
+    for (size_t off = 0; off < size; off += 8) {
+        DamageRect r{GetU16(data + off), GetU16(data + off + 2),
+                     GetU16(data + off + 4), GetU16(data + off + 6)};
+        if (r.width != 0 && r.height != 0) out->push_back(r);
+    }
+    return true;
+}
+
+}  // namespace ipc
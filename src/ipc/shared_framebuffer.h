@@ -1,18 +1,40 @@
 #pragma once
 
+#include "ipc/damage_region.h"
+
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace ipc {
 
+struct SharedFramebufferHeader;
+
 // Cross-platform shared-memory framebuffer for zero-copy frame transport
-// between the Runtime (writer) and Manager (reader) processes.
+// between the Runtime (writer) and Manager / daemon (readers).
+//
+// The mapping holds a header page and kBufferCount frames. The writer
+// composes into a back buffer and publishes it; readers always take the
+// latest published frame and check afterwards that it was not recycled
+// while they read it (a per-buffer sequence lock), so nobody ever sees a
+// torn frame and the writer never waits for a slow reader.
 //
-// Runtime side:  Create() → write pixels → notify via IPC
-// Manager side:  Open()   → read pixels on IPC notification
+// Runtime side:  Create() → write back_buffer() → Publish() → notify via IPC
+// Manager side:  Open()   → BeginRead() → read pixels → EndRead() on IPC notification
 class SharedFramebuffer {
 public:
+    static constexpr uint32_t kBufferCount = 3;
+
+    // A published frame as seen by a reader. Valid only if EndRead()
+    // returns true for it afterwards.
+    struct FrameView {
+        const uint8_t* data = nullptr;
+        uint32_t index = 0;
+        uint64_t seq = 0;
+        uint64_t frame_seq = 0;  // increments with every Publish()
+    };
+
     SharedFramebuffer() = default;
     ~SharedFramebuffer();
 
@@ -29,23 +51,55 @@ public:
     // Close and unmap. If this side created the shm, also unlinks/destroys it.
     void Close();
 
-    bool IsValid() const { return data_ != nullptr; }
+    bool IsValid() const { return map_ != nullptr; }
+
+    // Writer: the frame being composed. It already holds the latest
+    // published frame, so only the new damage needs to be written.
+    uint8_t* back_buffer() const;
 
-    uint8_t* data() const { return data_; }
-    size_t size() const { return size_; }
+    // Writer: make the back buffer the latest frame. |damage| lists what
+    // changed since the previous Publish() (empty means everything); it is
+    // used to bring the next back buffer up to date.
+    void Publish(const std::vector<DamageRect>& damage);
+
+    // Reader: grab the latest published frame. Returns false if nothing was
+    // published yet.
+    bool BeginRead(FrameView* view) const;
+
+    // Reader: true if |view| was not recycled by the writer while it was
+    // being read; otherwise what was read may be torn and should be redone.
+    bool EndRead(const FrameView& view) const;
+
+    size_t size() const { return frame_bytes_; }  // bytes of one frame
     uint32_t width() const { return width_; }
     uint32_t height() const { return height_; }
     uint32_t stride() const { return width_ * 4; }
     const std::string& name() const { return name_; }
 
 private:
-    uint8_t* data_ = nullptr;
-    size_t size_ = 0;
+    static constexpr size_t kHeaderBytes = 4096;
+
+    static size_t MappingSize(uint32_t width, uint32_t height);
+    SharedFramebufferHeader* header() const;
+    uint8_t* buffer(uint32_t index) const;
+    void InitHeader();
+    bool CheckHeader() const;
+    void BeginWrite(uint32_t index);
+
+    uint8_t* map_ = nullptr;
+    size_t map_size_ = 0;
+    size_t frame_bytes_ = 0;
     uint32_t width_ = 0;
     uint32_t height_ = 0;
     std::string name_;
     bool is_owner_ = false;
 
+    // Writer state: the buffer being composed, the publish counter and,
+    // per buffer, the damage published since that buffer last was.
+    uint32_t back_ = 0;
+    uint64_t frame_seq_ = 0;
+    DamageRegion stale_[kBufferCount];
+
 #ifdef _WIN32
     void* map_handle_ = nullptr;
 #else
@@ -15,7 +15,7 @@ SharedFramebuffer::~SharedFramebuffer() {
 bool SharedFramebuffer::Create(const std::string& name, uint32_t width, uint32_t height) {
     Close();
 
-    size_t bytes = static_cast<size_t>(width) * height * 4;
+    size_t bytes = MappingSize(width, height);
     if (bytes == 0) return false;
 
     shm_unlink(name.c_str());
@@ -36,20 +36,22 @@ bool SharedFramebuffer::Create(const std::string& name, uint32_t width, uint32_t
         return false;
     }
 
-    data_ = static_cast<uint8_t*>(ptr);
-    size_ = bytes;
+    map_ = static_cast<uint8_t*>(ptr);
+    map_size_ = bytes;
+    frame_bytes_ = static_cast<size_t>(width) * height * 4;
     width_ = width;
     height_ = height;
     name_ = name;
     shm_fd_ = fd;
     is_owner_ = true;
+    InitHeader();
     return true;
 }
 
 bool SharedFramebuffer::Open(const std::string& name, uint32_t width, uint32_t height) {
     Close();
 
-    size_t bytes = static_cast<size_t>(width) * height * 4;
+    size_t bytes = MappingSize(width, height);
     if (bytes == 0) return false;
 
     int fd = shm_open(name.c_str(), O_RDONLY, 0);
@@ -61,20 +63,25 @@ bool SharedFramebuffer::Open(const std::string& name, uint32_t width, uint32_t h
         return false;
     }
 
-    data_ = static_cast<uint8_t*>(ptr);
-    size_ = bytes;
+    map_ = static_cast<uint8_t*>(ptr);
+    map_size_ = bytes;
+    frame_bytes_ = static_cast<size_t>(width) * height * 4;
     width_ = width;
     height_ = height;
     name_ = name;
     shm_fd_ = fd;
     is_owner_ = false;
+    if (!CheckHeader()) {
+        Close();
+        return false;
+    }
     return true;
 }
 
 void SharedFramebuffer::Close() {
-    if (data_) {
-        munmap(data_, size_);
-        data_ = nullptr;
+    if (map_) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
     }
     if (shm_fd_ >= 0) {
         close(shm_fd_);
@@ -83,7 +90,8 @@ void SharedFramebuffer::Close() {
     if (is_owner_ && !name_.empty()) {
         shm_unlink(name_.c_str());
     }
-    size_ = 0;
+    map_size_ = 0;
+    frame_bytes_ = 0;
     width_ = 0;
     height_ = 0;
     name_.clear();
@@ -507,7 +507,14 @@ static std::string HexDecode(const std::string& hex) {
         size_t needed = static_cast<size_t>(h - 1) * shm_stride + static_cast<size_t>(w) * 4;
         if (offset + needed > _shmFb.size()) return;
 
-        fh(_shmFb.data() + offset, needed, w, h, shm_stride, resW, resH, dirtyX, dirtyY);
+        // The handler blits synchronously; redo it if the runtime recycled
+        // the buffer underneath, keeping the last attempt after a few tries.
+        for (int attempt = 0; attempt < 3; ++attempt) {
+            ipc::SharedFramebuffer::FrameView view;
+            if (!_shmFb.BeginRead(&view)) return;
+            fh(view.data + offset, needed, w, h, shm_stride, resW, resH, dirtyX, dirtyY);
+            if (_shmFb.EndRead(view)) break;
+        }
     }
     else if (msg.type == "display.cursor") {
         BOOL visible = (getU32("visible") != 0);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ipc {
+
+struct DamageRect {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// Damage accumulated on the shared framebuffer between two
+// display.frame_ready notifications. Overlapping rects are merged into
+// their bounding box, as are rects whose union is exact (same row or
+// column span, touching). Past kMaxRects the two rects whose merge adds
+// the least area are combined, so the list stays short and the union of
+// everything added is always covered.
+class DamageRegion {
+public:
+    static constexpr size_t kMaxRects = 16;
+
+    void Add(const DamageRect& rect);
+    void Clear() { rects_.clear(); }
+
+    bool empty() const { return rects_.empty(); }
+    const std::vector<DamageRect>& rects() const { return rects_; }
+    DamageRect Bounds() const;
+
+private:
+    std::vector<DamageRect> rects_;
+};
+
+// display.frame_ready payload: rect_count entries of four little-endian
+// uint16 values (x, y, width, height); 8 bytes per rect. Returns an empty
+// buffer when a coordinate does not fit, in which case senders omit the
+// payload and readers fall back to the bounding box in the header fields.
+std::vector<uint8_t> EncodeDamageRects(const std::vector<DamageRect>& rects);
+bool DecodeDamageRects(const uint8_t* data, size_t size, std::vector<DamageRect>* out);
+
+}  // namespace ipc
@@ -0,0 +1,152 @@
+#include "ipc/shared_framebuffer.h"
+
+#include <atomic>
+#include <cstring>
+
+namespace ipc {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x42464254;  // "TBFB"
+constexpr uint32_t kVersion = 2;
+constexpr uint32_t kSlotRects = 16;
+
+}  // namespace
+
+// Lives at the start of the mapping; both sides build it from this
+// definition. Only lock-free atomics, so it works across processes.
+struct SharedFramebufferSlot {
+    std::atomic<uint64_t> seq;  // odd while the writer fills the buffer
+    uint64_t frame_seq;         // Publish() count of the frame held, 0 = none
+    uint32_t rect_count;        // damage vs. the previous frame, 0 = all
+    uint32_t reserved;
+    DamageRect rects[kSlotRects];
+};
+
+struct SharedFramebufferHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t buffer_count;
+    std::atomic<uint32_t> latest;  // index of the newest published buffer
+    uint32_t reserved;
+    SharedFramebufferSlot slots[SharedFramebuffer::kBufferCount];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+size_t SharedFramebuffer::MappingSize(uint32_t width, uint32_t height) {
+    static_assert(sizeof(SharedFramebufferHeader) <= kHeaderBytes);
+    size_t frame = static_cast<size_t>(width) * height * 4;
+    return frame == 0 ? 0 : kHeaderBytes + frame * kBufferCount;
+}
+
+SharedFramebufferHeader* SharedFramebuffer::header() const {
+    return reinterpret_cast<SharedFramebufferHeader*>(map_);
+}
+
+uint8_t* SharedFramebuffer::buffer(uint32_t index) const {
+    return map_ + kHeaderBytes + frame_bytes_ * index;
+}
+
+uint8_t* SharedFramebuffer::back_buffer() const {
+    return map_ ? buffer(back_) : nullptr;
+}
+
+void SharedFramebuffer::InitHeader() {
+    // The mapping starts out zeroed: every buffer holds the same (black)
+    // frame, none of it is stale, and buffer 0 counts as published.
+    auto* hdr = header();
+    hdr->magic = kMagic;
+    hdr->version = kVersion;
+    hdr->width = width_;
+    hdr->height = height_;
+    hdr->stride = stride();
+    hdr->buffer_count = kBufferCount;
+    hdr->latest.store(0, std::memory_order_relaxed);
+    for (auto& region : stale_) region.Clear();
+    frame_seq_ = 0;
+    back_ = 1;
+    BeginWrite(back_);
+}
+
+bool SharedFramebuffer::CheckHeader() const {
+    const auto* hdr = header();
+    return hdr->magic == kMagic && hdr->version == kVersion &&
+           hdr->width == width_ && hdr->height == height_ &&
+           hdr->stride == stride() && hdr->buffer_count == kBufferCount;
+}
+
+void SharedFramebuffer::BeginWrite(uint32_t index) {
+    auto& slot = header()->slots[index];
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void SharedFramebuffer::Publish(const std::vector<DamageRect>& damage) {
+    if (!map_ || !is_owner_) return;
+    auto* hdr = header();
+    auto& slot = hdr->slots[back_];
+    slot.frame_seq = ++frame_seq_;
+    slot.rect_count = damage.size() <= kSlotRects ? static_cast<uint32_t>(damage.size()) : 0;
+    for (uint32_t i = 0; i < slot.rect_count; ++i) slot.rects[i] = damage[i];
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    hdr->latest.store(back_, std::memory_order_release);
+
+    const DamageRect full{0, 0, width_, height_};
+    for (uint32_t i = 0; i < kBufferCount; ++i) {
+        if (i == back_) continue;
+        if (damage.empty()) stale_[i].Add(full);
+        for (const auto& r : damage) stale_[i].Add(r);
+    }
+
+    // Recycle the oldest buffer and copy in what it missed from the frame
+    // just published. A reader still on it fails EndRead() and retries.
+    const uint32_t published = back_;
+    back_ = (back_ + 1) % kBufferCount;
+    BeginWrite(back_);
+    const uint8_t* src = buffer(published);
+    uint8_t* dst = buffer(back_);
+    const size_t row_stride = stride();
+    for (const auto& r : stale_[back_].rects()) {
+        if (r.x >= width_ || r.y >= height_) continue;
+        size_t row_bytes = static_cast<size_t>(std::min(r.width, width_ - r.x)) * 4;
+        uint32_t rows = std::min(r.height, height_ - r.y);
+        size_t off = static_cast<size_t>(r.y) * row_stride + static_cast<size_t>(r.x) * 4;
+        for (uint32_t row = 0; row < rows; ++row, off += row_stride) {
+            std::memcpy(dst + off, src + off, row_bytes);
+        }
+    }
+    stale_[back_].Clear();
+}
+
+bool SharedFramebuffer::BeginRead(FrameView* view) const {
+    if (!map_) return false;
+    const auto* hdr = header();
+    // |latest| only ever names a complete frame, but the writer may have
+    // moved on and started recycling it by the time we look.
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        uint32_t index = hdr->latest.load(std::memory_order_acquire);
+        if (index >= kBufferCount) return false;
+        const auto& slot = hdr->slots[index];
+        uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+        view->data = buffer(index);
+        view->index = index;
+        view->seq = seq;
+        view->frame_seq = slot.frame_seq;
+        return view->frame_seq != 0;
+    }
+    return false;
+}
+
+bool SharedFramebuffer::EndRead(const FrameView& view) const {
+    if (!map_ || view.index >= kBufferCount) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header()->slots[view.index].seq.load(std::memory_order_relaxed) == view.seq;
+}
+
+}  // namespace ipc
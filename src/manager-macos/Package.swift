@@ -59,6 +59,7 @@ let package = Package(
                        "VmProcessManager.swift", "TenBox-Bridging-Header.h"],
             sources: ["Sources/TenBoxBridge.mm", "Sources/TenBoxIPC.mm",
                        "Sources/ipc/unix_socket.cpp", "Sources/ipc/protocol_v1.cpp",
+                       "Sources/ipc/damage_region.cpp", "Sources/ipc/shared_framebuffer.cpp",
                        "Sources/ipc/shared_framebuffer_posix.cpp"],
             publicHeadersPath: "include",
             cxxSettings: [
@@ -1842,13 +1842,20 @@ void ManagerService::HandleIncomingMessage(const std::string& vm_id, const ipc::
         size_t row_bytes = static_cast<size_t>(dw) * 4;
         frame.pixels.resize(row_bytes * dh);
         uint32_t src_stride = fb->stride();
-        const uint8_t* src = fb->data();
-        for (uint32_t row = 0; row < dh; ++row) {
-            size_t src_off = static_cast<size_t>(dy + row) * src_stride +
-                             static_cast<size_t>(dx) * 4;
-            size_t dst_off = static_cast<size_t>(row) * row_bytes;
-            if (src_off + row_bytes > fb->size()) break;
-            std::memcpy(frame.pixels.data() + dst_off, src + src_off, row_bytes);
+        // Copy out of the latest published buffer and redo the copy if the
+        // runtime recycled it meanwhile. After a few tries keep the last
+        // copy; a later frame repaints whatever tore.
+        for (int attempt = 0; attempt < 3; ++attempt) {
+            ipc::SharedFramebuffer::FrameView view;
+            if (!fb->BeginRead(&view)) return;
+            for (uint32_t row = 0; row < dh; ++row) {
+                size_t src_off = static_cast<size_t>(dy + row) * src_stride +
+                                 static_cast<size_t>(dx) * 4;
+                size_t dst_off = static_cast<size_t>(row) * row_bytes;
+                if (src_off + row_bytes > fb->size()) break;
+                std::memcpy(frame.pixels.data() + dst_off, view.data + src_off, row_bytes);
+            }
+            if (fb->EndRead(view)) break;
         }
 
         DisplayCallback cb;
@@ -2,6 +2,7 @@
 #include "platform/linux/hypervisor/aarch64/kvm_vm.h"
 #include "platform/linux/hypervisor/kvm_platform.h"
 #include "core/vmm/types.h"
+#include "core/vmm/vcpu_stats.h"
 
 #include <cerrno>
 #include <condition_variable>
@@ -228,6 +229,7 @@ VCpuExitAction KvmVCpu::RunOnce() {
     if (rc < 0) {
         if (errno == EINTR || errno == EAGAIN) {
             run_->immediate_exit = 0;
+            VCpuStats::NoteExit(VCpuExitKind::kIntr);
             return VCpuExitAction::kContinue;
         }
         LOG_ERROR("kvm: KVM_RUN(%u) failed: %s", index_, strerror(errno));
@@ -253,6 +255,7 @@ VCpuExitAction KvmVCpu::RunOnce() {
         return VCpuExitAction::kHalt;
 
     case KVM_EXIT_INTR:
+        VCpuStats::NoteExit(VCpuExitKind::kIntr);
         return VCpuExitAction::kContinue;
 
     case KVM_EXIT_SHUTDOWN:
@@ -285,8 +288,11 @@ VCpuExitAction KvmVCpu::RunOnce() {
                   run_->internal.suberror);
         return VCpuExitAction::kError;
 
-    case KVM_EXIT_UNKNOWN:
     case KVM_EXIT_IRQ_WINDOW_OPEN:
+        VCpuStats::NoteExit(VCpuExitKind::kIrqWindow);
+        return VCpuExitAction::kContinue;
+
+    case KVM_EXIT_UNKNOWN:
         return VCpuExitAction::kContinue;
 
     default:
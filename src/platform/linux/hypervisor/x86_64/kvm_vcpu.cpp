@@ -4,6 +4,7 @@
 #include "core/arch/x86_64/boot.h"
 #include "core/device/irq/local_apic.h"
 #include "core/vmm/types.h"
+#include "core/vmm/vcpu_stats.h"
 
 #include <cerrno>
 #include <csignal>
@@ -238,6 +239,7 @@ VCpuExitAction KvmVCpu::RunOnce() {
         if (errno == EINTR || errno == EAGAIN) {
             // Signal or immediate_exit request.
             run_->immediate_exit = 0;
+            VCpuStats::NoteExit(VCpuExitKind::kIntr);
             return VCpuExitAction::kContinue;
         }
         LOG_ERROR("kvm: KVM_RUN failed: %s", strerror(errno));
@@ -281,6 +283,7 @@ VCpuExitAction KvmVCpu::RunOnce() {
         return VCpuExitAction::kHalt;
 
     case KVM_EXIT_INTR:
+        VCpuStats::NoteExit(VCpuExitKind::kIntr);
         return VCpuExitAction::kContinue;
 
     case KVM_EXIT_SHUTDOWN:
@@ -303,6 +306,9 @@ VCpuExitAction KvmVCpu::RunOnce() {
         return VCpuExitAction::kShutdown;
 
     case KVM_EXIT_IRQ_WINDOW_OPEN:
+        VCpuStats::NoteExit(VCpuExitKind::kIrqWindow);
+        return VCpuExitAction::kContinue;
+
     case KVM_EXIT_UNKNOWN:
         return VCpuExitAction::kContinue;
 
@@ -45,6 +45,8 @@ public:
     uint32_t Index() const override { return index_; }
     bool SetupBootRegisters(uint8_t* ram) override;
     bool WaitForInterrupt(uint32_t timeout_ms) override;
+    bool SupportsHaltPoll() const override { return true; }
+    bool HasPendingInterrupt() override { return IsIrqPending(); }
 
     void OnStartup(const VCpuStartupState& state) override;
 
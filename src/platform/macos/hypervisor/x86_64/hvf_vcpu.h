@@ -33,8 +33,9 @@ public:
 
     void QueueInterrupt(uint32_t vector);
     void WakeFromHalt();
-    bool HasPendingInterrupt();
+    bool HasPendingInterrupt() override;
     bool WaitForInterrupt(uint32_t timeout_ms) override;
+    bool SupportsHaltPoll() const override { return true; }
 
     // Set AP to start in real mode at CS:IP = (sipi_vector<<8):0000
     bool SetupSipiRegisters(uint8_t sipi_vector);
@@ -1,6 +1,7 @@
 #include "platform/windows/hypervisor/whvp_doorbell.h"
 #include "platform/windows/hypervisor/whvp_dyn.h"
 #include "core/vmm/types.h"
+#include "core/util/thread_policy.h"
 
 #include <cstring>
 
@@ -146,6 +147,7 @@ void WhvpDoorbellRegistrar::Shutdown() {
 }
 
 void WhvpDoorbellRegistrar::DispatcherLoop() {
+    InitVmThread("vm-doorbell", VmThreadRole::kIo);
     while (!stop_.load(std::memory_order_acquire)) {
         std::vector<HANDLE> handles;
         std::vector<std::function<void()>> callbacks;
@@ -1,6 +1,7 @@
 #include "platform/windows/hypervisor/whvp_vcpu.h"
 #include "core/arch/x86_64/boot.h"
 #include "core/device/irq/local_apic.h"
+#include "core/vmm/vcpu_stats.h"
 #include <chrono>
 #include <cinttypes>
 #include <cstdio>
@@ -884,6 +885,7 @@ VCpuExitAction WhvpVCpu::RunOnce() {
 
     case WHvRunVpExitReasonCanceled:
         if (stats) s_stats_.canceled.fetch_add(1, std::memory_order_relaxed);
+        VCpuStats::NoteExit(VCpuExitKind::kIntr);
         return VCpuExitAction::kContinue;
 
     case WHvRunVpExitReasonX64ApicEoi:
@@ -899,6 +901,7 @@ VCpuExitAction WhvpVCpu::RunOnce() {
 
     case WHvRunVpExitReasonX64InterruptWindow:
         if (stats) s_stats_.irq_wnd.fetch_add(1, std::memory_order_relaxed);
+        VCpuStats::NoteExit(VCpuExitKind::kIrqWindow);
         // WHPX auto-clears InterruptNotification when it fires the window
         // exit. Mirror that so our next TryInjectInterrupt won't skip the
         // re-arm SetRegisters call thinking the notification is still live.
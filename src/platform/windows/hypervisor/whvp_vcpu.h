@@ -41,8 +41,9 @@ public:
     // that after posting the vector so a single queued IRQ can target
     // multiple vCPUs with a single CancelRun each.
     void QueueInterrupt(uint32_t vector);
-    bool HasPendingInterrupt();
+    bool HasPendingInterrupt() override;
     bool WaitForInterrupt(uint32_t timeout_ms) override;
+    bool SupportsHaltPoll() const override { return true; }
 
     bool SetRegisters(const WHV_REGISTER_NAME* names,
                       const WHV_REGISTER_VALUE* values, uint32_t count);
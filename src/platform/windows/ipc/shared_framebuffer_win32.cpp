@@ -11,7 +11,7 @@ SharedFramebuffer::~SharedFramebuffer() {
 bool SharedFramebuffer::Create(const std::string& name, uint32_t width, uint32_t height) {
     Close();
 
-    size_t bytes = static_cast<size_t>(width) * height * 4;
+    size_t bytes = MappingSize(width, height);
     if (bytes == 0) return false;
 
     HANDLE h = CreateFileMappingA(
@@ -26,20 +26,22 @@ bool SharedFramebuffer::Create(const std::string& name, uint32_t width, uint32_t
         return false;
     }
 
-    data_ = static_cast<uint8_t*>(ptr);
-    size_ = bytes;
+    map_ = static_cast<uint8_t*>(ptr);
+    map_size_ = bytes;
+    frame_bytes_ = static_cast<size_t>(width) * height * 4;
     width_ = width;
     height_ = height;
     name_ = name;
     map_handle_ = h;
     is_owner_ = true;
+    InitHeader();
     return true;
 }
 
 bool SharedFramebuffer::Open(const std::string& name, uint32_t width, uint32_t height) {
     Close();
 
-    size_t bytes = static_cast<size_t>(width) * height * 4;
+    size_t bytes = MappingSize(width, height);
     if (bytes == 0) return false;
 
     HANDLE h = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
@@ -51,26 +53,32 @@ bool SharedFramebuffer::Open(const std::string& name, uint32_t width, uint32_t h
         return false;
     }
 
-    data_ = static_cast<uint8_t*>(ptr);
-    size_ = bytes;
+    map_ = static_cast<uint8_t*>(ptr);
+    map_size_ = bytes;
+    frame_bytes_ = static_cast<size_t>(width) * height * 4;
     width_ = width;
     height_ = height;
     name_ = name;
     map_handle_ = h;
     is_owner_ = false;
+    if (!CheckHeader()) {
+        Close();
+        return false;
+    }
     return true;
 }
 
 void SharedFramebuffer::Close() {
-    if (data_) {
-        UnmapViewOfFile(data_);
-        data_ = nullptr;
+    if (map_) {
+        UnmapViewOfFile(map_);
+        map_ = nullptr;
     }
     if (map_handle_) {
         CloseHandle(map_handle_);
         map_handle_ = nullptr;
     }
-    size_ = 0;
+    map_size_ = 0;
+    frame_bytes_ = 0;
     width_ = 0;
     height_ = 0;
     name_.clear();
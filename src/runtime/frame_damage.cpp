@@ -0,0 +1,228 @@
+#include "runtime/frame_damage.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TENBOX_DAMAGE_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TENBOX_DAMAGE_NEON 1
+#endif
+
+namespace {
+
+// XXH3-style accumulation: each 16-byte block of a row is mixed with the
+// key for its position in the row and folded into two 64-bit lanes with a
+// 32x32->64 multiply, which SSE2 and NEON both do two lanes at a time; the
+// lanes are scrambled after every row. Keys per position and the scramble
+// make the hash depend on where content sits, so content that only moves
+// within a tile still changes it. The scalar path computes the same value.
+constexpr uint32_t kMaxRowBlocks = TileDamageTracker::kTileSize * 4 / 16;
+constexpr uint64_t kPrime32 = 0x9e3779b1ull;
+constexpr uint64_t kScrambleKey0 = 0x7c01812cf721ad1cull;
+constexpr uint64_t kScrambleKey1 = 0xded46de9839097dbull;
+
+// Two keys per block position, from a splitmix64 sequence.
+constexpr std::array<uint64_t, kMaxRowBlocks * 2> kBlockKeys = [] {
+    std::array<uint64_t, kMaxRowBlocks * 2> keys{};
+    uint64_t state = 0xbe4ba423396cfeb8ull;
+    for (auto& key : keys) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        key = z ^ (z >> 31);
+    }
+    return keys;
+}();
+
+struct Acc {
+#if defined(TENBOX_DAMAGE_SSE2)
+    __m128i v = _mm_set_epi64x(static_cast<long long>(0xc2b2ae3d27d4eb4full),
+                               static_cast<long long>(0x9e3779b185ebca87ull));
+
+    void Mix(const uint8_t* p, const uint64_t* keys) {
+        const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+        __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i dk = _mm_xor_si128(data, key);
+        __m128i prod = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m128i swap = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        v = _mm_add_epi64(v, _mm_add_epi64(prod, swap));
+    }
+
+    // v = (v ^ (v >> 47) ^ key) * kPrime32, the 64x32 multiply in halves.
+    void Scramble() {
+        const __m128i key = _mm_set_epi64x(static_cast<long long>(kScrambleKey1),
+                                           static_cast<long long>(kScrambleKey0));
+        const __m128i prime = _mm_set1_epi32(static_cast<int>(kPrime32));
+        __m128i x = _mm_xor_si128(_mm_xor_si128(v, _mm_srli_epi64(v, 47)), key);
+        __m128i lo = _mm_mul_epu32(x, prime);
+        __m128i hi = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+        v = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+    }
+
+    void Get(uint64_t out[2]) const {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+    }
+#elif defined(TENBOX_DAMAGE_NEON)
+    uint64x2_t v = vcombine_u64(vcreate_u64(0x9e3779b185ebca87ull),
+                                vcreate_u64(0xc2b2ae3d27d4eb4full));
+
+    void Mix(const uint8_t* p, const uint64_t* keys) {
+        const uint64x2_t key = vld1q_u64(keys);
+        uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(p));
+        uint64x2_t dk = veorq_u64(data, key);
+        uint64x2_t prod = vmull_u32(vmovn_u64(dk), vshrn_n_u64(dk, 32));
+        uint64x2_t swap = vextq_u64(data, data, 1);
+        v = vaddq_u64(v, vaddq_u64(prod, swap));
+    }
+
+    // v = (v ^ (v >> 47) ^ key) * kPrime32, the 64x32 multiply in halves.
+    void Scramble() {
+        const uint64x2_t key = vcombine_u64(vcreate_u64(kScrambleKey0),
+                                            vcreate_u64(kScrambleKey1));
+        const uint32x2_t prime = vdup_n_u32(static_cast<uint32_t>(kPrime32));
+        uint64x2_t x = veorq_u64(veorq_u64(v, vshrq_n_u64(v, 47)), key);
+        uint64x2_t lo = vmull_u32(vmovn_u64(x), prime);
+        uint64x2_t hi = vmull_u32(vshrn_n_u64(x, 32), prime);
+        v = vaddq_u64(lo, vshlq_n_u64(hi, 32));
+    }
+
+    void Get(uint64_t out[2]) const {
+        vst1q_u64(out, v);
+    }
+#else
+    uint64_t v[2] = {0x9e3779b185ebca87ull, 0xc2b2ae3d27d4eb4full};
+
+    void Mix(const uint8_t* p, const uint64_t* keys) {
+        uint64_t d[2];
+        std::memcpy(d, p, sizeof(d));
+        uint64_t dk0 = d[0] ^ keys[0];
+        uint64_t dk1 = d[1] ^ keys[1];
+        v[0] += d[1] + (dk0 & 0xffffffffull) * (dk0 >> 32);
+        v[1] += d[0] + (dk1 & 0xffffffffull) * (dk1 >> 32);
+    }
+
+    void Scramble() {
+        v[0] = (v[0] ^ (v[0] >> 47) ^ kScrambleKey0) * kPrime32;
+        v[1] = (v[1] ^ (v[1] >> 47) ^ kScrambleKey1) * kPrime32;
+    }
+
+    void Get(uint64_t out[2]) const {
+        out[0] = v[0];
+        out[1] = v[1];
+    }
+#endif
+};
+
+uint64_t Avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= 0x165667919e3779f9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+// |row_bytes| is at most kTileSize * 4, i.e. kMaxRowBlocks blocks.
+uint64_t HashTile(const uint8_t* p, uint32_t stride, uint32_t row_bytes, uint32_t rows) {
+    Acc acc;
+    const uint32_t body = row_bytes & ~15u;
+    for (uint32_t row = 0; row < rows; ++row, p += stride) {
+        const uint64_t* keys = kBlockKeys.data();
+        for (uint32_t off = 0; off < body; off += 16, keys += 2) acc.Mix(p + off, keys);
+        if (body != row_bytes) {
+            uint8_t tail[16] = {};
+            std::memcpy(tail, p + body, row_bytes - body);
+            acc.Mix(tail, keys);
+        }
+        acc.Scramble();
+    }
+    uint64_t lanes[2];
+    acc.Get(lanes);
+    uint64_t h = lanes[0] + ((lanes[1] << 31) | (lanes[1] >> 33));
+    return Avalanche(h ^ (static_cast<uint64_t>(row_bytes) * rows));
+}
+
+}  // namespace
+
+void TileDamageTracker::Reset() {
+    width_ = 0;
+    height_ = 0;
+    tiles_x_ = 0;
+    hashes_.clear();
+    known_.clear();
+}
+
+TileDamageTracker::Rect TileDamageTracker::Update(const uint8_t* pixels, uint32_t stride,
+                                                  uint32_t width, uint32_t height,
+                                                  const Rect& dirty) {
+    if (width != width_ || height != height_) {
+        width_ = width;
+        height_ = height;
+        tiles_x_ = (width + kTileSize - 1) / kTileSize;
+        size_t tiles = static_cast<size_t>(tiles_x_) * ((height + kTileSize - 1) / kTileSize);
+        hashes_.assign(tiles, 0);
+        known_.assign(tiles, 0);
+    }
+
+    Rect rect = dirty;
+    if (rect.x >= width || rect.y >= height) rect.width = rect.height = 0;
+    rect.width = std::min(rect.width, width - std::min(rect.x, width));
+    rect.height = std::min(rect.height, height - std::min(rect.y, height));
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    dirty_bytes_.fetch_add(static_cast<uint64_t>(rect.width) * rect.height * 4,
+                           std::memory_order_relaxed);
+    if (rect.empty()) {
+        frames_unchanged_.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+
+    // Whole tiles are hashed even where the rect only clips them, so every
+    // stored hash always describes a full tile.
+    uint32_t tx0 = rect.x / kTileSize;
+    uint32_t ty0 = rect.y / kTileSize;
+    uint32_t tx1 = (rect.x + rect.width - 1) / kTileSize;
+    uint32_t ty1 = (rect.y + rect.height - 1) / kTileSize;
+    uint32_t min_tx = UINT32_MAX, min_ty = UINT32_MAX, max_tx = 0, max_ty = 0;
+    for (uint32_t ty = ty0; ty <= ty1; ++ty) {
+        uint32_t py = ty * kTileSize;
+        uint32_t rows = std::min(kTileSize, height - py);
+        for (uint32_t tx = tx0; tx <= tx1; ++tx) {
+            uint32_t px = tx * kTileSize;
+            uint32_t cols = std::min(kTileSize, width - px);
+            uint64_t h = HashTile(pixels + static_cast<size_t>(py) * stride + px * 4u,
+                                  stride, cols * 4, rows);
+            size_t idx = static_cast<size_t>(ty) * tiles_x_ + tx;
+            if (known_[idx] && hashes_[idx] == h) continue;
+            hashes_[idx] = h;
+            known_[idx] = 1;
+            min_tx = std::min(min_tx, tx);
+            min_ty = std::min(min_ty, ty);
+            max_tx = std::max(max_tx, tx);
+            max_ty = std::max(max_ty, ty);
+        }
+    }
+    if (min_tx == UINT32_MAX) {
+        frames_unchanged_.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+
+    uint32_t x0 = std::max(rect.x, min_tx * kTileSize);
+    uint32_t y0 = std::max(rect.y, min_ty * kTileSize);
+    uint32_t x1 = std::min(rect.x + rect.width, (max_tx + 1) * kTileSize);
+    uint32_t y1 = std::min(rect.y + rect.height, (max_ty + 1) * kTileSize);
+    Rect damage{x0, y0, x1 - x0, y1 - y0};
+    damage_bytes_.fetch_add(static_cast<uint64_t>(damage.width) * damage.height * 4,
+                            std::memory_order_relaxed);
+    return damage;
+}
+
+TileDamageTracker::Stats TileDamageTracker::GetStats() const {
+    Stats stats;
+    stats.frames = frames_.load(std::memory_order_relaxed);
+    stats.frames_unchanged = frames_unchanged_.load(std::memory_order_relaxed);
+    stats.dirty_bytes = dirty_bytes_.load(std::memory_order_relaxed);
+    stats.damage_bytes = damage_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Content-based damage detection for the shared framebuffer.
+//
+// Guest compositors often flush the whole screen when only a cursor blink
+// or a terminal line changed. The tracker keeps a hash per 64x64 tile of
+// the last frame it saw and, for each flushed rect, returns the part whose
+// tiles actually changed, so the reader only converts and encodes that.
+class TileDamageTracker {
+public:
+    static constexpr uint32_t kTileSize = 64;
+
+    struct Rect {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        bool empty() const { return width == 0 || height == 0; }
+    };
+
+    struct Stats {
+        uint64_t frames = 0;            // rects passed to Update()
+        uint64_t frames_unchanged = 0;  // ... whose content did not change at all
+        uint64_t dirty_bytes = 0;       // bytes the guest reported dirty
+        uint64_t damage_bytes = 0;      // bytes left after tile comparison
+    };
+
+    // Forget every tile hash, e.g. after the framebuffer was recreated, so
+    // the next Update() reports the whole rect it is given.
+    void Reset();
+
+    // Re-hash the tiles under |dirty| in |pixels|, a |width| x |height|
+    // BGRA image with rows |stride| bytes apart, and return the bounding
+    // box of the changed tiles clipped to |dirty| (empty if none changed).
+    Rect Update(const uint8_t* pixels, uint32_t stride, uint32_t width, uint32_t height,
+                const Rect& dirty);
+
+    // Counters since construction; safe to call from any thread.
+    Stats GetStats() const;
+
+private:
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t tiles_x_ = 0;
+    std::vector<uint64_t> hashes_;
+    std::vector<uint8_t> known_;
+
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> frames_unchanged_{0};
+    std::atomic<uint64_t> dirty_bytes_{0};
+    std::atomic<uint64_t> damage_bytes_{0};
+};
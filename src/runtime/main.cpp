@@ -2,6 +2,8 @@
 #include "runtime/crash_handler.h"
 #include "version.h"
 #include "core/vmm/vm.h"
+#include "core/util/thread_policy.h"
+#include "common/cpu_list.h"
 
 #ifdef _WIN32
 #define NOMINMAX
@@ -94,13 +96,19 @@ static void PrintUsage(const char* prog) {
         "  --cpus <N>           Number of vCPUs (default: 1, max: 128)\n"
         "  --net                Start with network link up (default: link down)\n"
         "  --debug              Enable debug mode (verbose kernel output)\n"
+        "  --halt-poll-ns <ns>  Max adaptive halt-poll window (default: 200000, 0: off)\n"
+        "  --vcpu-cpus <list>   Pin vCPU i to the i-th CPU of <list>, e.g. 4-7\n"
+        "  --io-cpus <list>     Affinity for device / I/O threads, e.g. 0-1\n"
+        "  --vcpu-fifo <prio>   Run vCPU threads under SCHED_FIFO (Linux)\n"
         "  --hostfwd <spec>     Port forward (repeatable), e.g.:\n"
         "                         tcp:127.0.0.1:8080-:80  (loopback)\n"
         "                         tcp:0.0.0.0:8080-:80    (LAN accessible)\n"
         "  --guestfwd <spec>    Guest forward (repeatable), e.g.:\n"
         "                         guestfwd:10.0.2.3:80-:18981\n"
         "                         guestfwd:10.0.2.3:80-127.0.0.1:18981\n"
-        "  --share TAG:PATH[:ro] Share host directory (repeatable)\n"
+        "  --share TAG:PATH[:ro][:cache=none|auto|always][:writeback][:iops=N][:bps=N]\n"
+        "                       Share host directory (repeatable)\n"
+        "  --fs-dax-window <MB> virtio-fs DAX cache window (Linux/KVM, default: 0 = off)\n"
         "  --version            Show version\n"
         "  --help               Show this help\n",
         prog);
@@ -143,6 +151,7 @@ int main(int argc, char* argv[]) {
     crash_handler::Install(std::string{}, "bootstrap", TENBOX_VERSION);
 
     VmConfig config;
+    ThreadPlacementPolicy placement;
     std::string vm_id = "default";
     std::string control_endpoint;
     std::string vm_dir;  // VM working dir; receives crash/ dumps if a fault occurs.
@@ -198,6 +207,24 @@ int main(int argc, char* argv[]) {
             config.net_link_up = true;
         } else if (Arg("--debug")) {
             config.debug_mode = true;
+        } else if (Arg("--halt-poll-ns")) {
+            auto v = NextArg(); if (!v) return 1;
+            config.halt_poll.max_ns = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+        } else if (Arg("--vcpu-cpus") || Arg("--io-cpus")) {
+            const bool vcpu = Arg("--vcpu-cpus");
+            auto v = NextArg(); if (!v) return 1;
+            auto& cpus = vcpu ? placement.vcpu_cpus : placement.io_cpus;
+            if (!ParseCpuList(v, &cpus)) {
+                fprintf(stderr, "Invalid CPU list: %s (expected e.g. 0-3,8)\n", v);
+                return 1;
+            }
+        } else if (Arg("--vcpu-fifo")) {
+            auto v = NextArg(); if (!v) return 1;
+            placement.vcpu_fifo_priority = std::atoi(v);
+            if (placement.vcpu_fifo_priority < 0 || placement.vcpu_fifo_priority > 99) {
+                fprintf(stderr, "Error: --vcpu-fifo must be between 0 and 99\n");
+                return 1;
+            }
         } else if (Arg("--hostfwd")) {
             auto v = NextArg(); if (!v) return 1;
             HostForward pf;
@@ -218,6 +245,9 @@ int main(int argc, char* argv[]) {
                         "  Expected: guestfwd:GUEST_IP:GPORT-[HOST_ADDR]:HPORT\n", v);
                 return 1;
             }
+        } else if (Arg("--fs-dax-window")) {
+            auto v = NextArg(); if (!v) return 1;
+            config.fs_dax_window_mb = std::strtoull(v, nullptr, 10);
         } else if (Arg("--share")) {
             auto v = NextArg(); if (!v) return 1;
             std::string arg(v);
@@ -226,15 +256,40 @@ int main(int argc, char* argv[]) {
             
             size_t first_colon = arg.find(':');
             if (first_colon == std::string::npos) {
-                fprintf(stderr, "Invalid --share format: %s (expected TAG:PATH[:ro])\n", v);
+                fprintf(stderr, "Invalid --share format: %s (expected TAG:PATH[:ro][:cache=MODE][:writeback][:iops=N][:bps=N])\n", v);
                 return 1;
             }
             sf.tag = arg.substr(0, first_colon);
             std::string rest = arg.substr(first_colon + 1);
             
-            if (rest.size() >= 3 && rest.substr(rest.size() - 3) == ":ro") {
-                sf.readonly = true;
-                rest = rest.substr(0, rest.size() - 3);
+            // Options trail the path, in any order.
+            for (;;) {
+                size_t colon = rest.rfind(':');
+                if (colon == std::string::npos) break;
+                std::string opt = rest.substr(colon + 1);
+                if (opt == "ro") {
+                    sf.readonly = true;
+                } else if (opt == "writeback") {
+                    sf.writeback = true;
+                } else if (opt.rfind("cache=", 0) == 0) {
+                    if (!ParseFsCachePolicy(opt.substr(6), &sf.cache)) {
+                        fprintf(stderr, "Invalid --share cache mode: %s (expected none, auto or always)\n", v);
+                        return 1;
+                    }
+                } else if (opt.rfind("iops=", 0) == 0) {
+                    if (!ParseFsRate(opt.substr(5), &sf.limits.iops)) {
+                        fprintf(stderr, "Invalid --share iops limit: %s\n", v);
+                        return 1;
+                    }
+                } else if (opt.rfind("bps=", 0) == 0) {
+                    if (!ParseFsRate(opt.substr(4), &sf.limits.bytes_per_sec)) {
+                        fprintf(stderr, "Invalid --share bps limit: %s\n", v);
+                        return 1;
+                    }
+                } else {
+                    break;
+                }
+                rest.resize(colon);
             }
             sf.host_path = rest;
             
@@ -274,6 +329,10 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Install before any worker thread starts (control loop, io loop, disk
+    // and network workers all apply it on entry).
+    SetThreadPlacementPolicy(placement);
+
     std::unique_ptr<RuntimeControlService> control;
     if (!control_endpoint.empty()) {
         control = std::make_unique<RuntimeControlService>(vm_id, control_endpoint);
@@ -305,7 +364,10 @@ int main(int argc, char* argv[]) {
     pid_t parent_pid = getppid();
     std::thread parent_watcher;
     if (parent_pid > 1) {
-        parent_watcher = std::thread(WatchParentProcess, parent_pid, vm.get());
+        parent_watcher = std::thread([parent_pid, vm_ptr = vm.get()] {
+            SetCurrentThreadName("vm-parent-watch");
+            WatchParentProcess(parent_pid, vm_ptr);
+        });
         parent_watcher.detach();
     }
 #endif
@@ -2,6 +2,7 @@
 
 #include "core/vmm/types.h"
 #include "core/vmm/vm.h"
+#include "core/util/thread_policy.h"
 #include "runtime/crash_handler.h"
 
 #include <algorithm>
@@ -9,6 +10,7 @@
 #include <charconv>
 #include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <unordered_map>
 #include <unordered_set>
@@ -188,6 +190,21 @@ void ManagedDisplayPort::SetStateHandler(std::function<void(bool, uint32_t, uint
     state_handler_ = std::move(handler);
 }
 
+DisplaySurface ManagedDisplayPort::AcquireScanoutSurface(uint32_t width, uint32_t height) {
+    std::function<DisplaySurface(uint32_t, uint32_t)> handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handler = surface_handler_;
+    }
+    return handler ? handler(width, height) : DisplaySurface{};
+}
+
+void ManagedDisplayPort::SetSurfaceHandler(
+    std::function<DisplaySurface(uint32_t, uint32_t)> handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    surface_handler_ = std::move(handler);
+}
+
 // ── ManagedClipboardPort ──────────────────────────────────────────────
 
 void ManagedClipboardPort::OnClipboardEvent(const ClipboardEvent& event) {
@@ -258,45 +275,23 @@ RuntimeControlService::RuntimeControlService(std::string vm_id, std::string pipe
         if (running_) uv_async_send(&send_wakeup_);
     });
 
+    display_port_->SetSurfaceHandler([this](uint32_t width, uint32_t height) {
+        DisplaySurface surface;
+        if (EnsureSharedFramebuffer(width, height)) {
+            surface.data = shm_fb_.back_buffer();
+            surface.size = shm_fb_.size();
+            surface.stride = shm_fb_.stride();
+        }
+        return surface;
+    });
+
     display_port_->SetFrameHandler([this](DisplayFrame frame) {
         uint32_t resW = frame.resource_width ? frame.resource_width : frame.width;
         uint32_t resH = frame.resource_height ? frame.resource_height : frame.height;
+        if (!EnsureSharedFramebuffer(resW, resH)) return;
 
-        // Create or resize shared framebuffer when resource dimensions change.
-        // Each resize uses a unique name (generation suffix) so the Manager
-        // can open the new mapping without conflicting with the old one that
-        // may still be mapped on its side.
-        if (!shm_fb_.IsValid() || shm_fb_.width() != resW || shm_fb_.height() != resH) {
-            if (shm_fb_.IsValid()) {
-                shm_fb_.Close();
-            }
-            ++shm_generation_;
-            std::string shm_name = ipc::GetSharedFramebufferName(vm_id_)
-                                   + "_" + std::to_string(shm_generation_);
-            if (!shm_fb_.Create(shm_name, resW, resH)) {
-                LOG_ERROR("RuntimeService: failed to create shared framebuffer %ux%u", resW, resH);
-                return;
-            }
-            shm_init_sent_ = false;
-            shm_frame_seq_ = 0;
-        }
-
-        // Send shm_init notification so the manager can open the mapping.
-        if (!shm_init_sent_) {
-            ipc::Message init;
-            init.kind = ipc::Kind::kEvent;
-            init.channel = ipc::Channel::kDisplay;
-            init.type = "display.shm_init";
-            init.vm_id = vm_id_;
-            init.request_id = next_event_id_++;
-            init.fields["shm_name"] = shm_fb_.name();
-            init.fields["width"] = std::to_string(resW);
-            init.fields["height"] = std::to_string(resH);
-            Send(init);
-            shm_init_sent_ = true;
-        }
-
-        // Blit dirty rect into shared memory.
+        // Blit dirty rect into the back buffer, unless the device rendered
+        // it there already.
         uint32_t dx = frame.dirty_x;
         uint32_t dy = frame.dirty_y;
         uint32_t dw = frame.width;
@@ -304,41 +299,37 @@ RuntimeControlService::RuntimeControlService(std::string vm_id, std::string pipe
         uint32_t src_stride = frame.stride;
         uint32_t dst_stride = shm_fb_.stride();
         const uint8_t* src = frame.data();
-        uint8_t* dst = shm_fb_.data();
-
-        for (uint32_t row = 0; row < dh; ++row) {
-            size_t src_off = static_cast<size_t>(row) * src_stride;
-            size_t dst_off = static_cast<size_t>(dy + row) * dst_stride +
-                             static_cast<size_t>(dx) * 4;
-            if (src_off + dw * 4 > frame.data_size()) break;
-            if (dst_off + dw * 4 > shm_fb_.size()) break;
-            std::memcpy(dst + dst_off, src + src_off, dw * 4);
+        uint8_t* dst = shm_fb_.back_buffer();
+
+        if (!frame.in_surface) {
+            for (uint32_t row = 0; row < dh; ++row) {
+                size_t src_off = static_cast<size_t>(row) * src_stride;
+                size_t dst_off = static_cast<size_t>(dy + row) * dst_stride +
+                                 static_cast<size_t>(dx) * 4;
+                if (src_off + dw * 4 > frame.data_size()) break;
+                if (dst_off + dw * 4 > shm_fb_.size()) break;
+                std::memcpy(dst + dst_off, src + src_off, dw * 4);
+            }
         }
 
-        // Send lightweight metadata-only notification.
-        uint64_t seq = ++shm_frame_seq_;
-        ipc::Message notify;
-        notify.kind = ipc::Kind::kEvent;
-        notify.channel = ipc::Channel::kDisplay;
-        notify.type = "display.frame_ready";
-        notify.vm_id = vm_id_;
-        notify.request_id = next_event_id_++;
-        notify.fields["width"] = std::to_string(dw);
-        notify.fields["height"] = std::to_string(dh);
-        notify.fields["stride"] = std::to_string(dst_stride);
-        notify.fields["format"] = std::to_string(frame.format);
-        notify.fields["resource_width"] = std::to_string(resW);
-        notify.fields["resource_height"] = std::to_string(resH);
-        notify.fields["dirty_x"] = std::to_string(dx);
-        notify.fields["dirty_y"] = std::to_string(dy);
-        notify.fields["seq"] = std::to_string(seq);
-
-        std::string encoded = ipc::Encode(notify);
+        // Narrow the flushed rect down to the tiles whose content changed;
+        // a flush that changed nothing is not announced at all.
+        TileDamageTracker::Rect damage =
+            damage_.Update(dst, dst_stride, resW, resH, {dx, dy, dw, dh});
+        if (damage.empty()) return;
+        shm_fb_.Publish({{damage.x, damage.y, damage.width, damage.height}});
+
+        // Fold the rect into the damage pending for the reader; the event
+        // loop ships everything accumulated so far as one notification, so
+        // a slow reader gets the union of what it missed, not just the
+        // latest rect.
         {
             std::lock_guard<std::mutex> lock(send_queue_mutex_);
-            // Shared-memory path: only keep the latest notification.
-            frame_queue_.clear();
-            frame_queue_.push_back(std::move(encoded));
+            pending_damage_.Add({damage.x, damage.y, damage.width, damage.height});
+            pending_width_ = resW;
+            pending_height_ = resH;
+            pending_stride_ = dst_stride;
+            pending_format_ = frame.format;
         }
         if (running_) uv_async_send(&send_wakeup_);
     });
@@ -468,6 +459,49 @@ RuntimeControlService::RuntimeControlService(std::string vm_id, std::string pipe
     });
 }
 
+// Create or resize the shared framebuffer when the resource dimensions
+// change. Each resize uses a unique name (generation suffix) so the Manager
+// can open the new mapping without conflicting with the old one that may
+// still be mapped on its side. Runs on the GPU device's thread.
+bool RuntimeControlService::EnsureSharedFramebuffer(uint32_t width, uint32_t height) {
+    if (!shm_fb_.IsValid() || shm_fb_.width() != width || shm_fb_.height() != height) {
+        if (shm_fb_.IsValid()) {
+            shm_fb_.Close();
+        }
+        ++shm_generation_;
+        std::string shm_name = ipc::GetSharedFramebufferName(vm_id_)
+                               + "_" + std::to_string(shm_generation_);
+        if (!shm_fb_.Create(shm_name, width, height)) {
+            LOG_ERROR("RuntimeService: failed to create shared framebuffer %ux%u", width, height);
+            return false;
+        }
+        shm_init_sent_ = false;
+        damage_.Reset();
+        {
+            // Damage still pending refers to the old mapping.
+            std::lock_guard<std::mutex> lock(send_queue_mutex_);
+            pending_damage_.Clear();
+            shm_frame_seq_ = 0;
+        }
+    }
+
+    // Send shm_init notification so the manager can open the mapping.
+    if (!shm_init_sent_) {
+        ipc::Message init;
+        init.kind = ipc::Kind::kEvent;
+        init.channel = ipc::Channel::kDisplay;
+        init.type = "display.shm_init";
+        init.vm_id = vm_id_;
+        init.request_id = next_event_id_++;
+        init.fields["shm_name"] = shm_fb_.name();
+        init.fields["width"] = std::to_string(width);
+        init.fields["height"] = std::to_string(height);
+        Send(init);
+        shm_init_sent_ = true;
+    }
+    return true;
+}
+
 RuntimeControlService::~RuntimeControlService() {
     Stop();
 }
@@ -765,6 +799,9 @@ void RuntimeControlService::HandleMessage(const ipc::Message& message) {
             std::string tag;
             std::string host_path;
             bool readonly;
+            FsCachePolicy cache = FsCachePolicy::kAuto;
+            bool writeback = false;
+            FsShareLimits limits;
         };
         std::vector<FolderSpec> new_folders;
         new_folders.reserve(count);
@@ -779,10 +816,26 @@ void RuntimeControlService::HandleMessage(const ipc::Message& message) {
             size_t pos2 = val.find('|', pos1 + 1);
             if (pos2 == std::string::npos) continue;
 
+            // tag|host_path|readonly[|cache[|writeback[|iops|bps]]]; senders
+            // that predate the trailing fields get the defaults.
+            std::vector<std::string> opts;
+            for (size_t start = pos2 + 1;;) {
+                size_t next = val.find('|', start);
+                opts.push_back(val.substr(start, next - start));
+                if (next == std::string::npos) break;
+                start = next + 1;
+            }
             FolderSpec spec;
             spec.tag = val.substr(0, pos1);
             spec.host_path = val.substr(pos1 + 1, pos2 - pos1 - 1);
-            spec.readonly = (val.substr(pos2 + 1) == "1");
+            spec.readonly = (opts[0] == "1");
+            if (opts.size() > 1 && !ParseFsCachePolicy(opts[1], &spec.cache)) {
+                LOG_WARN("RuntimeService: unknown cache policy for share '%s', using auto",
+                         spec.tag.c_str());
+            }
+            spec.writeback = opts.size() > 2 && opts[2] == "1";
+            if (opts.size() > 3) spec.limits.iops = std::strtoull(opts[3].c_str(), nullptr, 10);
+            if (opts.size() > 4) spec.limits.bytes_per_sec = std::strtoull(opts[4].c_str(), nullptr, 10);
             new_folders.push_back(std::move(spec));
         }
 
@@ -797,6 +850,9 @@ void RuntimeControlService::HandleMessage(const ipc::Message& message) {
             cs.tag = f.tag;
             cs.host_path = f.host_path;
             cs.readonly = f.readonly;
+            cs.cache = f.cache;
+            cs.writeback = f.writeback;
+            cs.limits = f.limits;
             current_map.emplace(f.tag, std::move(cs));
         }
 
@@ -814,15 +870,23 @@ void RuntimeControlService::HandleMessage(const ipc::Message& message) {
                                     [&](const FolderSpec& n) { return n.tag == cf.tag; });
             if (nit == new_folders.end() ||
                 nit->host_path != cf.host_path ||
-                nit->readonly != cf.readonly) {
+                nit->readonly != cf.readonly ||
+                nit->cache != cf.cache ||
+                nit->writeback != cf.writeback) {
                 vm_->RemoveSharedFolder(cf.tag);
                 current_map.erase(cf.tag);
             }
         }
 
+        // Limits apply to a live share without remounting it.
         for (const auto& f : new_folders) {
-            if (current_map.find(f.tag) == current_map.end()) {
-                vm_->AddSharedFolder(f.tag, f.host_path, f.readonly);
+            auto cit = current_map.find(f.tag);
+            if (cit == current_map.end()) {
+                vm_->AddSharedFolder(f.tag, f.host_path, f.readonly, f.cache, f.writeback,
+                                     f.limits);
+            } else if (cit->second.limits.iops != f.limits.iops ||
+                       cit->second.limits.bytes_per_sec != f.limits.bytes_per_sec) {
+                vm_->SetSharedFolderLimits(f.tag, f.limits);
             }
         }
 
@@ -908,6 +972,44 @@ void RuntimeControlService::HandleMessage(const ipc::Message& message) {
         return;
     }
 
+    if (message.channel == ipc::Channel::kControl &&
+        message.kind == ipc::Kind::kRequest &&
+        message.type == "runtime.stats") {
+        ipc::Message resp;
+        resp.kind = ipc::Kind::kResponse;
+        resp.channel = ipc::Channel::kControl;
+        resp.type = "runtime.stats.result";
+        resp.vm_id = vm_id_;
+        resp.request_id = message.request_id;
+        if (!vm_) {
+            resp.fields["ok"] = "false";
+            resp.fields["error"] = "vm not attached";
+            Send(resp);
+            return;
+        }
+        // The stats document is JSON; ship it as the payload so the
+        // daemon can splice it into its reply without re-encoding.
+        std::string json = vm_->GetStatsJson();
+        TileDamageTracker::Stats damage = damage_.GetStats();
+        char display[256];
+        snprintf(display, sizeof(display),
+                 ",\"display\":{\"frames\":%llu,\"frames_unchanged\":%llu,"
+                 "\"dirty_bytes\":%llu,\"damage_bytes\":%llu}}",
+                 static_cast<unsigned long long>(damage.frames),
+                 static_cast<unsigned long long>(damage.frames_unchanged),
+                 static_cast<unsigned long long>(damage.dirty_bytes),
+                 static_cast<unsigned long long>(damage.damage_bytes));
+        if (!json.empty() && json.back() == '}') {
+            json.pop_back();
+            json += display;
+        }
+        resp.fields["ok"] = "true";
+        resp.fields["format"] = "json";
+        resp.payload.assign(json.begin(), json.end());
+        SendWithPayload(resp);
+        return;
+    }
+
     // Clipboard messages from manager to VM
     if (message.channel == ipc::Channel::kClipboard &&
         message.kind == ipc::Kind::kRequest) {
@@ -991,9 +1093,31 @@ void RuntimeControlService::DrainSendQueues() {
             audio_queue_.pop_front();
         }
 
-        while (!frame_queue_.empty()) {
-            batch += std::move(frame_queue_.front());
-            frame_queue_.pop_front();
+        if (!pending_damage_.empty()) {
+            // Header fields carry the bounding box for readers that only
+            // look at one rect; the payload lists the rects themselves.
+            ipc::DamageRect bounds = pending_damage_.Bounds();
+            ipc::Message notify;
+            notify.kind = ipc::Kind::kEvent;
+            notify.channel = ipc::Channel::kDisplay;
+            notify.type = "display.frame_ready";
+            notify.vm_id = vm_id_;
+            notify.request_id = next_event_id_++;
+            notify.fields["width"] = std::to_string(bounds.width);
+            notify.fields["height"] = std::to_string(bounds.height);
+            notify.fields["stride"] = std::to_string(pending_stride_);
+            notify.fields["format"] = std::to_string(pending_format_);
+            notify.fields["resource_width"] = std::to_string(pending_width_);
+            notify.fields["resource_height"] = std::to_string(pending_height_);
+            notify.fields["dirty_x"] = std::to_string(bounds.x);
+            notify.fields["dirty_y"] = std::to_string(bounds.y);
+            notify.fields["seq"] = std::to_string(++shm_frame_seq_);
+            notify.payload = ipc::EncodeDamageRects(pending_damage_.rects());
+            if (!notify.payload.empty()) {
+                notify.fields["rect_count"] = std::to_string(pending_damage_.rects().size());
+            }
+            pending_damage_.Clear();
+            batch += ipc::Encode(notify);
         }
     }
 
@@ -1111,6 +1235,7 @@ void RuntimeControlService::OnStopSignal(uv_async_t* handle) {
 }
 
 void RuntimeControlService::EventLoopThread() {
+    InitVmThread("vm-control", VmThreadRole::kIo);
     uv_loop_init(&loop_);
 
     pipe_.data = this;
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "common/ports.h"
+#include "ipc/damage_region.h"
 #include "ipc/protocol_v1.h"
 #include "ipc/shared_framebuffer.h"
+#include "runtime/frame_damage.h"
 
 #include <uv.h>
 
@@ -73,15 +75,18 @@ public:
     void SubmitFrame(DisplayFrame frame) override;
     void SubmitCursor(const CursorInfo& cursor) override;
     void SubmitScanoutState(bool active, uint32_t width, uint32_t height) override;
+    DisplaySurface AcquireScanoutSurface(uint32_t width, uint32_t height) override;
     void SetFrameHandler(std::function<void(DisplayFrame)> handler);
     void SetCursorHandler(std::function<void(const CursorInfo&)> handler);
     void SetStateHandler(std::function<void(bool, uint32_t, uint32_t)> handler);
+    void SetSurfaceHandler(std::function<DisplaySurface(uint32_t, uint32_t)> handler);
 
 private:
     std::mutex mutex_;
     std::function<void(DisplayFrame)> frame_handler_;
     std::function<void(const CursorInfo&)> cursor_handler_;
     std::function<void(bool, uint32_t, uint32_t)> state_handler_;
+    std::function<DisplaySurface(uint32_t, uint32_t)> surface_handler_;
 };
 
 class ManagedClipboardPort final : public ClipboardPort {
@@ -128,6 +133,7 @@ private:
     void DrainSendQueues();
     void FlushConsoleData();
     void WriteRaw(const std::string& data);
+    bool EnsureSharedFramebuffer(uint32_t width, uint32_t height);
 
     static void OnPipeRead(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf);
     static void OnAllocBuffer(uv_handle_t* handle, size_t suggested, uv_buf_t* buf);
@@ -180,11 +186,15 @@ private:
     uint64_t shm_frame_seq_ = 0;
     uint32_t shm_generation_ = 0;
     bool shm_init_sent_ = false;
-
-    static constexpr size_t kMaxPendingFrames = 4;
-    std::deque<std::string> frame_queue_;
-    uint64_t frame_drop_count_ = 0;
-    std::chrono::steady_clock::time_point last_frame_drop_log_{};
+    TileDamageTracker damage_;
+
+    // Damage accumulated since the last display.frame_ready and the frame
+    // it belongs to (guarded by send_queue_mutex_, sent by DrainSendQueues).
+    ipc::DamageRegion pending_damage_;
+    uint32_t pending_width_ = 0;
+    uint32_t pending_height_ = 0;
+    uint32_t pending_stride_ = 0;
+    uint32_t pending_format_ = 0;
 
     static constexpr size_t kMaxPendingAudio = 32;
     std::deque<std::string> audio_queue_;
@@ -0,0 +1,571 @@
+// Host-side benchmark for the virtio-fs device.
+// Replays synthetic FUSE request streams through a request queue backed by
+// a fake guest RAM buffer, with no guest or hypervisor involved, and reports
+// ops/s and per-request latency percentiles for:
+//   - tree walk:    LOOKUP + GETATTR over a directory tree
+//   - seq write / seq read: 1 MiB WRITE / READ over one large file
+//   - small files:  CREATE + 4 KiB WRITE + RELEASE, then UNLINK
+//   - readdir:      READDIR and READDIRPLUS of one large directory
+//
+// Usage: bench_virtio_fs [--quick] [--depth N] [--dir PATH]
+//   --quick   small data sets, for CI smoke runs
+//   --depth   requests kept in flight (default: 16)
+//   --dir     parent of the scratch share directory (default: $TMPDIR or /tmp)
+//
+// Exits non-zero if any request fails, so it doubles as a regression test.
+
+#include "core/device/virtio/virtio_fs.h"
+#include "core/device/virtio/virtqueue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint64_t kRootNodeId = 1;
+static constexpr uint32_t kChunk = 1024 * 1024;  // matches INIT max_write
+
+// ── request replayer ─────────────────────────────────────────────────
+// One request: a FUSE header plus arguments, an optional payload appended
+// after them (WRITE data, names), and the reply buffer size.
+struct FuseRequest {
+    std::vector<uint8_t> args;
+    const uint8_t* payload = nullptr;
+    uint32_t payload_len = 0;
+    uint32_t out_size = 4096;
+};
+
+struct FuseReply {
+    int32_t error = 0;
+    std::vector<uint8_t> body;  // first kKeepBytes of the reply body
+};
+
+static FuseRequest MakeRequest(uint32_t opcode, uint64_t nodeid, const void* args, size_t len,
+                               uint32_t out_size = 4096) {
+    FuseRequest req;
+    req.args.resize(sizeof(FuseInHeader) + len);
+    FuseInHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.opcode = opcode;
+    hdr.nodeid = nodeid;
+    memcpy(req.args.data(), &hdr, sizeof(hdr));
+    if (len) memcpy(req.args.data() + sizeof(hdr), args, len);
+    req.out_size = out_size;
+    return req;
+}
+
+static FuseRequest MakeNameRequest(uint32_t opcode, uint64_t nodeid, const std::string& name) {
+    return MakeRequest(opcode, nodeid, name.c_str(), name.size() + 1);
+}
+
+template <typename T>
+static bool ReplyAs(const FuseReply& reply, T* out) {
+    if (reply.error != 0 || reply.body.size() < sizeof(T)) return false;
+    memcpy(out, reply.body.data(), sizeof(T));
+    return true;
+}
+
+// Latency samples of one benchmark row.
+struct Samples {
+    std::vector<uint64_t> ns;
+    uint64_t bytes = 0;
+    double seconds = 0;
+    uint64_t errors = 0;
+
+    void Merge(const Samples& other) {
+        ns.insert(ns.end(), other.ns.begin(), other.ns.end());
+        bytes += other.bytes;
+        seconds += other.seconds;
+        errors += other.errors;
+    }
+};
+
+// Drives one request queue of a VirtioFsDevice the way a guest driver
+// would: requests are placed in fixed per-slot buffers in guest RAM,
+// published on the avail ring and kicked with OnQueueNotify, and the worker
+// pool completes them onto the used ring, which is polled here.
+class FuseReplayer {
+public:
+    static constexpr uint32_t kQueueSize = 128;
+    static constexpr size_t kKeepBytes = 256;
+
+    FuseReplayer(VirtioFsDevice& dev, uint32_t queue_idx, uint32_t depth)
+        : dev_(dev), queue_idx_(queue_idx),
+          depth_(std::min<uint32_t>(std::max<uint32_t>(depth, 1), kQueueSize / 2)),
+          ram_(kSlotBase + static_cast<size_t>(depth_) * kSlotSize) {
+        GuestMemMap mem;
+        mem.base = ram_.data();
+        mem.alloc_size = ram_.size();
+        mem.low_size = ram_.size();
+        vq_.Setup(kQueueSize, mem);
+        vq_.SetDescAddr(kDescGpa);
+        vq_.SetDriverAddr(kAvailGpa);
+        vq_.SetDeviceAddr(kUsedGpa);
+        vq_.SetReady(true);
+    }
+
+    // Run |reqs| with up to depth requests in flight. Each latency sample
+    // spans publish to completion. Replies are returned in request order
+    // when |replies| is given; |keep_all| keeps whole reply bodies.
+    Samples Run(const std::vector<FuseRequest>& reqs, std::vector<FuseReply>* replies = nullptr,
+                bool keep_all = false) {
+        Samples s;
+        s.ns.reserve(reqs.size());
+        if (replies) replies->assign(reqs.size(), FuseReply{});
+
+        std::vector<size_t> slot_req(depth_, 0);
+        std::vector<Clock::time_point> slot_start(depth_);
+        std::vector<uint32_t> free_slots;
+        for (uint32_t i = 0; i < depth_; i++) free_slots.push_back(depth_ - 1 - i);
+
+        size_t next = 0, done = 0;
+        auto t0 = Clock::now();
+        while (done < reqs.size()) {
+            bool submitted = false;
+            while (next < reqs.size() && !free_slots.empty()) {
+                uint32_t slot = free_slots.back();
+                free_slots.pop_back();
+                Publish(slot, reqs[next]);
+                slot_req[slot] = next++;
+                slot_start[slot] = Clock::now();
+                submitted = true;
+            }
+            if (submitted) dev_.OnQueueNotify(queue_idx_, vq_);
+
+            uint16_t used_idx;
+            while ((used_idx = UsedIdx()) == last_used_) std::this_thread::yield();
+            auto now = Clock::now();
+            for (; last_used_ != used_idx; last_used_++) {
+                const uint8_t* elem = ram_.data() + kUsedGpa + 4 + (last_used_ % kQueueSize) * 8;
+                uint32_t head, len;
+                memcpy(&head, elem, 4);
+                memcpy(&len, elem + 4, 4);
+                uint32_t slot = head / 2;
+                s.ns.push_back(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(now - slot_start[slot]).count()));
+                Collect(slot, len, reqs[slot_req[slot]], replies ? &(*replies)[slot_req[slot]] : nullptr,
+                        keep_all, &s);
+                free_slots.push_back(slot);
+                done++;
+            }
+        }
+        s.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+        return s;
+    }
+
+    FuseReply Call(const FuseRequest& req, bool keep_all = false) {
+        std::vector<FuseReply> replies;
+        Run({req}, &replies, keep_all);
+        return replies[0];
+    }
+
+private:
+    // Guest RAM layout: descriptor table, avail ring and used ring in the
+    // first pages, then one in/out buffer pair per slot. Slot i owns
+    // descriptors 2i (device-readable) and 2i+1 (device-writable).
+    static constexpr uint64_t kDescGpa  = 0x0000;
+    static constexpr uint64_t kAvailGpa = 0x1000;
+    static constexpr uint64_t kUsedGpa  = 0x2000;
+    static constexpr uint64_t kSlotBase = 0x10000;
+    static constexpr size_t kBufSize    = kChunk + 0x1000;
+    static constexpr size_t kSlotSize   = 2 * kBufSize;
+
+    uint64_t InGpa(uint32_t slot) const { return kSlotBase + slot * kSlotSize; }
+    uint64_t OutGpa(uint32_t slot) const { return InGpa(slot) + kBufSize; }
+
+    void Publish(uint32_t slot, const FuseRequest& req) {
+        uint8_t* in = ram_.data() + InGpa(slot);
+        uint32_t in_len = static_cast<uint32_t>(req.args.size()) + req.payload_len;
+        memcpy(in, req.args.data(), req.args.size());
+        if (req.payload_len) memcpy(in + req.args.size(), req.payload, req.payload_len);
+        FuseInHeader hdr;
+        memcpy(&hdr, in, sizeof(hdr));
+        hdr.len = in_len;
+        hdr.unique = ++unique_;
+        memcpy(in, &hdr, sizeof(hdr));
+
+        auto* desc = reinterpret_cast<VirtqDesc*>(ram_.data() + kDescGpa);
+        desc[2 * slot] = {InGpa(slot), in_len, VIRTQ_DESC_F_NEXT, static_cast<uint16_t>(2 * slot + 1)};
+        desc[2 * slot + 1] = {OutGpa(slot), std::min<uint32_t>(req.out_size, kBufSize),
+                              VIRTQ_DESC_F_WRITE, 0};
+
+        uint8_t* avail = ram_.data() + kAvailGpa;
+        uint16_t head = static_cast<uint16_t>(2 * slot);
+        memcpy(avail + 4 + (avail_idx_ % kQueueSize) * 2, &head, 2);
+        avail_idx_++;
+        std::atomic_ref<uint16_t>(*reinterpret_cast<uint16_t*>(avail + 2))
+            .store(avail_idx_, std::memory_order_release);
+    }
+
+    uint16_t UsedIdx() {
+        return std::atomic_ref<uint16_t>(*reinterpret_cast<uint16_t*>(ram_.data() + kUsedGpa + 2))
+            .load(std::memory_order_acquire);
+    }
+
+    void Collect(uint32_t slot, uint32_t len, const FuseRequest& req, FuseReply* reply,
+                 bool keep_all, Samples* s) {
+        FuseInHeader in_hdr;
+        memcpy(&in_hdr, req.args.data(), sizeof(in_hdr));
+        bool no_reply = in_hdr.opcode == FUSE_FORGET || in_hdr.opcode == FUSE_BATCH_FORGET;
+        if (len < sizeof(FuseOutHeader)) {
+            if (!no_reply) s->errors++;
+            return;
+        }
+        const uint8_t* out = ram_.data() + OutGpa(slot);
+        FuseOutHeader out_hdr;
+        memcpy(&out_hdr, out, sizeof(out_hdr));
+        if (out_hdr.error != 0) {
+            s->errors++;
+        } else if (in_hdr.opcode == FUSE_READ) {
+            s->bytes += len - sizeof(out_hdr);
+        } else if (in_hdr.opcode == FUSE_WRITE) {
+            s->bytes += req.payload_len;
+        }
+        if (!reply) return;
+        reply->error = out_hdr.error;
+        size_t body = len - sizeof(out_hdr);
+        if (!keep_all) body = std::min(body, kKeepBytes);
+        reply->body.assign(out + sizeof(out_hdr), out + sizeof(out_hdr) + body);
+    }
+
+    VirtioFsDevice& dev_;
+    uint32_t queue_idx_;
+    uint32_t depth_;
+    std::vector<uint8_t> ram_;
+    VirtQueue vq_;
+    uint16_t avail_idx_ = 0;
+    uint16_t last_used_ = 0;
+    uint64_t unique_ = 0;
+};
+
+// ── reporting ────────────────────────────────────────────────────────
+static bool g_failed = false;
+
+static void Report(const char* name, Samples s) {
+    std::sort(s.ns.begin(), s.ns.end());
+    auto pct = [&](double p) -> double {
+        if (s.ns.empty()) return 0;
+        size_t i = std::min(s.ns.size() - 1, static_cast<size_t>(p * s.ns.size()));
+        return s.ns[i] / 1000.0;
+    };
+    double ops = s.seconds > 0 ? s.ns.size() / s.seconds : 0;
+    fprintf(stdout, "%-18s %9zu %9.3f %11.0f %9.1f %9.1f %10.1f", name, s.ns.size(), s.seconds,
+            ops, pct(0.50), pct(0.99), s.ns.empty() ? 0.0 : s.ns.back() / 1000.0);
+    if (s.bytes) fprintf(stdout, " %9.1f", s.bytes / s.seconds / (1024.0 * 1024.0));
+    fprintf(stdout, "\n");
+    if (s.errors) {
+        fprintf(stdout, "  %" PRIu64 " request(s) failed\n", s.errors);
+        g_failed = true;
+    }
+}
+
+// ── host scratch tree ────────────────────────────────────────────────
+static bool TouchFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    ::close(fd);
+    return true;
+}
+
+static FuseRequest Forget(const std::vector<uint64_t>& nodes) {
+    std::vector<uint8_t> body(sizeof(FuseBatchForgetIn) + nodes.size() * sizeof(FuseForgetOne));
+    FuseBatchForgetIn batch = {static_cast<uint32_t>(nodes.size()), 0};
+    memcpy(body.data(), &batch, sizeof(batch));
+    for (size_t i = 0; i < nodes.size(); i++) {
+        FuseForgetOne one = {nodes[i], 1};
+        memcpy(body.data() + sizeof(batch) + i * sizeof(one), &one, sizeof(one));
+    }
+    return MakeRequest(FUSE_BATCH_FORGET, 0, body.data(), body.size());
+}
+
+static void ForgetAll(FuseReplayer& fs, const std::vector<uint64_t>& nodes) {
+    // Keep each batch within one slot buffer.
+    constexpr size_t kBatch = 4096;
+    for (size_t i = 0; i < nodes.size(); i += kBatch) {
+        size_t n = std::min(kBatch, nodes.size() - i);
+        fs.Call(Forget(std::vector<uint64_t>(nodes.begin() + i, nodes.begin() + i + n)));
+    }
+}
+
+static uint64_t EntryNode(const FuseReply& reply) {
+    FuseEntryOut entry;
+    return ReplyAs(reply, &entry) ? entry.nodeid : 0;
+}
+
+// ── workloads ────────────────────────────────────────────────────────
+static void BenchTreeWalk(FuseReplayer& fs, const std::string& root, uint64_t share,
+                          int dirs, int files) {
+    std::vector<FuseRequest> lookups;
+    for (int d = 0; d < dirs; d++) {
+        std::string dir = root + "/d" + std::to_string(d);
+        ::mkdir(dir.c_str(), 0755);
+        for (int f = 0; f < files; f++) TouchFile(dir + "/f" + std::to_string(f));
+        lookups.push_back(MakeNameRequest(FUSE_LOOKUP, share, "d" + std::to_string(d)));
+    }
+
+    std::vector<FuseReply> replies;
+    Samples s = fs.Run(lookups, &replies);
+    std::vector<uint64_t> dir_nodes;
+    for (const auto& r : replies) dir_nodes.push_back(EntryNode(r));
+
+    std::vector<FuseRequest> file_lookups;
+    for (uint64_t node : dir_nodes) {
+        for (int f = 0; f < files; f++) {
+            file_lookups.push_back(MakeNameRequest(FUSE_LOOKUP, node, "f" + std::to_string(f)));
+        }
+    }
+    s.Merge(fs.Run(file_lookups, &replies));
+    std::vector<uint64_t> file_nodes;
+    for (const auto& r : replies) file_nodes.push_back(EntryNode(r));
+    Report("lookup", s);
+
+    std::vector<FuseRequest> getattrs;
+    FuseGetAttrIn getattr_in;
+    memset(&getattr_in, 0, sizeof(getattr_in));
+    for (uint64_t node : file_nodes) {
+        getattrs.push_back(MakeRequest(FUSE_GETATTR, node, &getattr_in, sizeof(getattr_in)));
+    }
+    Report("getattr", fs.Run(getattrs));
+
+    file_nodes.insert(file_nodes.end(), dir_nodes.begin(), dir_nodes.end());
+    ForgetAll(fs, file_nodes);
+}
+
+static void BenchSequential(FuseReplayer& fs, const std::string& root, uint64_t share,
+                            uint64_t file_size) {
+    TouchFile(root + "/seq");
+    uint64_t node = EntryNode(fs.Call(MakeNameRequest(FUSE_LOOKUP, share, "seq")));
+    FuseOpenIn open_in;
+    memset(&open_in, 0, sizeof(open_in));
+    open_in.flags = O_RDWR;
+    FuseOpenOut open_out;
+    if (!ReplyAs(fs.Call(MakeRequest(FUSE_OPEN, node, &open_in, sizeof(open_in))), &open_out)) {
+        fprintf(stdout, "seq: OPEN failed\n");
+        g_failed = true;
+        return;
+    }
+
+    std::vector<uint8_t> data(kChunk);
+    for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<uint8_t>(i * 131 + 7);
+
+    std::vector<FuseRequest> writes, reads;
+    for (uint64_t off = 0; off < file_size; off += kChunk) {
+        FuseWriteIn write_in;
+        memset(&write_in, 0, sizeof(write_in));
+        write_in.fh = open_out.fh;
+        write_in.offset = off;
+        write_in.size = kChunk;
+        FuseRequest w = MakeRequest(FUSE_WRITE, node, &write_in, sizeof(write_in));
+        w.payload = data.data();
+        w.payload_len = kChunk;
+        writes.push_back(std::move(w));
+
+        FuseReadIn read_in;
+        memset(&read_in, 0, sizeof(read_in));
+        read_in.fh = open_out.fh;
+        read_in.offset = off;
+        read_in.size = kChunk;
+        reads.push_back(MakeRequest(FUSE_READ, node, &read_in, sizeof(read_in),
+                                    sizeof(FuseOutHeader) + kChunk));
+    }
+    Report("seq write 1M", fs.Run(writes));
+
+    FuseReleaseIn release_in;
+    memset(&release_in, 0, sizeof(release_in));
+    release_in.fh = open_out.fh;
+    fs.Call(MakeRequest(FUSE_FSYNC, node, &release_in, sizeof(release_in)));
+    Report("seq read 1M", fs.Run(reads));
+    fs.Call(MakeRequest(FUSE_RELEASE, node, &release_in, sizeof(release_in)));
+    ForgetAll(fs, {node});
+}
+
+static void BenchSmallFiles(FuseReplayer& fs, uint64_t share, int count) {
+    std::vector<FuseRequest> creates;
+    for (int i = 0; i < count; i++) {
+        std::string name = "s" + std::to_string(i);
+        FuseCreateIn create_in;
+        memset(&create_in, 0, sizeof(create_in));
+        create_in.flags = O_RDWR;
+        create_in.mode = 0644;
+        std::vector<uint8_t> body(sizeof(create_in) + name.size() + 1);
+        memcpy(body.data(), &create_in, sizeof(create_in));
+        memcpy(body.data() + sizeof(create_in), name.c_str(), name.size() + 1);
+        creates.push_back(MakeRequest(FUSE_CREATE, share, body.data(), body.size()));
+    }
+    std::vector<FuseReply> replies;
+    Samples create_s = fs.Run(creates, &replies);
+
+    std::vector<uint8_t> data(4096, 'x');
+    std::vector<FuseRequest> writes, releases;
+    std::vector<uint64_t> nodes;
+    for (const auto& r : replies) {
+        if (r.error != 0 || r.body.size() < sizeof(FuseEntryOut) + sizeof(FuseOpenOut)) continue;
+        FuseEntryOut entry;
+        FuseOpenOut open_out;
+        memcpy(&entry, r.body.data(), sizeof(entry));
+        memcpy(&open_out, r.body.data() + sizeof(entry), sizeof(open_out));
+        nodes.push_back(entry.nodeid);
+
+        FuseWriteIn write_in;
+        memset(&write_in, 0, sizeof(write_in));
+        write_in.fh = open_out.fh;
+        write_in.size = static_cast<uint32_t>(data.size());
+        FuseRequest w = MakeRequest(FUSE_WRITE, entry.nodeid, &write_in, sizeof(write_in));
+        w.payload = data.data();
+        w.payload_len = static_cast<uint32_t>(data.size());
+        writes.push_back(std::move(w));
+
+        FuseReleaseIn release_in;
+        memset(&release_in, 0, sizeof(release_in));
+        release_in.fh = open_out.fh;
+        releases.push_back(MakeRequest(FUSE_RELEASE, entry.nodeid, &release_in, sizeof(release_in)));
+    }
+    Samples write_s = fs.Run(writes);
+    create_s.Merge(fs.Run(releases));
+    Report("create+release", create_s);
+    Report("write 4K", write_s);
+
+    std::vector<FuseRequest> unlinks;
+    for (int i = 0; i < count; i++) {
+        unlinks.push_back(MakeNameRequest(FUSE_UNLINK, share, "s" + std::to_string(i)));
+    }
+    Report("unlink", fs.Run(unlinks));
+    ForgetAll(fs, nodes);
+}
+
+static void BenchReadDir(FuseReplayer& fs, const std::string& root, uint64_t share, int entries) {
+    std::string dir = root + "/big";
+    ::mkdir(dir.c_str(), 0755);
+    for (int i = 0; i < entries; i++) TouchFile(dir + "/entry_" + std::to_string(i));
+    uint64_t node = EntryNode(fs.Call(MakeNameRequest(FUSE_LOOKUP, share, "big")));
+
+    for (int plus = 0; plus < 2; plus++) {
+        FuseOpenIn open_in;
+        memset(&open_in, 0, sizeof(open_in));
+        FuseOpenOut open_out;
+        if (!ReplyAs(fs.Call(MakeRequest(FUSE_OPENDIR, node, &open_in, sizeof(open_in))), &open_out)) {
+            fprintf(stdout, "readdir: OPENDIR failed\n");
+            g_failed = true;
+            return;
+        }
+
+        // Each READDIR resumes from the last entry's offset, so the stream
+        // is inherently serial: one page-sized request at a time, like the
+        // guest's getdents loop.
+        Samples s;
+        std::vector<uint64_t> nodes;
+        uint64_t offset = 0;
+        size_t seen = 0;
+        for (;;) {
+            FuseReadIn read_in;
+            memset(&read_in, 0, sizeof(read_in));
+            read_in.fh = open_out.fh;
+            read_in.offset = offset;
+            read_in.size = 4096;
+            FuseRequest req = MakeRequest(plus ? FUSE_READDIRPLUS : FUSE_READDIR, node, &read_in,
+                                          sizeof(read_in), sizeof(FuseOutHeader) + 4096);
+            std::vector<FuseReply> replies;
+            s.Merge(fs.Run({req}, &replies, true));
+            const auto& body = replies[0].body;
+            if (replies[0].error != 0 || body.empty()) break;
+
+            size_t pos = 0;
+            size_t head = plus ? sizeof(FuseDirentplus) : sizeof(FuseDirent);
+            while (pos + head <= body.size()) {
+                FuseDirent dirent;
+                memcpy(&dirent, body.data() + pos + (plus ? sizeof(FuseEntryOut) : 0), sizeof(dirent));
+                if (plus) {
+                    FuseEntryOut entry;
+                    memcpy(&entry, body.data() + pos, sizeof(entry));
+                    if (entry.nodeid) nodes.push_back(entry.nodeid);
+                }
+                offset = dirent.off;
+                seen++;
+                pos += (head + dirent.namelen + 7) & ~size_t(7);
+            }
+        }
+        Report(plus ? "readdirplus" : "readdir", s);
+        if (seen < static_cast<size_t>(entries)) {
+            fprintf(stdout, "  only %zu of %d entries listed\n", seen, entries);
+            g_failed = true;
+        }
+
+        FuseReleaseIn release_in;
+        memset(&release_in, 0, sizeof(release_in));
+        release_in.fh = open_out.fh;
+        fs.Call(MakeRequest(FUSE_RELEASEDIR, node, &release_in, sizeof(release_in)));
+        ForgetAll(fs, nodes);
+    }
+    ForgetAll(fs, {node});
+}
+
+int main(int argc, char* argv[]) {
+    bool quick = false;
+    uint32_t depth = 16;
+    const char* tmp = getenv("TMPDIR");
+    std::string parent = tmp && *tmp ? tmp : "/tmp";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--depth" && i + 1 < argc) {
+            depth = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--dir" && i + 1 < argc) {
+            parent = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--quick] [--depth N] [--dir PATH]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::string tmpl = parent + "/tenbox_vfs_bench_XXXXXX";
+    std::vector<char> buf(tmpl.begin(), tmpl.end());
+    buf.push_back('\0');
+    if (!mkdtemp(buf.data())) {
+        fprintf(stderr, "cannot create scratch directory under %s\n", parent.c_str());
+        return 2;
+    }
+    std::string root = buf.data();
+
+    {
+        VirtioFsDevice dev("shared");
+        if (!dev.AddShare("bench", root)) return 2;
+        FuseReplayer fs(dev, 1, depth);
+
+        FuseInitIn init_in;
+        memset(&init_in, 0, sizeof(init_in));
+        init_in.major = FUSE_KERNEL_VERSION;
+        init_in.minor = FUSE_KERNEL_MINOR_VERSION;
+        init_in.max_readahead = 128 * 1024;
+        init_in.flags = FUSE_ASYNC_READ | FUSE_ASYNC_DIO | FUSE_BIG_WRITES | FUSE_PARALLEL_DIROPS |
+                        FUSE_DO_READDIRPLUS;
+        fs.Call(MakeRequest(FUSE_INIT, 0, &init_in, sizeof(init_in)));
+        uint64_t share = EntryNode(fs.Call(MakeNameRequest(FUSE_LOOKUP, kRootNodeId, "bench")));
+
+        fprintf(stdout, "=== virtio-fs benchmark (%s, depth %u, %s) ===\n\n",
+                quick ? "quick" : "full", depth, root.c_str());
+        fprintf(stdout, "%-18s %9s %9s %11s %9s %9s %10s %9s\n", "workload", "ops", "secs",
+                "ops/s", "p50 us", "p99 us", "max us", "MiB/s");
+
+        BenchTreeWalk(fs, root, share, quick ? 20 : 100, quick ? 50 : 100);
+        BenchSequential(fs, root, share, quick ? (32ull << 20) : (512ull << 20));
+        BenchSmallFiles(fs, share, quick ? 1000 : 10000);
+        BenchReadDir(fs, root, share, quick ? 10000 : 100000);
+        dev.Stop();
+    }
+
+    std::string cmd = "rm -rf '" + root + "'";
+    (void)system(cmd.c_str());
+    return g_failed ? 1 : 0;
+}
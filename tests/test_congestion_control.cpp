@@ -0,0 +1,425 @@
+// Standalone loopback tests for the remote desktop congestion controller.
+// A simulated link (capacity, propagation delay, drop-tail queue, random
+// loss) carries the packets of frames sized to the controller's target;
+// the far end answers with real RTCP bytes (transport-wide feedback and
+// receiver reports) that go back through the parser. Verifies: feedback
+// parsing, convergence below a bottleneck without a standing queue,
+// backing off and dropping frames when capacity falls, recovery,
+// loss-based control with and without transport-wide feedback, and drops
+// counted per frame slot however often the pacer is polled.
+
+#include "daemon/congestion_control.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <vector>
+
+using tenbox::daemon::CongestionControlConfig;
+using tenbox::daemon::ParseRtcpFeedback;
+using tenbox::daemon::RtcpReportBlock;
+using tenbox::daemon::SendSideCongestionController;
+using tenbox::daemon::TransportFeedback;
+
+// ── test infrastructure ──────────────────────────────────────────────
+static int g_pass = 0, g_fail = 0;
+
+#define TEST_ASSERT(cond, msg)                                          \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "  ASSERT FAILED: %s  (%s:%d)\n",          \
+                    msg, __FILE__, __LINE__);                           \
+            return false;                                               \
+        }                                                               \
+    } while (0)
+
+static void RunTest(const char* name, std::function<bool()> fn) {
+    fprintf(stdout, "--- %s ---\n", name);
+    bool ok = fn();
+    if (ok) { g_pass++; fprintf(stdout, "  PASS\n"); }
+    else    { g_fail++; fprintf(stdout, "  FAIL\n"); }
+}
+
+// ── RTCP builders (the browser's side) ───────────────────────────────
+static constexpr uint32_t kMediaSsrc = 0x1234;
+static constexpr uint32_t kReceiverSsrc = 0x5678;
+
+static void Put16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+static void Put24(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 16));
+    Put16(out, static_cast<uint16_t>(v));
+}
+
+static void Put32(std::vector<uint8_t>& out, uint32_t v) {
+    Put16(out, static_cast<uint16_t>(v >> 16));
+    Put16(out, static_cast<uint16_t>(v));
+}
+
+static void FinishRtcp(std::vector<uint8_t>& out, size_t start) {
+    while ((out.size() - start) % 4) out.push_back(0);
+    const size_t words = (out.size() - start) / 4 - 1;
+    out[start + 2] = static_cast<uint8_t>(words >> 8);
+    out[start + 3] = static_cast<uint8_t>(words);
+}
+
+// |arrival_us| per sequence number from |base_seq|, -1 for lost. Uses
+// two-bit status vector chunks, so large deltas are exercised too.
+static void AppendTransportFeedback(std::vector<uint8_t>& out, uint16_t base_seq,
+                                    const std::vector<int64_t>& arrival_us, uint8_t fb_count) {
+    const size_t start = out.size();
+    out.push_back(0x80 | 15);
+    out.push_back(205);
+    Put16(out, 0);
+    Put32(out, kReceiverSsrc);
+    Put32(out, kMediaSsrc);
+    Put16(out, base_seq);
+    Put16(out, static_cast<uint16_t>(arrival_us.size()));
+
+    int64_t reference = 0;
+    for (int64_t a : arrival_us) {
+        if (a >= 0) { reference = a / 64'000; break; }
+    }
+    Put24(out, static_cast<uint32_t>(reference) & 0xffffff);
+    out.push_back(fb_count);
+
+    std::vector<uint8_t> symbols;
+    std::vector<uint8_t> deltas;
+    int64_t clock = reference * 64'000;
+    for (int64_t a : arrival_us) {
+        if (a < 0) { symbols.push_back(0); continue; }
+        const int64_t units = (a - clock) / 250;
+        clock += units * 250;
+        if (units >= 0 && units <= 255) {
+            symbols.push_back(1);
+            deltas.push_back(static_cast<uint8_t>(units));
+        } else {
+            symbols.push_back(2);
+            Put16(deltas, static_cast<uint16_t>(static_cast<int16_t>(units)));
+        }
+    }
+    for (size_t i = 0; i < symbols.size(); i += 7) {
+        uint16_t chunk = 0xc000;
+        for (size_t j = 0; j < 7 && i + j < symbols.size(); ++j) {
+            chunk |= static_cast<uint16_t>(symbols[i + j] << (12 - 2 * j));
+        }
+        Put16(out, chunk);
+    }
+    out.insert(out.end(), deltas.begin(), deltas.end());
+    FinishRtcp(out, start);
+}
+
+static void AppendReceiverReport(std::vector<uint8_t>& out, uint32_t ssrc,
+                                 uint8_t fraction_lost, uint32_t highest_seq) {
+    const size_t start = out.size();
+    out.push_back(0x81);
+    out.push_back(201);
+    Put16(out, 0);
+    Put32(out, kReceiverSsrc);
+    Put32(out, ssrc);
+    out.push_back(fraction_lost);
+    Put24(out, 0);
+    Put32(out, highest_seq);
+    Put32(out, 0);  // jitter
+    Put32(out, 0);  // LSR
+    Put32(out, 0);  // DLSR
+    FinishRtcp(out, start);
+}
+
+// ── simulated link ───────────────────────────────────────────────────
+struct LinkConfig {
+    uint32_t capacity_bps = 10'000'000;
+    double loss = 0;
+    int64_t propagation_us = 20'000;
+    int64_t queue_limit_us = 300'000;
+    bool transport_feedback = true;
+};
+
+class Loopback {
+public:
+    Loopback(SendSideCongestionController* cc, LinkConfig link) : cc_(cc), link_(link) {}
+
+    LinkConfig& link() { return link_; }
+
+    // Run until |until_us|, calling |sample| once per simulated millisecond.
+    void Run(int64_t until_us, const std::function<void(int64_t)>& sample = {}) {
+        for (; now_us_ < until_us; now_us_ += 1'000) {
+            if (now_us_ >= next_frame_us_) {
+                SendFrame();
+                next_frame_us_ += 16'667;
+            }
+            if (now_us_ >= next_feedback_us_) {
+                if (link_.transport_feedback) SendTransportFeedback();
+                next_feedback_us_ += 100'000;
+            }
+            if (now_us_ >= next_report_us_) {
+                SendReceiverReport();
+                next_report_us_ += 1'000'000;
+            }
+            while (!rtcp_.empty() && rtcp_.front().first <= now_us_) {
+                Deliver(rtcp_.front().second);
+                rtcp_.pop_front();
+            }
+            if (sample) sample(now_us_);
+        }
+    }
+
+    int64_t QueueDelayUs() const { return std::max<int64_t>(link_free_us_ - now_us_, 0); }
+
+private:
+    struct Arrival {
+        uint16_t seq;
+        int64_t arrival_us;
+    };
+
+    double Random() {
+        rng_ = rng_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<double>(rng_ >> 11) / static_cast<double>(1ULL << 53);
+    }
+
+    void SendFrame() {
+        if (!cc_->ReadyForFrame(now_us_)) return;
+        const size_t frame_bytes = cc_->target_bitrate_bps() / cc_->target_framerate() / 8;
+        for (size_t sent = 0; sent < frame_bytes; sent += 1200) {
+            const size_t bytes = std::min<size_t>(1200, frame_bytes - sent);
+            const uint16_t seq = next_seq_++;
+            cc_->OnPacketSent(seq, bytes, now_us_);
+            ++sent_packets_;
+            if (Random() < link_.loss) continue;
+            const int64_t start = std::max(now_us_, link_free_us_);
+            if (start - now_us_ > link_.queue_limit_us) continue;  // drop-tail
+            link_free_us_ = start + static_cast<int64_t>(bytes) * 8 * 1'000'000 / link_.capacity_bps;
+            // The receiver's clock has its own origin.
+            in_flight_.push_back({seq, link_free_us_ + link_.propagation_us + 7'777'777});
+        }
+        cc_->OnFrameSent(frame_bytes, now_us_);
+    }
+
+    // Everything that has arrived by now, in one feedback message.
+    void SendTransportFeedback() {
+        std::vector<int64_t> arrivals;
+        uint16_t base = feedback_base_;
+        while (!in_flight_.empty() &&
+               in_flight_.front().arrival_us - 7'777'777 <= now_us_) {
+            const Arrival a = in_flight_.front();
+            in_flight_.pop_front();
+            while (static_cast<uint16_t>(base + arrivals.size()) != a.seq) arrivals.push_back(-1);
+            arrivals.push_back(a.arrival_us);
+            ++received_packets_;
+            highest_seq_ = a.seq;
+        }
+        if (arrivals.empty()) return;
+        std::vector<uint8_t> packet;
+        AppendTransportFeedback(packet, base, arrivals, feedback_count_++);
+        feedback_base_ = static_cast<uint16_t>(base + arrivals.size());
+        rtcp_.emplace_back(now_us_ + link_.propagation_us, std::move(packet));
+    }
+
+    void SendReceiverReport() {
+        if (!link_.transport_feedback) {
+            while (!in_flight_.empty() &&
+                   in_flight_.front().arrival_us - 7'777'777 <= now_us_) {
+                highest_seq_ = in_flight_.front().seq;
+                in_flight_.pop_front();
+                ++received_packets_;
+            }
+        }
+        const uint64_t expected = sent_packets_ - report_sent_;
+        const uint64_t received = received_packets_ - report_received_;
+        report_sent_ = sent_packets_;
+        report_received_ = received_packets_;
+        if (expected == 0) return;
+        const uint64_t lost = expected > received ? expected - received : 0;
+        std::vector<uint8_t> packet;
+        // A report about some other stream, which must be ignored.
+        AppendReceiverReport(packet, kMediaSsrc + 1, 255, 0);
+        AppendReceiverReport(packet, kMediaSsrc, static_cast<uint8_t>(lost * 256 / expected),
+                             highest_seq_);
+        rtcp_.emplace_back(now_us_ + link_.propagation_us, std::move(packet));
+    }
+
+    void Deliver(const std::vector<uint8_t>& packet) {
+        std::vector<RtcpReportBlock> reports;
+        std::vector<TransportFeedback> feedback;
+        ParseRtcpFeedback(packet, kMediaSsrc, &reports, &feedback);
+        for (const auto& report : reports) cc_->OnReceiverReport(report, now_us_);
+        for (const auto& fb : feedback) cc_->OnTransportFeedback(fb, now_us_);
+    }
+
+    SendSideCongestionController* cc_;
+    LinkConfig link_;
+    int64_t now_us_ = 0;
+    int64_t next_frame_us_ = 0;
+    int64_t next_feedback_us_ = 100'000;
+    int64_t next_report_us_ = 1'000'000;
+    int64_t link_free_us_ = 0;
+    uint16_t next_seq_ = 65000;  // wraps early in every run
+    uint16_t feedback_base_ = 65000;
+    uint8_t feedback_count_ = 0;
+    uint16_t highest_seq_ = 0;
+    uint64_t sent_packets_ = 0;
+    uint64_t received_packets_ = 0;
+    uint64_t report_sent_ = 0;
+    uint64_t report_received_ = 0;
+    uint64_t rng_ = 42;
+    std::deque<Arrival> in_flight_;
+    std::deque<std::pair<int64_t, std::vector<uint8_t>>> rtcp_;
+};
+
+// ── tests ────────────────────────────────────────────────────────────
+
+static bool TestParseFeedback() {
+    const std::vector<int64_t> arrivals = {
+        1'000'000, 1'000'500, -1, 1'001'000, 1'200'000, 1'199'000, -1};
+    std::vector<uint8_t> packet;
+    AppendReceiverReport(packet, kMediaSsrc, 64, 1234);
+    AppendTransportFeedback(packet, 65534, arrivals, 9);
+    AppendReceiverReport(packet, kMediaSsrc + 1, 1, 1);
+
+    std::vector<RtcpReportBlock> reports;
+    std::vector<TransportFeedback> feedback;
+    TEST_ASSERT(ParseRtcpFeedback(packet, kMediaSsrc, &reports, &feedback), "compound packet parses");
+    TEST_ASSERT(reports.size() == 1, "only our SSRC's report block");
+    TEST_ASSERT(reports[0].fraction_lost == 64 && reports[0].highest_seq == 1234, "report fields");
+    TEST_ASSERT(feedback.size() == 1, "one feedback message");
+    const auto& fb = feedback[0];
+    TEST_ASSERT(fb.base_seq == 65534 && fb.feedback_count == 9, "feedback header");
+    TEST_ASSERT(fb.arrival_us.size() == arrivals.size(), "status count");
+    for (size_t i = 0; i < arrivals.size(); ++i) {
+        if (arrivals[i] < 0) {
+            TEST_ASSERT(fb.arrival_us[i] == TransportFeedback::kNotReceived, "lost packet");
+        } else if (i > 0) {
+            // Relative timing survives to the 250us resolution.
+            TEST_ASSERT(fb.arrival_us[i] - fb.arrival_us[0] == arrivals[i] - arrivals[0], "arrival delta");
+        }
+    }
+
+    packet.resize(packet.size() - 4);
+    reports.clear();
+    feedback.clear();
+    TEST_ASSERT(!ParseRtcpFeedback(packet, kMediaSsrc, &reports, &feedback), "truncated packet rejected");
+    TEST_ASSERT(reports.size() == 1 && feedback.size() == 1, "parts before the damage kept");
+    return true;
+}
+
+static bool TestConvergesBelowBottleneck() {
+    SendSideCongestionController cc;
+    Loopback loop(&cc, {.capacity_bps = 2'000'000});
+    loop.Run(20'000'000);
+
+    uint64_t sum = 0, samples = 0;
+    int64_t max_queue_us = 0;
+    loop.Run(40'000'000, [&](int64_t) {
+        sum += cc.target_bitrate_bps();
+        ++samples;
+        max_queue_us = std::max(max_queue_us, loop.QueueDelayUs());
+    });
+    const double average = static_cast<double>(sum) / samples;
+    fprintf(stdout, "  avg target %.0f bps, max queue %lld ms\n",
+            average, static_cast<long long>(max_queue_us / 1000));
+    TEST_ASSERT(average > 1'200'000 && average < 2'100'000, "settles just under capacity");
+    TEST_ASSERT(max_queue_us < 200'000, "no standing queue");
+    return true;
+}
+
+static bool TestCapacityDrop() {
+    SendSideCongestionController cc;
+    Loopback loop(&cc, {.capacity_bps = 8'000'000});
+    loop.Run(20'000'000);
+    const uint32_t before = cc.target_bitrate_bps();
+    TEST_ASSERT(before > 5'000'000, "ramps up on a fast link");
+    TEST_ASSERT(cc.target_framerate() == 60, "full frame rate on a fast link");
+
+    loop.link().capacity_bps = 1'000'000;
+    const uint64_t dropped_before = cc.frames_dropped();
+    loop.Run(25'000'000);
+    fprintf(stdout, "  %u -> %u bps, %u fps, %llu frames dropped\n", before,
+            cc.target_bitrate_bps(), cc.target_framerate(),
+            static_cast<unsigned long long>(cc.frames_dropped() - dropped_before));
+    TEST_ASSERT(cc.target_bitrate_bps() < 1'100'000, "backs off within 5s");
+    TEST_ASSERT(cc.target_framerate() < 60, "frame rate follows the bitrate down");
+    TEST_ASSERT(cc.frames_dropped() > dropped_before, "frames dropped while the queue drains");
+
+    loop.link().capacity_bps = 8'000'000;
+    loop.Run(45'000'000);
+    fprintf(stdout, "  recovered to %u bps\n", cc.target_bitrate_bps());
+    TEST_ASSERT(cc.target_bitrate_bps() > 3'000'000, "recovers once capacity returns");
+    return true;
+}
+
+static bool TestRandomLoss() {
+    SendSideCongestionController cc;
+    Loopback loop(&cc, {.capacity_bps = 30'000'000, .loss = 0.2});
+    loop.Run(10'000'000);
+    const uint32_t lossy = cc.target_bitrate_bps();
+    fprintf(stdout, "  20%% loss: %u bps\n", lossy);
+    TEST_ASSERT(lossy < 1'500'000, "backs off under heavy loss");
+
+    loop.link().loss = 0.005;
+    loop.Run(20'000'000);
+    fprintf(stdout, "  0.5%% loss: %u bps\n", cc.target_bitrate_bps());
+    TEST_ASSERT(cc.target_bitrate_bps() > lossy * 3 / 2, "climbs again at low loss");
+    return true;
+}
+
+static bool TestReceiverReportsOnly() {
+    SendSideCongestionController cc;
+    Loopback loop(&cc, {.capacity_bps = 30'000'000, .loss = 0.2, .transport_feedback = false});
+    loop.Run(10'000'000);
+    fprintf(stdout, "  20%% loss, RR only: %u bps\n", cc.target_bitrate_bps());
+    TEST_ASSERT(cc.target_bitrate_bps() < 2'500'000, "receiver reports drive the loss controller");
+    return true;
+}
+
+static bool TestMaxBitrate() {
+    SendSideCongestionController cc;
+    Loopback loop(&cc, {.capacity_bps = 30'000'000});
+    cc.SetMaxBitrate(8'000'000);
+    TEST_ASSERT(cc.target_bitrate_bps() == 8'000'000, "starts at the cap before any feedback");
+    loop.Run(10'000'000);
+    cc.SetMaxBitrate(3'000'000);
+    TEST_ASSERT(cc.target_bitrate_bps() <= 3'000'000, "lowering the cap applies at once");
+    cc.SetMaxBitrate(6'000'000);
+    TEST_ASSERT(cc.target_bitrate_bps() <= 3'000'000, "raising it later is earned, not jumped to");
+    loop.Run(30'000'000);
+    TEST_ASSERT(cc.target_bitrate_bps() <= 6'000'000, "capped by the session setting");
+    TEST_ASSERT(cc.target_bitrate_bps() >= 5'000'000, "reaches the cap on a clean link");
+    return true;
+}
+
+static bool TestDropsCountedPerFrame() {
+    SendSideCongestionController cc;
+    cc.SetMaxBitrate(1'000'000);
+    const uint32_t fps = cc.target_framerate();
+    TEST_ASSERT(cc.ReadyForFrame(0), "first frame goes");
+    cc.OnFrameSent(1'000'000, 0);  // eight seconds of queue at 1 Mbps
+    // Polled every millisecond for a second, the way the fan-out retries.
+    for (int64_t now_us = 1'000; now_us <= 1'000'000; now_us += 1'000) {
+        TEST_ASSERT(!cc.ReadyForFrame(now_us), "held back while the queue drains");
+    }
+    fprintf(stdout, "  %llu dropped at %u fps\n",
+            static_cast<unsigned long long>(cc.frames_dropped()), fps);
+    TEST_ASSERT(cc.frames_dropped() >= fps - 2 && cc.frames_dropped() <= fps + 2,
+                "one drop per frame interval");
+    return true;
+}
+
+int main() {
+    fprintf(stdout, "=== Congestion Control Loopback Tests ===\n\n");
+
+    RunTest("Test 1: RTCP feedback parsing",        TestParseFeedback);
+    RunTest("Test 2: Bottleneck convergence",        TestConvergesBelowBottleneck);
+    RunTest("Test 3: Capacity drop and recovery",    TestCapacityDrop);
+    RunTest("Test 4: Random loss",                   TestRandomLoss);
+    RunTest("Test 5: Receiver reports only",         TestReceiverReportsOnly);
+    RunTest("Test 6: Max bitrate",                   TestMaxBitrate);
+    RunTest("Test 7: Drops counted per frame",       TestDropsCountedPerFrame);
+
+    fprintf(stdout, "\n=== Results: %d passed, %d failed ===\n",
+            g_pass, g_fail);
+    return g_fail;
+}
@@ -0,0 +1,180 @@
+// Standalone unit tests for the framebuffer tile damage tracker.
+// Feeds synthetic BGRA frames through TileDamageTracker and checks the
+// rect it returns. Verifies: the first frame is reported whole, unchanged
+// frames report nothing, content that only moves within a tile (a caret,
+// swapped rows) is still damage, damage is limited to the changed tiles
+// and clipped to the dirty rect, and Reset() / a resize forget the hashes.
+
+#include "runtime/frame_damage.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// ── test infrastructure ──────────────────────────────────────────────
+static int g_pass = 0, g_fail = 0;
+
+#define TEST_ASSERT(cond, msg)                                          \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "  ASSERT FAILED: %s  (%s:%d)\n",          \
+                    msg, __FILE__, __LINE__);                           \
+            return false;                                               \
+        }                                                               \
+    } while (0)
+
+static void RunTest(const char* name, std::function<bool()> fn) {
+    fprintf(stdout, "--- %s ---\n", name);
+    bool ok = fn();
+    if (ok) { g_pass++; fprintf(stdout, "  PASS\n"); }
+    else    { g_fail++; fprintf(stdout, "  FAIL\n"); }
+}
+
+// ── synthetic frames ─────────────────────────────────────────────────
+using Rect = TileDamageTracker::Rect;
+
+struct Frame {
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    std::vector<uint8_t> pixels;
+
+    Frame(uint32_t w, uint32_t h, uint32_t background = 0xff202020)
+        : width(w), height(h), stride(w * 4 + 32), pixels(static_cast<size_t>(stride) * h) {
+        Fill({0, 0, w, h}, background);
+    }
+
+    void Fill(const Rect& r, uint32_t bgra) {
+        for (uint32_t y = r.y; y < r.y + r.height; ++y) {
+            for (uint32_t x = r.x; x < r.x + r.width; ++x) {
+                memcpy(pixels.data() + static_cast<size_t>(y) * stride + x * 4, &bgra, 4);
+            }
+        }
+    }
+
+    Rect Update(TileDamageTracker& tracker, const Rect& dirty) const {
+        return tracker.Update(pixels.data(), stride, width, height, dirty);
+    }
+
+    Rect UpdateAll(TileDamageTracker& tracker) const {
+        return Update(tracker, {0, 0, width, height});
+    }
+};
+
+static bool SameRect(const Rect& a, const Rect& b) {
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 1: first frame is damage, an identical one is not
+// ══════════════════════════════════════════════════════════════════════
+static bool TestUnchangedFrame() {
+    TileDamageTracker tracker;
+    Frame frame(200, 130);
+    frame.Fill({10, 10, 50, 20}, 0xffffffff);
+    TEST_ASSERT(SameRect(frame.UpdateAll(tracker), {0, 0, 200, 130}), "first frame whole");
+    TEST_ASSERT(frame.UpdateAll(tracker).empty(), "same frame again");
+
+    auto stats = tracker.GetStats();
+    TEST_ASSERT(stats.frames == 2 && stats.frames_unchanged == 1, "frames counted");
+    TEST_ASSERT(stats.damage_bytes == 200u * 130 * 4, "damage bytes counted");
+    return true;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 2: content moving inside one tile is damage
+// ══════════════════════════════════════════════════════════════════════
+static bool TestMoveWithinTile() {
+    constexpr uint32_t kCaret = 0xffe0e0e0;
+    TileDamageTracker tracker;
+    Frame frame(256, 128);
+    const Rect tile{64, 64, 64, 64};
+
+    // A 2px-wide caret stepping right one cell at a time.
+    frame.Fill({64 + 8, 70, 2, 16}, kCaret);
+    frame.UpdateAll(tracker);
+    frame = Frame(256, 128);
+    frame.Fill({64 + 16, 70, 2, 16}, kCaret);
+    TEST_ASSERT(SameRect(frame.UpdateAll(tracker), tile), "caret moved 8px");
+
+    // One pixel, staying inside the same 16-byte block.
+    frame = Frame(256, 128);
+    frame.Fill({64 + 17, 70, 2, 16}, kCaret);
+    TEST_ASSERT(SameRect(frame.UpdateAll(tracker), tile), "caret moved 1px");
+
+    // Down a row.
+    frame = Frame(256, 128);
+    frame.Fill({64 + 17, 71, 2, 16}, kCaret);
+    TEST_ASSERT(SameRect(frame.UpdateAll(tracker), tile), "caret moved down");
+
+    // Two rows trading places.
+    frame = Frame(256, 128);
+    frame.Fill({64, 80, 64, 1}, 0xff0000ff);
+    frame.Fill({64, 90, 64, 1}, 0xff00ff00);
+    frame.UpdateAll(tracker);
+    frame = Frame(256, 128);
+    frame.Fill({64, 80, 64, 1}, 0xff00ff00);
+    frame.Fill({64, 90, 64, 1}, 0xff0000ff);
+    TEST_ASSERT(SameRect(frame.UpdateAll(tracker), tile), "rows swapped");
+
+    // Two blocks of a row trading places.
+    frame = Frame(256, 128);
+    frame.Fill({64, 100, 4, 1}, 0xff0000ff);
+    frame.Fill({64 + 32, 100, 4, 1}, 0xff00ff00);
+    frame.UpdateAll(tracker);
+    frame = Frame(256, 128);
+    frame.Fill({64, 100, 4, 1}, 0xff00ff00);
+    frame.Fill({64 + 32, 100, 4, 1}, 0xff0000ff);
+    TEST_ASSERT(SameRect(frame.UpdateAll(tracker), tile), "blocks swapped");
+    return true;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 3: damage covers only the changed tiles, clipped to the dirty rect
+// ══════════════════════════════════════════════════════════════════════
+static bool TestDamageBounds() {
+    TileDamageTracker tracker;
+    Frame frame(300, 200);  // partial tiles on the right and bottom edges
+    frame.UpdateAll(tracker);
+
+    frame.Fill({70, 10, 5, 5}, 0xffffffff);     // tile (1, 0)
+    frame.Fill({200, 140, 5, 5}, 0xffffffff);   // tile (3, 2)
+    TEST_ASSERT(SameRect(frame.UpdateAll(tracker), {64, 0, 192, 192}), "bounding box of tiles");
+
+    frame.Fill({290, 195, 10, 5}, 0xff123456);  // edge tile (4, 3)
+    TEST_ASSERT(SameRect(frame.Update(tracker, {280, 190, 20, 10}), {280, 192, 20, 8}),
+                "clipped to dirty rect");
+    TEST_ASSERT(frame.Update(tracker, {0, 0, 1000, 1000}).empty(), "oversized dirty rect clamped");
+    TEST_ASSERT(frame.Update(tracker, {400, 0, 10, 10}).empty(), "dirty rect off screen");
+    return true;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 4: Reset() and a resize report everything again
+// ══════════════════════════════════════════════════════════════════════
+static bool TestResetAndResize() {
+    TileDamageTracker tracker;
+    Frame frame(128, 128);
+    frame.UpdateAll(tracker);
+    TEST_ASSERT(frame.UpdateAll(tracker).empty(), "unchanged");
+    tracker.Reset();
+    TEST_ASSERT(SameRect(frame.UpdateAll(tracker), {0, 0, 128, 128}), "whole after Reset");
+
+    Frame bigger(192, 128);
+    TEST_ASSERT(SameRect(bigger.UpdateAll(tracker), {0, 0, 192, 128}), "whole after resize");
+    return true;
+}
+
+int main() {
+    fprintf(stdout, "=== Frame damage Unit Tests ===\n\n");
+
+    RunTest("Test 1: Unchanged frame",          TestUnchangedFrame);
+    RunTest("Test 2: Move within a tile",       TestMoveWithinTile);
+    RunTest("Test 3: Damage bounds",            TestDamageBounds);
+    RunTest("Test 4: Reset and resize",         TestResetAndResize);
+
+    fprintf(stdout, "\n=== Results: %d passed, %d failed ===\n",
+            g_pass, g_fail);
+    return g_fail;
+}
@@ -0,0 +1,611 @@
+// Standalone unit tests for the virtio-fs device.
+// Drives FUSE requests through a VirtQueue backed by a fake guest RAM
+// buffer against a share rooted in a host temp directory. Verifies:
+// BATCH_FORGET dropping inodes, FALLOCATE preallocation and hole punching,
+// LSEEK SEEK_DATA/SEEK_HOLE, COPY_FILE_RANGE, writeback-cache
+// negotiation in INIT, per-share I/O accounting and limits, and a driver
+// reset with requests still in flight on the worker pool.
+
+#include "core/device/virtio/virtio_fs.h"
+#include "core/device/virtio/virtio_mmio.h"
+#include "core/device/virtio/virtqueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ── test infrastructure ──────────────────────────────────────────────
+static int g_pass = 0, g_fail = 0;
+
+#define TEST_ASSERT(cond, msg)                                          \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "  ASSERT FAILED: %s  (%s:%d)\n",          \
+                    msg, __FILE__, __LINE__);                           \
+            return false;                                               \
+        }                                                               \
+    } while (0)
+
+static void RunTest(const char* name, std::function<bool()> fn) {
+    fprintf(stdout, "--- %s ---\n", name);
+    bool ok = fn();
+    if (ok) { g_pass++; fprintf(stdout, "  PASS\n"); }
+    else    { g_fail++; fprintf(stdout, "  FAIL\n"); }
+}
+
+// ── fake guest ───────────────────────────────────────────────────────
+// Guest RAM layout: descriptor table, avail ring and used ring in the
+// first pages, request and reply buffers after them. Requests go to the
+// hiprio queue, which the device completes inline in OnQueueNotify.
+static constexpr uint32_t kQueueSize = 8;
+static constexpr uint64_t kDescGpa   = 0x0000;
+static constexpr uint64_t kAvailGpa  = 0x1000;
+static constexpr uint64_t kUsedGpa   = 0x2000;
+static constexpr uint64_t kInGpa     = 0x10000;
+static constexpr uint64_t kOutGpa    = 0x80000;
+static constexpr uint64_t kRamSize   = 0x100000;
+
+static constexpr uint64_t kRootNodeId = 1;
+
+struct Reply {
+    int32_t error = 0;
+    std::vector<uint8_t> body;
+    bool replied = false;
+};
+
+class FsHarness {
+public:
+    FsHarness() : ram_(kRamSize) {
+        GuestMemMap mem;
+        mem.base = ram_.data();
+        mem.alloc_size = kRamSize;
+        mem.low_size = kRamSize;
+        vq_.Setup(kQueueSize, mem);
+        vq_.SetDescAddr(kDescGpa);
+        vq_.SetDriverAddr(kAvailGpa);
+        vq_.SetDeviceAddr(kUsedGpa);
+        vq_.SetReady(true);
+    }
+
+    VirtioFsDevice& dev() { return dev_; }
+
+    Reply Call(uint32_t opcode, uint64_t nodeid, const void* body, size_t len,
+               uint32_t out_size = 4096) {
+        FuseInHeader hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.len = static_cast<uint32_t>(sizeof(hdr) + len);
+        hdr.opcode = opcode;
+        hdr.unique = ++unique_;
+        hdr.nodeid = nodeid;
+        memcpy(ram_.data() + kInGpa, &hdr, sizeof(hdr));
+        if (len) memcpy(ram_.data() + kInGpa + sizeof(hdr), body, len);
+        memset(ram_.data() + kOutGpa, 0, out_size);
+
+        auto* desc = reinterpret_cast<VirtqDesc*>(ram_.data() + kDescGpa);
+        desc[0] = {kInGpa, hdr.len, VIRTQ_DESC_F_NEXT, 1};
+        desc[1] = {kOutGpa, out_size, VIRTQ_DESC_F_WRITE, 0};
+
+        auto* avail = reinterpret_cast<VirtqAvail*>(ram_.data() + kAvailGpa);
+        auto* ring = reinterpret_cast<uint16_t*>(avail + 1);
+        ring[avail->idx % kQueueSize] = 0;
+        avail->idx++;
+
+        auto* used = reinterpret_cast<VirtqUsed*>(ram_.data() + kUsedGpa);
+        uint16_t used_before = used->idx;
+        dev_.OnQueueNotify(0, vq_);
+
+        Reply reply;
+        if (used->idx == used_before) return reply;
+        auto* elem = reinterpret_cast<VirtqUsedElem*>(used + 1) + (used_before % kQueueSize);
+        if (elem->len < sizeof(FuseOutHeader)) return reply;
+        FuseOutHeader out_hdr;
+        memcpy(&out_hdr, ram_.data() + kOutGpa, sizeof(out_hdr));
+        reply.replied = true;
+        reply.error = out_hdr.error;
+        const uint8_t* p = ram_.data() + kOutGpa + sizeof(out_hdr);
+        reply.body.assign(p, p + (elem->len - sizeof(out_hdr)));
+        return reply;
+    }
+
+    // LOOKUP |name| under |parent|; returns the node id or 0.
+    uint64_t Lookup(uint64_t parent, const std::string& name) {
+        Reply r = Call(FUSE_LOOKUP, parent, name.c_str(), name.size() + 1);
+        if (!r.replied || r.error != 0 || r.body.size() < sizeof(FuseEntryOut)) return 0;
+        FuseEntryOut entry;
+        memcpy(&entry, r.body.data(), sizeof(entry));
+        return entry.nodeid;
+    }
+
+    // INIT offering |flags|; returns the negotiated reply.
+    FuseInitOut Init(uint32_t flags) {
+        FuseInitIn init_in;
+        memset(&init_in, 0, sizeof(init_in));
+        init_in.major = FUSE_KERNEL_VERSION;
+        init_in.minor = FUSE_KERNEL_MINOR_VERSION;
+        init_in.max_readahead = 128 * 1024;
+        init_in.flags = flags;
+        Reply r = Call(FUSE_INIT, 0, &init_in, sizeof(init_in));
+        FuseInitOut init_out;
+        memset(&init_out, 0, sizeof(init_out));
+        if (r.replied && r.error == 0 && r.body.size() >= sizeof(init_out)) {
+            memcpy(&init_out, r.body.data(), sizeof(init_out));
+        }
+        return init_out;
+    }
+
+    // OPEN |nodeid| with |flags| (read-write by default); returns the file
+    // handle or 0, and the reply's open_flags through |open_flags|.
+    uint64_t Open(uint64_t nodeid, uint32_t flags = O_RDWR, uint32_t* open_flags = nullptr) {
+        FuseOpenIn open_in;
+        memset(&open_in, 0, sizeof(open_in));
+        open_in.flags = flags;
+        Reply r = Call(FUSE_OPEN, nodeid, &open_in, sizeof(open_in));
+        if (!r.replied || r.error != 0 || r.body.size() < sizeof(FuseOpenOut)) return 0;
+        FuseOpenOut open_out;
+        memcpy(&open_out, r.body.data(), sizeof(open_out));
+        if (open_flags) *open_flags = open_out.open_flags;
+        return open_out.fh;
+    }
+
+    int32_t Lseek(uint64_t nodeid, uint64_t fh, uint64_t offset, uint32_t whence,
+                  uint64_t* result) {
+        FuseLseekIn lseek_in;
+        memset(&lseek_in, 0, sizeof(lseek_in));
+        lseek_in.fh = fh;
+        lseek_in.offset = offset;
+        lseek_in.whence = whence;
+        Reply r = Call(FUSE_LSEEK, nodeid, &lseek_in, sizeof(lseek_in));
+        if (!r.replied) return 1;
+        if (r.error == 0 && r.body.size() >= sizeof(FuseLseekOut)) {
+            FuseLseekOut lseek_out;
+            memcpy(&lseek_out, r.body.data(), sizeof(lseek_out));
+            *result = lseek_out.offset;
+        }
+        return r.error;
+    }
+
+private:
+    std::vector<uint8_t> ram_;
+    VirtQueue vq_;
+    VirtioFsDevice dev_{"shared"};
+    uint64_t unique_ = 0;
+};
+
+// ── temp share directory ─────────────────────────────────────────────
+struct TempDir {
+    std::string path;
+    TempDir() {
+        char tmpl[] = "/tmp/tenbox_vfs_XXXXXX";
+        if (mkdtemp(tmpl)) path = tmpl;
+    }
+    ~TempDir() {
+        if (!path.empty()) {
+            std::string cmd = "rm -rf '" + path + "'";
+            (void)system(cmd.c_str());
+        }
+    }
+    std::string File(const char* name) const { return path + "/" + name; }
+};
+
+static bool WriteHostFile(const std::string& path, const std::string& data) {
+    int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size());
+    ::close(fd);
+    return ok;
+}
+
+static std::string ReadHostFile(const std::string& path) {
+    std::string data;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return data;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) data.append(buf, n);
+    ::close(fd);
+    return data;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 1: BATCH_FORGET drops every inode it names and sends no reply
+// ══════════════════════════════════════════════════════════════════════
+static bool TestBatchForget() {
+    TempDir dir;
+    TEST_ASSERT(!dir.path.empty(), "mkdtemp failed");
+    TEST_ASSERT(WriteHostFile(dir.File("a"), "a"), "write a");
+    TEST_ASSERT(WriteHostFile(dir.File("b"), "b"), "write b");
+
+    FsHarness fs;
+    TEST_ASSERT(fs.dev().AddShare("s", dir.path), "AddShare");
+    uint64_t share = fs.Lookup(kRootNodeId, "s");
+    TEST_ASSERT(share != 0, "lookup share root");
+
+    uint64_t a = fs.Lookup(share, "a");
+    uint64_t b = fs.Lookup(share, "b");
+    TEST_ASSERT(a != 0 && b != 0 && a != b, "lookup children");
+    TEST_ASSERT(fs.Lookup(share, "a") == a, "repeat lookup returns same node");
+
+    // a was looked up twice: forgetting one reference must keep it alive.
+    std::vector<uint8_t> batch(sizeof(FuseBatchForgetIn) + 2 * sizeof(FuseForgetOne));
+    FuseBatchForgetIn batch_in = {2, 0};
+    FuseForgetOne one[2] = {{a, 1}, {b, 1}};
+    memcpy(batch.data(), &batch_in, sizeof(batch_in));
+    memcpy(batch.data() + sizeof(batch_in), one, sizeof(one));
+    Reply r = fs.Call(FUSE_BATCH_FORGET, 0, batch.data(), batch.size());
+    TEST_ASSERT(!r.replied, "BATCH_FORGET must not reply");
+
+    Reply ga = fs.Call(FUSE_GETATTR, a, nullptr, 0);
+    TEST_ASSERT(ga.replied && ga.error == 0, "a still referenced");
+    Reply gb = fs.Call(FUSE_GETATTR, b, nullptr, 0);
+    TEST_ASSERT(gb.replied && gb.error == FUSE_ENOENT, "b forgotten");
+
+    // A count larger than the payload is clamped to what was sent.
+    batch_in.count = 1000;
+    one[0] = {a, 1};
+    memcpy(batch.data(), &batch_in, sizeof(batch_in));
+    memcpy(batch.data() + sizeof(batch_in), one, sizeof(FuseForgetOne));
+    fs.Call(FUSE_BATCH_FORGET, 0, batch.data(), sizeof(batch_in) + sizeof(FuseForgetOne));
+    ga = fs.Call(FUSE_GETATTR, a, nullptr, 0);
+    TEST_ASSERT(ga.replied && ga.error == FUSE_ENOENT, "a forgotten");
+    return true;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 2: FALLOCATE preallocates and punches holes; LSEEK finds them
+// ══════════════════════════════════════════════════════════════════════
+static bool TestFallocateLseek() {
+    TempDir dir;
+    TEST_ASSERT(!dir.path.empty(), "mkdtemp failed");
+    constexpr uint64_t kMiB = 1u << 20;
+    TEST_ASSERT(WriteHostFile(dir.File("f"), std::string(4 * kMiB, 'x')), "create f");
+
+    FsHarness fs;
+    TEST_ASSERT(fs.dev().AddShare("s", dir.path), "AddShare");
+    uint64_t share = fs.Lookup(kRootNodeId, "s");
+    uint64_t node = fs.Lookup(share, "f");
+    TEST_ASSERT(node != 0, "lookup f");
+    uint64_t fh = fs.Open(node);
+    TEST_ASSERT(fh != 0, "open f");
+
+    // Preallocate one more MiB past EOF.
+    constexpr uint64_t kSize = 5 * kMiB;
+    FuseFallocateIn falloc;
+    memset(&falloc, 0, sizeof(falloc));
+    falloc.fh = fh;
+    falloc.offset = 4 * kMiB;
+    falloc.length = kMiB;
+    Reply r = fs.Call(FUSE_FALLOCATE, node, &falloc, sizeof(falloc));
+    TEST_ASSERT(r.replied, "FALLOCATE replied");
+#if defined(__linux__)
+    if (r.error == FUSE_EOPNOTSUPP) {
+        fprintf(stdout, "  (host filesystem lacks fallocate, skipping)\n");
+        return true;
+    }
+    TEST_ASSERT(r.error == 0, "FALLOCATE succeeded");
+
+    struct stat st;
+    TEST_ASSERT(stat(dir.File("f").c_str(), &st) == 0, "stat f");
+    TEST_ASSERT(static_cast<uint64_t>(st.st_size) == kSize, "file extended");
+    blkcnt_t full_blocks = st.st_blocks;
+
+    // Punch [1 MiB, 3 MiB); the size stays and the blocks go away.
+    falloc.offset = kMiB;
+    falloc.length = 2 * kMiB;
+    falloc.mode = 0x01 | 0x02;  // FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE
+    r = fs.Call(FUSE_FALLOCATE, node, &falloc, sizeof(falloc));
+    TEST_ASSERT(r.replied && r.error == 0, "PUNCH_HOLE succeeded");
+    TEST_ASSERT(stat(dir.File("f").c_str(), &st) == 0, "stat f");
+    TEST_ASSERT(static_cast<uint64_t>(st.st_size) == kSize, "size kept");
+    TEST_ASSERT(st.st_blocks < full_blocks, "file is sparse");
+
+    uint64_t pos = 0;
+    int32_t err = fs.Lseek(node, fh, 0, FUSE_SEEK_HOLE, &pos);
+    TEST_ASSERT(err == 0, "SEEK_HOLE succeeded");
+    TEST_ASSERT(pos == kMiB, "SEEK_HOLE finds the punched hole");
+    err = fs.Lseek(node, fh, kMiB, FUSE_SEEK_DATA, &pos);
+    TEST_ASSERT(err == 0, "SEEK_DATA succeeded");
+    TEST_ASSERT(pos == 3 * kMiB, "SEEK_DATA lands past the hole");
+#else
+    TEST_ASSERT(r.error == FUSE_EOPNOTSUPP, "FALLOCATE unsupported off Linux");
+    uint64_t pos = 0;
+    TEST_ASSERT(fs.Lseek(node, fh, 0, FUSE_SEEK_DATA, &pos) == 0 && pos == 0, "SEEK_DATA");
+#endif
+
+    uint64_t ignored = 0;
+    TEST_ASSERT(fs.Lseek(node, fh, kSize + 1, FUSE_SEEK_DATA, &ignored) == FUSE_ENXIO,
+                "SEEK_DATA past EOF is ENXIO");
+    TEST_ASSERT(fs.Lseek(node, fh, 0, 0 /* SEEK_SET */, &ignored) == FUSE_EINVAL,
+                "plain whence rejected");
+    TEST_ASSERT(fs.Lseek(node, 0xdead, 0, FUSE_SEEK_DATA, &ignored) == FUSE_ENOENT,
+                "unknown fh rejected");
+    return true;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 3: COPY_FILE_RANGE copies host-side between two open handles
+// ══════════════════════════════════════════════════════════════════════
+static bool TestCopyFileRange() {
+    TempDir dir;
+    TEST_ASSERT(!dir.path.empty(), "mkdtemp failed");
+    std::string src_data;
+    for (int i = 0; i < 300000; i++) src_data.push_back(static_cast<char>('a' + i % 26));
+    TEST_ASSERT(WriteHostFile(dir.File("src"), src_data), "write src");
+    TEST_ASSERT(WriteHostFile(dir.File("dst"), "0123456789"), "write dst");
+
+    FsHarness fs;
+    TEST_ASSERT(fs.dev().AddShare("s", dir.path), "AddShare");
+    uint64_t share = fs.Lookup(kRootNodeId, "s");
+    uint64_t src = fs.Lookup(share, "src");
+    uint64_t dst = fs.Lookup(share, "dst");
+    TEST_ASSERT(src != 0 && dst != 0, "lookup files");
+    uint64_t src_fh = fs.Open(src);
+    uint64_t dst_fh = fs.Open(dst);
+    TEST_ASSERT(src_fh != 0 && dst_fh != 0, "open files");
+
+    FuseCopyFileRangeIn copy_in;
+    memset(&copy_in, 0, sizeof(copy_in));
+    copy_in.fh_in = src_fh;
+    copy_in.off_in = 100;
+    copy_in.nodeid_out = dst;
+    copy_in.fh_out = dst_fh;
+    copy_in.off_out = 5;
+    copy_in.len = 200000;
+    Reply r = fs.Call(FUSE_COPY_FILE_RANGE, src, &copy_in, sizeof(copy_in));
+    TEST_ASSERT(r.replied && r.error == 0, "COPY_FILE_RANGE succeeded");
+    TEST_ASSERT(r.body.size() >= sizeof(FuseWriteOut), "reply carries a count");
+    FuseWriteOut write_out;
+    memcpy(&write_out, r.body.data(), sizeof(write_out));
+    TEST_ASSERT(write_out.size == 200000, "whole range copied");
+
+    std::string expected = "01234" + src_data.substr(100, 200000);
+    TEST_ASSERT(ReadHostFile(dir.File("dst")) == expected, "destination contents");
+
+    // Copying from past EOF copies nothing.
+    copy_in.off_in = src_data.size() + 10;
+    r = fs.Call(FUSE_COPY_FILE_RANGE, src, &copy_in, sizeof(copy_in));
+    TEST_ASSERT(r.replied && r.error == 0, "copy past EOF succeeded");
+    memcpy(&write_out, r.body.data(), sizeof(write_out));
+    TEST_ASSERT(write_out.size == 0, "nothing copied past EOF");
+
+    copy_in.flags = 1;
+    r = fs.Call(FUSE_COPY_FILE_RANGE, src, &copy_in, sizeof(copy_in));
+    TEST_ASSERT(r.replied && r.error == FUSE_EINVAL, "unknown flags rejected");
+
+    // A read-only share refuses to be the destination.
+    FsHarness ro;
+    TEST_ASSERT(ro.dev().AddShare("r", dir.path, true), "AddShare ro");
+    uint64_t ro_share = ro.Lookup(kRootNodeId, "r");
+    uint64_t ro_dst = ro.Lookup(ro_share, "dst");
+    FuseOpenIn open_in;
+    memset(&open_in, 0, sizeof(open_in));
+    Reply o = ro.Call(FUSE_OPEN, ro_dst, &open_in, sizeof(open_in));
+    TEST_ASSERT(o.replied && o.error == 0, "open ro");
+    FuseOpenOut open_out;
+    memcpy(&open_out, o.body.data(), sizeof(open_out));
+    copy_in.flags = 0;
+    copy_in.off_in = 0;
+    copy_in.fh_in = open_out.fh;
+    copy_in.fh_out = open_out.fh;
+    copy_in.nodeid_out = ro_dst;
+    r = ro.Call(FUSE_COPY_FILE_RANGE, ro_dst, &copy_in, sizeof(copy_in));
+    TEST_ASSERT(r.replied && r.error == FUSE_EROFS, "read-only destination rejected");
+    return true;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 4: writeback cache is negotiated only when every share opts in
+// ══════════════════════════════════════════════════════════════════════
+static bool TestWritebackNegotiation() {
+    TempDir dir;
+    TEST_ASSERT(!dir.path.empty(), "mkdtemp failed");
+    TEST_ASSERT(WriteHostFile(dir.File("f"), "hello"), "write f");
+    const uint32_t kOffered = FUSE_WRITEBACK_CACHE | FUSE_ASYNC_READ | FUSE_ASYNC_DIO;
+
+    {
+        FsHarness fs;
+        TEST_ASSERT(fs.dev().AddShare("wb", dir.path, false, FsCachePolicy::kAuto, true), "AddShare wb");
+        TEST_ASSERT(fs.dev().AddShare("ro", dir.path, true), "AddShare ro");
+        FuseInitOut init_out = fs.Init(kOffered);
+        TEST_ASSERT(init_out.flags & FUSE_WRITEBACK_CACHE, "writeback negotiated");
+        TEST_ASSERT((init_out.flags & FUSE_ASYNC_READ) && (init_out.flags & FUSE_ASYNC_DIO),
+                    "async I/O negotiated");
+        TEST_ASSERT(init_out.max_background > 16, "max_background raised");
+
+        // A write-only open must still serve the page cache's reads.
+        uint64_t node = fs.Lookup(fs.Lookup(kRootNodeId, "wb"), "f");
+        uint32_t open_flags = 0;
+        uint64_t fh = fs.Open(node, O_WRONLY, &open_flags);
+        TEST_ASSERT(fh != 0, "open write-only");
+        TEST_ASSERT(!(open_flags & FOPEN_DIRECT_IO), "opted-in share is cached");
+        FuseReadIn read_in;
+        memset(&read_in, 0, sizeof(read_in));
+        read_in.fh = fh;
+        read_in.size = 5;
+        Reply r = fs.Call(FUSE_READ, node, &read_in, sizeof(read_in));
+        TEST_ASSERT(r.replied && r.error == 0, "read through write-only handle");
+        TEST_ASSERT(std::string(r.body.begin(), r.body.end()) == "hello", "read data");
+
+        // Shares added after INIT without opting in stay write-through.
+        TEST_ASSERT(fs.dev().AddShare("late", dir.path), "AddShare late");
+        uint64_t late = fs.Lookup(fs.Lookup(kRootNodeId, "late"), "f");
+        TEST_ASSERT(fs.Open(late, O_RDWR, &open_flags) != 0, "open late");
+        TEST_ASSERT(open_flags & FOPEN_DIRECT_IO, "late share uses direct I/O");
+    }
+    {
+        FsHarness fs;
+        TEST_ASSERT(fs.dev().AddShare("wb", dir.path, false, FsCachePolicy::kAuto, true), "AddShare wb");
+        TEST_ASSERT(fs.dev().AddShare("wt", dir.path), "AddShare wt");
+        FuseInitOut init_out = fs.Init(kOffered);
+        TEST_ASSERT(!(init_out.flags & FUSE_WRITEBACK_CACHE), "mixed shares stay write-through");
+        TEST_ASSERT(init_out.flags & FUSE_ASYNC_READ, "async read still negotiated");
+    }
+    return true;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 5: per-share token buckets delay requests past the limits
+// ══════════════════════════════════════════════════════════════════════
+static bool TestShareLimits() {
+    FsShareIo io({10, 0});
+    for (int i = 0; i < 10; ++i) {
+        TEST_ASSERT(io.Admit(FUSE_GETATTR, 0) == 0, "within iops burst");
+    }
+    uint64_t delay = io.Admit(FUSE_GETATTR, 0);
+    TEST_ASSERT(delay > 50000000 && delay <= 100000000, "11th op waits ~1/iops");
+
+    io.SetLimits({0, 1 << 20});
+    TEST_ASSERT(io.Admit(FUSE_READ, 1 << 20) == 0, "first MiB fits the bucket");
+    delay = io.Admit(FUSE_WRITE, 512 << 10);
+    TEST_ASSERT(delay > 400000000 && delay <= 500000000, "next 512 KiB waits ~0.5 s");
+
+    FsShareStats stats = io.Read();
+    TEST_ASSERT(stats.ops == 13, "ops counted");
+    TEST_ASSERT(stats.read_ops == 1 && stats.read_bytes == (1u << 20), "reads counted");
+    TEST_ASSERT(stats.write_ops == 1 && stats.write_bytes == (512u << 10), "writes counted");
+    TEST_ASSERT(stats.throttled == 2 && stats.throttled_ns > 0, "throttling counted");
+    TEST_ASSERT(stats.limits.bytes_per_sec == (1u << 20) && stats.limits.iops == 0,
+                "limits reported");
+
+    TempDir dir;
+    TEST_ASSERT(!dir.path.empty(), "mkdtemp failed");
+    FsHarness fs;
+    TEST_ASSERT(fs.dev().AddShare("b", dir.path, false, FsCachePolicy::kAuto, false, {100, 0}),
+                "AddShare b");
+    TEST_ASSERT(fs.dev().AddShare("a", dir.path), "AddShare a");
+    TEST_ASSERT(fs.dev().SetShareLimits("a", {0, 4096}), "SetShareLimits a");
+    TEST_ASSERT(!fs.dev().SetShareLimits("missing", {1, 1}), "unknown tag rejected");
+    auto all = fs.dev().GetShareStats();
+    TEST_ASSERT(all.size() == 2 && all[0].tag == "a" && all[1].tag == "b", "stats sorted by tag");
+    TEST_ASSERT(all[0].limits.bytes_per_sec == 4096 && all[1].limits.iops == 100,
+                "per-share limits");
+
+    uint64_t rate = 0;
+    TEST_ASSERT(ParseFsRate("64M", &rate) && rate == (64u << 20), "parse 64M");
+    TEST_ASSERT(ParseFsRate("500", &rate) && rate == 500, "parse 500");
+    TEST_ASSERT(!ParseFsRate("10x", &rate) && !ParseFsRate("", &rate), "reject junk");
+    return true;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Test 6: a driver reset with requests in flight on the worker pool
+// ══════════════════════════════════════════════════════════════════════
+// Goes through the MMIO transport with a request queue, so requests run on
+// the workers and the reset is the guest's Status=0 write. Page 0 of guest
+// RAM holds a pattern: a completion pushed after the rings were cleared
+// would land there.
+static bool TestResetWithRequestsInFlight() {
+    constexpr uint64_t kRingDesc  = 0x4000;
+    constexpr uint64_t kRingAvail = 0x5000;
+    constexpr uint64_t kRingUsed  = 0x6000;
+    constexpr uint32_t kRequests  = 4;
+    constexpr uint16_t kRingSize  = 16;  // two descriptors per request
+
+    TempDir dir;
+    TEST_ASSERT(!dir.path.empty(), "mkdtemp failed");
+    std::vector<uint8_t> ram(kRamSize);
+    memset(ram.data(), 0xA5, 0x1000);
+    GuestMemMap mem;
+    mem.base = ram.data();
+    mem.alloc_size = kRamSize;
+    mem.low_size = kRamSize;
+
+    // Declared first so the device (and its workers) goes before it.
+    VirtioMmioDevice mmio;
+    VirtioFsDevice dev("shared");
+    // One request per second: the first GETATTR runs, the rest are deferred.
+    TEST_ASSERT(dev.AddShare("s", dir.path, false, FsCachePolicy::kAuto, false, {1, 0}),
+                "AddShare");
+    mmio.Init(&dev, mem);
+    dev.SetMmioDevice(&mmio);
+    std::atomic<int> irqs{0};
+    mmio.SetIrqCallback([&] { irqs++; });
+
+    auto reg = [&](uint64_t offset, uint32_t value) { mmio.MmioWrite(offset, 4, value); };
+    reg(0x030, 1);              // QueueSel: first request queue
+    reg(0x038, kRingSize);      // QueueNum
+    reg(0x080, kRingDesc);      // QueueDescLow
+    reg(0x090, kRingAvail);     // QueueDriverLow
+    reg(0x0A0, kRingUsed);      // QueueDeviceLow
+    reg(0x044, 1);              // QueueReady
+    reg(0x070, 0xF);            // DRIVER_OK
+
+    auto* desc = reinterpret_cast<VirtqDesc*>(ram.data() + kRingDesc);
+    auto* avail = reinterpret_cast<VirtqAvail*>(ram.data() + kRingAvail);
+    auto* avail_ring = reinterpret_cast<uint16_t*>(avail + 1);
+    auto* used = reinterpret_cast<VirtqUsed*>(ram.data() + kRingUsed);
+    uint64_t unique = 0;
+    auto submit = [&](uint32_t opcode, uint64_t nodeid, const void* body, size_t len) {
+        const uint16_t slot = avail->idx % kRingSize;
+        const uint64_t in_gpa = kInGpa + slot * 0x1000;
+        const uint64_t out_gpa = kOutGpa + slot * 0x1000;
+        FuseInHeader hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.len = static_cast<uint32_t>(sizeof(hdr) + len);
+        hdr.opcode = opcode;
+        hdr.unique = ++unique;
+        hdr.nodeid = nodeid;
+        memcpy(ram.data() + in_gpa, &hdr, sizeof(hdr));
+        if (len) memcpy(ram.data() + in_gpa + sizeof(hdr), body, len);
+        desc[slot * 2] = {in_gpa, hdr.len, VIRTQ_DESC_F_NEXT, static_cast<uint16_t>(slot * 2 + 1)};
+        desc[slot * 2 + 1] = {out_gpa, 0x1000, VIRTQ_DESC_F_WRITE, 0};
+        avail_ring[slot] = static_cast<uint16_t>(slot * 2);
+        avail->idx++;
+        reg(0x050, 1);          // QueueNotify
+    };
+    auto wait_used = [&](uint16_t count) {
+        for (int i = 0; i < 200 && used->idx < count; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return used->idx >= count;
+    };
+
+    submit(FUSE_LOOKUP, kRootNodeId, "s", 2);
+    TEST_ASSERT(wait_used(1), "lookup completed");
+    FuseEntryOut entry;
+    memcpy(&entry, ram.data() + kOutGpa + sizeof(FuseOutHeader), sizeof(entry));
+    TEST_ASSERT(entry.nodeid != 0, "lookup share root");
+
+    for (uint32_t i = 0; i < kRequests; ++i) submit(FUSE_GETATTR, entry.nodeid, nullptr, 0);
+    TEST_ASSERT(wait_used(2), "first GETATTR completed");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    TEST_ASSERT(used->idx == 2, "the rest are throttled");
+
+    const int irqs_before_reset = irqs.load();
+    const auto reset_start = std::chrono::steady_clock::now();
+    reg(0x070, 0);              // Status: reset
+    const auto reset_time = std::chrono::steady_clock::now() - reset_start;
+    TEST_ASSERT(reset_time < std::chrono::milliseconds(500), "reset does not wait out throttling");
+
+    // Give dropped requests every chance to resurface.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    TEST_ASSERT(used->idx == 2, "no completions after the reset");
+    TEST_ASSERT(irqs.load() == irqs_before_reset, "no interrupts after the reset");
+    bool page0_intact = true;
+    for (size_t i = 0; i < 0x1000; ++i) page0_intact &= ram[i] == 0xA5;
+    TEST_ASSERT(page0_intact, "guest page 0 untouched");
+    return true;
+}
+
+int main() {
+    fprintf(stdout, "=== virtio-fs Unit Tests ===\n\n");
+
+    RunTest("Test 1: BATCH_FORGET",                 TestBatchForget);
+    RunTest("Test 2: FALLOCATE / LSEEK",            TestFallocateLseek);
+    RunTest("Test 3: COPY_FILE_RANGE",              TestCopyFileRange);
+    RunTest("Test 4: Writeback negotiation",        TestWritebackNegotiation);
+    RunTest("Test 5: Per-share I/O limits",         TestShareLimits);
+    RunTest("Test 6: Reset with requests in flight", TestResetWithRequestsInFlight);
+
+    fprintf(stdout, "\n=== Results: %d passed, %d failed ===\n",
+            g_pass, g_fail);
+    return g_fail;
+}